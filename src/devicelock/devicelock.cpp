@@ -20,6 +20,7 @@
 #include <MGConfItem>
 #include <QDebug>
 #include "devicelock.h"
+#include "systemstate.h"
 #include <sys/time.h>
 
 /* ------------------------------------------------------------------------- *
@@ -48,16 +49,14 @@ DeviceLock::DeviceLock(QObject * parent) :
     lockingGConfItem(new MGConfItem("/desktop/nemo/devicelock/automatic_locking", this)),
     lockTimer(new QTimer(this)),
     qmActivity(new MeeGo::QmActivity(this)),
-    qmLocks(new MeeGo::QmLocks(this)),
-    qmDisplayState(new MeeGo::QmDisplayState(this)),
     deviceLockState(Undefined)
 {
     monoTime.tv_sec = 0;
     connect(lockingGConfItem, SIGNAL(valueChanged()), this, SLOT(setStateAndSetupLockTimer()));
     connect(lockTimer, SIGNAL(timeout()), this, SLOT(lock()));
     connect(qmActivity, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)), this, SLOT(setStateAndSetupLockTimer()));
-    connect(qmLocks, SIGNAL(stateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), this, SLOT(setStateAndSetupLockTimer()));
-    connect(qmDisplayState, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), this, SLOT(checkDisplayState(MeeGo::QmDisplayState::DisplayState)));
+    connect(SystemState::instance(), SIGNAL(lockStateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), this, SLOT(setStateAndSetupLockTimer()));
+    connect(SystemState::instance(), SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), this, SLOT(checkDisplayState(MeeGo::QmDisplayState::DisplayState)));
 
     connect(qApp, SIGNAL(homeReady()), this, SLOT(init()));
 }
@@ -100,7 +99,7 @@ void DeviceLock::setStateAndSetupLockTimer()
 void DeviceLock::checkDisplayState(MeeGo::QmDisplayState::DisplayState state)
 {
     int lockingDelay = lockingGConfItem->value(-1).toInt();
-    if (lockingDelay == 0 && state == MeeGo::QmDisplayState::DisplayState::Off && qmLocks->getState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked) {
+    if (lockingDelay == 0 && state == MeeGo::QmDisplayState::DisplayState::Off && SystemState::instance()->lockState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked) {
         // Immediate locking enabled and the display is off: lock
         setState(Locked);
     } else if (state == MeeGo::QmDisplayState::DisplayState::Off) {
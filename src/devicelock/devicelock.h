@@ -64,8 +64,6 @@ private:
     MGConfItem *lockingGConfItem;
     QTimer *lockTimer;
     MeeGo::QmActivity *qmActivity;
-    MeeGo::QmLocks *qmLocks;
-    MeeGo::QmDisplayState *qmDisplayState;
     LockState deviceLockState;
     struct timeval monoTime;
 
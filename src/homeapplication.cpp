@@ -63,6 +63,7 @@ HomeApplication::HomeApplication(int &argc, char **argv, const QString &qmlPath)
     : QGuiApplication(argc, argv)
     , _mainWindowInstance(0)
     , _qmlPath(qmlPath)
+    , _asynchronousQmlCompilation(false)
     , originalSigIntHandler(signal(SIGINT, quitSignalHandler))
     , originalSigTermHandler(signal(SIGTERM, quitSignalHandler))
     , updatesEnabled(true)
@@ -84,7 +85,8 @@ HomeApplication::HomeApplication(int &argc, char **argv, const QString &qmlPath)
 
     // Initialize the notification manager
     NotificationManager::instance();
-    new NotificationFeedbackPlayer(new NotificationPreviewPresenter(this));
+    notificationPreviewPresenter = new NotificationPreviewPresenter(this);
+    new NotificationFeedbackPlayer(notificationPreviewPresenter);
 
     // Create screen lock logic - not parented to "this" since destruction happens too late in that case
     screenLock = new ScreenLock;
@@ -140,6 +142,7 @@ HomeApplication::HomeApplication(int &argc, char **argv, const QString &qmlPath)
     }
 
     connect(this, SIGNAL(homeReady()), this, SLOT(sendStartupNotifications()));
+    connect(this, SIGNAL(homeReady()), this, SLOT(prewarmWindows()));
 }
 
 HomeApplication::~HomeApplication()
@@ -191,6 +194,27 @@ void HomeApplication::sendStartupNotifications()
     systemBus.call(QDBusMessage::createSignal("/com/nokia/startup/signal", "com.nokia.startup.signal", "desktop_visible"), QDBus::NoBlock);
 }
 
+void HomeApplication::prewarmWindows()
+{
+    windowPrewarmQueue.clear();
+    windowPrewarmQueue << notificationPreviewPresenter << volumeControl << usbModeSelector << shutdownScreen;
+
+    // A zero timer fires only once the events already queued have been processed
+    QTimer::singleShot(0, this, SLOT(prewarmNextWindow()));
+}
+
+void HomeApplication::prewarmNextWindow()
+{
+    if (windowPrewarmQueue.isEmpty()) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(windowPrewarmQueue.takeFirst(), "createWindowIfNecessary");
+    if (!windowPrewarmQueue.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(prewarmNextWindow()));
+    }
+}
+
 bool HomeApplication::homeActive() const
 {
     LipstickCompositor *c = LipstickCompositor::instance();
@@ -266,6 +290,16 @@ void HomeApplication::setCompositorPath(const QString &path)
     }
 }
 
+bool HomeApplication::asynchronousQmlCompilation() const
+{
+    return _asynchronousQmlCompilation;
+}
+
+void HomeApplication::setAsynchronousQmlCompilation(bool asynchronous)
+{
+    _asynchronousQmlCompilation = asynchronous;
+}
+
 HomeWindow *HomeApplication::mainWindowInstance()
 {
     if (_mainWindowInstance)
@@ -25,6 +25,7 @@ class VolumeControl;
 class USBModeSelector;
 class ShutdownScreen;
 class ConnectionSelector;
+class NotificationPreviewPresenter;
 
 /*!
  * Extends QApplication with features necessary to create a desktop.
@@ -36,6 +37,7 @@ class LIPSTICK_EXPORT HomeApplication : public QGuiApplication
     HomeWindow *_mainWindowInstance;
     QString _qmlPath;
     QString _compositorPath;
+    bool _asynchronousQmlCompilation;
 
 public:
     /*!
@@ -85,6 +87,18 @@ public:
      */
     void setCompositorPath(const QString &path);
 
+    /*!
+     * Gets whether the QML components of the windows are compiled asynchronously.
+     */
+    bool asynchronousQmlCompilation() const;
+    /*!
+     * Sets whether the QML components of the windows are compiled
+     * asynchronously. An asynchronously compiled window doesn't block the
+     * user interface while it is being compiled but its contents appear only
+     * after the compilation has finished. Disabled by default.
+     */
+    void setAsynchronousQmlCompilation(bool asynchronous);
+
     /*!
      * Restores any installed signal handlers.
      */
@@ -139,6 +153,19 @@ private slots:
      */
     void connectFrameSwappedSignal(bool mainWindowVisible);
 
+    /*!
+     * Creates the notification preview, volume control, USB mode selector
+     * and shutdown screen windows ahead of time. The windows would otherwise
+     * be created when they are first shown, which would delay showing them
+     * until their QML has been compiled. The windows are created one at a
+     * time whenever the event loop has no other events to process so that
+     * input and rendering are not blocked for long.
+     */
+    void prewarmWindows();
+
+    //! Creates the next window to be created ahead of time and schedules the one after it
+    void prewarmNextWindow();
+
 private:
     friend class LipstickApi;
 
@@ -172,11 +199,17 @@ private:
     //! Login for showing the connection selector
     ConnectionSelector *connectionSelector;
 
+    //! Logic for showing notification previews
+    NotificationPreviewPresenter *notificationPreviewPresenter;
+
     //! Whether user interface updates should be enabled or not
     bool updatesEnabled;
 
     //! Whether the home ready signal has been sent or not
     bool homeReadySent;
+
+    //! Objects whose windows are still to be created ahead of time
+    QList<QObject *> windowPrewarmQueue;
 };
 
 #endif /* HOMEAPPLICATION_H_ */
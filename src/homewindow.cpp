@@ -16,6 +16,7 @@
 #include "homewindow.h"
 
 #include <QScreen>
+#include <QQmlComponent>
 #include <QQmlError>
 #include <QQuickView>
 #include <QQmlContext>
@@ -43,6 +44,7 @@ public:
     QQuickWindow *window;
     LipstickCompositorProcWindow *compositorWindow;
     QQmlContext *context;
+    QQmlComponent *component;
     QQuickItem *root;
     QList<QQmlError> errors;
 };
@@ -50,7 +52,7 @@ public:
 HomeWindowPrivate::Mode HomeWindowPrivate::mode = HomeWindowPrivate::Unknown;
 
 HomeWindowPrivate::HomeWindowPrivate()
-: isVisible(false), window(0), compositorWindow(0), context(0), root(0)
+: isVisible(false), window(0), compositorWindow(0), context(0), component(0), root(0)
 {
     checkMode();
     if (0 == HomeApplication::instance())
@@ -70,6 +72,7 @@ HomeWindowPrivate::HomeWindowPrivate()
 HomeWindowPrivate::~HomeWindowPrivate()
 {
     delete root;
+    delete component;
     delete context;
     if (isWindow()) delete window;
 }
@@ -174,9 +177,30 @@ void HomeWindow::setSource(const QUrl &source)
         d->root = 0;
     }
 
-    QQmlComponent component(d->context->engine(), source);
-    if (component.isError()) {
-        d->errors = component.errors();
+    // An asynchronously compiled component is instantiated once it has been compiled
+    delete d->component;
+    QQmlComponent::CompilationMode mode = HomeApplication::instance()->asynchronousQmlCompilation() ? QQmlComponent::Asynchronous : QQmlComponent::PreferSynchronous;
+    d->component = new QQmlComponent(d->context->engine(), source, mode);
+    if (d->component->isLoading()) {
+        connect(d->component, SIGNAL(statusChanged(QQmlComponent::Status)), this, SLOT(createRootObject()));
+    } else {
+        createRootObject();
+    }
+}
+
+void HomeWindow::createRootObject()
+{
+    QQmlComponent *component = d->component;
+    if (component == 0 || component->isLoading()) {
+        return;
+    }
+
+    // The component may be emitting a signal, so it must not be deleted right away
+    d->component = 0;
+    component->deleteLater();
+
+    if (component->isError()) {
+        d->errors = component->errors();
         foreach (const QQmlError &error, d->errors) {
             QMessageLogger(error.url().toString().toLatin1().constData(), error.line(), 0).warning()
                     << error;
@@ -184,7 +208,7 @@ void HomeWindow::setSource(const QUrl &source)
         return;
     }
 
-    QObject *o = component.create(d->context);
+    QObject *o = component->create(d->context);
     if (QQuickItem *item = qobject_cast<QQuickItem *>(o)) {
         d->root = item;
 
@@ -56,6 +56,9 @@ public:
 signals:
     void visibleChanged(bool arg);
 
+private slots:
+    void createRootObject();
+
 private:
     HomeWindowPrivate *d;
 };
@@ -0,0 +1,265 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <stdio.h>
+#include <string.h>
+#include "categorydefinitioncache.h"
+
+//! The identifier at the beginning of a cache file
+static const char CACHE_MAGIC[4] = { 'L', 'N', 'C', 'C' };
+
+//! The version of the cache file format
+static const quint32 CACHE_VERSION = 1;
+
+namespace {
+
+/*!
+ * The header of the cache file. It is followed by the category table,
+ * sorted by category name, the parameter table and the strings. Each
+ * string is stored as its length followed by its UTF-16 data and padded
+ * to a multiple of four bytes.
+ */
+struct Header {
+    char magic[4];
+    quint32 version;
+    qint64 sourceModified;
+    quint32 categoryCount;
+    quint32 parameterCount;
+};
+
+//! An entry of the category table
+struct CategoryEntry {
+    quint32 name;
+    quint32 firstParameter;
+    quint32 parameterCount;
+};
+
+//! An entry of the parameter table
+struct ParameterEntry {
+    quint32 key;
+    quint32 value;
+};
+
+}
+
+//! Appends a string to the cache file contents and returns its offset
+static quint32 appendString(QByteArray &contents, const QString &string)
+{
+    quint32 offset = contents.size();
+    quint32 length = string.length();
+    contents.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    contents.append(reinterpret_cast<const char *>(string.unicode()), length * sizeof(QChar));
+    while (contents.size() % sizeof(quint32) != 0) {
+        contents.append('\0');
+    }
+    return offset;
+}
+
+CategoryDefinitionCache::CategoryDefinitionCache(const QString &path) :
+    file(path),
+    data(0),
+    size(0)
+{
+}
+
+CategoryDefinitionCache::~CategoryDefinitionCache()
+{
+    close();
+}
+
+bool CategoryDefinitionCache::open(qint64 sourceModified)
+{
+    close();
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    size = file.size();
+    if (size >= (qint64)sizeof(Header)) {
+        data = file.map(0, size);
+    }
+    if (data == 0) {
+        close();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->version != CACHE_VERSION || header->sourceModified != sourceModified ||
+            (qint64)sizeof(Header) + (qint64)header->categoryCount * sizeof(CategoryEntry) + (qint64)header->parameterCount * sizeof(ParameterEntry) > size) {
+        close();
+        return false;
+    }
+
+    // Make sure that no category refers to parameters outside the parameter table
+    const CategoryEntry *categories = reinterpret_cast<const CategoryEntry *>(data + sizeof(Header));
+    for (quint32 i = 0; i < header->categoryCount; i++) {
+        if ((qint64)categories[i].firstParameter + categories[i].parameterCount > header->parameterCount) {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CategoryDefinitionCache::close()
+{
+    if (data != 0) {
+        file.unmap(const_cast<uchar *>(data));
+        data = 0;
+    }
+    size = 0;
+    file.close();
+}
+
+bool CategoryDefinitionCache::isOpen() const
+{
+    return data != 0;
+}
+
+bool CategoryDefinitionCache::write(const QHash<QString, Parameters> &definitions, qint64 sourceModified)
+{
+    close();
+
+    QStringList categoryNames = definitions.keys();
+    qSort(categoryNames);
+
+    QList<CategoryEntry> categories;
+    QList<ParameterEntry> parameters;
+    QByteArray contents;
+    int stringsOffset = sizeof(Header) + categoryNames.count() * sizeof(CategoryEntry);
+    foreach (const Parameters &categoryParameters, definitions) {
+        stringsOffset += categoryParameters.count() * sizeof(ParameterEntry);
+    }
+
+    // Reserve space for the tables and append the strings they refer to
+    contents.fill('\0', stringsOffset);
+    foreach (const QString &categoryName, categoryNames) {
+        const Parameters categoryParameters = definitions.value(categoryName);
+        CategoryEntry category;
+        category.name = appendString(contents, categoryName);
+        category.firstParameter = parameters.count();
+        category.parameterCount = categoryParameters.count();
+        categories.append(category);
+
+        for (Parameters::const_iterator parameter = categoryParameters.constBegin(); parameter != categoryParameters.constEnd(); ++parameter) {
+            ParameterEntry entry;
+            entry.key = appendString(contents, parameter->first);
+            entry.value = appendString(contents, parameter->second);
+            parameters.append(entry);
+        }
+    }
+
+    Header header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.sourceModified = sourceModified;
+    header.categoryCount = categories.count();
+    header.parameterCount = parameters.count();
+
+    char *table = contents.data();
+    memcpy(table, &header, sizeof(header));
+    table += sizeof(header);
+    foreach (const CategoryEntry &category, categories) {
+        memcpy(table, &category, sizeof(category));
+        table += sizeof(category);
+    }
+    foreach (const ParameterEntry &parameter, parameters) {
+        memcpy(table, &parameter, sizeof(parameter));
+        table += sizeof(parameter);
+    }
+
+    // Write a temporary file first and replace the cache with it so that a partially written cache is never read
+    QString path = file.fileName();
+    QString temporaryPath = path + ".tmp";
+    QDir::root().mkpath(QFileInfo(path).path());
+    QFile temporaryFile(temporaryPath);
+    if (!temporaryFile.open(QIODevice::WriteOnly) || temporaryFile.write(contents) != contents.size()) {
+        temporaryFile.remove();
+        return false;
+    }
+    temporaryFile.close();
+    if (::rename(QFile::encodeName(temporaryPath).constData(), QFile::encodeName(path).constData()) != 0) {
+        QFile::remove(temporaryPath);
+        return false;
+    }
+
+    return true;
+}
+
+bool CategoryDefinitionCache::contains(const QString &category) const
+{
+    return find(category) >= 0;
+}
+
+CategoryDefinitionCache::Parameters CategoryDefinitionCache::parameters(const QString &category) const
+{
+    Parameters parameters;
+    int index = find(category);
+    if (index >= 0) {
+        const Header *header = reinterpret_cast<const Header *>(data);
+        const CategoryEntry &entry = reinterpret_cast<const CategoryEntry *>(data + sizeof(Header))[index];
+        const ParameterEntry *parameterTable = reinterpret_cast<const ParameterEntry *>(data + sizeof(Header) + header->categoryCount * sizeof(CategoryEntry));
+        for (quint32 i = entry.firstParameter; i < entry.firstParameter + entry.parameterCount; i++) {
+            // The mapped strings are copied since the cache may be unmapped while the parameters are still in use
+            QString key = string(parameterTable[i].key);
+            QString value = string(parameterTable[i].value);
+            parameters.append(qMakePair(QString(key.unicode(), key.length()), QString(value.unicode(), value.length())));
+        }
+    }
+    return parameters;
+}
+
+int CategoryDefinitionCache::find(const QString &category) const
+{
+    if (data == 0) {
+        return -1;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    const CategoryEntry *categories = reinterpret_cast<const CategoryEntry *>(data + sizeof(Header));
+    int low = 0;
+    int high = header->categoryCount - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int comparison = QString::compare(string(categories[middle].name), category);
+        if (comparison < 0) {
+            low = middle + 1;
+        } else if (comparison > 0) {
+            high = middle - 1;
+        } else {
+            return middle;
+        }
+    }
+    return -1;
+}
+
+QString CategoryDefinitionCache::string(quint32 offset) const
+{
+    if (offset % sizeof(quint32) != 0 || (qint64)offset + (qint64)sizeof(quint32) > size) {
+        return QString();
+    }
+
+    quint32 length = *reinterpret_cast<const quint32 *>(data + offset);
+    if ((qint64)offset + (qint64)sizeof(quint32) + (qint64)length * sizeof(QChar) > size) {
+        return QString();
+    }
+
+    return QString::fromRawData(reinterpret_cast<const QChar *>(data + offset + sizeof(quint32)), length);
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef CATEGORYDEFINITIONCACHE_H
+#define CATEGORYDEFINITIONCACHE_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+/*!
+ * \class CategoryDefinitionCache
+ *
+ * \brief A precompiled binary cache of all notification category definitions.
+ *
+ * Parsing the category definition files is relatively expensive, so the
+ * parsed definitions are written to a single binary file which is memory
+ * mapped when it is opened. Looking up a category is a binary search in the
+ * mapped category table and reading its parameters does not touch the
+ * category definition files at all.
+ *
+ * The cache records the modification time of the category definition
+ * directory it was built from and is considered stale when the directory
+ * has been modified since. The file is in the native byte order and is
+ * only meant to be read on the device which wrote it.
+ */
+class CategoryDefinitionCache
+{
+public:
+    //! The parameters of a category definition as a flat list of key/value pairs
+    typedef QList<QPair<QString, QString> > Parameters;
+
+    /*!
+     * Creates a category definition cache. The cache file is not read
+     * before open() is called.
+     *
+     * \param path the path of the cache file
+     */
+    explicit CategoryDefinitionCache(const QString &path);
+
+    //! Unmaps the cache file.
+    ~CategoryDefinitionCache();
+
+    /*!
+     * Maps the cache file into memory. Fails if the cache file doesn't
+     * exist, is not valid or was built from a different version of the
+     * category definitions.
+     *
+     * \param sourceModified the modification time of the category definition directory in milliseconds since the epoch
+     * \return \c true if the cache file is valid and up to date, \c false otherwise
+     */
+    bool open(qint64 sourceModified);
+
+    //! Unmaps the cache file.
+    void close();
+
+    //! Returns whether the cache file is currently mapped
+    bool isOpen() const;
+
+    /*!
+     * Replaces the cache file with one holding the given category
+     * definitions. The file is written to a temporary file first so that a
+     * partially written cache is never read. Closes the cache; open() must
+     * be called to read the new cache file.
+     *
+     * \param definitions the parameters of each category definition by category
+     * \param sourceModified the modification time of the category definition directory in milliseconds since the epoch
+     * \return \c true if the cache file was written, \c false otherwise
+     */
+    bool write(const QHash<QString, Parameters> &definitions, qint64 sourceModified);
+
+    /*!
+     * Checks whether the cache has a definition for a category.
+     *
+     * \param category the category
+     * \return \c true if the category is defined, \c false otherwise
+     */
+    bool contains(const QString &category) const;
+
+    /*!
+     * Returns the parameters of a category definition.
+     *
+     * \param category the category
+     * \return the parameters of the category or an empty list if the category is not defined
+     */
+    Parameters parameters(const QString &category) const;
+
+private:
+    //! Returns the index of a category in the category table or -1 if it is not found
+    int find(const QString &category) const;
+
+    //! Returns a string stored in the mapped file without copying its data
+    QString string(quint32 offset) const;
+
+    //! The cache file
+    QFile file;
+
+    //! The mapped contents of the cache file or null if the file is not mapped
+    const uchar *data;
+
+    //! The size of the mapped contents
+    qint64 size;
+};
+
+#endif // CATEGORYDEFINITIONCACHE_H
@@ -15,8 +15,14 @@
 ****************************************************************************/
 
 #include "categorydefinitionstore.h"
+#include "notificationstringpool.h"
 #include <QFileInfo>
+#include <QDateTime>
 #include <QDir>
+#include <QSettings>
+#include <QSocketNotifier>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 //! The file extension for the category definition files
 static const char *FILE_EXTENSION = ".conf";
@@ -24,92 +30,167 @@ static const char *FILE_EXTENSION = ".conf";
 //! The maximum size of the category definition file
 static const uint FILE_MAX_SIZE = 32768;
 
+//! The time to wait for further changes in the category definition directory before applying the changes, in milliseconds
+static const int CHANGE_DEBOUNCE_INTERVAL = 500;
+
 CategoryDefinitionStore::CategoryDefinitionStore(const QString &categoryDefinitionsPath, uint maxStoredCategoryDefinitions, QObject *parent) :
     QObject(parent),
     categoryDefinitionsPath(categoryDefinitionsPath),
-    maxStoredCategoryDefinitions(maxStoredCategoryDefinitions)
+    maxStoredCategoryDefinitions_(qMax(maxStoredCategoryDefinitions, 1u)),
+    mostRecentlyUsedDefinition(0),
+    leastRecentlyUsedDefinition(0),
+    hitCount_(0),
+    missCount_(0),
+    inotifyDescriptor(-1)
 {
     if (!this->categoryDefinitionsPath.endsWith('/')) {
         this->categoryDefinitionsPath.append('/');
     }
 
-    // Watch for changes in category definition files
-    categoryDefinitionPathWatcher.addPath(this->categoryDefinitionsPath);
-    connect(&categoryDefinitionPathWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(updateCategoryDefinitionFileList()));
-    connect(&categoryDefinitionPathWatcher, SIGNAL(fileChanged(QString)), this, SLOT(updateCategoryDefinitionFile(QString)));
-    updateCategoryDefinitionFileList();
+    // Watch for changes in the category definition directory; a single watch covers all files in it
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyDescriptor >= 0) {
+        if (inotify_add_watch(inotifyDescriptor, QFile::encodeName(this->categoryDefinitionsPath).constData(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) >= 0) {
+            QSocketNotifier *notifier = new QSocketNotifier(inotifyDescriptor, QSocketNotifier::Read, this);
+            connect(notifier, SIGNAL(activated(int)), this, SLOT(readFileSystemEvents()));
+        } else {
+            ::close(inotifyDescriptor);
+            inotifyDescriptor = -1;
+        }
+    }
+
+    // Apply the changes once the directory has not changed for a while so that package upgrades are handled in one go
+    changeTimer.setSingleShot(true);
+    changeTimer.setInterval(CHANGE_DEBOUNCE_INTERVAL);
+    connect(&changeTimer, SIGNAL(timeout()), this, SLOT(applyCategoryDefinitionChanges()));
+
+    categoryDefinitionFiles = listCategoryDefinitionFiles();
 }
 
-void CategoryDefinitionStore::updateCategoryDefinitionFileList()
+CategoryDefinitionStore::~CategoryDefinitionStore()
 {
-    QDir categoryDefinitionsDir(categoryDefinitionsPath);
+    if (inotifyDescriptor >= 0) {
+        ::close(inotifyDescriptor);
+    }
+    qDeleteAll(categoryDefinitions);
+}
+
+void CategoryDefinitionStore::setMaxStoredCategoryDefinitions(uint maxStoredCategoryDefinitions)
+{
+    maxStoredCategoryDefinitions_ = qMax(maxStoredCategoryDefinitions, 1u);
+    removeExtraDefinitions();
+}
 
-    if(categoryDefinitionsDir.exists()) {
-        QStringList filter("*" + QString(FILE_EXTENSION));
+uint CategoryDefinitionStore::maxStoredCategoryDefinitions() const
+{
+    return maxStoredCategoryDefinitions_;
+}
 
-        QSet<QString> files = categoryDefinitionsDir.entryList(filter, QDir::Files).toSet();
-        QSet<QString> removedFiles = categoryDefinitionFiles - files;
+quint64 CategoryDefinitionStore::hitCount() const
+{
+    return hitCount_;
+}
 
-        foreach(const QString &removedCategory, removedFiles) {
-            QString category = QFileInfo(removedCategory).completeBaseName();
-            QString categoryDefinitionPath = categoryDefinitionsPath + removedCategory;
-            categoryDefinitionPathWatcher.removePath(categoryDefinitionPath);
-            categoryDefinitions.remove(category);
-            emit categoryDefinitionUninstalled(category);
-        }
+quint64 CategoryDefinitionStore::missCount() const
+{
+    return missCount_;
+}
 
-        categoryDefinitionFiles = files;
+void CategoryDefinitionStore::setCachePath(const QString &cachePath)
+{
+    cache.reset(new CategoryDefinitionCache(cachePath));
+    updateCache();
+}
 
-        // Add category definition files to watcher
-        foreach(QString file, categoryDefinitionFiles){
-            QString categoryDefinitionFilePath = categoryDefinitionsPath + file;
-            if (!categoryDefinitionPathWatcher.files().contains(categoryDefinitionFilePath)) {
-                categoryDefinitionPathWatcher.addPath(categoryDefinitionFilePath);
-            }
-        }
+QSet<QString> CategoryDefinitionStore::listCategoryDefinitionFiles() const
+{
+    QDir categoryDefinitionsDir(categoryDefinitionsPath);
+    if (!categoryDefinitionsDir.exists()) {
+        return QSet<QString>();
     }
+
+    QStringList filter("*" + QString(FILE_EXTENSION));
+    return categoryDefinitionsDir.entryList(filter, QDir::Files).toSet();
 }
 
-void CategoryDefinitionStore::updateCategoryDefinitionFile(const QString &path)
+void CategoryDefinitionStore::readFileSystemEvents()
 {
-    QFileInfo fileInfo(path);
-    if (fileInfo.exists()) {
-       QString category = fileInfo.completeBaseName();
-       loadSettings(category);
-       emit categoryDefinitionModified(category);
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = ::read(inotifyDescriptor, buffer, sizeof(buffer))) > 0) {
+        for (char *event = buffer; event < buffer + length; event += sizeof(struct inotify_event) + reinterpret_cast<struct inotify_event *>(event)->len) {
+            const struct inotify_event *inotifyEvent = reinterpret_cast<struct inotify_event *>(event);
+            if (inotifyEvent->mask & IN_Q_OVERFLOW) {
+                // Events have been lost so consider every category definition changed
+                changedFiles.unite(categoryDefinitionFiles);
+                changedFiles.unite(listCategoryDefinitionFiles());
+                continue;
+            }
+
+            QString file = inotifyEvent->len > 0 ? QFile::decodeName(inotifyEvent->name) : QString();
+            if (file.endsWith(FILE_EXTENSION)) {
+                changedFiles.insert(file);
+            }
+        }
+    }
+
+    if (!changedFiles.isEmpty()) {
+        changeTimer.start();
     }
 }
 
-bool CategoryDefinitionStore::categoryDefinitionExists(const QString &category)
+void CategoryDefinitionStore::applyCategoryDefinitionChanges()
 {
-    bool categoryFound = false;
+    QSet<QString> files = listCategoryDefinitionFiles();
+    QSet<QString> removedFiles = categoryDefinitionFiles - files;
+    QSet<QString> modifiedFiles = changedFiles & files;
+    categoryDefinitionFiles = files;
+    changedFiles.clear();
 
-    if (!categoryDefinitions.contains(category)) {
-        // If the category definition has not been loaded yet load it
-        loadSettings(category);
+    // Rebuild the cache once for all changes before reloading anything from it
+    updateCache(true);
+
+    QStringList uninstalledCategories;
+    foreach (const QString &file, removedFiles) {
+        QString category = QFileInfo(file).completeBaseName();
+        removeDefinition(category);
+        uninstalledCategories.append(category);
+    }
+
+    QStringList modifiedCategories;
+    foreach (const QString &file, modifiedFiles) {
+        QString category = QFileInfo(file).completeBaseName();
+        if (categoryDefinitions.contains(category)) {
+            loadSettings(category);
+        }
+        modifiedCategories.append(category);
     }
 
-    if (categoryDefinitions.contains(category)) {
-        categoryDefinitionAccessed(category);
-        categoryFound = true;
+    if (!modifiedCategories.isEmpty() || !uninstalledCategories.isEmpty()) {
+        emit categoryDefinitionsChanged(modifiedCategories, uninstalledCategories);
     }
+}
 
-    return categoryFound;
+bool CategoryDefinitionStore::categoryDefinitionExists(const QString &category)
+{
+    return loadedDefinition(category) != 0;
 }
 
 QList<QString> CategoryDefinitionStore::allKeys(const QString &category)
 {
-    if (categoryDefinitionExists(category)) {
-        return categoryDefinitions.value(category)->allKeys();
+    QList<QString> keys;
+    foreach (const Parameter &parameter, parameters(category)) {
+        keys.append(parameter.first);
     }
-
-    return QList<QString>();
+    return keys;
 }
 
 bool CategoryDefinitionStore::contains(const QString &category, const QString &key)
 {
-    if (categoryDefinitionExists(category)) {
-        return categoryDefinitions.value(category)->contains(key);
+    foreach (const Parameter &parameter, parameters(category)) {
+        if (parameter.first == key) {
+            return true;
+        }
     }
 
     return false;
@@ -117,32 +198,165 @@ bool CategoryDefinitionStore::contains(const QString &category, const QString &k
 
 QString CategoryDefinitionStore::value(const QString &category, const QString &key)
 {
-    if (contains(category, key)) {
-        return categoryDefinitions.value(category)->value(key).toString();
+    foreach (const Parameter &parameter, parameters(category)) {
+        if (parameter.first == key) {
+            return parameter.second;
+        }
     }
 
     return QString();
 }
 
+CategoryDefinitionStore::Parameters CategoryDefinitionStore::parameters(const QString &category)
+{
+    LoadedDefinition *definition = loadedDefinition(category);
+    return definition != 0 ? definition->parameters : Parameters();
+}
+
+CategoryDefinitionStore::LoadedDefinition *CategoryDefinitionStore::loadedDefinition(const QString &category)
+{
+    LoadedDefinition *definition = categoryDefinitions.value(category);
+    if (definition != 0) {
+        hitCount_++;
+
+        // Mark the category definition as recently used by moving it to the beginning of the usage list
+        if (definition != mostRecentlyUsedDefinition) {
+            unlinkDefinition(definition);
+            linkDefinition(definition);
+        }
+    } else {
+        missCount_++;
+
+        // If the category definition has not been loaded yet load it
+        loadSettings(category);
+        definition = categoryDefinitions.value(category);
+    }
+
+    return definition;
+}
+
 void CategoryDefinitionStore::loadSettings(const QString &category)
+{
+    Parameters parameters;
+    if (cache != 0 && cache->isOpen()) {
+        // The cache contains all valid category definitions
+        if (!cache->contains(category)) {
+            return;
+        }
+        parameters = cache->parameters(category);
+    } else if (!readCategoryDefinitionFile(category, parameters)) {
+        return;
+    }
+
+    // The keys end up in the hints of the notifications so share them with the other hint keys
+    for (Parameters::iterator parameter = parameters.begin(); parameter != parameters.end(); ++parameter) {
+        parameter->first = NotificationStringPool::intern(parameter->first);
+    }
+    storeDefinition(category, parameters);
+}
+
+bool CategoryDefinitionStore::readCategoryDefinitionFile(const QString &category, Parameters &parameters) const
 {
     QFileInfo file(QString(categoryDefinitionsPath).append(category).append(FILE_EXTENSION));
     if (file.exists() && file.size() != 0 && file.size() <= FILE_MAX_SIZE) {
-        QSharedPointer<QSettings> categoryDefinitionSettings(new QSettings(file.filePath(), QSettings::IniFormat));
-        if (categoryDefinitionSettings->status() == QSettings::NoError) {
-            categoryDefinitions.insert(category, categoryDefinitionSettings);
+        QSettings categoryDefinitionSettings(file.filePath(), QSettings::IniFormat);
+        if (categoryDefinitionSettings.status() == QSettings::NoError) {
+            parameters.clear();
+            foreach (const QString &key, categoryDefinitionSettings.allKeys()) {
+                parameters.append(qMakePair(key, categoryDefinitionSettings.value(key).toString()));
+            }
+            return true;
         }
     }
+
+    return false;
 }
 
-void CategoryDefinitionStore::categoryDefinitionAccessed(const QString &category)
+void CategoryDefinitionStore::updateCache(bool rebuild)
 {
-    // Mark the category definition as recently used by moving it to the beginning of the usage list
-    categoryDefinitionUsage.removeAll(category);
-    categoryDefinitionUsage.insert(0, category);
+    if (cache == 0) {
+        return;
+    }
+
+    QDateTime directoryModified = QFileInfo(categoryDefinitionsPath).lastModified();
+    qint64 sourceModified = directoryModified.isValid() ? directoryModified.toMSecsSinceEpoch() : 0;
+    if (!rebuild && cache->open(sourceModified)) {
+        return;
+    }
+
+    // Parse all category definition files and write them to the cache
+    QHash<QString, Parameters> definitions;
+    foreach (const QString &file, categoryDefinitionFiles) {
+        QString category = QFileInfo(file).completeBaseName();
+        Parameters parameters;
+        if (readCategoryDefinitionFile(category, parameters)) {
+            definitions.insert(category, parameters);
+        }
+    }
+    // If the cache can't be written the definitions are read from the files instead
+    if (cache->write(definitions, sourceModified)) {
+        cache->open(sourceModified);
+    }
+}
+
+void CategoryDefinitionStore::storeDefinition(const QString &category, const Parameters &parameters)
+{
+    LoadedDefinition *definition = categoryDefinitions.value(category);
+    if (definition != 0) {
+        definition->parameters = parameters;
+        return;
+    }
+
+    definition = new LoadedDefinition;
+    definition->category = NotificationStringPool::intern(category);
+    definition->parameters = parameters;
+    categoryDefinitions.insert(definition->category, definition);
+    linkDefinition(definition);
 
     // If there are too many category definitions in memory get rid of the extra ones
-    while (categoryDefinitionUsage.count() > (int)maxStoredCategoryDefinitions) {
-        categoryDefinitions.remove(categoryDefinitionUsage.takeLast());
+    removeExtraDefinitions();
+}
+
+void CategoryDefinitionStore::removeDefinition(const QString &category)
+{
+    LoadedDefinition *definition = categoryDefinitions.take(category);
+    if (definition != 0) {
+        unlinkDefinition(definition);
+        delete definition;
+    }
+}
+
+void CategoryDefinitionStore::linkDefinition(LoadedDefinition *definition)
+{
+    definition->previous = 0;
+    definition->next = mostRecentlyUsedDefinition;
+    if (mostRecentlyUsedDefinition != 0) {
+        mostRecentlyUsedDefinition->previous = definition;
+    } else {
+        leastRecentlyUsedDefinition = definition;
+    }
+    mostRecentlyUsedDefinition = definition;
+}
+
+void CategoryDefinitionStore::unlinkDefinition(LoadedDefinition *definition)
+{
+    if (definition->previous != 0) {
+        definition->previous->next = definition->next;
+    } else {
+        mostRecentlyUsedDefinition = definition->next;
+    }
+    if (definition->next != 0) {
+        definition->next->previous = definition->previous;
+    } else {
+        leastRecentlyUsedDefinition = definition->previous;
+    }
+    definition->previous = 0;
+    definition->next = 0;
+}
+
+void CategoryDefinitionStore::removeExtraDefinitions()
+{
+    while ((uint)categoryDefinitions.count() > maxStoredCategoryDefinitions_) {
+        removeDefinition(leastRecentlyUsedDefinition->category);
     }
 }
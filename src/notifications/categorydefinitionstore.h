@@ -18,12 +18,12 @@
 #define CATEGORYDEFINITIONSTORE_H_
 
 #include <QString>
-#include <QMap>
+#include <QHash>
+#include <QScopedPointer>
 #include <QSet>
-#include <QSettings>
-#include <QSharedPointer>
 #include <QStringList>
-#include <QFileSystemWatcher>
+#include <QTimer>
+#include "categorydefinitioncache.h"
 
 /*!
  * A class that represents a notification category store. The category
@@ -32,13 +32,33 @@
  * The category store will limit the number of configuration
  * files it will read. The rationale is to constrain memory usage and startup
  * time in case a huge number of category definitions are defined by a misbehaving
- * package.
+ * package. The least recently used category definition is dropped from
+ * memory when the limit is reached. Looking up a category definition and
+ * marking it used take constant time.
+ *
+ * Each category definition is parsed into a flat list of key/value pairs
+ * when it is loaded. If a cache path has been set the parsed definitions
+ * of all categories are also kept in a CategoryDefinitionCache, which is
+ * rebuilt whenever the modification time of the category definition
+ * directory changes. Loading a category definition from the cache does not
+ * parse the category definition file.
+ *
+ * The category definition directory is watched using a single inotify
+ * watch. Changes are applied once the directory has not changed for a
+ * moment, so that installing or upgrading a package with many category
+ * definitions results in a single categoryDefinitionsChanged() signal.
  */
 class CategoryDefinitionStore : public QObject
 {
     Q_OBJECT
 
 public:
+    //! A key/value pair of a category definition
+    typedef QPair<QString, QString> Parameter;
+
+    //! The parameters of a category definition as a flat list of key/value pairs
+    typedef CategoryDefinitionCache::Parameters Parameters;
+
     /*!
      * Creates a notification category definitions store.
      *
@@ -47,6 +67,37 @@ public:
      */
     explicit CategoryDefinitionStore(const QString &categoryDefinitionsPath, uint maxStoredCategoryDefinitions = 100, QObject *parent = 0);
 
+    //! Destroys the category definitions kept in memory.
+    virtual ~CategoryDefinitionStore();
+
+    /*!
+     * Sets the maximum number of category definitions to keep in memory.
+     * The least recently used category definitions are dropped right away
+     * if there are more category definitions in memory. At least one
+     * category definition is always kept.
+     *
+     * \param maxStoredCategoryDefinitions the maximum number of category definitions to keep in memory
+     */
+    void setMaxStoredCategoryDefinitions(uint maxStoredCategoryDefinitions);
+
+    //! Returns the maximum number of category definitions to keep in memory
+    uint maxStoredCategoryDefinitions() const;
+
+    //! Returns the number of category definition lookups which found the category definition in memory
+    quint64 hitCount() const;
+
+    //! Returns the number of category definition lookups which had to load the category definition
+    quint64 missCount() const;
+
+    /*!
+     * Sets the path of the precompiled cache of the category definitions.
+     * The cache is opened right away and rebuilt if it is missing or out
+     * of date.
+     *
+     * \param cachePath the path of the cache file
+     */
+    void setCachePath(const QString &cachePath);
+
     /*!
      * Tests if the \a category definition exists in the system.
      * Loads the category definition if it exists.
@@ -90,57 +141,133 @@ public:
      */
     QString value(const QString &category, const QString &key);
 
-private slots:
-    //! Updates the list of available category definition files
-    void updateCategoryDefinitionFileList();
-
     /*!
-     * Updates the category definition represented in the given file
+     * Returns all parameters of the definition for \a category as a flat
+     * list of key/value pairs. If the category doesn't exist, an empty list
+     * is returned.
      *
-     * Only updates the category definition if the file is modified. Removing an category definition file is handled
-     * by updateCategoryDefinitionFileList() slot
+     * \param category the category.
+     * \return the parameters of the category.
+     * \sa categoryDefinitionExists, allKeys, value
      */
-    void updateCategoryDefinitionFile(const QString &path);
+    Parameters parameters(const QString &category);
+
+private slots:
+    //! Reads the pending file system events of the category definition directory and schedules applying the changes
+    void readFileSystemEvents();
 
-signals:
     /*!
-     * A signal sent whenever an category definition has been modified
-     *
-     * \param category the category definition that was modified
+     * Applies the changes made to the category definition directory since
+     * the previous call. The list of available category definition files
+     * is updated, the cache is rebuilt and the modified category
+     * definitions are reloaded, after which all changes are signaled at
+     * once using categoryDefinitionsChanged().
      */
-    void categoryDefinitionModified(const QString &category);
+    void applyCategoryDefinitionChanges();
 
+signals:
     /*!
-     * A signal sent whenever an category definition has been uninstalled
+     * A signal sent when category definitions have been installed,
+     * modified or uninstalled. Changes made in quick succession, such as
+     * during a package upgrade, are collected into a single signal.
      *
-     * \param category the category definition that was removed
+     * \param modifiedCategories the category definitions that were installed or modified
+     * \param uninstalledCategories the category definitions that were removed
      */
-    void categoryDefinitionUninstalled(const QString &category);
+    void categoryDefinitionsChanged(const QStringList &modifiedCategories, const QStringList &uninstalledCategories);
 
 private:
     //! The path where the category definition files are stored
     QString categoryDefinitionsPath;
 
+    //! A category definition kept in memory, linked into the list of category definitions in the order of use
+    struct LoadedDefinition {
+        QString category;
+        Parameters parameters;
+        LoadedDefinition *previous;
+        LoadedDefinition *next;
+    };
+
     //! The maximum number of category definitions to keep in memory
-    uint maxStoredCategoryDefinitions;
+    uint maxStoredCategoryDefinitions_;
+
+    //! The category definitions kept in memory by category
+    QHash<QString, LoadedDefinition *> categoryDefinitions;
+
+    //! The most recently used category definition or null if no category definitions are in memory
+    LoadedDefinition *mostRecentlyUsedDefinition;
 
-    //! Map for storing category definitions and corresponding QSettings object
-    mutable QMap<QString, QSharedPointer<QSettings> > categoryDefinitions;
+    //! The least recently used category definition or null if no category definitions are in memory
+    LoadedDefinition *leastRecentlyUsedDefinition;
 
-    //! List for keeping track of which category definitions have been most recently used
-    mutable QStringList categoryDefinitionUsage;
+    //! The number of lookups which found the category definition in memory
+    quint64 hitCount_;
+
+    //! The number of lookups which had to load the category definition
+    quint64 missCount_;
+
+    /*!
+     * Returns the definition of a category, loading it if it is not in
+     * memory yet, and marks it as the most recently used one.
+     *
+     * \param category the category
+     * \return the category definition or null if the category doesn't exist
+     */
+    LoadedDefinition *loadedDefinition(const QString &category);
 
     //! Load the data into our internal map
     void loadSettings(const QString &category);
 
-    //! Marks the category to be used recently
-    void categoryDefinitionAccessed(const QString &category);
+    //! Replaces the parameters of a category definition in memory or adds the category definition as the most recently used one
+    void storeDefinition(const QString &category, const Parameters &parameters);
+
+    //! Drops a category definition from memory
+    void removeDefinition(const QString &category);
+
+    //! Adds a category definition to the beginning of the list of category definitions in the order of use
+    void linkDefinition(LoadedDefinition *definition);
+
+    //! Removes a category definition from the list of category definitions in the order of use
+    void unlinkDefinition(LoadedDefinition *definition);
+
+    //! Drops the least recently used category definitions while there are too many category definitions in memory
+    void removeExtraDefinitions();
 
-    //! File system watcher to notice changes in installed category definitions
-    QFileSystemWatcher categoryDefinitionPathWatcher;
+    /*!
+     * Parses a category definition file.
+     *
+     * \param category the category whose definition file to parse
+     * \param parameters the parameters read from the file
+     * \return \c true if the file was parsed, \c false if it doesn't exist or is not valid
+     */
+    bool readCategoryDefinitionFile(const QString &category, Parameters &parameters) const;
+
+    /*!
+     * Opens the cache and rebuilds it from the category definition files
+     * if it is missing or was built from an older version of the category
+     * definition directory.
+     *
+     * \param rebuild whether to rebuild the cache even if it is up to date
+     */
+    void updateCache(bool rebuild = false);
+
+    //! Returns the names of the category definition files in the category definition directory
+    QSet<QString> listCategoryDefinitionFiles() const;
+
+    //! The inotify instance watching the category definition directory or -1 if the directory is not watched
+    int inotifyDescriptor;
+
+    //! Timer for applying the changes once the category definition directory has stopped changing
+    QTimer changeTimer;
+
+    //! The category definition files changed since the changes were last applied
+    QSet<QString> changedFiles;
 
     //! List of available category definition files
     QSet<QString> categoryDefinitionFiles;
+
+    //! Precompiled cache of all category definitions or null if no cache is used
+    QScopedPointer<CategoryDefinitionCache> cache;
 };
 
 #endif /* CATEGORYDEFINITIONSTORE_H_ */
@@ -72,9 +72,9 @@ void DiskSpaceNotifier::handleDiskSpaceChange(const QString &path, int percentag
 void DiskSpaceNotifier::removeDiskSpaceNotifications()
 {
     NotificationManager *manager = NotificationManager::instance();
-    foreach (uint id, manager->notificationIds()) {
-        LipstickNotification *notification = NotificationManager::instance()->notification(id);
-        if (notification->appName() == qApp->applicationName() && notification->category() == "x-nemo.system.diskspace") {
+    foreach (uint id, manager->notificationIdsForCategory("x-nemo.system.diskspace")) {
+        LipstickNotification *notification = manager->notification(id);
+        if (notification->appName() == qApp->applicationName()) {
             manager->CloseNotification(id);
         }
     }
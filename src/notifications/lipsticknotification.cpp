@@ -26,6 +26,7 @@ LipstickNotification::LipstickNotification(const QString &appName, uint replaces
     body_(body),
     actions_(actions),
     hints_(hints),
+    hintValues_(decodeHints(hints)),
     expireTimeout_(expireTimeout)
 {
 }
@@ -37,6 +38,20 @@ LipstickNotification::LipstickNotification(QObject *parent) :
 {
 }
 
+LipstickNotification::LipstickNotification(const NotificationData &data, QObject *parent) :
+    QObject(parent),
+    appName_(data.appName),
+    replacesId_(data.replacesId),
+    appIcon_(data.appIcon),
+    summary_(data.summary),
+    body_(data.body),
+    actions_(data.actions),
+    hints_(data.hints),
+    hintValues_(decodeHints(data.hints)),
+    expireTimeout_(data.expireTimeout)
+{
+}
+
 LipstickNotification::LipstickNotification(const LipstickNotification &notification) :
     QObject(notification.parent()),
     appName_(notification.appName_),
@@ -46,10 +61,16 @@ LipstickNotification::LipstickNotification(const LipstickNotification &notificat
     body_(notification.body_),
     actions_(notification.actions_),
     hints_(notification.hints_),
+    hintValues_(notification.hintValues_),
     expireTimeout_(notification.expireTimeout_)
 {
 }
 
+NotificationData LipstickNotification::data() const
+{
+    return NotificationData(appName_, replacesId_, appIcon_, summary_, body_, actions_, hints_, expireTimeout_);
+}
+
 QString LipstickNotification::appName() const
 {
     return appName_;
@@ -119,52 +140,50 @@ QVariantHash LipstickNotification::hints() const
 void LipstickNotification::setHints(const QVariantHash &hints)
 {
     QString oldIcon = icon();
-    QDateTime oldTimestamp = timestamp();
-    QString oldPreviewIcon = previewIcon();
-    QString oldPreviewSummary = previewSummary();
-    QString oldPreviewBody = previewBody();
-    int oldUrgency = urgency();
-    int oldItemCount = itemCount();
-    int oldPriority = priority();
-    QString oldCategory = category();
+    HintValues oldValues = hintValues_;
 
     hints_ = hints;
+    hintValues_ = decodeHints(hints);
 
     if (oldIcon != icon()) {
         emit iconChanged();
     }
 
-    if (oldTimestamp != timestamp()) {
+    if (oldValues.timestamp != hintValues_.timestamp) {
         emit timestampChanged();
     }
 
-    if (oldPreviewIcon != previewIcon()) {
+    if (oldValues.previewIcon != hintValues_.previewIcon) {
         emit previewIconChanged();
     }
 
-    if (oldPreviewSummary != previewSummary()) {
+    if (oldValues.previewSummary != hintValues_.previewSummary) {
         emit previewSummaryChanged();
     }
 
-    if (oldPreviewBody != previewBody()) {
+    if (oldValues.previewBody != hintValues_.previewBody) {
         emit previewBodyChanged();
     }
 
-    if (oldUrgency != urgency()) {
+    if (oldValues.urgency != hintValues_.urgency) {
         emit urgencyChanged();
     }
 
-    if (oldItemCount != itemCount()) {
+    if (oldValues.itemCount != hintValues_.itemCount) {
         emit itemCountChanged();
     }
 
-    if (oldPriority != priority()) {
+    if (oldValues.priority != hintValues_.priority) {
         emit priorityChanged();
     }
 
-    if (oldCategory != category()) {
+    if (oldValues.category != hintValues_.category) {
         emit categoryChanged();
     }
+
+    if (oldValues.userRemovable != hintValues_.userRemovable) {
+        emit userRemovableChanged();
+    }
 }
 
 int LipstickNotification::expireTimeout() const
@@ -179,52 +198,96 @@ void LipstickNotification::setExpireTimeout(int expireTimeout)
 
 QString LipstickNotification::icon() const
 {
-    return appIcon_.isEmpty() ? hints_.value(NotificationManager::HINT_ICON).toString() : appIcon_;
+    return appIcon_.isEmpty() ? hintValues_.icon : appIcon_;
 }
 
 QDateTime LipstickNotification::timestamp() const
 {
-    return hints_.value(NotificationManager::HINT_TIMESTAMP).toDateTime();
+    return hintValues_.timestamp;
 }
 
 QString LipstickNotification::previewIcon() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_ICON).toString();
+    return hintValues_.previewIcon;
 }
 
 QString LipstickNotification::previewSummary() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_SUMMARY).toString();
+    return hintValues_.previewSummary;
 }
 
 QString LipstickNotification::previewBody() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_BODY).toString();
+    return hintValues_.previewBody;
 }
 
 int LipstickNotification::urgency() const
 {
-    return hints_.value(NotificationManager::HINT_URGENCY).toInt();
+    return hintValues_.urgency;
 }
 
 int LipstickNotification::itemCount() const
 {
-    return hints_.value(NotificationManager::HINT_ITEM_COUNT).toInt();
+    return hintValues_.itemCount;
 }
 
 int LipstickNotification::priority() const
 {
-    return hints_.value(NotificationManager::HINT_PRIORITY).toInt();
+    return hintValues_.priority;
 }
 
 QString LipstickNotification::category() const
 {
-    return hints_.value(NotificationManager::HINT_CATEGORY).toString();
+    return hintValues_.category;
 }
 
 bool LipstickNotification::isUserRemovable() const
 {
-    return hints_.value(NotificationManager::HINT_USER_REMOVABLE, QVariant(true)).toBool();
+    return hintValues_.userRemovable;
+}
+
+bool LipstickNotification::isHidden() const
+{
+    return hintValues_.hidden;
+}
+
+QString LipstickNotification::feedback() const
+{
+    return hintValues_.feedback;
+}
+
+bool LipstickNotification::displayOn() const
+{
+    return hintValues_.displayOn;
+}
+
+LipstickNotification::HintValues::HintValues() :
+    urgency(0),
+    itemCount(0),
+    priority(0),
+    hidden(false),
+    userRemovable(true),
+    displayOn(false)
+{
+}
+
+LipstickNotification::HintValues LipstickNotification::decodeHints(const QVariantHash &hints)
+{
+    HintValues values;
+    values.icon = hints.value(NotificationManager::HINT_ICON).toString();
+    values.timestamp = hints.value(NotificationManager::HINT_TIMESTAMP).toDateTime();
+    values.previewIcon = hints.value(NotificationManager::HINT_PREVIEW_ICON).toString();
+    values.previewSummary = hints.value(NotificationManager::HINT_PREVIEW_SUMMARY).toString();
+    values.previewBody = hints.value(NotificationManager::HINT_PREVIEW_BODY).toString();
+    values.urgency = hints.value(NotificationManager::HINT_URGENCY).toInt();
+    values.itemCount = hints.value(NotificationManager::HINT_ITEM_COUNT).toInt();
+    values.priority = hints.value(NotificationManager::HINT_PRIORITY).toInt();
+    values.category = hints.value(NotificationManager::HINT_CATEGORY).toString();
+    values.hidden = hints.value(NotificationManager::HINT_HIDDEN).toBool();
+    values.userRemovable = hints.value(NotificationManager::HINT_USER_REMOVABLE, QVariant(true)).toBool();
+    values.displayOn = hints.value(NotificationManager::HINT_DISPLAY_ON).toBool();
+    values.feedback = hints.value(NotificationManager::HINT_FEEDBACK).toString();
+    return values;
 }
 
 QDBusArgument &operator<<(QDBusArgument &argument, const LipstickNotification &notification)
@@ -254,6 +317,37 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, LipstickNotificat
     argument >> notification.hints_;
     argument >> notification.expireTimeout_;
     argument.endStructure();
+    notification.hintValues_ = LipstickNotification::decodeHints(notification.hints_);
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const NotificationData &data)
+{
+    argument.beginStructure();
+    argument << data.appName;
+    argument << data.replacesId;
+    argument << data.appIcon;
+    argument << data.summary;
+    argument << data.body;
+    argument << data.actions;
+    argument << data.hints;
+    argument << data.expireTimeout;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, NotificationData &data)
+{
+    argument.beginStructure();
+    argument >> data.appName;
+    argument >> data.replacesId;
+    argument >> data.appIcon;
+    argument >> data.summary;
+    argument >> data.body;
+    argument >> data.actions;
+    argument >> data.hints;
+    argument >> data.expireTimeout;
+    argument.endStructure();
     return argument;
 }
 
@@ -263,24 +357,48 @@ NotificationList::NotificationList()
 
 NotificationList::NotificationList(const QList<LipstickNotification *> &notificationList) :
     notificationList(notificationList)
+{
+    notificationData.reserve(notificationList.count());
+    foreach (LipstickNotification *notification, notificationList) {
+        notificationData.append(notification->data());
+    }
+}
+
+NotificationList::NotificationList(const QList<NotificationData> &notificationData) :
+    notificationData(notificationData)
 {
 }
 
 NotificationList::NotificationList(const NotificationList &notificationList) :
-    notificationList(notificationList.notificationList)
+    notificationList(notificationList.notificationList),
+    notificationData(notificationList.notificationData)
 {
 }
 
 QList<LipstickNotification *> NotificationList::notifications() const
 {
-    return notificationList;
+    if (!notificationList.isEmpty() || notificationData.isEmpty()) {
+        return notificationList;
+    }
+
+    QList<LipstickNotification *> notifications;
+    notifications.reserve(notificationData.count());
+    foreach (const NotificationData &data, notificationData) {
+        notifications.append(new LipstickNotification(data));
+    }
+    return notifications;
+}
+
+QList<NotificationData> NotificationList::data() const
+{
+    return notificationData;
 }
 
 QDBusArgument &operator<<(QDBusArgument &argument, const NotificationList &notificationList)
 {
-    argument.beginArray(qMetaTypeId<LipstickNotification>());
-    foreach (LipstickNotification *notification, notificationList.notificationList) {
-        argument << *notification;
+    argument.beginArray(qMetaTypeId<NotificationData>());
+    foreach (const NotificationData &data, notificationList.notificationData) {
+        argument << data;
     }
     argument.endArray();
     return argument;
@@ -290,10 +408,11 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, NotificationList
 {
     argument.beginArray();
     notificationList.notificationList.clear();
+    notificationList.notificationData.clear();
     while (!argument.atEnd()) {
-        LipstickNotification *notification = new LipstickNotification;
-        argument >> *notification;
-        notificationList.notificationList.append(notification);
+        NotificationData data;
+        argument >> data;
+        notificationList.notificationData.append(data);
     }
     argument.endArray();
     return argument;
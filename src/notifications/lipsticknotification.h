@@ -23,6 +23,33 @@
 
 class QDBusArgument;
 
+/*!
+ * The data of a single notification as transferred over D-Bus. Unlike
+ * LipstickNotification this is a plain value type, so lists of notifications
+ * can be marshalled and unmarshalled without allocating an object for each
+ * notification or decoding its hints.
+ */
+struct LIPSTICK_EXPORT NotificationData
+{
+    NotificationData() : replacesId(0), expireTimeout(-1) {}
+    NotificationData(const QString &appName, uint replacesId, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout) :
+        appName(appName), replacesId(replacesId), appIcon(appIcon), summary(summary), body(body), actions(actions), hints(hints), expireTimeout(expireTimeout) {}
+
+    QString appName;
+    uint replacesId;
+    QString appIcon;
+    QString summary;
+    QString body;
+    QStringList actions;
+    QVariantHash hints;
+    int expireTimeout;
+};
+
+LIPSTICK_EXPORT QDBusArgument &operator<<(QDBusArgument &argument, const NotificationData &data);
+LIPSTICK_EXPORT const QDBusArgument &operator>>(const QDBusArgument &argument, NotificationData &data);
+
+Q_DECLARE_METATYPE(NotificationData)
+
 /*!
  * An object for storing information about a single notification.
  */
@@ -70,6 +97,24 @@ public:
      */
     LipstickNotification(QObject *parent = 0);
 
+    /*!
+     * Creates an object for storing information about a single notification
+     * from the D-Bus representation of the notification.
+     *
+     * \param data the data of the notification
+     * \param parent the parent QObject
+     */
+    explicit LipstickNotification(const NotificationData &data, QObject *parent = 0);
+
+    /*!
+     * Returns the D-Bus representation of the notification. The strings,
+     * actions and hints are implicitly shared with the notification so this
+     * does not copy them.
+     *
+     * \return the data of the notification
+     */
+    NotificationData data() const;
+
     //! Returns the name of the application sending the notification
     QString appName() const;
 
@@ -145,6 +190,15 @@ public:
     //! Returns the user removability of the notification
     bool isUserRemovable() const;
 
+    //! Returns whether the notification has been hidden from the user
+    bool isHidden() const;
+
+    //! Returns the feedback of the notification
+    QString feedback() const;
+
+    //! Returns whether the display should be turned on for the notification
+    bool displayOn() const;
+
     //! \internal
     /*!
      * Creates a copy of an existing representation of a notification.
@@ -204,6 +258,33 @@ signals:
     void userRemovableChanged();
 
 private:
+    //! Values of the well-known hints decoded once when the hints are set
+    struct HintValues {
+        HintValues();
+
+        QString icon;
+        QDateTime timestamp;
+        QString previewIcon;
+        QString previewSummary;
+        QString previewBody;
+        int urgency;
+        int itemCount;
+        int priority;
+        QString category;
+        bool hidden;
+        bool userRemovable;
+        bool displayOn;
+        QString feedback;
+    };
+
+    /*!
+     * Decodes the well-known hints of a notification.
+     *
+     * \param hints the hints to decode
+     * \return the decoded hint values
+     */
+    static HintValues decodeHints(const QVariantHash &hints);
+
     //! Name of the application sending the notification
     QString appName_;
 
@@ -225,24 +306,56 @@ private:
     //! Hints for the notification
     QVariantHash hints_;
 
+    //! The well-known hints decoded from the hints
+    HintValues hintValues_;
+
     //! Expiration timeout for the notification
     int expireTimeout_;
 };
 
 Q_DECLARE_METATYPE(LipstickNotification)
 
+/*!
+ * A list of notifications as transferred over D-Bus. The notifications are
+ * held as NotificationData values, so the list is marshalled and
+ * unmarshalled without creating LipstickNotification objects.
+ */
 class LIPSTICK_EXPORT NotificationList
 {
 public:
     NotificationList();
+
+    //! Creates a list holding the data of the given notifications. The list does not take ownership of the notifications.
     NotificationList(const QList<LipstickNotification *> &notificationList);
+
+    //! Creates a list holding the given notification data
+    NotificationList(const QList<NotificationData> &notificationData);
+
     NotificationList(const NotificationList &notificationList);
+
+    /*!
+     * Returns the notifications the list was created from. For a list
+     * created from notification data or unmarshalled from D-Bus, new
+     * notification objects are created on each call and the caller takes
+     * ownership of them.
+     *
+     * \deprecated Use data() instead.
+     * \return the notifications in the list
+     */
     QList<LipstickNotification *> notifications() const;
+
+    //! Returns the data of the notifications in the list
+    QList<NotificationData> data() const;
+
     friend QDBusArgument &operator<<(QDBusArgument &, const NotificationList &);
     friend const QDBusArgument &operator>>(const QDBusArgument &, NotificationList &);
 
 private:
+    //! The notifications the list was created from, if any
     QList<LipstickNotification *> notificationList;
+
+    //! The data of the notifications in the list
+    QList<NotificationData> notificationData;
 };
 
 Q_DECLARE_METATYPE(NotificationList)
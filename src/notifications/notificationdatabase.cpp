@@ -0,0 +1,715 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <climits>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlTableModel>
+#include <sys/statfs.h>
+#include "notificationmanager.h"
+#include "notificationdatabase.h"
+#include "notificationimagestore.h"
+#include "notificationjournal.h"
+
+// Define this if you'd like to see debug messages from the notification database
+#ifdef DEBUG_NOTIFICATIONS
+#define NOTIFICATIONS_DEBUG(things) qDebug() << Q_FUNC_INFO << things
+#else
+#define NOTIFICATIONS_DEBUG(things)
+#endif
+
+//! Path of the privileged storage directory relative to the home directory
+static const char *PRIVILEGED_DATA_PATH= "/.local/share/system/privileged";
+
+//! Minimum amount of disk space needed for the notification database in kilobytes
+static const uint MINIMUM_FREE_SPACE_NEEDED_IN_KB = 1024;
+
+//! Version of the database schema stored in the user_version pragma. Version 0 stored the actions and hints in separate tables, version 1 had no sort key columns and version 2 had no expiration time column.
+static const int DATABASE_SCHEMA_VERSION = 3;
+
+//! The time in milliseconds after a modification when the journal is synced to the storage device
+static const int JOURNAL_SYNC_INTERVAL = 100;
+
+//! Value of the auto_vacuum pragma when incremental vacuuming is enabled
+static const int AUTO_VACUUM_INCREMENTAL = 2;
+
+//! Maximum number of free pages released by a single incremental vacuum step
+static const int INCREMENTAL_VACUUM_STEP_PAGES = 32;
+
+//! SQL definition of the notifications table
+static const char *NOTIFICATIONS_TABLE_DEFINITION = "id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER, data BLOB, timestamp INTEGER, urgency INTEGER, category TEXT, expire_at INTEGER";
+
+//! Version of the QDataStream format used for serializing the actions and hints
+static const int DATA_STREAM_VERSION = QDataStream::Qt_5_0;
+
+//! SQL of the prepared statements in the order of the PreparedStatement enumeration
+static const char *PREPARED_STATEMENT_SQL[] = {
+    "INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+    "DELETE FROM notifications WHERE id=?"
+};
+
+//! Serializes the actions and hints of a notification into a single blob
+static QByteArray serializeData(const QStringList &actions, const QVariantHash &hints)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream << actions << hints;
+    return data;
+}
+
+//! Deserializes the actions and hints of a notification from a blob created by serializeData()
+static void deserializeData(const QByteArray &data, QStringList &actions, QVariantHash &hints)
+{
+    QDataStream stream(data);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream >> actions >> hints;
+    if (stream.status() != QDataStream::Ok) {
+        NOTIFICATIONS_DEBUG("Unable to deserialize notification data");
+        actions.clear();
+        hints.clear();
+    }
+}
+
+//! Binds the values of a notification to a statement for storing a notification. The sort keys are derived from the hints. Already serialized actions and hints are used as is.
+static void bindNotification(QSqlQuery *query, const NotificationDatabase::Record &record)
+{
+    QDateTime timestamp = record.hints.value(NotificationManager::HINT_TIMESTAMP).toDateTime();
+
+    query->bindValue(0, record.id);
+    query->bindValue(1, record.appName);
+    query->bindValue(2, record.appIcon);
+    query->bindValue(3, record.summary);
+    query->bindValue(4, record.body);
+    query->bindValue(5, record.expireTimeout);
+    query->bindValue(6, record.data.isEmpty() ? serializeData(record.actions, record.hints) : record.data);
+    query->bindValue(7, timestamp.isValid() ? timestamp.toMSecsSinceEpoch() : 0);
+    query->bindValue(8, record.hints.value(NotificationManager::HINT_URGENCY).toInt());
+    query->bindValue(9, record.hints.value(NotificationManager::HINT_CATEGORY).toString());
+    query->bindValue(10, record.expireAt);
+}
+
+NotificationDatabase::NotificationDatabase(QObject *parent) :
+    QObject(parent),
+    database(new QSqlDatabase),
+    committed(true),
+    commitFailed(false),
+    databaseCommitTimer(new QTimer(this)),
+    journal(new NotificationJournal(dataPath() + "/notifications.journal")),
+    journalSyncTimer(new QTimer(this))
+{
+    // Commit the modifications to the database 10 seconds after the last modification so that writing to disk doesn't affect user experience
+    databaseCommitTimer->setInterval(10000);
+    databaseCommitTimer->setSingleShot(true);
+    connect(databaseCommitTimer, SIGNAL(timeout()), this, SLOT(commit()));
+
+    // Sync the journal once per burst of modifications instead of after each of them
+    journalSyncTimer->setInterval(JOURNAL_SYNC_INTERVAL);
+    journalSyncTimer->setSingleShot(true);
+    connect(journalSyncTimer, SIGNAL(timeout()), this, SLOT(syncJournal()));
+
+    for (int statement = 0; statement < PreparedStatementCount; statement++) {
+        preparedStatements[statement] = 0;
+    }
+
+    // Batches of notifications are passed to the database thread as a whole
+    qRegisterMetaType<QList<NotificationDatabase::Record> >("QList<NotificationDatabase::Record>");
+}
+
+NotificationDatabase::~NotificationDatabase()
+{
+    if (!committed) {
+        commitTransaction();
+    }
+    clearStatements();
+
+    // The connection can only be removed once no QSqlDatabase refers to it
+    database->close();
+    delete database;
+    QSqlDatabase::removeDatabase(metaObject()->className());
+    delete journal;
+}
+
+void NotificationDatabase::decodeData(Record &record)
+{
+    if (!record.data.isEmpty()) {
+        deserializeData(record.data, record.actions, record.hints);
+        record.data.clear();
+    }
+}
+
+QString NotificationDatabase::dataPath()
+{
+    return QDir::homePath() + QString(PRIVILEGED_DATA_PATH) + QDir::separator() + "Notifications";
+}
+
+NotificationDatabase::Statistics NotificationDatabase::statistics() const
+{
+    QMutexLocker locker(&statisticsMutex);
+    return statistics_;
+}
+
+QList<NotificationDatabase::Record> NotificationDatabase::takeRestoredRecords()
+{
+    QList<Record> records;
+    records.swap(restoredRecords);
+    return records;
+}
+
+void NotificationDatabase::restore()
+{
+    if (connectToDatabase()) {
+        if (checkTableValidity()) {
+            prepareStatements();
+            replayJournal();
+            fetchData();
+        } else {
+            database->close();
+        }
+    }
+}
+
+void NotificationDatabase::storeNotification(uint id, const QString &appName, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout, qint64 expireAt)
+{
+    if (!beginModification()) {
+        return;
+    }
+
+    // Add or replace the notification along with its actions and hints as a single row
+    Record record;
+    record.id = id;
+    record.appName = appName;
+    record.appIcon = appIcon;
+    record.summary = summary;
+    record.body = body;
+    record.actions = actions;
+    record.hints = hints;
+    record.expireTimeout = expireTimeout;
+    record.expireAt = expireAt;
+    record.data = serializeData(actions, hints);
+    journal->appendStore(record);
+    if (!journalSyncTimer->isActive()) {
+        journalSyncTimer->start();
+    }
+
+    QSqlQuery *query = preparedStatements[StoreNotification];
+    bindNotification(query, record);
+    execStatement(query);
+}
+
+void NotificationDatabase::removeNotification(uint id)
+{
+    if (!beginModification()) {
+        return;
+    }
+
+    journal->appendRemove(id);
+    if (!journalSyncTimer->isActive()) {
+        journalSyncTimer->start();
+    }
+
+    // Remove the notification along with its actions and hints
+    QSqlQuery *query = preparedStatements[DeleteNotification];
+    query->bindValue(0, id);
+    execStatement(query);
+}
+
+void NotificationDatabase::storeNotifications(const QList<NotificationDatabase::Record> &records)
+{
+    foreach (const Record &record, records) {
+        storeNotification(record.id, record.appName, record.appIcon, record.summary, record.body, record.actions, record.hints, record.expireTimeout, record.expireAt);
+    }
+}
+
+void NotificationDatabase::commit()
+{
+    // Any aditional rules about when database commits are allowed can be added here
+    if (!committed) {
+        commitTransaction();
+    }
+
+    emit transactionCommitted();
+}
+
+void NotificationDatabase::commitTransaction()
+{
+    committed = true;
+    if (database->commit()) {
+        // The journal is only needed for the modifications which have not been committed
+        journalSyncTimer->stop();
+        journal->clear();
+        commitFailed = false;
+        return;
+    }
+
+    qWarning() << Q_FUNC_INFO << "Unable to commit the notification database:" << database->lastError().text();
+
+    // The modifications remain in the journal; make sure it is on disk and write them again with the next transaction
+    database->rollback();
+    journalSyncTimer->stop();
+    journal->sync();
+    commitFailed = true;
+}
+
+void NotificationDatabase::syncJournal()
+{
+    journal->sync();
+}
+
+void NotificationDatabase::performMaintenance(int timeBudget, qint64 sizeBudget)
+{
+    if (preparedStatements[StoreNotification] == 0) {
+        return;
+    }
+
+    QElapsedTimer maintenanceTimer;
+    maintenanceTimer.start();
+
+    // Checkpointing and vacuuming can't be done inside a transaction
+    databaseCommitTimer->stop();
+    commit();
+
+    // Copy the write-ahead log to the database without blocking; truncate the log if all of it could be copied
+    bool checkpointed = false;
+    {
+        QSqlQuery query(*database);
+        checkpointed = query.exec("PRAGMA wal_checkpoint(PASSIVE)") && query.next() && query.value(0).toInt() == 0 && query.value(1).toInt() == query.value(2).toInt();
+    }
+    if (checkpointed) {
+        QSqlQuery(*database).exec("PRAGMA wal_checkpoint(TRUNCATE)");
+    }
+
+    int pageSize = pragmaValue("page_size");
+    if (pageSize > 0) {
+        if (pragmaValue("auto_vacuum") != AUTO_VACUUM_INCREMENTAL) {
+            // Databases created before incremental vacuuming was enabled have to be rebuilt once
+            QSqlQuery(*database).exec("PRAGMA auto_vacuum=INCREMENTAL");
+            QSqlQuery(*database).exec("VACUUM");
+        } else {
+            // Release the free pages in small steps until either of the budgets has been used up
+            int pageBudget = int(qMin(sizeBudget / pageSize, qint64(INT_MAX)));
+            while (pageBudget > 0 && maintenanceTimer.elapsed() < timeBudget && pragmaValue("freelist_count") > 0) {
+                int pages = qMin(pageBudget, INCREMENTAL_VACUUM_STEP_PAGES);
+                QSqlQuery(*database).exec(QString("PRAGMA incremental_vacuum(%1)").arg(pages));
+                pageBudget -= pages;
+            }
+        }
+    }
+
+    updateStatistics(maintenanceTimer.elapsed());
+
+    NOTIFICATIONS_DEBUG("MAINTENANCE:" << statistics_.lastMaintenanceDuration << "ms, size:" << statistics_.databaseSize << "wal size:" << statistics_.walSize << "fragmentation:" << statistics_.fragmentation());
+}
+
+void NotificationDatabase::writeImage(const QString &filePath, const QByteArray &header, const QByteArray &pixels)
+{
+    if (!NotificationImageStore::writeFile(filePath, header, pixels)) {
+        qWarning() << Q_FUNC_INFO << "Unable to write the notification image" << filePath;
+    }
+}
+
+void NotificationDatabase::removeImage(const QString &filePath)
+{
+    NotificationImageStore::removeFile(filePath);
+}
+
+void NotificationDatabase::removeUnreferencedImages(const QString &path, const QStringList &keys)
+{
+    NotificationImageStore::removeUnreferencedFiles(path, keys);
+}
+
+bool NotificationDatabase::connectToDatabase()
+{
+    QString databasePath = dataPath();
+    if (!QDir::root().exists(databasePath)) {
+        QDir::root().mkpath(databasePath);
+    }
+    QString databaseName = databasePath + "/notifications.db";
+
+    *database = QSqlDatabase::addDatabase("QSQLITE", metaObject()->className());
+    database->setDatabaseName(databaseName);
+    bool success = checkForDiskSpace(databasePath, MINIMUM_FREE_SPACE_NEEDED_IN_KB);
+    if (success) {
+        success = database->open();
+        if (!success) {
+            NOTIFICATIONS_DEBUG(database->lastError().driverText() << databaseName << database->lastError().databaseText());
+
+            // If opening the database fails, try to recreate the database
+            removeDatabaseFile(databaseName);
+            success = database->open();
+            NOTIFICATIONS_DEBUG("Unable to open database file. Recreating. Success: " << success);
+        }
+    } else {
+        NOTIFICATIONS_DEBUG("Not enough free disk space available. Unable to open database.");
+    }
+
+    if (success) {
+        // Set up the database mode to write-ahead locking to improve performance
+        QSqlQuery(*database).exec("PRAGMA journal_mode=WAL");
+    }
+
+    return success;
+}
+
+bool NotificationDatabase::checkForDiskSpace(const QString &path, unsigned long freeSpaceNeeded)
+{
+    struct statfs st;
+    bool spaceAvailable = false;
+    if (statfs(path.toUtf8().data(), &st) != -1) {
+        unsigned long freeSpaceInKb = (st.f_bsize * st.f_bavail) / 1024;
+        if (freeSpaceInKb > freeSpaceNeeded) {
+            spaceAvailable = true;
+        }
+    }
+    return spaceAvailable;
+}
+
+int NotificationDatabase::pragmaValue(const QString &pragma)
+{
+    QSqlQuery query(*database);
+    if (query.exec("PRAGMA " + pragma) && query.next()) {
+        return query.value(0).toInt();
+    }
+    return -1;
+}
+
+void NotificationDatabase::updateStatistics(qint64 maintenanceDuration)
+{
+    QString databaseName = database->databaseName();
+    Statistics statistics = this->statistics();
+    statistics.databaseSize = QFileInfo(databaseName).size();
+    statistics.walSize = QFileInfo(databaseName + "-wal").size();
+    statistics.pageSize = qMax(pragmaValue("page_size"), 0);
+    statistics.pageCount = qMax(pragmaValue("page_count"), 0);
+    statistics.freePageCount = qMax(pragmaValue("freelist_count"), 0);
+    statistics.maintenanceCount++;
+    statistics.lastMaintenanceDuration = maintenanceDuration;
+
+    QMutexLocker locker(&statisticsMutex);
+    statistics_ = statistics;
+}
+
+void NotificationDatabase::removeDatabaseFile(const QString &path)
+{
+    // Remove also -shm and -wal files created when journal-mode=WAL is being used
+    QDir::root().remove(path + "-shm");
+    QDir::root().remove(path + "-wal");
+    QDir::root().remove(path);
+}
+
+bool NotificationDatabase::checkTableValidity()
+{
+    int schemaVersion = 0;
+    {
+        QSqlQuery query(*database);
+        if (query.exec("PRAGMA user_version") && query.next()) {
+            schemaVersion = query.value(0).toInt();
+        }
+    }
+
+    if (schemaVersion < DATABASE_SCHEMA_VERSION) {
+        // Convert any notifications stored using an older schema to the current one
+        return migrateTables(schemaVersion);
+    }
+
+    bool recreateNotificationsTable = false;
+    {
+        // Check that the notifications table schema is as expected
+        QSqlTableModel notificationsTableModel(0, *database);
+        notificationsTableModel.setTable("notifications");
+        recreateNotificationsTable = (notificationsTableModel.fieldIndex("id") == -1 ||
+                                      notificationsTableModel.fieldIndex("app_name") == -1 ||
+                                      notificationsTableModel.fieldIndex("app_icon") == -1 ||
+                                      notificationsTableModel.fieldIndex("summary") == -1 ||
+                                      notificationsTableModel.fieldIndex("body") == -1 ||
+                                      notificationsTableModel.fieldIndex("expire_timeout") == -1 ||
+                                      notificationsTableModel.fieldIndex("data") == -1 ||
+                                      notificationsTableModel.fieldIndex("timestamp") == -1 ||
+                                      notificationsTableModel.fieldIndex("urgency") == -1 ||
+                                      notificationsTableModel.fieldIndex("category") == -1 ||
+                                      notificationsTableModel.fieldIndex("expire_at") == -1);
+    }
+
+    bool result = true;
+    if (recreateNotificationsTable) {
+        result = recreateTable("notifications", NOTIFICATIONS_TABLE_DEFINITION);
+    }
+
+    return result;
+}
+
+bool NotificationDatabase::migrateTables(int schemaVersion)
+{
+    QList<Record> records;
+    if (schemaVersion == 0) {
+        // Read the notifications stored in the separate tables of schema version 0, if they are intact
+        bool tablesValid = false;
+        {
+            QSqlTableModel notificationsTableModel(0, *database);
+            notificationsTableModel.setTable("notifications");
+            QSqlTableModel actionsTableModel(0, *database);
+            actionsTableModel.setTable("actions");
+            QSqlTableModel hintsTableModel(0, *database);
+            hintsTableModel.setTable("hints");
+            tablesValid = (notificationsTableModel.fieldIndex("id") != -1 &&
+                           notificationsTableModel.fieldIndex("app_name") != -1 &&
+                           notificationsTableModel.fieldIndex("app_icon") != -1 &&
+                           notificationsTableModel.fieldIndex("summary") != -1 &&
+                           notificationsTableModel.fieldIndex("body") != -1 &&
+                           notificationsTableModel.fieldIndex("expire_timeout") != -1 &&
+                           actionsTableModel.fieldIndex("id") != -1 &&
+                           actionsTableModel.fieldIndex("action") != -1 &&
+                           hintsTableModel.fieldIndex("id") != -1 &&
+                           hintsTableModel.fieldIndex("hint") != -1 &&
+                           hintsTableModel.fieldIndex("value") != -1);
+        }
+
+        if (tablesValid) {
+            records = fetchVersion0Data();
+        }
+    } else {
+        records = fetchVersion1Data();
+    }
+
+    // Replace the old tables with the current schema and write the notifications back in a single transaction
+    database->transaction();
+    if (schemaVersion == 0) {
+        QSqlQuery(*database).exec("DROP TABLE actions");
+        QSqlQuery(*database).exec("DROP TABLE hints");
+    }
+    bool result = recreateTable("notifications", NOTIFICATIONS_TABLE_DEFINITION);
+    if (result) {
+        QSqlQuery query(*database);
+        query.prepare(PREPARED_STATEMENT_SQL[StoreNotification]);
+        foreach (Record record, records) {
+            if (record.expireTimeout > 0) {
+                // The expiration time was not stored by the older schema versions so expire the notification relative to its timestamp
+                QDateTime timestamp = record.hints.value(NotificationManager::HINT_TIMESTAMP).toDateTime();
+                if (timestamp.isValid()) {
+                    record.expireAt = timestamp.toMSecsSinceEpoch() + record.expireTimeout;
+                }
+            }
+            bindNotification(&query, record);
+            execStatement(&query);
+        }
+
+        result = QSqlQuery(*database).exec(QString("PRAGMA user_version=%1").arg(DATABASE_SCHEMA_VERSION));
+    }
+
+    if (result) {
+        database->commit();
+    } else {
+        database->rollback();
+    }
+
+    NOTIFICATIONS_DEBUG("Migrated" << records.count() << "notifications to schema version" << DATABASE_SCHEMA_VERSION << "Success:" << result);
+    return result;
+}
+
+bool NotificationDatabase::recreateTable(const QString &tableName, const QString &definition)
+{
+    bool result = false;
+
+    if (database->isOpen()) {
+        // Takes effect immediately in a new database; an existing one is converted by the next maintenance run
+        QSqlQuery(*database).exec("PRAGMA auto_vacuum=INCREMENTAL");
+        QSqlQuery(*database).exec("DROP TABLE " + tableName);
+        result = QSqlQuery(*database).exec("CREATE TABLE " + tableName + " (" + definition + ")");
+    }
+
+    return result;
+}
+
+void NotificationDatabase::fetchData()
+{
+    // Gather the notifications in a single sequential scan. The actions and hints are decoded only when needed.
+    QSqlQuery notificationsQuery("SELECT * FROM notifications", *database);
+    QSqlRecord notificationsRecord = notificationsQuery.record();
+    int notificationsTableIdFieldIndex = notificationsRecord.indexOf("id");
+    int notificationsTableAppNameFieldIndex = notificationsRecord.indexOf("app_name");
+    int notificationsTableAppIconFieldIndex = notificationsRecord.indexOf("app_icon");
+    int notificationsTableSummaryFieldIndex = notificationsRecord.indexOf("summary");
+    int notificationsTableBodyFieldIndex = notificationsRecord.indexOf("body");
+    int notificationsTableExpireTimeoutFieldIndex = notificationsRecord.indexOf("expire_timeout");
+    int notificationsTableDataFieldIndex = notificationsRecord.indexOf("data");
+    int notificationsTableTimestampFieldIndex = notificationsRecord.indexOf("timestamp");
+    int notificationsTableUrgencyFieldIndex = notificationsRecord.indexOf("urgency");
+    int notificationsTableCategoryFieldIndex = notificationsRecord.indexOf("category");
+    int notificationsTableExpireAtFieldIndex = notificationsRecord.indexOf("expire_at");
+    while (notificationsQuery.next()) {
+        Record record;
+        record.id = notificationsQuery.value(notificationsTableIdFieldIndex).toUInt();
+        record.appName = notificationsQuery.value(notificationsTableAppNameFieldIndex).toString();
+        record.appIcon = notificationsQuery.value(notificationsTableAppIconFieldIndex).toString();
+        record.summary = notificationsQuery.value(notificationsTableSummaryFieldIndex).toString();
+        record.body = notificationsQuery.value(notificationsTableBodyFieldIndex).toString();
+        record.expireTimeout = notificationsQuery.value(notificationsTableExpireTimeoutFieldIndex).toInt();
+        record.data = notificationsQuery.value(notificationsTableDataFieldIndex).toByteArray();
+        record.timestamp = notificationsQuery.value(notificationsTableTimestampFieldIndex).toLongLong();
+        record.urgency = notificationsQuery.value(notificationsTableUrgencyFieldIndex).toInt();
+        record.category = notificationsQuery.value(notificationsTableCategoryFieldIndex).toString();
+        record.expireAt = notificationsQuery.value(notificationsTableExpireAtFieldIndex).toLongLong();
+        restoredRecords.append(record);
+    }
+}
+
+QList<NotificationDatabase::Record> NotificationDatabase::fetchVersion1Data()
+{
+    QList<Record> records;
+    QSqlQuery notificationsQuery("SELECT id, app_name, app_icon, summary, body, expire_timeout, data FROM notifications", *database);
+    while (notificationsQuery.next()) {
+        Record record;
+        record.id = notificationsQuery.value(0).toUInt();
+        record.appName = notificationsQuery.value(1).toString();
+        record.appIcon = notificationsQuery.value(2).toString();
+        record.summary = notificationsQuery.value(3).toString();
+        record.body = notificationsQuery.value(4).toString();
+        record.expireTimeout = notificationsQuery.value(5).toInt();
+        deserializeData(notificationsQuery.value(6).toByteArray(), record.actions, record.hints);
+        records.append(record);
+    }
+
+    return records;
+}
+
+QList<NotificationDatabase::Record> NotificationDatabase::fetchVersion0Data()
+{
+    // Gather actions for each notification
+    QSqlQuery actionsQuery("SELECT id, action FROM actions", *database);
+    QHash<uint, QStringList> actions;
+    while (actionsQuery.next()) {
+        actions[actionsQuery.value(0).toUInt()].append(actionsQuery.value(1).toString());
+    }
+
+    // Gather hints for each notification
+    QSqlQuery hintsQuery("SELECT id, hint, value FROM hints", *database);
+    QHash<uint, QVariantHash> hints;
+    while (hintsQuery.next()) {
+        hints[hintsQuery.value(0).toUInt()].insert(hintsQuery.value(1).toString(), hintsQuery.value(2));
+    }
+
+    // Gather the notifications
+    QList<Record> records;
+    QSqlQuery notificationsQuery("SELECT id, app_name, app_icon, summary, body, expire_timeout FROM notifications", *database);
+    while (notificationsQuery.next()) {
+        Record record;
+        record.id = notificationsQuery.value(0).toUInt();
+        record.appName = notificationsQuery.value(1).toString();
+        record.appIcon = notificationsQuery.value(2).toString();
+        record.summary = notificationsQuery.value(3).toString();
+        record.body = notificationsQuery.value(4).toString();
+        record.actions = actions.value(record.id);
+        record.hints = hints.value(record.id);
+        record.expireTimeout = notificationsQuery.value(5).toInt();
+        records.append(record);
+    }
+
+    return records;
+}
+
+void NotificationDatabase::replayJournal()
+{
+    if (!journal->isEmpty()) {
+        database->transaction();
+        int count = writeJournal();
+        if (!database->commit()) {
+            // Keep the journal so that the modifications are replayed again on the next start
+            qWarning() << Q_FUNC_INFO << "Unable to commit the notification database:" << database->lastError().text();
+            database->rollback();
+            return;
+        }
+        NOTIFICATIONS_DEBUG("Replayed" << count << "modifications from the journal");
+    }
+
+    journal->clear();
+}
+
+int NotificationDatabase::writeJournal()
+{
+    QList<NotificationJournal::Entry> entries = journal->read();
+    foreach (NotificationJournal::Entry entry, entries) {
+        QSqlQuery *query = preparedStatements[entry.operation == NotificationJournal::StoreNotification ? StoreNotification : DeleteNotification];
+        if (entry.operation == NotificationJournal::StoreNotification) {
+            // The sort keys are derived from the hints
+            deserializeData(entry.record.data, entry.record.actions, entry.record.hints);
+            bindNotification(query, entry.record);
+        } else {
+            query->bindValue(0, entry.record.id);
+        }
+        execStatement(query);
+    }
+
+    return entries.count();
+}
+
+void NotificationDatabase::prepareStatements()
+{
+    for (int statement = 0; statement < PreparedStatementCount; statement++) {
+        QSqlQuery *query = new QSqlQuery(*database);
+        if (!query->prepare(PREPARED_STATEMENT_SQL[statement])) {
+            NOTIFICATIONS_DEBUG(PREPARED_STATEMENT_SQL[statement] << query->lastError());
+        }
+        preparedStatements[statement] = query;
+    }
+}
+
+void NotificationDatabase::clearStatements()
+{
+    for (int statement = 0; statement < PreparedStatementCount; statement++) {
+        delete preparedStatements[statement];
+        preparedStatements[statement] = 0;
+    }
+}
+
+bool NotificationDatabase::beginModification()
+{
+    // The statements are only prepared if the database was successfully opened
+    if (preparedStatements[StoreNotification] == 0) {
+        return false;
+    }
+
+    if (committed) {
+        committed = false;
+        database->transaction();
+
+        if (commitFailed) {
+            // The modifications of the transaction that could not be committed are only in the journal
+            writeJournal();
+        }
+    }
+
+    databaseCommitTimer->start();
+
+    return true;
+}
+
+void NotificationDatabase::execStatement(QSqlQuery *query)
+{
+    if (!query->exec()) {
+        NOTIFICATIONS_DEBUG(query->lastQuery() << query->boundValues() << query->lastError());
+    }
+
+    // Reset the statement so that it can be reused without holding any locks in the meanwhile
+    query->finish();
+}
@@ -0,0 +1,395 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONDATABASE_H
+#define NOTIFICATIONDATABASE_H
+
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QVariantHash>
+
+class NotificationJournal;
+class QSqlDatabase;
+class QSqlQuery;
+class QTimer;
+
+/*!
+ * \class NotificationDatabase
+ *
+ * \brief Persists notifications to a Sqlite database.
+ *
+ * The notification database is meant to be moved to a dedicated writer
+ * thread. All database access happens in the slots of this class, which
+ * are invoked through queued connections so that the caller never blocks
+ * on disk I/O. Modifications are collected into a transaction which is
+ * committed 10 seconds after the last modification. Each modification is
+ * also appended to a NotificationJournal right away so that the
+ * uncommitted modifications can be recovered when the database is next
+ * restored if lipstick exits before the commit.
+ *
+ * Each notification is stored as a single row of the notifications table.
+ * The actions and hints of the notification are serialized into a binary
+ * blob in the same row so that storing a notification takes a single write
+ * regardless of the number of hints. The timestamp, urgency and category
+ * are additionally stored in their own columns so that they can be read
+ * without decoding the blob. The schema version is kept in the
+ * user_version pragma of the database and notifications stored by older
+ * versions are migrated automatically when the database is opened.
+ *
+ * The write-ahead log and the free pages left behind by removed
+ * notifications are reclaimed by performMaintenance(), which is expected to
+ * be called when the device is idle.
+ */
+class NotificationDatabase : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * The stored data of a single notification. Restored records carry the
+     * actions and hints still serialized in \c data along with the sort keys
+     * read from their own columns; decodeData() fills in the actions and hints.
+     */
+    struct Record {
+        Record() : id(0), expireTimeout(0), timestamp(0), urgency(0), expireAt(0) {}
+
+        uint id;
+        QString appName;
+        QString appIcon;
+        QString summary;
+        QString body;
+        QStringList actions;
+        QVariantHash hints;
+        int expireTimeout;
+        QByteArray data;
+        qint64 timestamp;
+        int urgency;
+        QString category;
+        qint64 expireAt;
+    };
+
+    /*!
+     * Size and fragmentation statistics of the database, updated after
+     * each maintenance run.
+     */
+    struct Statistics {
+        Statistics() : databaseSize(0), walSize(0), pageSize(0), pageCount(0), freePageCount(0), maintenanceCount(0), lastMaintenanceDuration(0) {}
+
+        //! Returns the share of the pages of the database which are free, between 0 and 1
+        double fragmentation() const { return pageCount > 0 ? double(freePageCount) / pageCount : 0; }
+
+        //! Size of the database file in bytes
+        qint64 databaseSize;
+        //! Size of the write-ahead log file in bytes
+        qint64 walSize;
+        //! Size of a database page in bytes
+        int pageSize;
+        //! Number of pages in the database
+        int pageCount;
+        //! Number of unused pages in the database
+        int freePageCount;
+        //! Number of maintenance runs since the database was opened
+        int maintenanceCount;
+        //! Duration of the latest maintenance run in milliseconds
+        qint64 lastMaintenanceDuration;
+    };
+
+    /*!
+     * Creates a notification database. The database is not opened before
+     * restore() is called.
+     *
+     * \param parent the parent object
+     */
+    explicit NotificationDatabase(QObject *parent = 0);
+
+    //! Commits any pending modifications and closes the database.
+    virtual ~NotificationDatabase();
+
+    /*!
+     * Returns the notifications read from the database by restore() and
+     * clears the internal list. Must only be called when restore() has
+     * finished.
+     *
+     * \return the restored notifications
+     */
+    QList<Record> takeRestoredRecords();
+
+    /*!
+     * Decodes the actions and hints of a restored record from its serialized
+     * data. Does nothing if the record has already been decoded.
+     *
+     * \param record the record to decode
+     */
+    static void decodeData(Record &record);
+
+    /*!
+     * Returns the directory in which the notification data is stored.
+     *
+     * \return the path of the notification data directory
+     */
+    static QString dataPath();
+
+    /*!
+     * Returns the latest size and fragmentation statistics of the
+     * database. Can be called from any thread.
+     *
+     * \return the database statistics
+     */
+    Statistics statistics() const;
+
+public slots:
+    /*!
+     * Opens the database, ensures that the tables are valid, replays the
+     * modifications left in the journal and reads the stored notifications.
+     * The notifications can be fetched using takeRestoredRecords().
+     */
+    void restore();
+
+    /*!
+     * Stores a notification along with its actions and hints as a single
+     * row. Any previously stored notification with the same ID is replaced.
+     * \a expireAt is the time in milliseconds since the epoch when the
+     * notification expires or 0 if it never expires.
+     */
+    void storeNotification(uint id, const QString &appName, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout, qint64 expireAt);
+
+    /*!
+     * Removes a notification along with its actions and hints.
+     *
+     * \param id the ID of the notification to remove
+     */
+    void removeNotification(uint id);
+
+    /*!
+     * Stores several notifications like storeNotification(). The
+     * notifications end up in the same transaction.
+     *
+     * \param records the notifications to store
+     */
+    void storeNotifications(const QList<NotificationDatabase::Record> &records);
+
+    /*!
+     * Commits the current database transaction, if any, and clears the
+     * journal.
+     */
+    void commit();
+
+    /*!
+     * Commits any pending modifications, checkpoints the write-ahead log
+     * and releases free pages from the database file. Stops vacuuming
+     * once the time budget has been used up. At most \a sizeBudget bytes
+     * of free pages are released in one run. A database created before
+     * incremental vacuuming was enabled is fully vacuumed once instead.
+     *
+     * \param timeBudget the time that can be spent on vacuuming in milliseconds
+     * \param sizeBudget the amount of data that can be vacuumed in bytes
+     */
+    void performMaintenance(int timeBudget, qint64 sizeBudget);
+
+    /*!
+     * Writes an image file of the notification image store, so that the
+     * image files are written in this thread along with the database.
+     *
+     * \param filePath the path of the image file
+     * \param header the serialized image data or the header of it
+     * \param pixels the pixel data following the header, if any
+     */
+    void writeImage(const QString &filePath, const QByteArray &header, const QByteArray &pixels);
+
+    /*!
+     * Removes an image file of the notification image store.
+     *
+     * \param filePath the path of the image file
+     */
+    void removeImage(const QString &filePath);
+
+    /*!
+     * Removes the image files of the notification image store which are not
+     * referred to by the given keys.
+     *
+     * \param path the directory of the image files
+     * \param keys the keys of the referenced images
+     */
+    void removeUnreferencedImages(const QString &path, const QStringList &keys);
+
+signals:
+    //! Sent when the modifications made so far have been committed.
+    void transactionCommitted();
+
+private slots:
+    //! Flushes the journal entries appended since the previous sync to the storage device.
+    void syncJournal();
+
+private:
+    /*!
+     * Creates a connection to the Sqlite database.
+     *
+     * \return \c true if the connection was successfully established, \c false otherwise
+     */
+    bool connectToDatabase();
+
+    /*!
+     * Checks whether there is enough free disk space available.
+     *
+     * \param path any path to the file system from which the space should be checked
+     * \param freeSpaceNeeded free space needed in kilobytes
+     * \return \c true if there is enough free space in given file system, \c false otherwise
+     */
+    static bool checkForDiskSpace(const QString &path, unsigned long freeSpaceNeeded);
+
+    /*!
+     * Removes a database file from the filesystem. Removes related -wal and -shm files as well.
+     *
+     * \param path the path of the database file to be removed
+     */
+    static void removeDatabaseFile(const QString &path);
+
+    /*!
+     * Ensures that all database tables have the requires fields.
+     * Migrates tables using an older schema version and recreates the
+     * tables if needed.
+     *
+     * \return \c true if the database can be used, \c false otherwise
+     */
+    bool checkTableValidity();
+
+    /*!
+     * Converts the notifications stored using an older schema version to
+     * the current schema and updates the schema version of the database.
+     *
+     * \param schemaVersion the schema version of the database
+     * \return \c true if the database can be used, \c false otherwise
+     */
+    bool migrateTables(int schemaVersion);
+
+    /*!
+     * Recreates a table in the database. Incremental vacuuming is enabled
+     * before the table is created.
+     *
+     * \param tableName the name of the table to be created
+     * \param definition SQL definition for the table
+     * \return \c true if the table was created, \c false otherwise
+     */
+    bool recreateTable(const QString &tableName, const QString &definition);
+
+    //! Fills the restored records list with data from the database
+    void fetchData();
+
+    //! Reads the notifications stored in the separate notifications, actions and hints tables of schema version 0
+    QList<Record> fetchVersion0Data();
+
+    //! Reads the notifications stored in the notifications table of schema versions 1 and 2
+    QList<Record> fetchVersion1Data();
+
+    //! Writes the modifications found in the journal to the database and clears the journal
+    void replayJournal();
+
+    /*!
+     * Writes the modifications found in the journal to the current transaction.
+     *
+     * \return the number of modifications written
+     */
+    int writeJournal();
+
+    /*!
+     * Commits the current database transaction and clears the journal. If
+     * the commit fails the transaction is rolled back and the modifications
+     * are kept in the journal so that they are written again with the next
+     * transaction.
+     */
+    void commitTransaction();
+
+    //! Prepares the statements used for modifying the database
+    void prepareStatements();
+
+    //! Destroys the prepared statements
+    void clearStatements();
+
+    /*!
+     * Prepares the database for a modification. Starts a new transaction if none is active currently, otherwise
+     * the modification goes to the active transaction. Restarts the transaction commit timer.
+     *
+     * \return \c true if the database can be modified, \c false otherwise
+     */
+    bool beginModification();
+
+    /*!
+     * Executes a prepared statement. The values for the statement must have been bound before calling this.
+     *
+     * \param query the prepared statement to execute
+     */
+    void execStatement(QSqlQuery *query);
+
+    /*!
+     * Reads the value of a pragma.
+     *
+     * \param pragma the name of the pragma to read
+     * \return the value of the pragma or -1 if it could not be read
+     */
+    int pragmaValue(const QString &pragma);
+
+    /*!
+     * Updates the database statistics after a maintenance run.
+     *
+     * \param maintenanceDuration the duration of the maintenance run in milliseconds
+     */
+    void updateStatistics(qint64 maintenanceDuration);
+
+    //! Statements which are prepared once when the database is opened and reused for every modification
+    enum PreparedStatement {
+        StoreNotification,
+        DeleteNotification,
+        PreparedStatementCount
+    };
+
+    //! Database for the notifications
+    QSqlDatabase *database;
+
+    //! The prepared statements indexed by PreparedStatement; null when the database is not usable
+    QSqlQuery *preparedStatements[PreparedStatementCount];
+
+    //! Whether the current database transaction has been committed to the database
+    bool committed;
+
+    //! Whether the latest commit failed so that the journal holds modifications missing from the database
+    bool commitFailed;
+
+    //! Timer for triggering the commit of the current database transaction
+    QTimer *databaseCommitTimer;
+
+    //! Journal of the modifications not committed yet
+    NotificationJournal *journal;
+
+    //! Timer for syncing the journal shortly after a burst of modifications
+    QTimer *journalSyncTimer;
+
+    //! Notifications read from the database by restore()
+    QList<Record> restoredRecords;
+
+    //! The latest database statistics
+    Statistics statistics_;
+
+    //! Protects the statistics, which are read from other threads
+    mutable QMutex statisticsMutex;
+
+#ifdef UNIT_TEST
+    friend class Ut_NotificationManager;
+#endif
+};
+
+Q_DECLARE_METATYPE(QList<NotificationDatabase::Record>)
+
+#endif // NOTIFICATIONDATABASE_H
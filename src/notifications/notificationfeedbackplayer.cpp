@@ -13,32 +13,39 @@
 **
 ****************************************************************************/
 
+#include <QSettings>
 #include <NgfClient>
-#include <QWaylandSurface>
 #include <QDBusMessage>
 #include <QDBusConnection>
 #include <QDBusPendingCall>
 #include <mce/dbus-names.h>
-#include "lipstickcompositor.h"
 #include "notificationmanager.h"
 #include "notificationpreviewpresenter.h"
 #include "notificationfeedbackplayer.h"
+#include "systemstate.h"
 
-enum PreviewMode {
-    AllNotificationsEnabled = 0,
-    ApplicationNotificationsDisabled,
-    SystemNotificationsDisabled,
-    AllNotificationsDisabled
-};
+//! The global lipstick settings file
+static const char *LIPSTICK_SETTINGS_FILE = "/usr/share/lipstick/lipstick.conf";
+
+//! The default length of the feedback coalescing window in milliseconds
+static const int DEFAULT_FEEDBACK_COALESCING_WINDOW = 1000;
 
 NotificationFeedbackPlayer::NotificationFeedbackPlayer(NotificationPreviewPresenter *notificationPreviewPresenter) :
     QObject(notificationPreviewPresenter),
     ngfClient(new Ngf::Client(this)),
-    notificationPreviewPresenter(notificationPreviewPresenter)
+    notificationPreviewPresenter(notificationPreviewPresenter),
+    displayOnRequested(false),
+    suppressedFeedbackCount_(0),
+    suppressedDisplayOnRequestCount_(0)
 {
     connect(notificationPreviewPresenter, SIGNAL(notificationPresented(uint)), this, SLOT(addNotification(uint)));
     connect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), this, SLOT(removeNotification(uint)));
 
+    QSettings settings(LIPSTICK_SETTINGS_FILE, QSettings::IniFormat);
+    coalescingTimer.setSingleShot(true);
+    coalescingTimer.setInterval(qMax(0, settings.value("notifications/feedback_coalescing_window", DEFAULT_FEEDBACK_COALESCING_WINDOW).toInt()));
+    connect(&coalescingTimer, SIGNAL(timeout()), this, SLOT(endCoalescingWindow()));
+
     QTimer::singleShot(0, this, SLOT(init()));
 }
 
@@ -46,52 +53,100 @@ void NotificationFeedbackPlayer::init()
 {
     ngfClient->connect();
 
+    // Only the IDs of the existing notifications are needed, so the lazily restored notifications are not created
     foreach(uint id, NotificationManager::instance()->notificationIds()) {
-        idToEventId.insert(NotificationManager::instance()->notification(id), 0);
+        idToEventId.insert(id, 0);
     }
 }
 
 void NotificationFeedbackPlayer::addNotification(uint id)
 {
+    // Feedback is not played again for notifications which already existed or have already been presented
+    if (idToEventId.contains(id)) {
+        return;
+    }
+
     LipstickNotification *notification = NotificationManager::instance()->notification(id);
 
-    if (notification != 0 && !idToEventId.contains(notification) && isEnabled(notification)) {
-        // Ask mce to turn the screen on if requested
-        if (notification->hints().value(NotificationManager::HINT_DISPLAY_ON).toBool()) {
-            QDBusMessage msg = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF, MCE_DISPLAY_ON_REQ);
-            QDBusConnection::systemBus().asyncCall(msg);
+    if (notification != 0 && isEnabled(notification)) {
+        // Ask mce to turn the screen on if requested and not already requested within the coalescing window
+        if (notification->displayOn()) {
+            if (displayOnRequested) {
+                suppressedDisplayOnRequestCount_++;
+            } else {
+                QDBusMessage msg = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF, MCE_DISPLAY_ON_REQ);
+                QDBusConnection::systemBus().asyncCall(msg);
+                if (coalescingTimer.interval() > 0) {
+                    displayOnRequested = true;
+                    startCoalescingWindow();
+                }
+            }
         }
 
-        // Play the feedback related to the notification if any
-        QString feedback = notification->hints().value(NotificationManager::HINT_FEEDBACK).toString();
+        // Play the feedback related to the notification if any, unless the same feedback is already playing for the coalescing window
+        QString feedback = notification->feedback();
         if (!feedback.isEmpty()) {
-            idToEventId.insert(notification, ngfClient->play(feedback, QMap<QString, QVariant>()));
+            QHash<QString, uint>::const_iterator coalescedEventId = coalescedFeedbackEventIds.constFind(feedback);
+            if (coalescedEventId != coalescedFeedbackEventIds.constEnd()) {
+                idToEventId.insert(id, coalescedEventId.value());
+                eventIdReferenceCounts[coalescedEventId.value()]++;
+                suppressedFeedbackCount_++;
+            } else {
+                uint eventId = ngfClient->play(feedback, QMap<QString, QVariant>());
+                idToEventId.insert(id, eventId);
+                eventIdReferenceCounts[eventId]++;
+                if (coalescingTimer.interval() > 0) {
+                    coalescedFeedbackEventIds.insert(feedback, eventId);
+                    startCoalescingWindow();
+                }
+            }
         }
     }
 }
 
 void NotificationFeedbackPlayer::removeNotification(uint id)
 {
-    LipstickNotification *notification = NotificationManager::instance()->notification(id);
-
-    if (notification != 0) {
-        // Stop the feedback related to the notification, if any
-        uint eventId = idToEventId.take(notification);
-        if (eventId != 0) {
-            ngfClient->stop(eventId);
+    // Stop the feedback related to the notification, if any
+    uint eventId = idToEventId.take(id);
+    if (eventId != 0) {
+        // Coalesced notifications share the feedback so it's stopped only when none of them remain
+        QHash<uint, int>::iterator referenceCount = eventIdReferenceCounts.find(eventId);
+        if (referenceCount != eventIdReferenceCounts.end() && --referenceCount.value() > 0) {
+            return;
         }
+        eventIdReferenceCounts.remove(eventId);
+        ngfClient->stop(eventId);
     }
 }
 
-bool NotificationFeedbackPlayer::isEnabled(LipstickNotification *notification)
+void NotificationFeedbackPlayer::endCoalescingWindow()
+{
+    coalescedFeedbackEventIds.clear();
+    displayOnRequested = false;
+}
+
+void NotificationFeedbackPlayer::startCoalescingWindow()
 {
-    uint mode = AllNotificationsEnabled;
-    QWaylandSurface *surface = LipstickCompositor::instance()->surfaceForId(LipstickCompositor::instance()->topmostWindowId());
-    if (surface != 0) {
-        mode = surface->windowProperties().value("NOTIFICATION_PREVIEWS_DISABLED", uint(AllNotificationsEnabled)).toUInt();
+    if (!coalescingTimer.isActive()) {
+        coalescingTimer.start();
     }
+}
+
+uint NotificationFeedbackPlayer::suppressedFeedbackCount() const
+{
+    return suppressedFeedbackCount_;
+}
+
+uint NotificationFeedbackPlayer::suppressedDisplayOnRequestCount() const
+{
+    return suppressedDisplayOnRequestCount_;
+}
+
+bool NotificationFeedbackPlayer::isEnabled(LipstickNotification *notification)
+{
+    SystemState::NotificationPreviewMode mode = SystemState::instance()->notificationPreviewMode();
 
-    return mode == AllNotificationsEnabled ||
-           (mode == ApplicationNotificationsDisabled && notification->hints().value(NotificationManager::HINT_URGENCY).toInt() >= 2) ||
-           (mode == SystemNotificationsDisabled && notification->hints().value(NotificationManager::HINT_URGENCY).toInt() < 2);
+    return mode == SystemState::AllNotificationsEnabled ||
+           (mode == SystemState::ApplicationNotificationsDisabled && notification->urgency() >= 2) ||
+           (mode == SystemState::SystemNotificationsDisabled && notification->urgency() < 2);
 }
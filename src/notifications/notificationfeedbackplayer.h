@@ -18,6 +18,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QTimer>
 
 class LipstickNotification;
 class NotificationPreviewPresenter;
@@ -29,6 +30,13 @@ namespace Ngf {
  * \class NotificationFeedbackPlayer
  *
  * \brief Plays non-graphical feedback for notifications.
+ *
+ * Feedback events are coalesced: the same feedback is played only once
+ * and the display is requested to be turned on only once within the
+ * coalescing window, so a burst of notifications does not result in a
+ * burst of overlapping feedback. The length of the window is read from
+ * the notifications/feedback_coalescing_window setting in milliseconds;
+ * 0 disables coalescing.
  */
 class NotificationFeedbackPlayer : public QObject
 {
@@ -36,7 +44,24 @@ class NotificationFeedbackPlayer : public QObject
 
 public:
     explicit NotificationFeedbackPlayer(NotificationPreviewPresenter *notificationPreviewPresenter = 0);
-    
+
+    /*!
+     * Returns the number of feedback events not played because the same
+     * feedback was already played within the coalescing window.
+     *
+     * \return the number of suppressed feedback events
+     */
+    uint suppressedFeedbackCount() const;
+
+    /*!
+     * Returns the number of display on requests not sent because the
+     * display was already requested to be turned on within the coalescing
+     * window.
+     *
+     * \return the number of suppressed display on requests
+     */
+    uint suppressedDisplayOnRequestCount() const;
+
 private slots:
     //! Initializes the feedback player
     void init();
@@ -55,19 +80,43 @@ private slots:
      */
     void removeNotification(uint id);
 
+    //! Ends the coalescing window so that the next feedback events are played again
+    void endCoalescingWindow();
+
 private:
     //! Check whether feedbacks should be enabled for the given notification
     static bool isEnabled(LipstickNotification *notification);
 
+    //! Starts the coalescing window unless it is already running or coalescing is disabled
+    void startCoalescingWindow();
+
     //! Non-graphical feedback player
     Ngf::Client *ngfClient;
 
     //! A mapping between notification IDs and NGF play IDs.
-    QHash<LipstickNotification *, uint> idToEventId;
+    QHash<uint, uint> idToEventId;
+
+    //! The number of notifications sharing each NGF play ID
+    QHash<uint, int> eventIdReferenceCounts;
 
     //! The notification preview presenter this feedback player is synced to
     NotificationPreviewPresenter *notificationPreviewPresenter;
 
+    //! Timer for ending the coalescing window
+    QTimer coalescingTimer;
+
+    //! A mapping between the feedbacks played within the coalescing window and their NGF play IDs
+    QHash<QString, uint> coalescedFeedbackEventIds;
+
+    //! Whether the display has been requested to be turned on within the coalescing window
+    bool displayOnRequested;
+
+    //! Number of feedback events not played because of coalescing
+    uint suppressedFeedbackCount_;
+
+    //! Number of display on requests not sent because of coalescing
+    uint suppressedDisplayOnRequestCount_;
+
 #ifdef UNIT_TEST
     friend class Ut_NotificationFeedbackPlayer;
 #endif
@@ -0,0 +1,105 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <algorithm>
+#include "notificationidallocator.h"
+
+NotificationIdAllocator::NotificationIdAllocator(uint maximumId) :
+    maximumId(maximumId)
+{
+    if (maximumId > 0) {
+        freeRanges.append(qMakePair(1u, maximumId));
+    }
+}
+
+uint NotificationIdAllocator::allocate()
+{
+    for (;;) {
+        if (freeRanges.isEmpty()) {
+            // All IDs up to the maximum have been handed out so wrap around to the IDs released since
+            rebuildFreeRanges();
+            if (freeRanges.isEmpty()) {
+                return 0;
+            }
+        }
+
+        QPair<uint, uint> &range = freeRanges.first();
+        uint id = range.first;
+        if (range.first == range.second) {
+            freeRanges.removeFirst();
+        } else {
+            range.first++;
+        }
+
+        // IDs reserved after the free ranges were built may still be in the ranges
+        if (!allocatedIds.contains(id)) {
+            allocatedIds.insert(id);
+            return id;
+        }
+    }
+}
+
+void NotificationIdAllocator::reserve(uint id)
+{
+    if (id == 0 || id > maximumId) {
+        return;
+    }
+
+    allocatedIds.insert(id);
+
+    // Continue the allocation after the reserved ID; any skipped IDs are recovered when the allocation wraps around
+    while (!freeRanges.isEmpty() && freeRanges.first().second <= id) {
+        freeRanges.removeFirst();
+    }
+    if (!freeRanges.isEmpty() && freeRanges.first().first <= id) {
+        freeRanges.first().first = id + 1;
+    }
+}
+
+void NotificationIdAllocator::release(uint id)
+{
+    allocatedIds.remove(id);
+}
+
+bool NotificationIdAllocator::isAllocated(uint id) const
+{
+    return allocatedIds.contains(id);
+}
+
+int NotificationIdAllocator::count() const
+{
+    return allocatedIds.count();
+}
+
+void NotificationIdAllocator::rebuildFreeRanges()
+{
+    QList<uint> ids = allocatedIds.toList();
+    std::sort(ids.begin(), ids.end());
+
+    freeRanges.clear();
+    uint first = 1;
+    foreach (uint id, ids) {
+        if (id > first) {
+            freeRanges.append(qMakePair(first, id - 1));
+        }
+        if (id == maximumId) {
+            return;
+        }
+        first = id + 1;
+    }
+    if (maximumId > 0) {
+        freeRanges.append(qMakePair(first, maximumId));
+    }
+}
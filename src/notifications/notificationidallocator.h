@@ -0,0 +1,101 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONIDALLOCATOR_H
+#define NOTIFICATIONIDALLOCATOR_H
+
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <climits>
+
+/*!
+ * \class NotificationIdAllocator
+ *
+ * \brief Allocates notification IDs.
+ *
+ * IDs are handed out in increasing order starting from 1. When the
+ * largest ID has been used the allocation wraps around and continues
+ * from the smallest ID not in use. ID 0 is never allocated and an ID is
+ * never reallocated before it has been released.
+ *
+ * The unused IDs are kept as a list of free ranges which is consumed from
+ * the front. When the list runs out it is rebuilt from the IDs in use, so
+ * allocation is O(1) amortized as long as the IDs in use are a small
+ * fraction of the ID space.
+ */
+class NotificationIdAllocator
+{
+public:
+    /*!
+     * Creates a notification ID allocator.
+     *
+     * \param maximumId the largest ID to allocate
+     */
+    explicit NotificationIdAllocator(uint maximumId = UINT_MAX);
+
+    /*!
+     * Allocates an unused ID.
+     *
+     * \return the allocated ID or 0 if all IDs are in use
+     */
+    uint allocate();
+
+    /*!
+     * Marks an ID as being in use, for example when restoring stored
+     * notifications. Allocation continues after the largest reserved ID.
+     *
+     * \param id the ID to reserve
+     */
+    void reserve(uint id);
+
+    /*!
+     * Releases an allocated or reserved ID. The ID may be allocated again
+     * after the allocation has wrapped around.
+     *
+     * \param id the ID to release
+     */
+    void release(uint id);
+
+    /*!
+     * Returns whether an ID is in use.
+     *
+     * \param id the ID to check
+     * \return \c true if the ID has been allocated or reserved and not released, \c false otherwise
+     */
+    bool isAllocated(uint id) const;
+
+    /*!
+     * Returns the number of IDs in use.
+     *
+     * \return the number of IDs in use
+     */
+    int count() const;
+
+private:
+    //! Rebuilds the free ranges from the IDs in use
+    void rebuildFreeRanges();
+
+    //! The largest ID to allocate
+    uint maximumId;
+
+    //! IDs currently in use
+    QSet<uint> allocatedIds;
+
+    //! Inclusive ranges of IDs available for allocation in allocation order
+    QList<QPair<uint, uint> > freeRanges;
+};
+
+#endif // NOTIFICATIONIDALLOCATOR_H
@@ -0,0 +1,265 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include "notificationimagestore.h"
+
+//! The version of the serialized image data format
+static const int DATA_STREAM_VERSION = QDataStream::Qt_5_0;
+
+//! The length of an image key: a SHA-1 hash in hexadecimal
+static const int KEY_LENGTH = 40;
+
+//! The maximum width and height of an image in pixels
+static const int MAXIMUM_DIMENSION = 4096;
+
+NotificationImageStore::NotificationImageStore(const QString &path) :
+    path(path),
+    fileWorker(0)
+{
+}
+
+void NotificationImageStore::setFileWorker(QObject *worker)
+{
+    fileWorker = worker;
+}
+
+QString NotificationImageStore::store(const QByteArray &header, const QByteArray &pixels)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(header);
+    hash.addData(pixels);
+    QString key = hash.result().toHex();
+
+    if (!referenceCounts.contains(key)) {
+        if (fileWorker != 0) {
+            // The image is read from memory until the file has been written
+            prunePendingWrites();
+            pendingWrites.insert(key, qMakePair(header, pixels));
+
+            // The file is written after any earlier removal of the same image has been done
+            QMetaObject::invokeMethod(fileWorker, "writeImage", Qt::QueuedConnection, Q_ARG(QString, filePath(key)), Q_ARG(QByteArray, header), Q_ARG(QByteArray, pixels));
+        } else if (!writeFile(filePath(key), header, pixels)) {
+            return QString();
+        }
+    }
+
+    referenceCounts[key]++;
+    return key;
+}
+
+bool NotificationImageStore::addReference(const QString &key)
+{
+    if (!isValidKey(key) || (!referenceCounts.contains(key) && !QFile::exists(filePath(key)))) {
+        return false;
+    }
+
+    referenceCounts[key]++;
+    return true;
+}
+
+void NotificationImageStore::release(const QString &key)
+{
+    QHash<QString, int>::iterator referenceCount = referenceCounts.find(key);
+    if (referenceCount != referenceCounts.end() && --*referenceCount == 0) {
+        referenceCounts.erase(referenceCount);
+        pendingWrites.remove(key);
+        if (fileWorker != 0) {
+            QMetaObject::invokeMethod(fileWorker, "removeImage", Qt::QueuedConnection, Q_ARG(QString, filePath(key)));
+        } else {
+            removeFile(filePath(key));
+        }
+    }
+}
+
+QByteArray NotificationImageStore::data(const QString &key) const
+{
+    if (!isValidKey(key)) {
+        return QByteArray();
+    }
+
+    QHash<QString, QPair<QByteArray, QByteArray> >::const_iterator pendingWrite = pendingWrites.constFind(key);
+    if (pendingWrite != pendingWrites.constEnd()) {
+        return pendingWrite->first + pendingWrite->second;
+    }
+
+    // Image files are never modified once written, so they can be read without waiting for the file worker
+    return readFile(filePath(key));
+}
+
+void NotificationImageStore::removeUnreferenced()
+{
+    if (fileWorker != 0) {
+        QMetaObject::invokeMethod(fileWorker, "removeUnreferencedImages", Qt::QueuedConnection, Q_ARG(QString, path), Q_ARG(QStringList, referenceCounts.keys()));
+    } else {
+        removeUnreferencedFiles(path, referenceCounts.keys());
+    }
+}
+
+int NotificationImageStore::count() const
+{
+    return referenceCounts.count();
+}
+
+bool NotificationImageStore::isValidKey(const QString &key)
+{
+    if (key.length() != KEY_LENGTH) {
+        return false;
+    }
+
+    for (int i = 0; i < KEY_LENGTH; i++) {
+        QChar c = key.at(i);
+        if (!(c >= QLatin1Char('0') && c <= QLatin1Char('9')) && !(c >= QLatin1Char('a') && c <= QLatin1Char('f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NotificationImageStore::isValid(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, int pixelsSize)
+{
+    if (width <= 0 || height <= 0 || width > MAXIMUM_DIMENSION || height > MAXIMUM_DIMENSION || rowstride <= 0 ||
+            bitsPerSample != 8 || channels != (hasAlpha ? 4 : 3)) {
+        return false;
+    }
+
+    // The sizes are calculated in 64 bits so that no combination of the values can overflow
+    qint64 rowSize = qint64(width) * channels;
+    return rowstride >= rowSize && pixelsSize >= qint64(rowstride) * (height - 1) + rowSize;
+}
+
+bool NotificationImageStore::isValid(const QByteArray &data)
+{
+    int width, height, rowstride, bitsPerSample, channels;
+    bool hasAlpha;
+    quint32 pixelsSize;
+    QDataStream stream(data);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream >> width >> height >> rowstride >> hasAlpha >> bitsPerSample >> channels >> pixelsSize;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    // The pixel data must be all that follows the header
+    qint64 remainingSize = data.size() - stream.device()->pos();
+    return pixelsSize == remainingSize && isValid(width, height, rowstride, hasAlpha, bitsPerSample, channels, int(pixelsSize));
+}
+
+QByteArray NotificationImageStore::encode(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, const QByteArray &pixels)
+{
+    return encodeHeader(width, height, rowstride, hasAlpha, bitsPerSample, channels, pixels.size()) + pixels;
+}
+
+QByteArray NotificationImageStore::encodeHeader(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, int pixelsSize)
+{
+    // The size of the pixel data is serialized the same way as a QByteArray
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream << width << height << rowstride << hasAlpha << bitsPerSample << channels << quint32(pixelsSize);
+    return header;
+}
+
+QImage NotificationImageStore::decode(const QByteArray &data)
+{
+    int width, height, rowstride, bitsPerSample, channels;
+    bool hasAlpha;
+    QByteArray pixels;
+    QDataStream stream(data);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream >> width >> height >> rowstride >> hasAlpha >> bitsPerSample >> channels >> pixels;
+
+    if (stream.status() != QDataStream::Ok || !isValid(width, height, rowstride, hasAlpha, bitsPerSample, channels, pixels.size())) {
+        return QImage();
+    }
+
+    QImage image(width, height, hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    for (int y = 0; y < height; y++) {
+        const uchar *source = reinterpret_cast<const uchar *>(pixels.constData()) + qint64(y) * rowstride;
+        QRgb *target = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; x++, source += channels) {
+            target[x] = hasAlpha ? qRgba(source[0], source[1], source[2], source[3]) : qRgb(source[0], source[1], source[2]);
+        }
+    }
+    return image;
+}
+
+bool NotificationImageStore::writeFile(const QString &filePath, const QByteArray &header, const QByteArray &pixels)
+{
+    if (QFile::exists(filePath)) {
+        return true;
+    }
+
+    // Write the image to a temporary file first so that a partially written file is never used
+    QDir::root().mkpath(QFileInfo(filePath).path());
+    QString temporaryPath = filePath + ".tmp";
+    QFile file(temporaryPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(header) != header.size() || file.write(pixels) != pixels.size()) {
+        file.remove();
+        return false;
+    }
+    file.close();
+    if (!QFile::rename(temporaryPath, filePath)) {
+        QFile::remove(temporaryPath);
+        return false;
+    }
+    return true;
+}
+
+QByteArray NotificationImageStore::readFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+void NotificationImageStore::removeFile(const QString &filePath)
+{
+    QFile::remove(filePath);
+}
+
+void NotificationImageStore::removeUnreferencedFiles(const QString &path, const QStringList &keys)
+{
+    QSet<QString> referencedKeys = keys.toSet();
+    QDir directory(path);
+    foreach (const QString &fileName, directory.entryList(QDir::Files)) {
+        if (!referencedKeys.contains(fileName)) {
+            QFile::remove(directory.filePath(fileName));
+        }
+    }
+}
+
+QString NotificationImageStore::filePath(const QString &key) const
+{
+    return isValidKey(key) ? path + QDir::separator() + key : QString();
+}
+
+void NotificationImageStore::prunePendingWrites()
+{
+    QHash<QString, QPair<QByteArray, QByteArray> >::iterator pendingWrite = pendingWrites.begin();
+    while (pendingWrite != pendingWrites.end()) {
+        if (QFile::exists(filePath(pendingWrite.key()))) {
+            pendingWrite = pendingWrites.erase(pendingWrite);
+        } else {
+            ++pendingWrite;
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONIMAGESTORE_H
+#define NOTIFICATIONIMAGESTORE_H
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \class NotificationImageStore
+ *
+ * \brief Stores the image data of notifications in files outside of the notifications.
+ *
+ * Each image is stored once in a file named after the SHA-1 hash of its
+ * data, so identical images sent in several notifications share the same
+ * file. Notifications only keep the key of their image. The store counts
+ * the references to each image and removes the file when the last
+ * reference is released. Only keys of the form generated by the store, 40
+ * lowercase hexadecimal digits, are accepted, so a key can never refer to
+ * a file outside the store.
+ *
+ * The image data is kept in the raw format of the image_data hint of the
+ * Desktop Notifications Specification, serialized using encode(). It is
+ * converted to a QImage only when decode() is called.
+ *
+ * The reference counts are kept in the thread using the store. If a file
+ * worker has been set with setFileWorker(), the files are written and
+ * removed in the thread of the worker, in the order the operations were
+ * requested. Otherwise the files are accessed directly. The files are
+ * always read directly: an image file is never modified once it has been
+ * written, and an image which is still waiting to be written is read from
+ * memory.
+ */
+class NotificationImageStore
+{
+public:
+    /*!
+     * Creates a notification image store. The directory is created when
+     * the first image is stored.
+     *
+     * \param path the directory in which the images are stored
+     */
+    explicit NotificationImageStore(const QString &path);
+
+    /*!
+     * Sets the object in whose thread the image files are accessed. The
+     * object must provide the writeImage(QString, QByteArray, QByteArray),
+     * removeImage(QString) and removeUnreferencedImages(QString, QStringList)
+     * slots, which call writeFile(), removeFile() and
+     * removeUnreferencedFiles() respectively.
+     *
+     * \param worker the object accessing the files or 0 to access them directly
+     */
+    void setFileWorker(QObject *worker);
+
+    /*!
+     * Stores image data and adds a reference to it. If identical data has
+     * already been stored the existing file is used. The data is given in
+     * two parts, which are stored one after the other, so that the pixels
+     * of an image can be stored without copying them.
+     *
+     * \param header the serialized image data or the header returned by encodeHeader()
+     * \param pixels the pixel data following the header, if any
+     * \return the key of the image or an empty string if storing failed
+     */
+    QString store(const QByteArray &header, const QByteArray &pixels = QByteArray());
+
+    /*!
+     * Adds a reference to an image which has already been stored, for
+     * example by an earlier run.
+     *
+     * \param key the key of the image
+     * \return \c true if the image exists, \c false otherwise
+     */
+    bool addReference(const QString &key);
+
+    /*!
+     * Releases a reference to an image. The image file is removed when the
+     * last reference is released.
+     *
+     * \param key the key of the image
+     */
+    void release(const QString &key);
+
+    /*!
+     * Reads the data of an image.
+     *
+     * \param key the key of the image
+     * \return the serialized image data or an empty byte array if the image doesn't exist
+     */
+    QByteArray data(const QString &key) const;
+
+    /*!
+     * Removes the image files which have no references. Should only be
+     * called once the references of all notifications have been added.
+     */
+    void removeUnreferenced();
+
+    /*!
+     * Returns the number of images with references.
+     *
+     * \return the number of referenced images
+     */
+    int count() const;
+
+    /*!
+     * Checks whether a string is a valid image key.
+     *
+     * \param key the string to check
+     * \return \c true if the key consists of 40 lowercase hexadecimal digits, \c false otherwise
+     */
+    static bool isValidKey(const QString &key);
+
+    /*!
+     * Checks whether image data given in the format of the image_data hint
+     * describes a valid image which can be decoded.
+     *
+     * \param width the width of the image in pixels
+     * \param height the height of the image in pixels
+     * \param rowstride the distance between the starts of two rows in bytes
+     * \param hasAlpha whether the image has an alpha channel
+     * \param bitsPerSample the number of bits per color sample; only 8 is supported
+     * \param channels the number of channels, 4 with an alpha channel and 3 without
+     * \param pixelsSize the size of the pixel data in bytes
+     * \return \c true if the image is valid, \c false otherwise
+     */
+    static bool isValid(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, int pixelsSize);
+
+    /*!
+     * Checks whether serialized image data, as returned by encode(),
+     * describes a valid image which can be decoded.
+     *
+     * \param data the serialized image data
+     * \return \c true if the header is valid and followed by exactly the pixel data it describes, \c false otherwise
+     */
+    static bool isValid(const QByteArray &data);
+
+    /*!
+     * Serializes image data given in the format of the image_data hint.
+     *
+     * \param width the width of the image in pixels
+     * \param height the height of the image in pixels
+     * \param rowstride the distance between the starts of two rows in bytes
+     * \param hasAlpha whether the image has an alpha channel
+     * \param bitsPerSample the number of bits per color sample; only 8 is supported
+     * \param channels the number of channels, 4 with an alpha channel and 3 without
+     * \param pixels the RGB or RGBA pixel data
+     * \return the serialized image data
+     */
+    static QByteArray encode(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, const QByteArray &pixels);
+
+    /*!
+     * Serializes the part of image data preceding the pixels. The header
+     * followed by the pixels is the same as the data returned by encode().
+     *
+     * \param width the width of the image in pixels
+     * \param height the height of the image in pixels
+     * \param rowstride the distance between the starts of two rows in bytes
+     * \param hasAlpha whether the image has an alpha channel
+     * \param bitsPerSample the number of bits per color sample; only 8 is supported
+     * \param channels the number of channels, 4 with an alpha channel and 3 without
+     * \param pixelsSize the size of the pixel data in bytes
+     * \return the serialized header
+     */
+    static QByteArray encodeHeader(int width, int height, int rowstride, bool hasAlpha, int bitsPerSample, int channels, int pixelsSize);
+
+    /*!
+     * Converts serialized image data to an image.
+     *
+     * \param data the serialized image data
+     * \return the image or a null image if the data is not valid
+     */
+    static QImage decode(const QByteArray &data);
+
+    //! Writes the header and the pixels of an image to a file, replacing the file only once it has been fully written
+    static bool writeFile(const QString &filePath, const QByteArray &header, const QByteArray &pixels);
+
+    //! Reads the data of an image from a file
+    static QByteArray readFile(const QString &filePath);
+
+    //! Removes the file of an image
+    static void removeFile(const QString &filePath);
+
+    //! Removes the files in a directory which are not named after one of the given keys
+    static void removeUnreferencedFiles(const QString &path, const QStringList &keys);
+
+private:
+    //! Returns the path of the file of an image or an empty string if the key is not valid
+    QString filePath(const QString &key) const;
+
+    //! Drops the images which have been written by the file worker from the pending writes
+    void prunePendingWrites();
+
+    //! The directory in which the images are stored
+    QString path;
+
+    //! Object in whose thread the files are accessed or 0 if they are accessed directly
+    QObject *fileWorker;
+
+    //! Number of references to each image keyed by image keys
+    QHash<QString, int> referenceCounts;
+
+    //! Header and pixels of the images queued to the file worker which may not have been written yet keyed by image keys
+    QHash<QString, QPair<QByteArray, QByteArray> > pendingWrites;
+};
+
+#endif // NOTIFICATIONIMAGESTORE_H
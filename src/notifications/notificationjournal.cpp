@@ -0,0 +1,140 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QDataStream>
+#include <unistd.h>
+#include "notificationjournal.h"
+
+//! The version of the QDataStream format used for the journal entries
+static const int DATA_STREAM_VERSION = QDataStream::Qt_5_0;
+
+//! Size of the header preceding each entry: the payload size and its checksum
+static const int ENTRY_HEADER_SIZE = sizeof(quint32) + sizeof(quint16);
+
+NotificationJournal::NotificationJournal(const QString &path) :
+    file(path),
+    dirty(false)
+{
+}
+
+void NotificationJournal::appendStore(const NotificationDatabase::Record &record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream << quint8(StoreNotification) << record.id << record.appName << record.appIcon << record.summary << record.body << qint32(record.expireTimeout) << record.data << record.expireAt;
+    append(payload);
+}
+
+void NotificationJournal::appendRemove(uint id)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(DATA_STREAM_VERSION);
+    stream << quint8(RemoveNotification) << id;
+    append(payload);
+}
+
+void NotificationJournal::sync()
+{
+    if (file.isOpen()) {
+        fdatasync(file.handle());
+    }
+}
+
+QList<NotificationJournal::Entry> NotificationJournal::read() const
+{
+    QList<Entry> entries;
+    QFile journal(file.fileName());
+    if (!journal.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QByteArray contents = journal.readAll();
+    int position = 0;
+    while (contents.size() - position >= ENTRY_HEADER_SIZE) {
+        quint32 size;
+        quint16 checksum;
+        {
+            QDataStream header(contents.mid(position, ENTRY_HEADER_SIZE));
+            header >> size >> checksum;
+        }
+        position += ENTRY_HEADER_SIZE;
+        if (size > quint32(contents.size() - position)) {
+            // The last entry was not written completely
+            break;
+        }
+
+        QByteArray payload = contents.mid(position, size);
+        position += size;
+        if (qChecksum(payload.constData(), payload.size()) != checksum) {
+            break;
+        }
+
+        QDataStream stream(payload);
+        stream.setVersion(DATA_STREAM_VERSION);
+        quint8 operation;
+        Entry entry;
+        stream >> operation >> entry.record.id;
+        if (operation == StoreNotification) {
+            qint32 expireTimeout;
+            stream >> entry.record.appName >> entry.record.appIcon >> entry.record.summary >> entry.record.body >> expireTimeout >> entry.record.data >> entry.record.expireAt;
+            entry.record.expireTimeout = expireTimeout;
+        } else if (operation != RemoveNotification) {
+            break;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        entry.operation = Operation(operation);
+        entries.append(entry);
+    }
+
+    return entries;
+}
+
+void NotificationJournal::clear()
+{
+    if (file.isOpen()) {
+        if (dirty) {
+            file.resize(0);
+        }
+    } else if (file.exists()) {
+        file.resize(0);
+    }
+    dirty = false;
+}
+
+bool NotificationJournal::isEmpty() const
+{
+    return !dirty && QFile(file.fileName()).size() == 0;
+}
+
+void NotificationJournal::append(const QByteArray &payload)
+{
+    if (!file.isOpen() && !file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        return;
+    }
+
+    QByteArray entry;
+    QDataStream header(&entry, QIODevice::WriteOnly);
+    header << quint32(payload.size()) << qChecksum(payload.constData(), payload.size());
+    entry.append(payload);
+
+    // The entry is written to the file with a single system call so that it survives lipstick crashing right after this
+    file.write(entry);
+    dirty = true;
+}
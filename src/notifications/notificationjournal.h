@@ -0,0 +1,118 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONJOURNAL_H
+#define NOTIFICATIONJOURNAL_H
+
+#include <QFile>
+#include "notificationdatabase.h"
+
+/*!
+ * \class NotificationJournal
+ *
+ * \brief An append-only log of the notification database modifications which have not been committed yet.
+ *
+ * Each modification is appended to the journal file as a single
+ * checksummed entry as soon as it is made, which is far cheaper than
+ * committing a database transaction. If lipstick exits before the
+ * transaction is committed the entries are replayed into the database on
+ * the next start. The journal is cleared whenever the database transaction
+ * has been committed.
+ *
+ * Replaying an entry more than once has the same effect as replaying it
+ * once, so a crash between committing the database and clearing the
+ * journal is harmless. An entry which was only partially written when
+ * lipstick exited is detected by its checksum and ignored along with
+ * anything after it.
+ */
+class NotificationJournal
+{
+public:
+    //! The type of a journal entry
+    enum Operation {
+        //! A notification was added or replaced
+        StoreNotification = 1,
+        //! A notification was removed
+        RemoveNotification
+    };
+
+    //! A modification read from the journal
+    struct Entry {
+        Entry() : operation(StoreNotification) {}
+
+        //! The type of the modification
+        Operation operation;
+        //! The stored notification with its actions and hints serialized in the data field, or only the ID of a removed notification
+        NotificationDatabase::Record record;
+    };
+
+    /*!
+     * Creates a journal. The journal file is not opened before the first
+     * entry is appended.
+     *
+     * \param path the path of the journal file
+     */
+    explicit NotificationJournal(const QString &path);
+
+    /*!
+     * Appends a stored notification to the journal.
+     *
+     * \param record the notification; the actions and hints are expected to be serialized in the data field
+     */
+    void appendStore(const NotificationDatabase::Record &record);
+
+    /*!
+     * Appends a removed notification to the journal.
+     *
+     * \param id the ID of the removed notification
+     */
+    void appendRemove(uint id);
+
+    /*!
+     * Flushes the appended entries to the storage device so that they are
+     * not lost even if the whole device goes down.
+     */
+    void sync();
+
+    /*!
+     * Reads the intact entries of the journal in the order they were
+     * appended.
+     *
+     * \return the entries of the journal
+     */
+    QList<Entry> read() const;
+
+    //! Removes all entries from the journal.
+    void clear();
+
+    /*!
+     * Returns whether the journal has entries.
+     *
+     * \return \c true if there are no entries in the journal, \c false otherwise
+     */
+    bool isEmpty() const;
+
+private:
+    //! Appends a single serialized entry to the journal file
+    void append(const QByteArray &payload);
+
+    //! The journal file; kept open for appending once the first entry has been written
+    QFile file;
+
+    //! Whether any entries have been appended since the journal was last cleared
+    bool dirty;
+};
+
+#endif // NOTIFICATIONJOURNAL_H
@@ -13,14 +13,18 @@
 **
 ****************************************************************************/
 
+#include <algorithm>
+#include <functional>
 #include "notificationmanager.h"
 #include "notificationlistmodel.h"
 
+//! The number of rows placed in the model at a time when the view fetches more rows
+static const int FETCH_BATCH_SIZE = 20;
+
 NotificationListModel::NotificationListModel(QObject *parent) :
     QObjectListModel(parent)
 {
-    connect(NotificationManager::instance(), SIGNAL(notificationModified(uint)), this, SLOT(updateNotification(uint)));
-    connect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), this, SLOT(removeNotification(uint)));
+    connect(NotificationManager::instance(), SIGNAL(notificationsChanged(QList<uint>, QList<uint>)), this, SLOT(updateNotifications(QList<uint>, QList<uint>)));
     connect(this, SIGNAL(clearRequested()), NotificationManager::instance(), SLOT(removeUserRemovableNotifications()));
 
     QTimer::singleShot(0, this, SLOT(init()));
@@ -32,48 +36,200 @@ NotificationListModel::~NotificationListModel()
 
 void NotificationListModel::init()
 {
-    foreach(uint id, NotificationManager::instance()->notificationIds()) {
+    // Only the timestamps are needed for ordering the notifications, so they are not created before their rows are fetched
+    NotificationManager *manager = NotificationManager::instance();
+    foreach(uint id, manager->notificationIds()) {
+        if (!sortKeys.contains(id)) {
+            addPendingNotification(id, manager->notificationTimestamp(id));
+        }
+    }
+
+    fetchMore(QModelIndex());
+}
+
+bool NotificationListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !pendingNotifications.isEmpty();
+}
+
+void NotificationListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    // Place the latest pending notifications until a batch of rows has been added
+    int targetCount = itemCount() + FETCH_BATCH_SIZE;
+    while (itemCount() < targetCount && !pendingNotifications.isEmpty()) {
+        updateNotification((pendingNotifications.end() - 1).value());
+    }
+}
+
+void NotificationListModel::updateNotifications(const QList<uint> &modifiedIds, const QList<uint> &removedIds)
+{
+    if (!removedIds.isEmpty()) {
+        // The removed notifications can no longer be fetched from the manager so find them by their IDs
+        QList<int> rows;
+        foreach (uint id, removedIds) {
+            int row = rowFor(id);
+            if (row >= 0) {
+                rows.append(row);
+            }
+        }
+        foreach (uint id, removedIds) {
+            removePendingNotification(id);
+        }
+
+        // Remove the rows starting from the last one, removing adjacent rows at once
+        std::sort(rows.begin(), rows.end(), std::greater<int>());
+        for (int i = 0; i < rows.count();) {
+            int first = i;
+            while (i + 1 < rows.count() && rows.at(i + 1) == rows.at(i) - 1) {
+                i++;
+            }
+            removeNotifications(rows.at(i), i - first + 1);
+            i++;
+        }
+    }
+
+    foreach (uint id, modifiedIds) {
         updateNotification(id);
     }
 }
 
 void NotificationListModel::updateNotification(uint id)
 {
+    removePendingNotification(id);
+
     LipstickNotification *notification = NotificationManager::instance()->notification(id);
 
     if (notification != 0) {
-        int index = indexOf(notification);
+        int index = rowFor(id);
+        if (index >= 0 && get(index) != notification) {
+            // The notification has been replaced by another one with the same ID
+            removeNotifications(index);
+            index = -1;
+        }
+
         if (notificationShouldBeShown(notification)) {
             // Place the notifications in the model latest first, moving existing notifications if necessary
-            int expectedIndex = indexFor(notification);
-            if (index < 0) {
-                insertItem(expectedIndex, notification);
-            } else if (index != expectedIndex) {
-                move(index, expectedIndex);
+            qint64 key = sortKey(notification);
+            if (!pendingNotifications.isEmpty() && key < (pendingNotifications.end() - 1).key()) {
+                // The notification belongs after rows not fetched yet so it is fetched along with them
+                if (index >= 0) {
+                    removeNotifications(index);
+                }
+                addPendingNotification(id, key);
+            } else if (index < 0) {
+                insertNotification(indexFor(notification), id, notification, key);
+            } else {
+                // The row being moved still has its previous sort key so it is skipped when counting the rows before the new position
+                int expectedIndex = indexFor(notification);
+                if (expectedIndex > index) {
+                    expectedIndex--;
+                }
+                sortKeys.insert(id, key);
+                if (index != expectedIndex) {
+                    move(index, expectedIndex);
+                }
             }
         } else if (index >= 0) {
-            removeItem(notification);
+            removeNotifications(index);
         }
     }
 }
 
 int NotificationListModel::indexFor(LipstickNotification *notification)
 {
-    for (int index = 0; index < itemCount(); index++) {
-        LipstickNotification *notificationAtIndex = static_cast<LipstickNotification *>(get(index));
-        if (notificationAtIndex->timestamp() <= notification->timestamp()) {
+    return lowerBound(sortKey(notification));
+}
+
+qint64 NotificationListModel::sortKey(LipstickNotification *notification)
+{
+    QDateTime timestamp = notification->timestamp();
+    return timestamp.isValid() ? timestamp.toMSecsSinceEpoch() : 0;
+}
+
+qint64 NotificationListModel::sortKeyAt(int index)
+{
+    return sortKeys.value(static_cast<LipstickNotification *>(get(index))->replacesId());
+}
+
+int NotificationListModel::lowerBound(qint64 key)
+{
+    // The rows are ordered by descending sort keys
+    int first = 0;
+    int last = itemCount();
+    while (first < last) {
+        int middle = first + (last - first) / 2;
+        if (sortKeyAt(middle) <= key) {
+            last = middle;
+        } else {
+            first = middle + 1;
+        }
+    }
+    return first;
+}
+
+int NotificationListModel::rowFor(uint id)
+{
+    QHash<uint, qint64>::const_iterator key = sortKeys.constFind(id);
+    if (key == sortKeys.constEnd()) {
+        return -1;
+    }
+
+    // Several notifications may share the sort key so check each of them
+    for (int index = lowerBound(*key); index < itemCount() && sortKeyAt(index) == *key; index++) {
+        if (static_cast<LipstickNotification *>(get(index))->replacesId() == id) {
             return index;
         }
     }
-    return itemCount();
+    return -1;
 }
 
-void NotificationListModel::removeNotification(uint id)
+void NotificationListModel::insertNotification(int index, uint id, LipstickNotification *notification, qint64 key)
 {
-    removeItem(NotificationManager::instance()->notification(id));
+    sortKeys.insert(id, key);
+    notificationIds.insert(notification, id);
+    insertItem(index, notification);
+}
+
+void NotificationListModel::removeNotifications(int index, int count)
+{
+    for (int i = index; i < index + count; i++) {
+        sortKeys.remove(notificationIds.take(get(i)));
+    }
+    removeItems(index, count);
+}
+
+void NotificationListModel::removeDestroyedItem()
+{
+    // The destroyed notification can no longer tell its ID so it is looked up to drop the sort key
+    QHash<QObject *, uint>::iterator id = notificationIds.find(sender());
+    if (id != notificationIds.end()) {
+        sortKeys.remove(*id);
+        notificationIds.erase(id);
+    }
+
+    QObjectListModel::removeDestroyedItem();
+}
+
+void NotificationListModel::addPendingNotification(uint id, qint64 key)
+{
+    pendingNotifications.insert(key, id);
+    pendingSortKeys.insert(id, key);
+}
+
+void NotificationListModel::removePendingNotification(uint id)
+{
+    QHash<uint, qint64>::iterator key = pendingSortKeys.find(id);
+    if (key != pendingSortKeys.end()) {
+        pendingNotifications.remove(*key, id);
+        pendingSortKeys.erase(key);
+    }
 }
 
 bool NotificationListModel::notificationShouldBeShown(LipstickNotification *notification)
 {
-    return !notification->hints().value(NotificationManager::HINT_HIDDEN).toBool() && !(notification->body().isEmpty() && notification->summary().isEmpty()) && notification->hints().value(NotificationManager::HINT_URGENCY).toInt() < 2;
+    return !notification->isHidden() && !(notification->body().isEmpty() && notification->summary().isEmpty()) && notification->urgency() < 2;
 }
@@ -16,11 +16,24 @@
 #ifndef NOTIFICATIONLISTMODEL_H
 #define NOTIFICATIONLISTMODEL_H
 
+#include <QHash>
+#include <QMultiMap>
 #include "qobjectlistmodel.h"
 #include "lipstickglobal.h"
 
 class LipstickNotification;
 
+/*!
+ * \class NotificationListModel
+ *
+ * \brief A model of the notifications to be shown in the notification list,
+ * latest first.
+ *
+ * The notifications are ordered by their timestamps, which are available
+ * without creating the lazily restored notifications. The rows are
+ * fetched in batches as the view asks for them, so the notifications
+ * further down the list are only created once they are scrolled to.
+ */
 class LIPSTICK_EXPORT NotificationListModel : public QObjectListModel
 {
     Q_OBJECT
@@ -29,13 +42,27 @@ public:
     explicit NotificationListModel(QObject *parent = 0);
     virtual ~NotificationListModel();
 
+    //! \reimp
+    virtual bool canFetchMore(const QModelIndex &parent) const;
+    virtual void fetchMore(const QModelIndex &parent);
+    //! \reimp_end
+
 signals:
     void clearRequested();
 
 private slots:
     void init();
-    void updateNotification(uint id);
-    void removeNotification(uint id);
+
+    /*!
+     * Applies a batch of notification changes to the model. Removed
+     * notifications are removed first, removing adjacent rows with a single
+     * row operation, after which the modified notifications are inserted,
+     * moved or removed as needed.
+     *
+     * \param modifiedIds the IDs of the modified notifications
+     * \param removedIds the IDs of the removed notifications
+     */
+    void updateNotifications(const QList<uint> &modifiedIds, const QList<uint> &removedIds);
 
 protected:
     /*!
@@ -50,14 +77,59 @@ protected:
 
     /*!
      * Checks where the notification should be placed so that the
-     * notifications in the model are ordered by timestamp.
+     * notifications in the model are ordered by timestamp. The position is
+     * found with a binary search over the cached sort keys of the rows.
      *
      * \param notification the notification for which to get the position
      * \return index in which the notification shoud be placed
      */
     virtual int indexFor(LipstickNotification *notification);
 
+protected slots:
+    //! \reimp
+    virtual void removeDestroyedItem();
+    //! \reimp_end
+
 private:
+    //! Inserts, moves or removes a notification in the model depending on whether it should be shown
+    void updateNotification(uint id);
+
+    //! Returns the sort key of a notification: its timestamp in milliseconds since the epoch
+    static qint64 sortKey(LipstickNotification *notification);
+
+    //! Returns the cached sort key of the notification in the given row
+    qint64 sortKeyAt(int index);
+
+    //! Returns the first row whose cached sort key is less than or equal to the given key
+    int lowerBound(qint64 key);
+
+    //! Returns the row of the notification with the given ID or -1 if it is not in the model
+    int rowFor(uint id);
+
+    //! Inserts a notification to the given row and caches its sort key
+    void insertNotification(int index, uint id, LipstickNotification *notification, qint64 key);
+
+    //! Removes the given number of rows starting from the given row and drops their cached sort keys
+    void removeNotifications(int index, int count = 1);
+
+    //! Adds a notification to the notifications not fetched yet
+    void addPendingNotification(uint id, qint64 key);
+
+    //! Removes a notification from the notifications not fetched yet, if it is there
+    void removePendingNotification(uint id);
+
+    //! Sort keys of the notifications in the model at the time they were placed, keyed by notification IDs
+    QHash<uint, qint64> sortKeys;
+
+    //! IDs of the notifications in the model keyed by the notifications, for dropping the sort keys of destroyed notifications
+    QHash<QObject *, uint> notificationIds;
+
+    //! IDs of the notifications not fetched to the model yet keyed by their sort keys
+    QMultiMap<qint64, uint> pendingNotifications;
+
+    //! Sort keys of the notifications not fetched to the model yet keyed by notification IDs
+    QHash<uint, qint64> pendingSortKeys;
+
     Q_DISABLE_COPY(NotificationListModel)
 
 #ifdef UNIT_TEST
@@ -13,18 +13,24 @@
 **
 ****************************************************************************/
 
+#include <climits>
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
-#include <QSqlDatabase>
-#include <QSqlError>
-#include <QSqlQuery>
-#include <QSqlRecord>
-#include <QSqlTableModel>
+#include <QDBusArgument>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSettings>
 #include <mremoteaction.h>
-#include <sys/statfs.h>
+#include <qmactivity.h>
 #include "categorydefinitionstore.h"
+#include "notificationdatabase.h"
+#include "notificationidallocator.h"
+#include "notificationimagestore.h"
+#include "notificationstringpool.h"
 #include "notificationmanageradaptor.h"
 #include "notificationmanager.h"
+#include "systemstate.h"
 
 // Define this if you'd like to see debug messages from the notification manager
 #ifdef DEBUG_NOTIFICATIONS
@@ -36,14 +42,50 @@
 //! The category definitions directory
 static const char *CATEGORY_DEFINITION_FILE_DIRECTORY = "/usr/share/lipstick/notificationcategories";
 
-//! The number configuration files to load into the event type store.
-static const uint MAX_CATEGORY_DEFINITION_FILES = 100;
+//! The name of the precompiled category definition cache file in the notification data directory
+static const char *CATEGORY_DEFINITION_CACHE_FILE = "categorydefinitions.cache";
 
-//! Path of the privileged storage directory relative to the home directory
-static const char *PRIVILEGED_DATA_PATH= "/.local/share/system/privileged";
+//! The default number of category definitions to keep in memory
+static const uint DEFAULT_MAX_CATEGORY_DEFINITIONS = 100;
 
-//! Minimum amount of disk space needed for the notification database in kilobytes
-static const uint MINIMUM_FREE_SPACE_NEEDED_IN_KB = 1024;
+//! The global lipstick settings file
+static const char *LIPSTICK_SETTINGS_FILE = "/usr/share/lipstick/lipstick.conf";
+
+//! The default number of notifications an application can send in a burst
+static const int DEFAULT_RATE_LIMIT_BURST = 50;
+
+//! The default number of notifications per second an application can send after a burst
+static const double DEFAULT_RATE_LIMIT_RATE = 10;
+
+//! The category definition key for overriding the rate limit burst size
+static const char *RATE_LIMIT_BURST_KEY = "x-nemo-rate-limit-burst";
+
+//! The category definition key for overriding the rate limit refill rate
+static const char *RATE_LIMIT_RATE_KEY = "x-nemo-rate-limit-rate";
+
+//! The number of rate limit buckets after which the buckets that have been refilled are dropped
+static const int RATE_LIMIT_BUCKET_SWEEP_THRESHOLD = 64;
+
+//! The maximum number of notifications handled in one NotifyBatch() call
+static const int MAXIMUM_BATCH_SIZE = 100;
+
+//! The interval in milliseconds for signaling notification updates deferred because of rate limiting
+static const int MODIFICATION_COALESCING_INTERVAL = 500;
+
+//! The maximum number of closed notifications remembered for GetNotificationChanges()
+static const int MAXIMUM_REMOVAL_COUNT = 1000;
+
+//! The time in milliseconds the device must stay idle with the display off before the database maintenance starts
+static const int DATABASE_MAINTENANCE_DELAY = 60 * 1000;
+
+//! The minimum time in milliseconds between two database maintenance runs
+static const qint64 DATABASE_MAINTENANCE_INTERVAL = 60 * 60 * 1000;
+
+//! The default time in milliseconds a database maintenance run can spend vacuuming
+static const int DEFAULT_DATABASE_MAINTENANCE_TIME_BUDGET = 200;
+
+//! The default amount of data in bytes a database maintenance run can vacuum
+static const qint64 DEFAULT_DATABASE_MAINTENANCE_SIZE_BUDGET = 1024 * 1024;
 
 const char *NotificationManager::HINT_URGENCY = "urgency";
 const char *NotificationManager::HINT_CATEGORY = "category";
@@ -66,6 +108,22 @@ const char *NotificationManager::HINT_USER_CLOSEABLE = "x-nemo-user-closeable";
 const char *NotificationManager::HINT_FEEDBACK = "x-nemo-feedback";
 const char *NotificationManager::HINT_HIDDEN = "x-nemo-hidden";
 const char *NotificationManager::HINT_DISPLAY_ON = "x-nemo-display-on";
+const char *NotificationManager::HINT_IMAGE_DATA_KEY = "x-nemo-image-data-key";
+
+class NotificationManagerPrivate
+{
+public:
+    NotificationManagerPrivate() : batching(false) {}
+
+    //! Records of the lazily restored notifications which have not been accessed yet keyed by notification IDs
+    QHash<uint, NotificationDatabase::Record> unrestoredNotifications;
+
+    //! Whether the notifications of a NotifyBatch() call are being handled
+    bool batching;
+
+    //! Records of the notifications of the batch being handled, stored at the end of the batch
+    QList<NotificationDatabase::Record> batchRecords;
+};
 
 NotificationManager *NotificationManager::instance_ = 0;
 
@@ -79,116 +137,276 @@ NotificationManager *NotificationManager::instance()
 
 NotificationManager::NotificationManager(QObject *parent) :
     QObject(parent),
-    previousNotificationID(0),
-    categoryDefinitionStore(new CategoryDefinitionStore(CATEGORY_DEFINITION_FILE_DIRECTORY, MAX_CATEGORY_DEFINITION_FILES, this)),
-    database(new QSqlDatabase),
-    committed(true)
+    d(new NotificationManagerPrivate),
+    restoreDuration_(0),
+    idAllocator(new NotificationIdAllocator),
+    imageStore(new NotificationImageStore(NotificationDatabase::dataPath() + QDir::separator() + "images")),
+    imageReferencesCounted(false),
+    categoryDefinitionStore(new CategoryDefinitionStore(CATEGORY_DEFINITION_FILE_DIRECTORY, DEFAULT_MAX_CATEGORY_DEFINITIONS, this)),
+    database(new NotificationDatabase),
+    defaultRateLimitBurst(DEFAULT_RATE_LIMIT_BURST),
+    defaultRateLimitRate(DEFAULT_RATE_LIMIT_RATE),
+    rateLimitBucketSweepThreshold(RATE_LIMIT_BUCKET_SWEEP_THRESHOLD),
+    droppedNotificationCount_(0),
+    coalescedNotificationCount_(0),
+    activity(new MeeGo::QmActivity(this)),
+    databaseMaintenanceTimeBudget(DEFAULT_DATABASE_MAINTENANCE_TIME_BUDGET),
+    databaseMaintenanceSizeBudget(DEFAULT_DATABASE_MAINTENANCE_SIZE_BUDGET),
+    // Start the change sequence from the current time so that the numbers keep increasing across restarts
+    changeSequence_(quint64(QDateTime::currentMSecsSinceEpoch()) * 1000),
+    firstChangeSequence(changeSequence_),
+    forgottenRemovalSequence(changeSequence_)
 {
     qDBusRegisterMetaType<QVariantHash>();
     qDBusRegisterMetaType<LipstickNotification>();
+    qDBusRegisterMetaType<NotificationData>();
     qDBusRegisterMetaType<NotificationList>();
+    qDBusRegisterMetaType<QList<uint> >();
 
     new NotificationManagerAdaptor(this);
     QDBusConnection::sessionBus().registerService("org.freedesktop.Notifications");
     QDBusConnection::sessionBus().registerObject("/org/freedesktop/Notifications", this);
 
-    connect(categoryDefinitionStore, SIGNAL(categoryDefinitionUninstalled(QString)), this, SLOT(removeNotificationsWithCategory(QString)));
-    connect(categoryDefinitionStore, SIGNAL(categoryDefinitionModified(QString)), this, SLOT(updateNotificationsWithCategory(QString)));
-
-    // Commit the modifications to the database 10 seconds after the last modification so that writing to disk doesn't affect user experience
-    databaseCommitTimer.setInterval(10000);
-    databaseCommitTimer.setSingleShot(true);
-    connect(&databaseCommitTimer, SIGNAL(timeout()), this, SLOT(commit()));
+    categoryDefinitionStore->setCachePath(NotificationDatabase::dataPath() + QDir::separator() + CATEGORY_DEFINITION_CACHE_FILE);
+    connect(categoryDefinitionStore, SIGNAL(categoryDefinitionsChanged(QStringList, QStringList)), this, SLOT(applyCategoryDefinitionChanges(QStringList, QStringList)));
+
+    // Write the notifications to the disk in a separate thread so that disk I/O doesn't block the D-Bus handlers or the UI
+    database->moveToThread(&databaseThread);
+    imageStore->setFileWorker(database);
+    connect(&databaseThread, SIGNAL(finished()), database, SLOT(deleteLater()));
+    connect(database, SIGNAL(transactionCommitted()), this, SLOT(destroyRemovedNotifications()));
+    databaseThread.start();
+
+    expirationTimer.setSingleShot(true);
+    connect(&expirationTimer, SIGNAL(timeout()), this, SLOT(expireNotifications()));
+
+    QSettings settings(LIPSTICK_SETTINGS_FILE, QSettings::IniFormat);
+    defaultRateLimitBurst = settings.value("notifications/rate_limit_burst", DEFAULT_RATE_LIMIT_BURST).toInt();
+    defaultRateLimitRate = settings.value("notifications/rate_limit_rate", DEFAULT_RATE_LIMIT_RATE).toDouble();
+    rateLimitClock.start();
+    databaseMaintenanceTimeBudget = settings.value("notifications/maintenance_time_budget", DEFAULT_DATABASE_MAINTENANCE_TIME_BUDGET).toInt();
+    databaseMaintenanceSizeBudget = settings.value("notifications/maintenance_size_budget", DEFAULT_DATABASE_MAINTENANCE_SIZE_BUDGET).toLongLong();
+    categoryDefinitionStore->setMaxStoredCategoryDefinitions(settings.value("notifications/max_category_definitions", DEFAULT_MAX_CATEGORY_DEFINITIONS).toUInt());
+
+    modificationCoalescingTimer.setSingleShot(true);
+    modificationCoalescingTimer.setInterval(MODIFICATION_COALESCING_INTERVAL);
+    connect(&modificationCoalescingTimer, SIGNAL(timeout()), this, SLOT(emitPendingModifications()));
+
+    notificationsChangedTimer.setSingleShot(true);
+    notificationsChangedTimer.setInterval(0);
+    connect(&notificationsChangedTimer, SIGNAL(timeout()), this, SLOT(emitNotificationsChanged()));
+
+    // Compact the database only when the device is not being used
+    databaseMaintenanceTimer.setSingleShot(true);
+    databaseMaintenanceTimer.setInterval(DATABASE_MAINTENANCE_DELAY);
+    connect(&databaseMaintenanceTimer, SIGNAL(timeout()), this, SLOT(performDatabaseMaintenance()));
+    connect(SystemState::instance(), SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), this, SLOT(scheduleDatabaseMaintenance()));
+    connect(activity, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)), this, SLOT(scheduleDatabaseMaintenance()));
 
     restoreNotifications();
 }
 
 NotificationManager::~NotificationManager()
 {
-    database->commit();
-    delete database;
+    // Apply and store any deferred updates before the final commit
+    emitPendingModifications();
+
+    // Wait until all queued database operations have been written and committed
+    QMetaObject::invokeMethod(database, "commit", Qt::BlockingQueuedConnection);
+    databaseThread.quit();
+    databaseThread.wait();
+
+    delete imageStore;
+    delete idAllocator;
+    delete d;
 }
 
-LipstickNotification *NotificationManager::notification(uint id) const
+LipstickNotification *NotificationManager::notification(uint id)
 {
-    return notifications.value(id);
+    LipstickNotification *notification = notifications.value(id);
+    if (notification == 0 && d->unrestoredNotifications.contains(id)) {
+        // Create lazily restored notifications on first access
+        notification = restoreNotification(id);
+    }
+    return notification;
 }
 
 QList<uint> NotificationManager::notificationIds() const
 {
-    return notifications.keys();
+    return notifications.keys() + d->unrestoredNotifications.keys();
+}
+
+qint64 NotificationManager::notificationTimestamp(uint id) const
+{
+    LipstickNotification *notification = notifications.value(id);
+    if (notification != 0) {
+        QDateTime timestamp = notification->timestamp();
+        return timestamp.isValid() ? timestamp.toMSecsSinceEpoch() : 0;
+    }
+
+    // The timestamps of the lazily restored notifications are read from their own column so no decoding is needed
+    return d->unrestoredNotifications.value(id).timestamp;
+}
+
+QList<uint> NotificationManager::notificationIdsForAppName(const QString &appName) const
+{
+    return notificationIdsByAppName.values(appName);
+}
+
+QList<uint> NotificationManager::notificationIdsForCategory(const QString &category) const
+{
+    return notificationIdsByCategory.values(category);
+}
+
+qint64 NotificationManager::restoreDuration() const
+{
+    return restoreDuration_;
+}
+
+uint NotificationManager::droppedNotificationCount() const
+{
+    return droppedNotificationCount_;
+}
+
+uint NotificationManager::coalescedNotificationCount() const
+{
+    return coalescedNotificationCount_;
+}
+
+QVariantMap NotificationManager::databaseStatistics() const
+{
+    NotificationDatabase::Statistics statistics = database->statistics();
+    QVariantMap map;
+    map.insert("databaseSize", statistics.databaseSize);
+    map.insert("walSize", statistics.walSize);
+    map.insert("pageSize", statistics.pageSize);
+    map.insert("pageCount", statistics.pageCount);
+    map.insert("freePageCount", statistics.freePageCount);
+    map.insert("fragmentation", statistics.fragmentation());
+    map.insert("maintenanceCount", statistics.maintenanceCount);
+    map.insert("lastMaintenanceDuration", statistics.lastMaintenanceDuration);
+    return map;
+}
+
+QImage NotificationManager::notificationImage(uint id)
+{
+    LipstickNotification *notification = this->notification(id);
+    if (notification == 0) {
+        return QImage();
+    }
+
+    QString key = notification->hints().value(HINT_IMAGE_DATA_KEY).toString();
+    return key.isEmpty() ? QImage() : NotificationImageStore::decode(imageStore->data(key));
 }
 
 QStringList NotificationManager::GetCapabilities()
 {
-    return QStringList() << "body" << "actions" << HINT_ICON << HINT_ITEM_COUNT << HINT_TIMESTAMP << HINT_PREVIEW_ICON << HINT_PREVIEW_BODY << HINT_PREVIEW_SUMMARY << "x-nemo-remote-actions" << HINT_USER_REMOVABLE << "x-nemo-get-notifications";
+    return QStringList() << "body" << "actions" << HINT_ICON << HINT_ITEM_COUNT << HINT_TIMESTAMP << HINT_PREVIEW_ICON << HINT_PREVIEW_BODY << HINT_PREVIEW_SUMMARY << "x-nemo-remote-actions" << HINT_USER_REMOVABLE << "x-nemo-get-notifications" << "x-nemo-notify-batch" << "x-nemo-get-notification-changes";
 }
 
 uint NotificationManager::Notify(const QString &appName, uint replacesId, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &originalHints, int expireTimeout)
 {
-    uint id = replacesId != 0 ? replacesId : nextAvailableNotificationID();
-
-    if (replacesId == 0 || notifications.contains(id)) {
-        // Apply a category definition, if any, to the hints
-        QVariantHash hints(originalHints);
-        applyCategoryDefinition(hints);
+    bool withinRateLimit = consumeRateLimitToken(appName, originalHints.value(HINT_CATEGORY).toString());
+    return notify(NotificationData(appName, replacesId, appIcon, summary, body, actions, originalHints, expireTimeout), withinRateLimit);
+}
 
-        // Ensure the hints contain a timestamp
-        addTimestamp(hints);
+uint NotificationManager::notify(const NotificationData &originalData, bool withinRateLimit)
+{
+    uint replacesId = originalData.replacesId;
+    if (replacesId == 0 && !withinRateLimit) {
+        // New notifications from applications exceeding their rate limit are dropped
+        droppedNotificationCount_++;
+        NOTIFICATIONS_DEBUG("DROP:" << originalData.appName << originalData.appIcon << originalData.summary << originalData.body);
+        return 0;
+    }
 
-        if (replacesId == 0) {
-            // Create a new notification
-            LipstickNotification *notification = new LipstickNotification(appName, id, appIcon, summary, body, actions, hints, expireTimeout, this);
-            connect(notification, SIGNAL(actionInvoked(QString)), this, SLOT(invokeAction(QString)));
-            notifications.insert(id, notification);
+    uint id = replacesId != 0 ? replacesId : idAllocator->allocate();
+
+    if ((replacesId == 0 && id != 0) || notification(id) != 0) {
+        // Image keys are only accepted from the image store, never from clients
+        NotificationData data(originalData);
+        data.hints.remove(HINT_IMAGE_DATA_KEY);
+        if (withinRateLimit) {
+            // Add or replace the notification in the database; this supersedes any deferred update
+            pendingModifications.remove(id);
+            applyNotification(id, data);
+            storeNotification(id, notifications.value(id)->hints());
+            signalModification(id);
         } else {
-            // Only replace an existing notification if it really exists
-            LipstickNotification *notification = notifications.value(id);
-            notification->setAppName(appName);
-            notification->setAppIcon(appIcon);
-            notification->setSummary(summary);
-            notification->setBody(body);
-            notification->setActions(actions);
-            notification->setHints(hints);
-            notification->setExpireTimeout(expireTimeout);
-
-            // Delete the existing notification from the database
-            execSQL(QString("DELETE FROM notifications WHERE id=?"), QVariantList() << id);
-            execSQL(QString("DELETE FROM actions WHERE id=?"), QVariantList() << id);
-            execSQL(QString("DELETE FROM hints WHERE id=?"), QVariantList() << id);
-        }
-
-        // Add the notification, its actions and its hints to the database
-        execSQL("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)", QVariantList() << id << appName << appIcon << summary << body << expireTimeout);
-        foreach (const QString &action, actions) {
-            execSQL("INSERT INTO actions VALUES (?, ?)", QVariantList() << id << action);
+            // Updates from applications exceeding their rate limit are applied, stored and signaled later; the timestamp is the time of the update
+            addTimestamp(data.hints);
+            deferModification(id, data);
         }
-        foreach (const QString &hint, hints.keys()) {
-            execSQL("INSERT INTO hints VALUES (?, ?, ?)", QVariantList() << id << hint << hints.value(hint));
-        }
-
-        NOTIFICATIONS_DEBUG("NOTIFY:" << appName << appIcon << summary << body << actions << hints << expireTimeout << "->" << id);
-        emit notificationModified(id);
     } else {
-        // Return the ID 0 when trying to update a notification which doesn't exist
+        // Return the ID 0 when trying to update a notification which doesn't exist or when all IDs are in use
         id = 0;
     }
 
     return id;
 }
 
+void NotificationManager::applyNotification(uint id, const NotificationData &data)
+{
+    // Apply a category definition, if any, to the hints
+    QVariantHash hints(data.hints);
+    applyCategoryDefinition(hints);
+
+    // Ensure the hints contain a timestamp
+    addTimestamp(hints);
+
+    // Share the hint keys and the category with the other notifications
+    internHints(hints);
+
+    // Keep only a reference to the image data in the hints
+    storeImageData(hints);
+
+    if (data.replacesId == 0) {
+        // Create a new notification
+        LipstickNotification *notification = new LipstickNotification(data.appName, id, data.appIcon, data.summary, data.body, data.actions, hints, data.expireTimeout, this);
+        connect(notification, SIGNAL(actionInvoked(QString)), this, SLOT(invokeAction(QString)));
+        notifications.insert(id, notification);
+    } else {
+        // Replace the existing notification
+        LipstickNotification *notification = notifications.value(id);
+        removeFromIndexes(id, notification->appName(), notification->category());
+        releaseImageData(notification->hints());
+        notification->setAppName(data.appName);
+        notification->setAppIcon(data.appIcon);
+        notification->setSummary(data.summary);
+        notification->setBody(data.body);
+        notification->setActions(data.actions);
+        notification->setHints(hints);
+        notification->setExpireTimeout(data.expireTimeout);
+    }
+
+    addToIndexes(id, data.appName, hints.value(HINT_CATEGORY).toString());
+    recordModification(id);
+
+    // Notifications with a positive expiration timeout are closed once the timeout has passed
+    setExpirationTime(id, data.expireTimeout > 0 ? QDateTime::currentMSecsSinceEpoch() + data.expireTimeout : 0);
+    scheduleExpiration();
+
+    NOTIFICATIONS_DEBUG("NOTIFY:" << data.appName << data.appIcon << data.summary << data.body << data.actions << hints << data.expireTimeout << "->" << id);
+}
+
 void NotificationManager::CloseNotification(uint id, NotificationClosedReason closeReason)
 {
-    if (notifications.contains(id)) {
+    LipstickNotification *notification = this->notification(id);
+    if (notification != 0) {
         emit NotificationClosed(id, closeReason);
 
+        setExpirationTime(id, 0);
+        removeFromIndexes(id, notification->appName(), notification->category());
+        recordRemoval(id, notification->appName());
+        pendingModifications.remove(id);
+        idAllocator->release(id);
+        releaseImageData(notification->hints());
+
         // Remove the notification, its actions and its hints from database
-        execSQL(QString("DELETE FROM notifications WHERE id=?"), QVariantList() << id);
-        execSQL(QString("DELETE FROM actions WHERE id=?"), QVariantList() << id);
-        execSQL(QString("DELETE FROM hints WHERE id=?"), QVariantList() << id);
+        QMetaObject::invokeMethod(database, "removeNotification", Qt::QueuedConnection, Q_ARG(uint, id));
 
         NOTIFICATIONS_DEBUG("REMOVE:" << id);
-        emit notificationRemoved(id);
+        signalRemoval(id);
 
         // Mark the notification to be destroyed
         removedNotifications.insert(notifications.take(id));
@@ -205,54 +423,118 @@ QString NotificationManager::GetServerInformation(QString &name, QString &vendor
 
 NotificationList NotificationManager::GetNotifications(const QString &appName)
 {
-    QList<LipstickNotification *> notificationList;
-    foreach (uint id, notifications.keys()) {
-        LipstickNotification *notification = notifications.value(id);
-        if (notification->appName() == appName) {
-            notificationList.append(notification);
-        }
+    QList<NotificationData> notificationList;
+    foreach (uint id, notificationIdsForAppName(appName)) {
+        notificationList.append(notification(id)->data());
     }
 
     return NotificationList(notificationList);
 }
 
-uint NotificationManager::nextAvailableNotificationID()
+QList<uint> NotificationManager::NotifyBatch(const NotificationList &notifications)
 {
-    bool idIncreased = false;
+    QList<NotificationData> batch = notifications.data();
+    QList<uint> ids;
+    ids.reserve(batch.count());
+
+    // The notifications of the batch are stored with a single database operation
+    d->batching = true;
+    foreach (const NotificationData &data, batch) {
+        if (ids.count() < MAXIMUM_BATCH_SIZE) {
+            // Each notification is charged against the rate limit of its own application
+            bool withinRateLimit = consumeRateLimitToken(data.appName, data.hints.value(HINT_CATEGORY).toString());
+            ids.append(notify(data, withinRateLimit));
+        } else {
+            // Notifications beyond the maximum batch size are not handled
+            ids.append(0);
+        }
+    }
+    d->batching = false;
+
+    if (batch.count() > MAXIMUM_BATCH_SIZE) {
+        qWarning() << Q_FUNC_INFO << "Ignored" << batch.count() - MAXIMUM_BATCH_SIZE << "notifications exceeding the maximum batch size of" << MAXIMUM_BATCH_SIZE;
+    }
+
+    if (!d->batchRecords.isEmpty()) {
+        QMetaObject::invokeMethod(database, "storeNotifications", Qt::QueuedConnection, Q_ARG(QList<NotificationDatabase::Record>, d->batchRecords));
+        d->batchRecords.clear();
+    }
+
+    return ids;
+}
 
-    // Try to find an unused ID. Increase the ID at least once but only up to 2^32-1 times.
-    for (uint i = 0; i < UINT32_MAX && (!idIncreased || notifications.contains(previousNotificationID)); i++, idIncreased = true) {
-        previousNotificationID++;
+void NotificationManager::CloseNotifications(const QList<uint> &ids)
+{
+    foreach (uint id, ids) {
+        CloseNotification(id);
+    }
+}
 
-        if (previousNotificationID == 0) {
-            // 0 is not a valid ID so skip it
-            previousNotificationID = 1;
+NotificationList NotificationManager::GetNotificationChanges(const QString &appName, quint64 since, QList<uint> &removedIds, quint64 &sequence, bool &reset)
+{
+    QList<NotificationData> notificationList;
+    removedIds.clear();
+    sequence = changeSequence_;
+    reset = since < firstChangeSequence || since < forgottenRemovalSequence || since > changeSequence_;
+
+    if (reset) {
+        // The changes are not known so return everything
+        foreach (uint id, notificationIdsForAppName(appName)) {
+            notificationList.append(notification(id)->data());
+        }
+    } else {
+        for (QMap<quint64, uint>::const_iterator modification = modificationsBySequence.upperBound(since); modification != modificationsBySequence.constEnd(); ++modification) {
+            LipstickNotification *notification = notifications.value(*modification);
+            if (notification != 0 && notification->appName() == appName) {
+                notificationList.append(notification->data());
+            }
+        }
+        for (QMap<quint64, Removal>::const_iterator removal = removalsBySequence.upperBound(since); removal != removalsBySequence.constEnd(); ++removal) {
+            if (removal->appName == appName) {
+                removedIds.append(removal->id);
+            }
         }
     }
 
-    return previousNotificationID;
+    return NotificationList(notificationList);
+}
+
+quint64 NotificationManager::changeSequence() const
+{
+    return changeSequence_;
+}
+
+void NotificationManager::applyCategoryDefinitionChanges(const QStringList &modifiedCategories, const QStringList &uninstalledCategories)
+{
+    // All modifications end up in the same database transaction and notificationsChanged() signal
+    foreach (const QString &category, uninstalledCategories) {
+        removeNotificationsWithCategory(category);
+    }
+    foreach (const QString &category, modifiedCategories) {
+        updateNotificationsWithCategory(category);
+    }
 }
 
 void NotificationManager::removeNotificationsWithCategory(const QString &category)
 {
-    foreach(uint id, notifications.keys()) {
-        if (notifications[id]->hints().value("category").toString() == category) {
-            CloseNotification(id);
-        }
+    foreach(uint id, notificationIdsForCategory(category)) {
+        CloseNotification(id);
     }
 }
 
 void NotificationManager::updateNotificationsWithCategory(const QString &category)
 {
-    foreach(uint id, notifications.keys()) {
-        if (notifications[id]->hints().value("category").toString() == category) {
-            // Remove the preview summary and body hints to avoid showing the preview banner again
-            QVariantHash hints = notifications[id]->hints();
-            hints.remove(HINT_PREVIEW_SUMMARY);
-            hints.remove(HINT_PREVIEW_BODY);
-
-            Notify(notifications[id]->appName(), id, notifications[id]->appIcon(), notifications[id]->summary(), notifications[id]->body(), notifications[id]->actions(), hints, notifications[id]->expireTimeout());
-        }
+    foreach(uint id, notificationIdsForCategory(category)) {
+        // Remove the preview summary and body hints to avoid showing the preview banner again
+        LipstickNotification *notification = this->notification(id);
+        QVariantHash hints = notification->hints();
+        hints.remove(HINT_PREVIEW_SUMMARY);
+        hints.remove(HINT_PREVIEW_BODY);
+
+        // The notification is updated directly rather than through Notify() so that its image reference is kept
+        applyNotification(id, NotificationData(notification->appName(), id, notification->appIcon(), notification->summary(), notification->body(), notification->actions(), hints, notification->expireTimeout()));
+        storeNotification(id, notification->hints());
+        signalModification(id);
     }
 }
 
@@ -260,9 +542,9 @@ void NotificationManager::applyCategoryDefinition(QVariantHash &hints)
 {
     QString category = hints.value(HINT_CATEGORY).toString();
     if (!category.isEmpty()) {
-        foreach (const QString &key, categoryDefinitionStore->allKeys(category)) {
-            if (!hints.contains(key))
-                hints.insert(key, categoryDefinitionStore->value(category, key));
+        foreach (const CategoryDefinitionStore::Parameter &parameter, categoryDefinitionStore->parameters(category)) {
+            if (!hints.contains(parameter.first))
+                hints.insert(parameter.first, parameter.second);
         }
     }
 }
@@ -274,275 +556,456 @@ void NotificationManager::addTimestamp(QVariantHash &hints)
     }
 }
 
-void NotificationManager::restoreNotifications()
+void NotificationManager::internHints(QVariantHash &hints)
 {
-    if (connectToDatabase()) {
-        if (checkTableValidity()) {
-            fetchData();
-        } else {
-            database->close();
-        }
+    QVariantHash internedHints;
+    internedHints.reserve(hints.count());
+    for (QVariantHash::const_iterator hint = hints.constBegin(); hint != hints.constEnd(); ++hint) {
+        internedHints.insert(NotificationStringPool::intern(hint.key()), hint.value());
     }
+
+    QVariantHash::iterator category = internedHints.find(HINT_CATEGORY);
+    if (category != internedHints.end() && category->type() == QVariant::String) {
+        *category = NotificationStringPool::intern(category->toString());
+    }
+
+    hints = internedHints;
 }
 
-bool NotificationManager::connectToDatabase()
+void NotificationManager::storeImageData(QVariantHash &hints)
 {
-    QString databasePath = QDir::homePath() + QString(PRIVILEGED_DATA_PATH) + QDir::separator() + "Notifications";
-    if (!QDir::root().exists(databasePath)) {
-        QDir::root().mkpath(databasePath);
+    QVariantHash::iterator imageDataKey = hints.find(HINT_IMAGE_DATA_KEY);
+    if (imageDataKey != hints.end() && !imageStore->addReference(imageDataKey->toString())) {
+        // Only keep references to images which exist in the store
+        hints.erase(imageDataKey);
     }
-    QString databaseName = databasePath + "/notifications.db";
 
-    *database = QSqlDatabase::addDatabase("QSQLITE", metaObject()->className());
-    database->setDatabaseName(databaseName);
-    bool success = checkForDiskSpace(databasePath, MINIMUM_FREE_SPACE_NEEDED_IN_KB);
-    if (success) {
-        success = database->open();
-        if (!success) {
-            NOTIFICATIONS_DEBUG(database->lastError().driverText() << databaseName << database->lastError().databaseText());
+    QVariant imageData = hints.take(HINT_IMAGE_DATA);
+    if (!imageData.isValid()) {
+        return;
+    }
 
-            // If opening the database fails, try to recreate the database
-            removeDatabaseFile(databaseName);
-            success = database->open();
-            NOTIFICATIONS_DEBUG("Unable to open database file. Recreating. Success: " << success);
+    // The pixels are stored after the header as is so that they don't need to be copied
+    QByteArray header;
+    QByteArray pixels;
+    if (imageData.userType() == qMetaTypeId<QDBusArgument>()) {
+        // Image data sent over D-Bus is a (iiibiiay) structure
+        const QDBusArgument argument = imageData.value<QDBusArgument>();
+        if (argument.currentSignature() == "(iiibiiay)") {
+            int width, height, rowstride, bitsPerSample, channels;
+            bool hasAlpha;
+            argument.beginStructure();
+            argument >> width >> height >> rowstride >> hasAlpha >> bitsPerSample >> channels >> pixels;
+            argument.endStructure();
+            if (NotificationImageStore::isValid(width, height, rowstride, hasAlpha, bitsPerSample, channels, pixels.size())) {
+                header = NotificationImageStore::encodeHeader(width, height, rowstride, hasAlpha, bitsPerSample, channels, pixels.size());
+            }
+        }
+    } else if (imageData.type() == QVariant::ByteArray) {
+        // Image data already in the serialized format of the image store
+        QByteArray data = imageData.toByteArray();
+        if (NotificationImageStore::isValid(data)) {
+            header = data;
         }
-    } else {
-        NOTIFICATIONS_DEBUG("Not enough free disk space available. Unable to open database.");
     }
 
-    if (success) {
-        // Set up the database mode to write-ahead locking to improve performance
-        QSqlQuery(*database).exec("PRAGMA journal_mode=WAL");
+    if (!header.isEmpty()) {
+        QString key = imageStore->store(header, pixels);
+        if (!key.isEmpty()) {
+            // The image data replaces the referred image, if any
+            releaseImageData(hints);
+            hints.insert(NotificationStringPool::intern(HINT_IMAGE_DATA_KEY), key);
+        }
     }
-
-    return success;
 }
 
-bool NotificationManager::checkForDiskSpace(const QString &path, unsigned long freeSpaceNeeded)
+void NotificationManager::releaseImageData(const QVariantHash &hints)
 {
-    struct statfs st;
-    bool spaceAvailable = false;
-    if (statfs(path.toUtf8().data(), &st) != -1) {
-        unsigned long freeSpaceInKb = (st.f_bsize * st.f_bavail) / 1024;
-        if (freeSpaceInKb > freeSpaceNeeded) {
-            spaceAvailable = true;
+    QString key = hints.value(HINT_IMAGE_DATA_KEY).toString();
+    if (!key.isEmpty()) {
+        if (!imageReferencesCounted) {
+            countImageReferences();
         }
+        imageStore->release(key);
     }
-    return spaceAvailable;
 }
 
-void NotificationManager::removeDatabaseFile(const QString &path)
+void NotificationManager::countImageReferences()
 {
-    // Remove also -shm and -wal files created when journal-mode=WAL is being used
-    QDir::root().remove(path + "-shm");
-    QDir::root().remove(path + "-wal");
-    QDir::root().remove(path);
+    for (QHash<uint, NotificationDatabase::Record>::iterator record = d->unrestoredNotifications.begin(); record != d->unrestoredNotifications.end(); ++record) {
+        NotificationDatabase::decodeData(*record);
+        imageStore->addReference(record->hints.value(HINT_IMAGE_DATA_KEY).toString());
+    }
+    imageReferencesCounted = true;
+
+    imageStore->removeUnreferenced();
 }
 
-bool NotificationManager::checkTableValidity()
+void NotificationManager::restoreNotifications()
 {
-    bool result = true;
-    bool recreateNotificationsTable = false;
-    bool recreateActionsTable = false;
-    bool recreateHintsTable = false;
+    QElapsedTimer restoreTimer;
+    restoreTimer.start();
 
-    {
-        // Check that the notifications table schema is as expected
-        QSqlTableModel notificationsTableModel(0, *database);
-        notificationsTableModel.setTable("notifications");
-        recreateNotificationsTable = (notificationsTableModel.fieldIndex("id") == -1 ||
-                                      notificationsTableModel.fieldIndex("app_name") == -1 ||
-                                      notificationsTableModel.fieldIndex("app_icon") == -1 ||
-                                      notificationsTableModel.fieldIndex("summary") == -1 ||
-                                      notificationsTableModel.fieldIndex("body") == -1 ||
-                                      notificationsTableModel.fieldIndex("expire_timeout") == -1);
+    // Wait for the database thread to read the stored notifications
+    QMetaObject::invokeMethod(database, "restore", Qt::BlockingQueuedConnection);
+
+    QSettings settings(LIPSTICK_SETTINGS_FILE, QSettings::IniFormat);
+    bool lazyRestore = settings.value("notifications/lazy_restore", true).toBool();
+
+    foreach (const NotificationDatabase::Record &record, database->takeRestoredRecords()) {
+        // Only keep the record; in the lazy restore mode the notification is created when it is first accessed
+        d->unrestoredNotifications.insert(record.id, record);
+        if (!lazyRestore) {
+            restoreNotification(record.id);
+            signalModification(record.id);
+        }
 
-        // Check that the actions table schema is as expected
-        QSqlTableModel actionsTableModel(0, *database);
-        actionsTableModel.setTable("actions");
-        recreateActionsTable = (actionsTableModel.fieldIndex("id") == -1 ||
-                                actionsTableModel.fieldIndex("action") == -1);
+        // New IDs are allocated after the highest restored ID
+        idAllocator->reserve(record.id);
 
-        // Check that the hints table schema is as expected
-        QSqlTableModel hintsTableModel(0, *database);
-        hintsTableModel.setTable("hints");
-        recreateHintsTable = (hintsTableModel.fieldIndex("id") == -1 ||
-                              hintsTableModel.fieldIndex("hint") == -1 ||
-                              hintsTableModel.fieldIndex("value") == -1);
+        addToIndexes(record.id, record.appName, NotificationStringPool::intern(record.category));
+
+        // Notifications whose expiration time passed while lipstick was not running expire right away
+        setExpirationTime(record.id, record.expireAt);
     }
+    scheduleExpiration();
 
-    if (recreateNotificationsTable) {
-        result &= recreateTable("notifications", "id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER");
+    if (!lazyRestore) {
+        // All image references are known once the notifications have been restored
+        countImageReferences();
     }
 
-    if (recreateActionsTable) {
-        result &= recreateTable("actions", "id INTEGER, action TEXT, PRIMARY KEY(id, action)");
+    restoreDuration_ = restoreTimer.elapsed();
+    NOTIFICATIONS_DEBUG("RESTORED" << notificationIds().count() << "notifications in" << restoreDuration_ << "ms, lazy restore:" << lazyRestore);
+}
+
+LipstickNotification *NotificationManager::restoreNotification(uint id)
+{
+    NotificationDatabase::Record record = d->unrestoredNotifications.take(id);
+    NotificationDatabase::decodeData(record);
+    internHints(record.hints);
+    if (!imageReferencesCounted) {
+        imageStore->addReference(record.hints.value(HINT_IMAGE_DATA_KEY).toString());
     }
+    LipstickNotification *notification = new LipstickNotification(record.appName, record.id, record.appIcon, record.summary, record.body, record.actions, record.hints, record.expireTimeout, this);
+    connect(notification, SIGNAL(actionInvoked(QString)), this, SLOT(invokeAction(QString)));
+    notifications.insert(record.id, notification);
 
-    if (recreateHintsTable) {
-        result &= recreateTable("hints", "id INTEGER, hint TEXT, value TEXT, PRIMARY KEY(id, hint)");
+    NOTIFICATIONS_DEBUG("RESTORED:" << record.appName << record.appIcon << record.summary << record.body << record.actions << record.hints << record.expireTimeout << "->" << record.id);
+    return notification;
+}
+
+void NotificationManager::addToIndexes(uint id, const QString &appName, const QString &category)
+{
+    notificationIdsByAppName.insert(appName, id);
+    if (!category.isEmpty()) {
+        notificationIdsByCategory.insert(category, id);
     }
+}
+
+void NotificationManager::removeFromIndexes(uint id, const QString &appName, const QString &category)
+{
+    notificationIdsByAppName.remove(appName, id);
+    notificationIdsByCategory.remove(category, id);
+}
 
-    return result;
+void NotificationManager::destroyRemovedNotifications()
+{
+    qDeleteAll(removedNotifications);
+    removedNotifications.clear();
 }
 
-bool NotificationManager::recreateTable(const QString &tableName, const QString &definition)
+void NotificationManager::invokeAction(const QString &action)
 {
-    bool result = false;
+    LipstickNotification *notification = qobject_cast<LipstickNotification *>(sender());
+    if (notification != 0) {
+        uint id = notifications.key(notification, 0);
+        if (id > 0) {
+            QString remoteAction = notification->hints().value(QString(HINT_REMOTE_ACTION_PREFIX) + action).toString();
+            if (!remoteAction.isEmpty()) {
+                NOTIFICATIONS_DEBUG("INVOKE REMOTE ACTION:" << action << id);
+
+                // If a remote action has been defined for the given action, trigger it
+                MRemoteAction(remoteAction).trigger();
+            }
+
+            for (int actionIndex = 0; actionIndex < notification->actions().count() / 2; actionIndex++) {
+                // Actions are sent over as a list of pairs. Each even element in the list (starting at index 0) represents the identifier for the action. Each odd element in the list is the localized string that will be displayed to the user.
+                if (notification->actions().at(actionIndex * 2) == action) {
+                    NOTIFICATIONS_DEBUG("INVOKE ACTION:" << action << id);
 
-    if (database->isOpen()) {
-        QSqlQuery(*database).exec("DROP TABLE " + tableName);
-        result = QSqlQuery(*database).exec("CREATE TABLE " + tableName + " (" + definition + ")");
+                    emit ActionInvoked(id, action);
+                }
+            }
+
+            removeNotificationIfUserRemovable(id);
+        }
+    }
+}
+
+void NotificationManager::storeNotification(uint id, const QVariantHash &hints)
+{
+    LipstickNotification *notification = notifications.value(id);
+    if (d->batching) {
+        NotificationDatabase::Record record;
+        record.id = id;
+        record.appName = notification->appName();
+        record.appIcon = notification->appIcon();
+        record.summary = notification->summary();
+        record.body = notification->body();
+        record.actions = notification->actions();
+        record.hints = hints;
+        record.expireTimeout = notification->expireTimeout();
+        record.expireAt = expirationTimes.value(id);
+        d->batchRecords.append(record);
+        return;
     }
 
-    return result;
+    QMetaObject::invokeMethod(database, "storeNotification", Qt::QueuedConnection, Q_ARG(uint, id), Q_ARG(QString, notification->appName()), Q_ARG(QString, notification->appIcon()), Q_ARG(QString, notification->summary()), Q_ARG(QString, notification->body()), Q_ARG(QStringList, notification->actions()), Q_ARG(QVariantHash, hints), Q_ARG(int, notification->expireTimeout()), Q_ARG(qint64, expirationTimes.value(id)));
 }
 
-void NotificationManager::fetchData()
+void NotificationManager::setExpirationTime(uint id, qint64 expireAt)
 {
-    // Gather actions for each notification
-    QSqlQuery actionsQuery("SELECT * FROM actions", *database);
-    QSqlRecord actionsRecord = actionsQuery.record();
-    int actionsTableIdFieldIndex = actionsRecord.indexOf("id");
-    int actionsTableActionFieldIndex = actionsRecord.indexOf("action");
-    QHash<uint, QStringList> actions;
-    while (actionsQuery.next()) {
-        uint id = actionsQuery.value(actionsTableIdFieldIndex).toUInt();
-        actions[id].append(actionsQuery.value(actionsTableActionFieldIndex).toString());
+    qint64 previousExpireAt = expirationTimes.take(id);
+    if (previousExpireAt != 0) {
+        expirationQueue.remove(previousExpireAt, id);
     }
 
-    // Gather hints for each notification
-    QSqlQuery hintsQuery("SELECT * FROM hints", *database);
-    QSqlRecord hintsRecord = hintsQuery.record();
-    int hintsTableIdFieldIndex = hintsRecord.indexOf("id");
-    int hintsTableHintFieldIndex = hintsRecord.indexOf("hint");
-    int hintsTableValueFieldIndex = hintsRecord.indexOf("value");
-    QHash<uint, QVariantHash> hints;
-    while (hintsQuery.next()) {
-        uint id = hintsQuery.value(hintsTableIdFieldIndex).toUInt();
-        hints[id].insert(hintsQuery.value(hintsTableHintFieldIndex).toString(), hintsQuery.value(hintsTableValueFieldIndex));
+    if (expireAt != 0) {
+        expirationTimes.insert(id, expireAt);
+        expirationQueue.insert(expireAt, id);
     }
+}
 
-    // Create the notifications
-    QSqlQuery notificationsQuery("SELECT * FROM notifications", *database);
-    QSqlRecord notificationsRecord = notificationsQuery.record();
-    int notificationsTableIdFieldIndex = notificationsRecord.indexOf("id");
-    int notificationsTableAppNameFieldIndex = notificationsRecord.indexOf("app_name");
-    int notificationsTableAppIconFieldIndex = notificationsRecord.indexOf("app_icon");
-    int notificationsTableSummaryFieldIndex = notificationsRecord.indexOf("summary");
-    int notificationsTableBodyFieldIndex = notificationsRecord.indexOf("body");
-    int notificationsTableExpireTimeoutFieldIndex = notificationsRecord.indexOf("expire_timeout");
-    while (notificationsQuery.next()) {
-        uint id = notificationsQuery.value(notificationsTableIdFieldIndex).toUInt();
-        QString appName = notificationsQuery.value(notificationsTableAppNameFieldIndex).toString();
-        QString appIcon = notificationsQuery.value(notificationsTableAppIconFieldIndex).toString();
-        QString summary = notificationsQuery.value(notificationsTableSummaryFieldIndex).toString();
-        QString body = notificationsQuery.value(notificationsTableBodyFieldIndex).toString();
-        int expireTimeout = notificationsQuery.value(notificationsTableExpireTimeoutFieldIndex).toInt();
-        LipstickNotification *notification = new LipstickNotification(appName, id, appIcon, summary, body, actions[id], hints[id], expireTimeout, this);
-        connect(notification, SIGNAL(actionInvoked(QString)), this, SLOT(invokeAction(QString)));
-        notifications.insert(id, notification);
+void NotificationManager::scheduleExpiration()
+{
+    if (expirationQueue.isEmpty()) {
+        expirationTimer.stop();
+    } else {
+        // QTimer intervals are limited to an int so notifications expiring further away are rescheduled when the timer fires
+        qint64 timeout = expirationQueue.firstKey() - QDateTime::currentMSecsSinceEpoch();
+        expirationTimer.setInterval(qBound<qint64>(0, timeout, INT_MAX));
+        expirationTimer.start();
+    }
+}
 
-        NOTIFICATIONS_DEBUG("RESTORED:" << appName << appIcon << summary << body << actions[id] << hints[id] << expireTimeout << "->" << id);
-        emit notificationModified(id);
+void NotificationManager::expireNotifications()
+{
+    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    while (!expirationQueue.isEmpty() && expirationQueue.firstKey() <= currentTime) {
+        uint id = expirationQueue.first();
+        setExpirationTime(id, 0);
+
+        NOTIFICATIONS_DEBUG("EXPIRE:" << id);
+        CloseNotification(id, NotificationExpired);
+    }
+
+    scheduleExpiration();
+}
+
+bool NotificationManager::consumeRateLimitToken(const QString &appName, const QString &category)
+{
+    int burst = defaultRateLimitBurst;
+    double rate = defaultRateLimitRate;
+    if (!category.isEmpty()) {
+        if (categoryDefinitionStore->contains(category, RATE_LIMIT_BURST_KEY)) {
+            burst = categoryDefinitionStore->value(category, RATE_LIMIT_BURST_KEY).toInt();
+        }
+        if (categoryDefinitionStore->contains(category, RATE_LIMIT_RATE_KEY)) {
+            rate = categoryDefinitionStore->value(category, RATE_LIMIT_RATE_KEY).toDouble();
+        }
+    }
+
+    if (burst <= 0) {
+        // Rate limiting is disabled
+        return true;
+    }
 
-        if (id > previousNotificationID) {
-            // Use the highest notification ID found as the previous notification ID
-            previousNotificationID = id;
+    qint64 currentTime = rateLimitClock.elapsed();
+    QHash<QString, RateLimitBucket>::iterator bucket = rateLimitBuckets.find(appName);
+    if (bucket == rateLimitBuckets.end()) {
+        if (rateLimitBuckets.count() >= rateLimitBucketSweepThreshold) {
+            sweepRateLimitBuckets(currentTime);
         }
+        bucket = rateLimitBuckets.insert(appName, RateLimitBucket(burst, currentTime));
+    } else if (currentTime >= bucket->fullTime) {
+        // A bucket that has been refilled is the same as a new one
+        *bucket = RateLimitBucket(burst, currentTime);
+    } else {
+        bucket->tokens = qMin<double>(burst, bucket->tokens + (currentTime - bucket->lastRefillTime) * rate / 1000);
+        bucket->lastRefillTime = currentTime;
+    }
+
+    if (bucket->tokens < 1) {
+        return false;
     }
+
+    bucket->tokens--;
+    bucket->fullTime = rate > 0 ? currentTime + qint64((burst - bucket->tokens) * 1000 / rate) : LLONG_MAX;
+    return true;
 }
 
-void NotificationManager::commit()
+void NotificationManager::sweepRateLimitBuckets(qint64 currentTime)
 {
-    // Any aditional rules about when database commits are allowed can be added here
-    if (!committed) {
-        database->commit();
-        committed = true;
+    // Buckets that have been refilled carry no state, so they are dropped
+    QHash<QString, RateLimitBucket>::iterator bucket = rateLimitBuckets.begin();
+    while (bucket != rateLimitBuckets.end()) {
+        if (currentTime >= bucket->fullTime) {
+            bucket = rateLimitBuckets.erase(bucket);
+        } else {
+            ++bucket;
+        }
     }
 
-    qDeleteAll(removedNotifications);
-    removedNotifications.clear();
+    // Sweep again only once the number of buckets has doubled so that the cost of sweeping stays constant per bucket
+    rateLimitBucketSweepThreshold = qMax(RATE_LIMIT_BUCKET_SWEEP_THRESHOLD, 2 * rateLimitBuckets.count());
 }
 
-void NotificationManager::execSQL(const QString &command, const QVariantList &args)
+void NotificationManager::deferModification(uint id, const NotificationData &data)
 {
-    if (!database->isOpen()) {
-        return;
+    if (pendingModifications.contains(id)) {
+        coalescedNotificationCount_++;
+    }
+    pendingModifications.insert(id, data);
+
+    if (!modificationCoalescingTimer.isActive()) {
+        modificationCoalescingTimer.start();
     }
+}
 
-    if (committed) {
-        committed = false;
-        database->transaction();
+void NotificationManager::emitPendingModifications()
+{
+    QHash<uint, NotificationData> modifications;
+    modifications.swap(pendingModifications);
+    QHash<uint, NotificationData>::const_iterator modification;
+    for (modification = modifications.constBegin(); modification != modifications.constEnd(); ++modification) {
+        uint id = modification.key();
+        if (notifications.contains(id)) {
+            applyNotification(id, modification.value());
+            storeNotification(id, notifications.value(id)->hints());
+            signalModification(id);
+        }
     }
+}
 
-    QSqlQuery query(*database);
-    query.prepare(command);
+void NotificationManager::signalModification(uint id)
+{
+    // The notifications of a batch are only signaled together in notificationsChanged()
+    if (!d->batching) {
+        emit notificationModified(id);
+    }
 
-    foreach(const QVariant &arg, args) {
-        query.addBindValue(arg);
+    modifiedNotificationIds.insert(id);
+    if (!notificationsChangedTimer.isActive()) {
+        notificationsChangedTimer.start();
     }
+}
 
-    query.exec();
+void NotificationManager::signalRemoval(uint id)
+{
+    emit notificationRemoved(id);
+
+    // A notification modified and removed within the same batch is only reported as removed
+    modifiedNotificationIds.remove(id);
+    removedNotificationIds.insert(id);
+    if (!notificationsChangedTimer.isActive()) {
+        notificationsChangedTimer.start();
+    }
+}
 
-    if (query.lastError().isValid()) {
-        NOTIFICATIONS_DEBUG(command << args << query.lastError());
+void NotificationManager::emitNotificationsChanged()
+{
+    if (modifiedNotificationIds.isEmpty() && removedNotificationIds.isEmpty()) {
+        return;
     }
 
-    databaseCommitTimer.start();
+    QList<uint> modifiedIds = modifiedNotificationIds.toList();
+    QList<uint> removedIds = removedNotificationIds.toList();
+    modifiedNotificationIds.clear();
+    removedNotificationIds.clear();
+
+    NOTIFICATIONS_DEBUG("CHANGED:" << modifiedIds << "REMOVED:" << removedIds);
+    emit notificationsChanged(modifiedIds, removedIds);
 }
 
-void NotificationManager::invokeAction(const QString &action)
+void NotificationManager::scheduleDatabaseMaintenance()
 {
-    LipstickNotification *notification = qobject_cast<LipstickNotification *>(sender());
-    if (notification != 0) {
-        uint id = notifications.key(notification, 0);
-        if (id > 0) {
-            QString remoteAction = notification->hints().value(QString(HINT_REMOTE_ACTION_PREFIX) + action).toString();
-            if (!remoteAction.isEmpty()) {
-                NOTIFICATIONS_DEBUG("INVOKE REMOTE ACTION:" << action << id);
+    bool idle = SystemState::instance()->displayState() == MeeGo::QmDisplayState::Off && activity->get() == MeeGo::QmActivity::Inactive;
+    bool due = !databaseMaintenanceClock.isValid() || databaseMaintenanceClock.elapsed() >= DATABASE_MAINTENANCE_INTERVAL;
+    if (idle && due) {
+        if (!databaseMaintenanceTimer.isActive()) {
+            databaseMaintenanceTimer.start();
+        }
+    } else {
+        databaseMaintenanceTimer.stop();
+    }
+}
 
-                // If a remote action has been defined for the given action, trigger it
-                MRemoteAction(remoteAction).trigger();
-            }
+void NotificationManager::performDatabaseMaintenance()
+{
+    if (SystemState::instance()->displayState() != MeeGo::QmDisplayState::Off || activity->get() != MeeGo::QmActivity::Inactive) {
+        return;
+    }
 
-            for (int actionIndex = 0; actionIndex < notification->actions().count() / 2; actionIndex++) {
-                // Actions are sent over as a list of pairs. Each even element in the list (starting at index 0) represents the identifier for the action. Each odd element in the list is the localized string that will be displayed to the user.
-                if (notification->actions().at(actionIndex * 2) == action) {
-                    NOTIFICATIONS_DEBUG("INVOKE ACTION:" << action << id);
+    NOTIFICATIONS_DEBUG("MAINTENANCE");
+    QMetaObject::invokeMethod(database, "performMaintenance", Qt::QueuedConnection, Q_ARG(int, databaseMaintenanceTimeBudget), Q_ARG(qint64, databaseMaintenanceSizeBudget));
+    databaseMaintenanceClock.start();
+}
 
-                    emit ActionInvoked(id, action);
-                }
-            }
+void NotificationManager::recordModification(uint id)
+{
+    QHash<uint, quint64>::iterator modificationSequence = modificationSequences.find(id);
+    if (modificationSequence != modificationSequences.end()) {
+        modificationsBySequence.remove(*modificationSequence);
+        *modificationSequence = ++changeSequence_;
+    } else {
+        modificationSequences.insert(id, ++changeSequence_);
+    }
+    modificationsBySequence.insert(changeSequence_, id);
+}
 
-            removeNotificationIfUserRemovable(id);
-        }
+void NotificationManager::recordRemoval(uint id, const QString &appName)
+{
+    quint64 modificationSequence = modificationSequences.take(id);
+    if (modificationSequence != 0) {
+        modificationsBySequence.remove(modificationSequence);
+    }
+
+    removalsBySequence.insert(++changeSequence_, Removal(id, appName));
+    if (removalsBySequence.count() > MAXIMUM_REMOVAL_COUNT) {
+        // Forget the oldest closing; callers which haven't synced since have to get all notifications
+        forgottenRemovalSequence = removalsBySequence.firstKey();
+        removalsBySequence.erase(removalsBySequence.begin());
     }
 }
 
 void NotificationManager::removeNotificationIfUserRemovable(uint id)
 {
-    LipstickNotification *notification = notifications[id];
-    QVariant userRemovable = notification->hints().value(HINT_USER_REMOVABLE);
-    if (!userRemovable.isValid() || userRemovable.toBool()) {
+    LipstickNotification *notification = this->notification(id);
+    if (notification->isUserRemovable()) {
         // The notification should be removed if user removability is not defined (defaults to true) or is set to true
         QVariant userCloseable = notification->hints().value(HINT_USER_CLOSEABLE);
         if (!userCloseable.isValid() || userCloseable.toBool()) {
             // The notification should be closed if user closeability is not defined (defaults to true) or is set to true
             CloseNotification(id, NotificationDismissedByUser);
         } else {
-            // Uncloseable notifications should be only removed
-            emit notificationRemoved(id);
+            // Uncloseable notifications should be only removed; any deferred update is applied before they are hidden
+            if (pendingModifications.contains(id)) {
+                applyNotification(id, pendingModifications.take(id));
+            }
+            signalRemoval(id);
 
-            // Mark the notification as hidden
-            execSQL("INSERT INTO hints VALUES (?, ?, ?)", QVariantList() << id << HINT_HIDDEN << true);
+            // Mark the notification as hidden in the database
+            QVariantHash hints(notification->hints());
+            hints.insert(HINT_HIDDEN, true);
+            storeNotification(id, hints);
         }
     }
 }
 
 void NotificationManager::removeUserRemovableNotifications()
 {
-    foreach(uint id, notifications.keys()) {
+    foreach(uint id, notificationIds()) {
         removeNotificationIfUserRemovable(id);
     }
 }
@@ -19,11 +19,21 @@
 #include "lipstickglobal.h"
 #include "lipsticknotification.h"
 #include <QObject>
+#include <QElapsedTimer>
 #include <QTimer>
+#include <QThread>
 #include <QSet>
+#include <QMap>
+#include <QImage>
 
 class CategoryDefinitionStore;
-class QSqlDatabase;
+class NotificationDatabase;
+class NotificationIdAllocator;
+class NotificationImageStore;
+class NotificationManagerPrivate;
+namespace MeeGo {
+class QmActivity;
+}
 
 /*!
  * \class NotificationManager
@@ -34,6 +44,19 @@ class QSqlDatabase;
  * on the <a href="http://www.galago-project.org/specs/notification/0.9/">Desktop Notifications Specification</a>.
  * The service is registered as org.freedesktop.Notifications on the D-Bus
  * session bus in the path /org/freedesktop/Notifications.
+ *
+ * New notifications are rate limited per application using a token bucket.
+ * The bucket size and refill rate default to the notifications/rate_limit_burst
+ * and notifications/rate_limit_rate keys of the lipstick settings file and can
+ * be overridden for a category using the x-nemo-rate-limit-burst and
+ * x-nemo-rate-limit-rate keys of its category definition. New notifications
+ * sent by an application exceeding its rate limit are dropped, while updates
+ * to existing notifications are coalesced and signaled at most once per
+ * coalescing interval.
+ *
+ * The number of category definitions kept in memory defaults to 100 and
+ * can be changed using the notifications/max_category_definitions key of
+ * the lipstick settings file.
  */
 class LIPSTICK_EXPORT NotificationManager : public QObject
 {
@@ -49,7 +72,7 @@ public:
     //! Standard hint: This specifies the name of the desktop filename representing the calling program. This should be the same as the prefix used for the application's .desktop file. An example would be "rhythmbox" from "rhythmbox.desktop". This can be used by the daemon to retrieve the correct icon for the application, for logging purposes, etc. Not supported by this implementation.
     static const char *HINT_DESKTOP_ENTRY;
 
-    //! Standard hint: This is a raw data image format which describes the width, height, rowstride, has alpha, bits per sample, channels and image data respectively. We use this value if the icon field is left blank. Not supported by this implementation.
+    //! Standard hint: This is a raw data image format which describes the width, height, rowstride, has alpha, bits per sample, channels and image data respectively. We use this value if the icon field is left blank. The image data is moved to the notification image store and replaced by the HINT_IMAGE_DATA_KEY hint.
     static const char *HINT_IMAGE_DATA;
 
     //! Standard hint: The path to a sound file to play when the notification pops up. Not supported by this implementation.
@@ -103,6 +126,9 @@ public:
     //! Nemo hint: Whether to turn the screen on when displaying preview
     static const char *HINT_DISPLAY_ON;
 
+    //! Nemo hint: Key of the image of the notification in the notification image store. Set by the notification manager in place of HINT_IMAGE_DATA; keys sent by clients are ignored.
+    static const char *HINT_IMAGE_DATA_KEY;
+
     //! Notifation closing reasons used in the NotificationClosed signal
     enum NotificationClosedReason {
         //! The notification expired.
@@ -121,12 +147,13 @@ public:
     static NotificationManager *instance();
 
     /*!
-     * Returns a notification with the given ID.
+     * Returns a notification with the given ID. Notifications restored
+     * lazily from the database are created on first access.
      *
      * \param id the ID of the notification to return
      * \return the notification with the given ID
      */
-    LipstickNotification *notification(uint id) const;
+    LipstickNotification *notification(uint id);
 
     /*!
      * Returns a list of notification IDs.
@@ -135,6 +162,80 @@ public:
      */
     QList<uint> notificationIds() const;
 
+    /*!
+     * Returns the timestamp of a notification. Unlike notification(), does
+     * not create a lazily restored notification, so this can be used for
+     * ordering notifications which are not needed otherwise.
+     *
+     * \param id the ID of the notification
+     * \return the timestamp in milliseconds since the epoch or 0 if the notification has no timestamp
+     */
+    qint64 notificationTimestamp(uint id) const;
+
+    /*!
+     * Returns the time it took to restore the stored notifications when
+     * the notification manager was created.
+     *
+     * \return the restore duration in milliseconds
+     */
+    qint64 restoreDuration() const;
+
+    /*!
+     * Returns the IDs of the notifications sent by the given application.
+     *
+     * \param appName the name of the application
+     * \return a list of notification IDs
+     */
+    QList<uint> notificationIdsForAppName(const QString &appName) const;
+
+    /*!
+     * Returns the IDs of the notifications in the given category.
+     *
+     * \param category the category of the notifications
+     * \return a list of notification IDs
+     */
+    QList<uint> notificationIdsForCategory(const QString &category) const;
+
+    /*!
+     * Returns the number of new notifications dropped because their
+     * application exceeded its rate limit.
+     *
+     * \return the number of dropped notifications
+     */
+    uint droppedNotificationCount() const;
+
+    /*!
+     * Returns the number of notification updates merged into a pending
+     * update of the same notification because their application exceeded
+     * its rate limit.
+     *
+     * \return the number of coalesced notification updates
+     */
+    uint coalescedNotificationCount() const;
+
+    /*!
+     * Returns the size and fragmentation statistics of the notification
+     * database, as refreshed by the latest database maintenance run. The
+     * map contains the keys "databaseSize" and "walSize" in bytes,
+     * "pageSize", "pageCount", "freePageCount", "fragmentation" as the
+     * share of free pages between 0 and 1, "maintenanceCount" and
+     * "lastMaintenanceDuration" in milliseconds.
+     *
+     * \return the database statistics
+     */
+    QVariantMap databaseStatistics() const;
+
+    /*!
+     * Returns the image sent in the image data hint of a notification.
+     * The image is read from the notification image store and decoded on
+     * each call, so callers should keep the returned image if they need it
+     * repeatedly.
+     *
+     * \param id the ID of the notification
+     * \return the image of the notification or a null image if it has no image
+     */
+    QImage notificationImage(uint id);
+
     /*!
      * Returns an array of strings. Each string describes an optional capability
      * implemented by the server. Refer to the Desktop Notification Specifications for
@@ -187,6 +288,61 @@ public:
      */
     NotificationList GetNotifications(const QString &appName);
 
+    /*!
+     * Adds or updates several notifications in one call. Each notification
+     * is handled like in Notify(), with its ID used as the ID of the
+     * notification to replace, and charged against the rate limit of its
+     * own application. At most 100 notifications are handled in one call.
+     * The notifications are stored with a single database operation and
+     * signaled in a single notificationsChanged(); no notificationModified()
+     * is emitted for them.
+     *
+     * \param notifications the notifications to add or update
+     * \return the IDs of the notifications in the same order, 0 for each notification which could not be added or updated or which exceeded the maximum batch size
+     */
+    QList<uint> NotifyBatch(const NotificationList &notifications);
+
+    /*!
+     * Closes several notifications in one call. Each notification is
+     * closed like in CloseNotification(). The removals go to the same
+     * database transaction and are signaled in a single
+     * notificationsChanged().
+     *
+     * \param ids the IDs of the notifications to be closed
+     */
+    void CloseNotifications(const QList<uint> &ids);
+
+    /*!
+     * Returns the notifications of an application added or modified after
+     * a given change sequence number and the IDs of the notifications of
+     * the application closed after it. This allows applications to resync
+     * their state with a cost proportional to the amount of changes.
+     *
+     * If the changes since \a since are not known, for example because
+     * lipstick has been restarted or too many notifications have been
+     * closed since, all notifications of the application are returned
+     * and \a reset is set to \c true. The caller should then replace its
+     * state with the returned notifications. Otherwise the removals
+     * should be applied before the modifications, since the ID of a
+     * closed notification may have been reused by a new one.
+     *
+     * \param appName the name of the application to get the changes for
+     * \param since the change sequence number returned by the previous call or 0 to get all notifications
+     * \param removedIds set to the IDs of the notifications closed since \a since
+     * \param sequence set to the current change sequence number, to be passed to the next call
+     * \param reset set to \c true if all notifications of the application were returned, \c false otherwise
+     * \return the notifications added or modified since \a since
+     */
+    NotificationList GetNotificationChanges(const QString &appName, quint64 since, QList<uint> &removedIds, quint64 &sequence, bool &reset);
+
+    /*!
+     * Returns the current change sequence number. The number is increased
+     * whenever a notification is added, modified or closed.
+     *
+     * \return the current change sequence number
+     */
+    quint64 changeSequence() const;
+
 signals:
     /*!
      * A completed notification is one that has timed out, or has been dismissed by the user.
@@ -207,7 +363,9 @@ signals:
     void ActionInvoked(uint id, const QString &actionKey);
 
     /*!
-     * Emitted when a notification is modified (added or updated).
+     * Emitted when a notification is modified (added or updated). Not
+     * emitted for the notifications of a NotifyBatch() call, which are only
+     * reported by notificationsChanged().
      *
      * \param id the ID of the modified notification
      */
@@ -220,6 +378,19 @@ signals:
      */
     void notificationRemoved(uint id);
 
+    /*!
+     * Emitted once per event loop iteration with all the notifications
+     * modified (added or updated) and removed since the previous emission.
+     * A notification removed after being modified is only listed in
+     * \a removedIds. A notification removed and then added again with the
+     * same ID is listed in both, in which case the removal applies to the
+     * previous notification.
+     *
+     * \param modifiedIds the IDs of the modified notifications
+     * \param removedIds the IDs of the removed notifications
+     */
+    void notificationsChanged(const QList<uint> &modifiedIds, const QList<uint> &removedIds);
+
 public slots:
     /*!
      * Removes all notifications which are user removable.
@@ -227,6 +398,16 @@ public slots:
     void removeUserRemovableNotifications();
 
 private slots:
+    /*!
+     * Removes the notifications whose category definition has been
+     * uninstalled and updates the notifications whose category definition
+     * has been modified.
+     *
+     * \param modifiedCategories the category definitions that were installed or modified
+     * \param uninstalledCategories the category definitions that were removed
+     */
+    void applyCategoryDefinitionChanges(const QStringList &modifiedCategories, const QStringList &uninstalledCategories);
+
     /*!
      * Removes all notifications with the specified category.
      *
@@ -243,10 +424,10 @@ private slots:
     void updateNotificationsWithCategory(const QString &category);
 
     /*!
-     * Commits the current database transaction, if any.
-     * Also destroys any removed notifications.
+     * Destroys any removed notifications. Called when the removals have
+     * been committed to the database.
      */
-    void commit();
+    void destroyRemovedNotifications();
 
     /*!
      * Invokes the given action if it is has been defined. The
@@ -256,6 +437,21 @@ private slots:
      */
     void invokeAction(const QString &action);
 
+    //! Closes all notifications whose expiration time has passed and schedules the next expiration.
+    void expireNotifications();
+
+    //! Stores and signals the notification updates deferred because of rate limiting.
+    void emitPendingModifications();
+
+    //! Emits the notifications changed signal for the modifications and removals collected since the previous emission.
+    void emitNotificationsChanged();
+
+    //! Starts the database maintenance timer if the display is off and the device is idle, stops it otherwise.
+    void scheduleDatabaseMaintenance();
+
+    //! Requests the database thread to checkpoint and vacuum the database if the device is still idle.
+    void performDatabaseMaintenance();
+
 private:
     /*!
      * Creates a new notification manager.
@@ -267,13 +463,6 @@ private:
     //! Destroys the notification manager.
     virtual ~NotificationManager();
 
-    /*!
-     * Returns the next available notification ID
-     *
-     * \return The next available notification ID
-     */
-    uint nextAvailableNotificationID();
-
     /*!
      * Applies a category definition to a notification's hints by inserting
      * all key-value pairs in the category definition to the hints.
@@ -290,59 +479,180 @@ private:
      */
     void addTimestamp(QVariantHash &hints);
 
-    //! Restores the notifications from a database on the disk
+    /*!
+     * Replaces the keys of a notification's hints and the category hint
+     * with their interned instances so that they are shared by all
+     * notifications.
+     *
+     * \param hints the notification hints to intern
+     */
+    void internHints(QVariantHash &hints);
+
+    /*!
+     * Moves the image data hint of a notification to the notification
+     * image store and replaces it with a reference to the stored image. A
+     * reference hint already present in the hints is only kept if it
+     * refers to an image in the store. Adds a reference to the image
+     * referred to by the resulting hints, if any.
+     *
+     * \param hints the notification hints to move the image data from
+     */
+    void storeImageData(QVariantHash &hints);
+
+    /*!
+     * Releases the reference of a notification to its image in the
+     * notification image store, if any.
+     *
+     * \param hints the hints of the notification
+     */
+    void releaseImageData(const QVariantHash &hints);
+
+    /*!
+     * Adds the image references of the lazily restored notifications
+     * which have not been accessed yet and removes the images not
+     * referenced by any notification. Done once before the first image
+     * reference is released, since the images are only known after
+     * decoding the hints of the notifications.
+     */
+    void countImageReferences();
+
+    /*!
+     * Restores the notifications from a database on the disk. In the lazy
+     * restore mode (the default, controlled by the notifications/lazy_restore
+     * key of the lipstick settings file) only the stored records are kept
+     * and the notifications are created on first access.
+     */
     void restoreNotifications();
 
     /*!
-     * Creates a connection to the Sqlite database.
+     * Creates a notification from its record restored from the database.
+     *
+     * \param id the ID of a notification which has not been created yet
+     * \return the created notification
+     */
+    LipstickNotification *restoreNotification(uint id);
+
+    /*!
+     * Adds a notification to the application name and category indexes.
+     *
+     * \param id the ID of the notification
+     * \param appName the application name of the notification
+     * \param category the category of the notification
+     */
+    void addToIndexes(uint id, const QString &appName, const QString &category);
+
+    /*!
+     * Removes a notification from the application name and category indexes.
+     *
+     * \param id the ID of the notification
+     * \param appName the application name the notification was indexed with
+     * \param category the category the notification was indexed with
+     */
+    void removeFromIndexes(uint id, const QString &appName, const QString &category);
+
+    /*!
+     * Queues a notification to be written to the database, replacing any
+     * previously stored copy of it. The notifications of a NotifyBatch()
+     * call are collected and written together at the end of the batch.
+     *
+     * \param id the ID of the notification to be stored
+     * \param hints the hints to store for the notification
+     */
+    void storeNotification(uint id, const QVariantHash &hints);
+
+    /*!
+     * Sets the time when a notification expires. Any previous expiration
+     * time of the notification is removed from the expiration queue.
+     * scheduleExpiration() must be called for the change to take effect.
+     *
+     * \param id the ID of the notification
+     * \param expireAt the expiration time in milliseconds since the epoch or 0 if the notification never expires
+     */
+    void setExpirationTime(uint id, qint64 expireAt);
+
+    //! Starts the expiration timer for the earliest expiration time in the expiration queue, if any
+    void scheduleExpiration();
+
+    /*!
+     * Takes a token from the rate limit bucket of an application. The
+     * bucket is refilled based on the time passed since it was last used.
+     *
+     * \param appName the name of the application sending a notification
+     * \param category the category of the notification, used to look up category specific limits
+     * \return \c true if the application is within its rate limit, \c false otherwise
+     */
+    bool consumeRateLimitToken(const QString &appName, const QString &category);
+
+    /*!
+     * Drops the rate limit buckets that have been refilled since they were
+     * last used, as they are equivalent to new buckets.
      *
-     * \return \c true if the connection was successfully established, \c false otherwise
+     * \param currentTime the current time of the rate limit clock in milliseconds
      */
-    bool connectToDatabase();
+    void sweepRateLimitBuckets(qint64 currentTime);
 
     /*!
-     * Checks whether there is enough free disk space available.
+     * Adds or updates a notification like Notify() once the rate limit has
+     * been checked.
      *
-     * \param path any path to the file system from which the space should be checked
-     * \param freeSpaceNeeded free space needed in kilobytes
-     * \return \c true if there is enough free space in given file system, \c false otherwise
+     * \param data the notification data; a replaces ID of 0 adds a new notification
+     * \param withinRateLimit whether the application is within its rate limit
+     * \return the ID of the notification or 0 if it could not be added or updated
      */
-    static bool checkForDiskSpace(const QString &path, unsigned long freeSpaceNeeded);
+    uint notify(const NotificationData &data, bool withinRateLimit);
 
     /*!
-     * Removes a database file from the filesystem. Removes related -wal and -shm files as well.
+     * Creates or replaces a notification with the given data. The
+     * notification is not stored or signaled.
      *
-     * \param path the path of the database file to be removed
+     * \param id the ID of the notification
+     * \param data the notification data; a replaces ID of 0 creates a new notification
      */
-    static void removeDatabaseFile(const QString &path);
+    void applyNotification(uint id, const NotificationData &data);
 
     /*!
-     * Ensures that all database tables have the requires fields.
-     * Recreates the tables if needed.
+     * Defers applying, storing and signaling a notification update until
+     * the coalescing timer fires. Further updates to the same notification
+     * before that replace the pending one.
      *
-     * \return \c true if the database can be used, \c false otherwise
+     * \param id the ID of the updated notification
+     * \param data the data of the update
      */
-    bool checkTableValidity();
+    void deferModification(uint id, const NotificationData &data);
 
     /*!
-     * Recreates a table in the database.
+     * Signals that a notification has been modified, right away unless the
+     * notifications of a NotifyBatch() call are being handled, and as a part
+     * of the next notification change batch.
      *
-     * \param tableName the name of the table to be created
-     * \param definition SQL definition for the table
-     * \return \c true if the table was created, \c false otherwise
+     * \param id the ID of the modified notification
+     */
+    void signalModification(uint id);
+
+    /*!
+     * Signals that a notification has been removed, both right away and
+     * as a part of the next notification change batch.
+     *
+     * \param id the ID of the removed notification
      */
-    bool recreateTable(const QString &tableName, const QString &definition);
+    void signalRemoval(uint id);
 
-    //! Fills the notifications hash table with data from the database
-    void fetchData();
+    /*!
+     * Assigns a new change sequence number to a notification which has
+     * been added or modified.
+     *
+     * \param id the ID of the notification
+     */
+    void recordModification(uint id);
 
     /*!
-     * Executes a SQL command in the database. Starts a new transaction if none is active currently, otherwise
-     * the command goes to the active transaction. Restarts the transaction commit timer.
-     * \param command the SQL command
-     * \param args list of values to be bound to the positional placeholders ('?' -character) in the command.
+     * Records that a notification has been closed so that the closing can
+     * be reported by GetNotificationChanges().
+     *
+     * \param id the ID of the notification
+     * \param appName the application name of the notification
      */
-    void execSQL(const QString &command, const QVariantList &args = QVariantList());
+    void recordRemoval(uint id, const QString &appName);
 
     /*!
      * Removes a notification if it is removable by the user.
@@ -357,23 +667,141 @@ private:
     //! Hash of all notifications keyed by notification IDs
     QHash<uint, LipstickNotification*> notifications;
 
+    //! Records of the lazily restored notifications which have not been accessed yet
+    NotificationManagerPrivate *d;
+
+    //! IDs of all notifications keyed by application names
+    QMultiHash<QString, uint> notificationIdsByAppName;
+
+    //! IDs of all notifications with a category keyed by categories
+    QMultiHash<QString, uint> notificationIdsByCategory;
+
+    //! The time it took to restore the notifications in milliseconds
+    qint64 restoreDuration_;
+
     //! Notifications waiting to be destroyed
     QSet<LipstickNotification *> removedNotifications;
 
-    //! Previous notification ID used
-    uint previousNotificationID;
+    //! Allocator for the IDs of new notifications
+    NotificationIdAllocator *idAllocator;
+
+    //! Store for the images sent in the image data hints
+    NotificationImageStore *imageStore;
+
+    //! Whether the image references of all restored notifications have been added to the image store
+    bool imageReferencesCounted;
 
     //! The category definition store
     CategoryDefinitionStore *categoryDefinitionStore;
 
-    //! Database for the notifications
-    QSqlDatabase *database;
+    //! Database for the notifications. Lives in the database thread.
+    NotificationDatabase *database;
+
+    //! Thread in which all database operations are executed
+    QThread databaseThread;
+
+    //! IDs of the expiring notifications ordered by their expiration times in milliseconds since the epoch
+    QMultiMap<qint64, uint> expirationQueue;
+
+    //! Expiration times of the expiring notifications keyed by notification IDs
+    QHash<uint, qint64> expirationTimes;
+
+    //! A single timer for expiring the notification at the head of the expiration queue
+    QTimer expirationTimer;
+
+    //! Rate limit state of a single application
+    struct RateLimitBucket {
+        RateLimitBucket(double tokens = 0, qint64 lastRefillTime = 0) : tokens(tokens), lastRefillTime(lastRefillTime), fullTime(lastRefillTime) {}
+
+        //! Number of notifications the application can still send
+        double tokens;
+
+        //! Time of the last refill in milliseconds since the rate limit clock was started
+        qint64 lastRefillTime;
+
+        //! Time at which the bucket is full again in milliseconds since the rate limit clock was started
+        qint64 fullTime;
+    };
+
+    //! Rate limit buckets keyed by application names
+    QHash<QString, RateLimitBucket> rateLimitBuckets;
+
+    //! Monotonic clock for refilling the rate limit buckets
+    QElapsedTimer rateLimitClock;
+
+    //! Default number of notifications an application can send in a burst; 0 disables rate limiting
+    int defaultRateLimitBurst;
+
+    //! Default number of notifications per second an application can send after a burst
+    double defaultRateLimitRate;
+
+    //! Number of rate limit buckets at which the refilled buckets are dropped next
+    int rateLimitBucketSweepThreshold;
+
+    //! Updates deferred because of rate limiting keyed by notification IDs
+    QHash<uint, NotificationData> pendingModifications;
+
+    //! Timer for storing and signaling the deferred notification updates
+    QTimer modificationCoalescingTimer;
+
+    //! Number of new notifications dropped because of rate limiting
+    uint droppedNotificationCount_;
+
+    //! Number of notification updates coalesced because of rate limiting
+    uint coalescedNotificationCount_;
+
+    //! IDs of the notifications modified since the notifications changed signal was last emitted
+    QSet<uint> modifiedNotificationIds;
+
+    //! IDs of the notifications removed since the notifications changed signal was last emitted
+    QSet<uint> removedNotificationIds;
+
+    //! Timer for emitting the notifications changed signal once control returns to the event loop
+    QTimer notificationsChangedTimer;
+
+    //! The latest change sequence number
+    quint64 changeSequence_;
+
+    //! The change sequence number when the notification manager was created; changes before it are not known
+    quint64 firstChangeSequence;
+
+    //! Change sequence numbers of the notifications modified after the notification manager was created keyed by notification IDs
+    QHash<uint, quint64> modificationSequences;
+
+    //! IDs of the notifications modified after the notification manager was created ordered by their change sequence numbers
+    QMap<quint64, uint> modificationsBySequence;
+
+    //! A closed notification
+    struct Removal {
+        Removal(uint id = 0, const QString &appName = QString()) : id(id), appName(appName) {}
+
+        //! The ID of the closed notification
+        uint id;
+
+        //! The application name of the closed notification
+        QString appName;
+    };
+
+    //! The most recently closed notifications ordered by the change sequence numbers of the closings
+    QMap<quint64, Removal> removalsBySequence;
+
+    //! The change sequence number of the latest closing forgotten from the removals; changes before it are not known
+    quint64 forgottenRemovalSequence;
+
+    //! For getting the activity state to schedule database maintenance
+    MeeGo::QmActivity *activity;
+
+    //! Timer for starting database maintenance once the device has been idle for a while
+    QTimer databaseMaintenanceTimer;
+
+    //! Time since the latest database maintenance; invalid if no maintenance has been done
+    QElapsedTimer databaseMaintenanceClock;
 
-    //! Whether the current database transaction has been committed to the database
-    bool committed;
+    //! Time in milliseconds a database maintenance run can spend vacuuming
+    int databaseMaintenanceTimeBudget;
 
-    //! Timer for triggering the commit of the current database transaction
-    QTimer databaseCommitTimer;
+    //! Amount of data in bytes a database maintenance run can vacuum
+    qint64 databaseMaintenanceSizeBudget;
 
 #ifdef UNIT_TEST
     friend class Ut_NotificationManager;
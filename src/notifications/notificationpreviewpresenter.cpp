@@ -21,25 +21,32 @@
 #include "notifications/notificationmanager.h"
 #include "notificationpreviewpresenter.h"
 #include "compositor/lipstickcompositor.h"
+#include "systemstate.h"
 
-#include <qmdisplaystate.h>
-#include <qmlocks.h>
+//! The number of queued notifications above which notifications of the same application or category are collapsed into a summary
+static const int MAX_QUEUED_NOTIFICATIONS = 5;
 
-enum PreviewMode {
-    AllNotificationsEnabled = 0,
-    ApplicationNotificationsDisabled,
-    SystemNotificationsDisabled,
-    AllNotificationsDisabled
-};
+bool NotificationPreviewPresenter::QueueKey::operator<(const QueueKey &other) const
+{
+    if (urgency != other.urgency) {
+        return urgency > other.urgency;
+    }
+    if (priority != other.priority) {
+        return priority > other.priority;
+    }
+    if (timestamp != other.timestamp) {
+        return timestamp < other.timestamp;
+    }
+    return sequence < other.sequence;
+}
 
 NotificationPreviewPresenter::NotificationPreviewPresenter(QObject *parent) :
     QObject(parent),
     window(0),
+    nextQueueSequence(0),
     currentNotification(0)
-    ,locks(new MeeGo::QmLocks(this)),
-    displayState(new MeeGo::QmDisplayState(this))
 {
-    connect(NotificationManager::instance(), SIGNAL(notificationModified(uint)), this, SLOT(updateNotification(uint)));
+    connect(NotificationManager::instance(), SIGNAL(notificationsChanged(QList<uint>, QList<uint>)), this, SLOT(updateNotifications(QList<uint>, QList<uint>)));
     connect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), this, SLOT(removeNotification(uint)));
 }
 
@@ -63,11 +70,18 @@ void NotificationPreviewPresenter::showNextNotification()
 
         setCurrentNotification(0);
     } else {
-        LipstickNotification *notification = notificationQueue.takeFirst();
+        QMap<QueueKey, LipstickNotification *>::iterator first = notificationQueue.begin();
+        LipstickNotification *notification = first.value();
+        notificationQueuePositions.remove(notification);
+        notificationQueue.erase(first);
 
-        if (locks->getState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked && displayState->get() == MeeGo::QmDisplayState::Off) {
+        SystemState *systemState = SystemState::instance();
+        if (systemState->lockState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked && systemState->displayState() == MeeGo::QmDisplayState::Off) {
             // Screen locked and off: don't show the notification but just remove it from the queue
-            emit notificationPresented(notification->property("id").toUInt());
+            emitNotificationPresented(notification);
+            if (summaryNotificationIds.contains(notification)) {
+                releaseSummary(notification);
+            }
 
             setCurrentNotification(0);
 
@@ -79,7 +93,7 @@ void NotificationPreviewPresenter::showNextNotification()
                 window->show();
             }
 
-            emit notificationPresented(notification->property("id").toUInt());
+            emitNotificationPresented(notification);
 
             setCurrentNotification(notification);
         }
@@ -91,6 +105,13 @@ LipstickNotification *NotificationPreviewPresenter::notification() const
     return currentNotification;
 }
 
+void NotificationPreviewPresenter::updateNotifications(const QList<uint> &modifiedIds, const QList<uint> &)
+{
+    foreach (uint id, modifiedIds) {
+        updateNotification(id);
+    }
+}
+
 void NotificationPreviewPresenter::updateNotification(uint id)
 {
     LipstickNotification *notification = NotificationManager::instance()->notification(id);
@@ -98,13 +119,18 @@ void NotificationPreviewPresenter::updateNotification(uint id)
     if (notification != 0) {
         notification->setProperty("id", id);
         if (notificationShouldBeShown(notification)) {
-            // Add the notification to the queue if not already there or the current notification
-            if (currentNotification != notification && !notificationQueue.contains(notification)) {
-                notificationQueue.append(notification);
+            // Add the notification to the queue if it's not the current notification or already collapsed into a summary
+            if (currentNotification != notification && !summaryForNotificationId.contains(id)) {
+                bool alreadyQueued = notificationQueuePositions.contains(notification);
+                enqueueNotification(notification);
+
+                if (!alreadyQueued) {
+                    collapseQueueIfNecessary();
 
-                // Show the notification if no notification currently being shown
-                if (currentNotification == 0) {
-                    showNextNotification();
+                    // Show the notification if no notification currently being shown
+                    if (currentNotification == 0) {
+                        showNextNotification();
+                    }
                 }
             }
         } else {
@@ -113,7 +139,7 @@ void NotificationPreviewPresenter::updateNotification(uint id)
 
             removeNotification(id, true);
 
-            if (currentNotification != notification && notification->hints().value(NotificationManager::HINT_URGENCY).toInt() >= 2) {
+            if (currentNotification != notification && notification->urgency() >= 2) {
                 NotificationManager::instance()->CloseNotification(id);
             }
         }
@@ -122,11 +148,15 @@ void NotificationPreviewPresenter::updateNotification(uint id)
 
 void NotificationPreviewPresenter::removeNotification(uint id, bool onlyFromQueue)
 {
+    if (removeNotificationFromSummary(id, onlyFromQueue)) {
+        return;
+    }
+
     // Remove the notification from the queue
     LipstickNotification *notification = NotificationManager::instance()->notification(id);
 
     if (notification != 0) {
-        notificationQueue.removeAll(notification);
+        dequeueNotification(notification);
 
         // If the notification is currently being shown hide it - the next notification will be shown after the current one has been hidden
         if (!onlyFromQueue && currentNotification == notification) {
@@ -154,29 +184,164 @@ void NotificationPreviewPresenter::createWindowIfNecessary()
 
 bool NotificationPreviewPresenter::notificationShouldBeShown(LipstickNotification *notification)
 {
-    bool screenOrDeviceLocked = locks->getState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked || locks->getState(MeeGo::QmLocks::Device) == MeeGo::QmLocks::Locked;
-    bool notificationHidden = notification->hints().value(NotificationManager::HINT_HIDDEN).toBool();
+    SystemState *systemState = SystemState::instance();
+    bool screenOrDeviceLocked = systemState->lockState(MeeGo::QmLocks::TouchAndKeyboard) == MeeGo::QmLocks::Locked || systemState->lockState(MeeGo::QmLocks::Device) == MeeGo::QmLocks::Locked;
+    bool notificationHidden = notification->isHidden();
     bool notificationHasPreviewText = !(notification->previewBody().isEmpty() && notification->previewSummary().isEmpty());
-    int notificationIsCritical = notification->hints().value(NotificationManager::HINT_URGENCY).toInt() >= 2;
+    int notificationIsCritical = notification->urgency() >= 2;
 
-    uint mode = AllNotificationsEnabled;
-    QWaylandSurface *surface = LipstickCompositor::instance()->surfaceForId(LipstickCompositor::instance()->topmostWindowId());
-    if (surface != 0) {
-        mode = surface->windowProperties().value("NOTIFICATION_PREVIEWS_DISABLED", uint(AllNotificationsEnabled)).toUInt();
-    }
+    SystemState::NotificationPreviewMode mode = systemState->notificationPreviewMode();
 
     return !notificationHidden && notificationHasPreviewText && (!screenOrDeviceLocked || notificationIsCritical) &&
-            (mode == AllNotificationsEnabled || (mode == ApplicationNotificationsDisabled && notificationIsCritical) || (mode == SystemNotificationsDisabled && !notificationIsCritical));
+            (mode == SystemState::AllNotificationsEnabled || (mode == SystemState::ApplicationNotificationsDisabled && notificationIsCritical) || (mode == SystemState::SystemNotificationsDisabled && !notificationIsCritical));
 }
 
 void NotificationPreviewPresenter::setCurrentNotification(LipstickNotification *notification)
 {
     if (currentNotification != notification) {
-        if (currentNotification != 0 && currentNotification->hints().value(NotificationManager::HINT_URGENCY).toInt() >= 2) {
-            NotificationManager::instance()->CloseNotification(currentNotification->property("id").toUInt());
+        LipstickNotification *previousNotification = currentNotification;
+        if (previousNotification != 0 && previousNotification->urgency() >= 2) {
+            NotificationManager::instance()->CloseNotification(previousNotification->property("id").toUInt());
         }
 
         currentNotification = notification;
         emit notificationChanged();
+
+        if (summaryNotificationIds.contains(previousNotification)) {
+            releaseSummary(previousNotification);
+        }
+    }
+}
+
+void NotificationPreviewPresenter::enqueueNotification(LipstickNotification *notification)
+{
+    QueueKey key;
+    if (notificationQueuePositions.contains(notification)) {
+        // Keep the original arrival order but move the notification according to its current urgency and priority
+        key = notificationQueuePositions.value(notification);
+        notificationQueue.remove(key);
+    } else {
+        QDateTime timestamp = notification->timestamp();
+        key.timestamp = timestamp.isValid() ? timestamp.toMSecsSinceEpoch() : QDateTime::currentMSecsSinceEpoch();
+        key.sequence = nextQueueSequence++;
+    }
+    key.urgency = notification->urgency();
+    key.priority = notification->priority();
+
+    notificationQueue.insert(key, notification);
+    notificationQueuePositions.insert(notification, key);
+}
+
+bool NotificationPreviewPresenter::dequeueNotification(LipstickNotification *notification)
+{
+    QHash<LipstickNotification *, QueueKey>::iterator position = notificationQueuePositions.find(notification);
+    if (position == notificationQueuePositions.end()) {
+        return false;
+    }
+
+    notificationQueue.remove(position.value());
+    notificationQueuePositions.erase(position);
+    return true;
+}
+
+void NotificationPreviewPresenter::collapseQueueIfNecessary()
+{
+    if (notificationQueue.count() <= MAX_QUEUED_NOTIFICATIONS) {
+        return;
+    }
+
+    // Group the non-critical notifications by category or, if they have no category, by application
+    QHash<QString, QList<LipstickNotification *> > groups;
+    QStringList groupOrder;
+    foreach (LipstickNotification *notification, notificationQueue) {
+        if (notification->urgency() >= 2) {
+            continue;
+        }
+
+        QString group = notification->category().isEmpty() ? ("app:" + notification->appName()) : ("category:" + notification->category());
+        if (!groups.contains(group)) {
+            groupOrder.append(group);
+        }
+        groups[group].append(notification);
+    }
+
+    foreach (const QString &group, groupOrder) {
+        const QList<LipstickNotification *> &members = groups[group];
+        if (members.count() < 2) {
+            continue;
+        }
+
+        // The summary takes the position of the earliest member in the queue and shows the contents of the latest one
+        QueueKey key = notificationQueuePositions.value(members.first());
+        QList<uint> ids;
+        int itemCount = 0;
+        foreach (LipstickNotification *member, members) {
+            dequeueNotification(member);
+            if (summaryNotificationIds.contains(member)) {
+                ids.append(summaryNotificationIds.value(member));
+                itemCount += member->itemCount();
+                releaseSummary(member);
+            } else {
+                ids.append(member->property("id").toUInt());
+                itemCount += qMax(member->itemCount(), 1);
+            }
+        }
+
+        NotificationData data = members.last()->data();
+        data.actions.clear();
+        data.hints.insert(NotificationManager::HINT_ITEM_COUNT, itemCount);
+        LipstickNotification *summary = new LipstickNotification(data, this);
+        summary->setProperty("id", ids.last());
+
+        summaryNotificationIds.insert(summary, ids);
+        foreach (uint id, ids) {
+            summaryForNotificationId.insert(id, summary);
+        }
+        notificationQueue.insert(key, summary);
+        notificationQueuePositions.insert(summary, key);
+    }
+}
+
+bool NotificationPreviewPresenter::removeNotificationFromSummary(uint id, bool onlyFromQueue)
+{
+    LipstickNotification *summary = summaryForNotificationId.take(id);
+    if (summary == 0) {
+        return false;
+    }
+
+    QList<uint> &ids = summaryNotificationIds[summary];
+    ids.removeAll(id);
+    if (ids.isEmpty()) {
+        // Nothing left to summarize: drop the summary from the queue or hide it if it's being shown
+        if (currentNotification != summary) {
+            dequeueNotification(summary);
+            releaseSummary(summary);
+        } else if (!onlyFromQueue) {
+            currentNotification = 0;
+            emit notificationChanged();
+            releaseSummary(summary);
+        }
+    }
+    return true;
+}
+
+void NotificationPreviewPresenter::releaseSummary(LipstickNotification *summary)
+{
+    foreach (uint id, summaryNotificationIds.take(summary)) {
+        summaryForNotificationId.remove(id);
+    }
+
+    // The summary may still be referenced by the preview window
+    summary->deleteLater();
+}
+
+void NotificationPreviewPresenter::emitNotificationPresented(LipstickNotification *notification)
+{
+    if (summaryNotificationIds.contains(notification)) {
+        foreach (uint id, summaryNotificationIds.value(notification)) {
+            emit notificationPresented(id);
+        }
+    } else {
+        emit notificationPresented(notification->property("id").toUInt());
     }
 }
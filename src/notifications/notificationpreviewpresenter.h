@@ -18,15 +18,12 @@
 
 #include "lipstickglobal.h"
 #include <QObject>
+#include <QHash>
+#include <QMap>
 
 class HomeWindow;
 class LipstickNotification;
 
-namespace MeeGo {
-class QmLocks;
-class QmDisplayState;
-}
-
 /*!
  * \class NotificationPreviewPresenter
  *
@@ -34,6 +31,12 @@ class QmDisplayState;
  *
  * Creates a transparent notification window which can be used to show
  * notification previews.
+ *
+ * Queued notifications are shown in order of urgency, priority and
+ * timestamp so that a critical notification is shown next even if less
+ * urgent notifications were queued before it. When the queue grows too long
+ * the non-critical notifications of each application or category are
+ * collapsed into a single summary preview.
  */
 class LIPSTICK_EXPORT NotificationPreviewPresenter : public QObject
 {
@@ -76,7 +79,20 @@ public slots:
      */
     void showNextNotification();
 
+    //! Creates the notification window if it has not been created yet
+    void createWindowIfNecessary();
+
 private slots:
+    /*!
+     * Updates the modified notifications of a batch of notification
+     * changes. The removals are handled by removeNotification() as soon as
+     * they happen.
+     *
+     * \param modifiedIds the IDs of the modified notifications
+     * \param removedIds the IDs of the removed notifications
+     */
+    void updateNotifications(const QList<uint> &modifiedIds, const QList<uint> &removedIds);
+
     /*!
      * Updates the notification with the given ID.
      *
@@ -92,29 +108,78 @@ private slots:
     void removeNotification(uint id, bool onlyFromQueue = false);
 
 private:
-    //! Creates the notification window if it has not been created yet.
-    void createWindowIfNecessary();
-
     //! Checks whether the given notification has a preview body and a preview summary.
     bool notificationShouldBeShown(LipstickNotification *notification);
 
     //! Sets the given notification as the current notification
     void setCurrentNotification(LipstickNotification *notification);
 
+    //! The position of a notification in the queue
+    struct QueueKey {
+        int urgency;
+        int priority;
+        qint64 timestamp;
+        quint64 sequence;
+
+        //! Orders more urgent notifications first and older notifications first among equally urgent ones
+        bool operator<(const QueueKey &other) const;
+    };
+
+    /*!
+     * Adds a notification to the queue or moves it to its new position if its
+     * urgency or priority have changed.
+     *
+     * \param notification the notification to be queued
+     */
+    void enqueueNotification(LipstickNotification *notification);
+
+    /*!
+     * Removes a notification from the queue.
+     *
+     * \param notification the notification to be removed
+     * \return \c true if the notification was queued, \c false otherwise
+     */
+    bool dequeueNotification(LipstickNotification *notification);
+
+    //! Collapses the queued notifications of each application or category into summary previews if the queue is too long
+    void collapseQueueIfNecessary();
+
+    /*!
+     * Removes a notification from the summary preview it has been collapsed
+     * into. A summary with no notifications left is removed as well.
+     *
+     * \param id the ID of the notification to be removed
+     * \param onlyFromQueue whether a summary currently being shown should be kept visible
+     * \return \c true if the notification had been collapsed into a summary, \c false otherwise
+     */
+    bool removeNotificationFromSummary(uint id, bool onlyFromQueue);
+
+    //! Forgets the members of a summary preview and destroys it
+    void releaseSummary(LipstickNotification *summary);
+
+    //! Signals that the given notification or all notifications in the given summary have been presented
+    void emitNotificationPresented(LipstickNotification *notification);
+
     //! The notification window
     HomeWindow *window;
 
-    //! Notifications to be shown
-    QList<LipstickNotification *> notificationQueue;
+    //! Notifications to be shown ordered by their queue position
+    QMap<QueueKey, LipstickNotification *> notificationQueue;
 
-    //! Notification currently being shown
-    LipstickNotification *currentNotification;
+    //! Queue positions of the notifications to be shown
+    QHash<LipstickNotification *, QueueKey> notificationQueuePositions;
 
-    //! For getting information about the touch screen lock state
-    MeeGo::QmLocks *locks;
+    //! The sequence number of the next queued notification
+    quint64 nextQueueSequence;
 
-    //! For getting information about the display state
-    MeeGo::QmDisplayState *displayState;
+    //! IDs of the notifications collapsed into each summary preview
+    QHash<LipstickNotification *, QList<uint> > summaryNotificationIds;
+
+    //! Summary preview each collapsed notification has been collapsed into by notification ID
+    QHash<uint, LipstickNotification *> summaryForNotificationId;
+
+    //! Notification currently being shown
+    LipstickNotification *currentNotification;
 
 #ifdef UNIT_TEST
     friend class Ut_NotificationPreviewPresenter;
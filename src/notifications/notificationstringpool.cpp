@@ -0,0 +1,69 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QMutex>
+#include <QSet>
+#include "notificationstringpool.h"
+
+//! Guards the interned strings
+static QMutex poolMutex;
+
+//! The interned strings
+static QSet<QString> pool;
+
+//! Number of strings that didn't fit in the full pool since the last eviction
+static int missCount = 0;
+
+//! Removes the strings only referenced by the pool itself
+static void evictUnreferencedStrings()
+{
+    QSet<QString>::iterator string = pool.begin();
+    while (string != pool.end()) {
+        if (string->isDetached()) {
+            string = pool.erase(string);
+        } else {
+            ++string;
+        }
+    }
+    missCount = 0;
+}
+
+QString NotificationStringPool::intern(const QString &string)
+{
+    if (string.isEmpty()) {
+        return string;
+    }
+
+    QMutexLocker locker(&poolMutex);
+    QSet<QString>::const_iterator interned = pool.constFind(string);
+    if (interned != pool.constEnd()) {
+        return *interned;
+    }
+
+    if (pool.count() >= MAXIMUM_COUNT && ++missCount >= EVICTION_INTERVAL) {
+        evictUnreferencedStrings();
+    }
+
+    if (pool.count() < MAXIMUM_COUNT) {
+        pool.insert(string);
+    }
+    return string;
+}
+
+int NotificationStringPool::count()
+{
+    QMutexLocker locker(&poolMutex);
+    return pool.count();
+}
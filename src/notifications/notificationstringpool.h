@@ -0,0 +1,66 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONSTRINGPOOL_H
+#define NOTIFICATIONSTRINGPOOL_H
+
+#include <QString>
+
+/*!
+ * \class NotificationStringPool
+ *
+ * \brief Interns strings which repeat across notifications.
+ *
+ * Hint keys and category names are the same for a large number of
+ * notifications but each notification received over D-Bus or restored from
+ * the database carries its own copies of them. Interning replaces the copies
+ * with a single shared instance of each string, so each string is stored
+ * only once. Interned strings are still compared and hashed by their
+ * contents like any other strings.
+ *
+ * The pool is limited to a fixed number of strings so that clients sending
+ * arbitrary hint keys can't make it grow without bounds. When the pool is
+ * full, the strings no longer referenced outside the pool are evicted to
+ * make room; the eviction is done once per a number of strings that didn't
+ * fit so that its cost is spread over them. Strings that don't fit are
+ * returned as is. The pool may be used from any thread.
+ */
+class NotificationStringPool
+{
+public:
+    /*!
+     * Returns the shared instance of a string, adding the string to the
+     * pool if it is not there yet.
+     *
+     * \param string the string to intern
+     * \return a string sharing its data with all other interned instances of the same string
+     */
+    static QString intern(const QString &string);
+
+    /*!
+     * Returns the number of strings in the pool.
+     *
+     * \return the number of strings in the pool
+     */
+    static int count();
+
+    //! The maximum number of strings in the pool
+    static const int MAXIMUM_COUNT = 1024;
+
+    //! The number of strings that didn't fit in the full pool after which the unreferenced strings are evicted
+    static const int EVICTION_INTERVAL = MAXIMUM_COUNT / 4;
+};
+
+#endif // NOTIFICATIONSTRINGPOOL_H
@@ -35,17 +35,9 @@ ShutdownScreen::ShutdownScreen(QObject *parent) :
 void ShutdownScreen::setWindowVisible(bool visible)
 {
     if (visible) {
-        if (window == 0) {
-            window = new HomeWindow();
-            window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
-            window->setCategory(QLatin1String("notification"));
-            window->setWindowTitle("Shutdown");
-            window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
-            window->setContextProperty("shutdownScreen", this);
-            window->setContextProperty("shutdownMode", shutdownMode);
-            window->setSource(QUrl("qrc:/qml/ShutdownScreen.qml"));
-            window->installEventFilter(new CloseEventEater(this));
-        }
+        // The window may have been created before the shutdown mode was set
+        createWindowIfNecessary();
+        window->setContextProperty("shutdownMode", shutdownMode);
 
         if (!window->isVisible()) {
             window->show();
@@ -57,6 +49,23 @@ void ShutdownScreen::setWindowVisible(bool visible)
     }
 }
 
+void ShutdownScreen::createWindowIfNecessary()
+{
+    if (window != 0) {
+        return;
+    }
+
+    window = new HomeWindow();
+    window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
+    window->setCategory(QLatin1String("notification"));
+    window->setWindowTitle("Shutdown");
+    window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
+    window->setContextProperty("shutdownScreen", this);
+    window->setContextProperty("shutdownMode", shutdownMode);
+    window->setSource(QUrl("qrc:/qml/ShutdownScreen.qml"));
+    window->installEventFilter(new CloseEventEater(this));
+}
+
 bool ShutdownScreen::windowVisible() const
 {
     return window != 0 && window->isVisible();
@@ -56,6 +56,10 @@ signals:
     //! Sent when the visibility of the window has changed.
     void windowVisibleChanged();
 
+public slots:
+    //! Creates the shutdown screen window if it has not been created yet
+    void createWindowIfNecessary();
+
 private slots:
     /*!
      * Reacts to system state changes by showing the shutdown screen or a
@@ -51,6 +51,12 @@ HEADERS += \
     $$PUBLICHEADERS \
     notifications/notificationmanageradaptor.h \
     notifications/categorydefinitionstore.h \
+    notifications/categorydefinitioncache.h \
+    notifications/notificationdatabase.h \
+    notifications/notificationidallocator.h \
+    notifications/notificationimagestore.h \
+    notifications/notificationjournal.h \
+    notifications/notificationstringpool.h \
     notifications/batterynotifier.h \
     notifications/lowbatterynotifier.h \
     notifications/diskspacenotifier.h \
@@ -65,7 +71,8 @@ HEADERS += \
     homeapplicationadaptor.h \
     shutdownscreenadaptor.h \
     screenshotservice.h \
-    screenshotserviceadaptor.h
+    screenshotserviceadaptor.h \
+    systemstate.h
 
 SOURCES += \
     homeapplication.cpp \
@@ -80,6 +87,12 @@ SOURCES += \
     notifications/notificationmanageradaptor.cpp \
     notifications/lipsticknotification.cpp \
     notifications/categorydefinitionstore.cpp \
+    notifications/categorydefinitioncache.cpp \
+    notifications/notificationdatabase.cpp \
+    notifications/notificationidallocator.cpp \
+    notifications/notificationimagestore.cpp \
+    notifications/notificationjournal.cpp \
+    notifications/notificationstringpool.cpp \
     notifications/notificationlistmodel.cpp \
     notifications/notificationpreviewpresenter.cpp \
     notifications/batterynotifier.cpp \
@@ -98,7 +111,8 @@ SOURCES += \
     devicelock/devicelockadaptor.cpp \
     devicelock/devicelock.cpp \
     screenshotservice.cpp \
-    screenshotserviceadaptor.cpp
+    screenshotserviceadaptor.cpp \
+    systemstate.cpp
 
 CONFIG += link_pkgconfig mobility qt warn_on depend_includepath qmake_cache target_qt
 CONFIG -= link_prl
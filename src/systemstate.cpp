@@ -0,0 +1,143 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QWaylandSurface>
+#include "compositor/lipstickcompositor.h"
+#include "systemstate.h"
+
+SystemState *SystemState::instance_ = 0;
+
+SystemState *SystemState::instance()
+{
+    if (instance_ == 0) {
+        instance_ = new SystemState(qApp);
+    }
+    return instance_;
+}
+
+SystemState::SystemState(QObject *parent) :
+    QObject(parent),
+    locks(new MeeGo::QmLocks(this)),
+    qmDisplayState(new MeeGo::QmDisplayState(this)),
+    displayState_(MeeGo::QmDisplayState::Off),
+    displayStateKnown(false),
+    notificationPreviewMode_(AllNotificationsEnabled),
+    notificationPreviewModeKnown(false),
+    compositorConnected(false),
+    topmostSurface(0),
+    ipcCallCount_(0),
+    ipcCallsAvoided_(0)
+{
+    connect(locks, SIGNAL(stateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), this, SLOT(setLockState(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)));
+    connect(qmDisplayState, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), this, SLOT(setDisplayState(MeeGo::QmDisplayState::DisplayState)));
+}
+
+MeeGo::QmLocks::State SystemState::lockState(MeeGo::QmLocks::Lock lock)
+{
+    QHash<int, MeeGo::QmLocks::State>::const_iterator state = lockStates.constFind(lock);
+    if (state != lockStates.constEnd()) {
+        ipcCallsAvoided_++;
+        return state.value();
+    }
+
+    // Query the lock state only once; after that it is kept up to date by the change signals
+    ipcCallCount_++;
+    MeeGo::QmLocks::State currentState = locks->getState(lock);
+    lockStates.insert(lock, currentState);
+    return currentState;
+}
+
+MeeGo::QmDisplayState::DisplayState SystemState::displayState()
+{
+    if (displayStateKnown) {
+        ipcCallsAvoided_++;
+        return displayState_;
+    }
+
+    ipcCallCount_++;
+    displayState_ = qmDisplayState->get();
+    displayStateKnown = true;
+    return displayState_;
+}
+
+SystemState::NotificationPreviewMode SystemState::notificationPreviewMode()
+{
+    if (notificationPreviewModeKnown) {
+        return notificationPreviewMode_;
+    }
+
+    LipstickCompositor *compositor = LipstickCompositor::instance();
+    if (compositor == 0) {
+        // The mode can't be cached before there is a compositor to signal the changes
+        return AllNotificationsEnabled;
+    }
+
+    if (!compositorConnected) {
+        connect(compositor, SIGNAL(topmostWindowIdChanged()), this, SLOT(invalidateNotificationPreviewMode()));
+        connect(compositor, SIGNAL(windowAdded(QObject*)), this, SLOT(invalidateNotificationPreviewMode()));
+        connect(compositor, SIGNAL(windowRemoved(QObject*)), this, SLOT(invalidateNotificationPreviewMode()));
+        compositorConnected = true;
+    }
+
+    topmostSurface = compositor->surfaceForId(compositor->topmostWindowId());
+    notificationPreviewMode_ = AllNotificationsEnabled;
+    if (topmostSurface != 0) {
+        connect(topmostSurface, SIGNAL(windowPropertyChanged(QString,QVariant)), this, SLOT(invalidateNotificationPreviewMode()));
+        connect(topmostSurface, SIGNAL(destroyed()), this, SLOT(clearTopmostSurface()));
+        notificationPreviewMode_ = static_cast<NotificationPreviewMode>(topmostSurface->windowProperties().value("NOTIFICATION_PREVIEWS_DISABLED", uint(AllNotificationsEnabled)).toUInt());
+    }
+    notificationPreviewModeKnown = true;
+
+    return notificationPreviewMode_;
+}
+
+qulonglong SystemState::ipcCallCount() const
+{
+    return ipcCallCount_;
+}
+
+qulonglong SystemState::ipcCallsAvoided() const
+{
+    return ipcCallsAvoided_;
+}
+
+void SystemState::setLockState(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state)
+{
+    lockStates.insert(lock, state);
+    emit lockStateChanged(lock, state);
+}
+
+void SystemState::setDisplayState(MeeGo::QmDisplayState::DisplayState state)
+{
+    displayState_ = state;
+    displayStateKnown = true;
+    emit displayStateChanged(state);
+}
+
+void SystemState::invalidateNotificationPreviewMode()
+{
+    if (topmostSurface != 0) {
+        disconnect(topmostSurface, 0, this, 0);
+        topmostSurface = 0;
+    }
+    notificationPreviewModeKnown = false;
+}
+
+void SystemState::clearTopmostSurface()
+{
+    topmostSurface = 0;
+    notificationPreviewModeKnown = false;
+}
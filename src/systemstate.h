@@ -0,0 +1,159 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef SYSTEMSTATE_H
+#define SYSTEMSTATE_H
+
+#include <QObject>
+#include <QHash>
+#include <qmlocks.h>
+#include <qmdisplaystate.h>
+#include "lipstickglobal.h"
+
+class QWaylandSurface;
+
+/*!
+ * \class SystemState
+ *
+ * \brief A cached snapshot of the system state relevant for showing
+ * notifications and dialogs.
+ *
+ * Querying the lock and display states from the system services is a
+ * synchronous IPC round trip. The system state queries each state once and
+ * then keeps it up to date from the change signals of the services, so
+ * reading a state doesn't require any IPC. The notification preview mode
+ * requested by the topmost window is cached likewise and refreshed when the
+ * topmost window or its properties change.
+ */
+class LIPSTICK_EXPORT SystemState : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! The notification previews the topmost window allows to be shown
+    enum NotificationPreviewMode {
+        AllNotificationsEnabled = 0,
+        ApplicationNotificationsDisabled,
+        SystemNotificationsDisabled,
+        AllNotificationsDisabled
+    };
+
+    //! Returns the singleton system state instance
+    static SystemState *instance();
+
+    /*!
+     * Returns the state of a lock.
+     *
+     * \param lock the lock
+     * \return the state of the lock
+     */
+    MeeGo::QmLocks::State lockState(MeeGo::QmLocks::Lock lock);
+
+    /*!
+     * Returns the display state.
+     *
+     * \return the display state
+     */
+    MeeGo::QmDisplayState::DisplayState displayState();
+
+    /*!
+     * Returns the notification preview mode set by the topmost window in its
+     * NOTIFICATION_PREVIEWS_DISABLED window property.
+     *
+     * \return the notification preview mode
+     */
+    NotificationPreviewMode notificationPreviewMode();
+
+    //! Returns the number of lock and display state queries made to the system services
+    qulonglong ipcCallCount() const;
+
+    //! Returns the number of lock and display state queries answered from the cache instead of the system services
+    qulonglong ipcCallsAvoided() const;
+
+signals:
+    //! Sent when the state of a lock has changed.
+    void lockStateChanged(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state);
+
+    //! Sent when the display state has changed.
+    void displayStateChanged(MeeGo::QmDisplayState::DisplayState state);
+
+private slots:
+    /*!
+     * Updates the cached state of a lock and signals the change.
+     *
+     * \param lock the lock
+     * \param state the new state of the lock
+     */
+    void setLockState(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state);
+
+    /*!
+     * Updates the cached display state and signals the change.
+     *
+     * \param state the new display state
+     */
+    void setDisplayState(MeeGo::QmDisplayState::DisplayState state);
+
+    //! Makes the notification preview mode to be read again from the topmost window when it's next needed
+    void invalidateNotificationPreviewMode();
+
+    //! Forgets the topmost window once it has been destroyed
+    void clearTopmostSurface();
+
+private:
+    //! Creates the system state instance
+    explicit SystemState(QObject *parent = 0);
+
+    //! The singleton system state instance
+    static SystemState *instance_;
+
+    //! For getting information about the lock states
+    MeeGo::QmLocks *locks;
+
+    //! For getting information about the display state
+    MeeGo::QmDisplayState *qmDisplayState;
+
+    //! The cached states of the locks that have been queried
+    QHash<int, MeeGo::QmLocks::State> lockStates;
+
+    //! The cached display state
+    MeeGo::QmDisplayState::DisplayState displayState_;
+
+    //! Whether the display state has been queried
+    bool displayStateKnown;
+
+    //! The cached notification preview mode
+    NotificationPreviewMode notificationPreviewMode_;
+
+    //! Whether the cached notification preview mode is up to date
+    bool notificationPreviewModeKnown;
+
+    //! Whether the compositor signals are connected
+    bool compositorConnected;
+
+    //! The topmost window the notification preview mode was read from
+    QWaylandSurface *topmostSurface;
+
+    //! The number of queries made to the system services
+    qulonglong ipcCallCount_;
+
+    //! The number of queries answered from the cache
+    qulonglong ipcCallsAvoided_;
+
+#ifdef UNIT_TEST
+    friend class Ut_SystemState;
+#endif
+};
+
+#endif // SYSTEMSTATE_H
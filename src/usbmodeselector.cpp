@@ -18,17 +18,16 @@
 #include <QQmlContext>
 #include <QScreen>
 #include "utilities/closeeventeater.h"
-#include <qmlocks.h>
 #include "notifications/notificationmanager.h"
 #include "usbmodeselector.h"
+#include "systemstate.h"
 
 QMap<QString, QString> USBModeSelector::errorCodeToTranslationID;
 
 USBModeSelector::USBModeSelector(QObject *parent) :
     QObject(parent),
     window(0)
-    ,usbMode(new MeeGo::QmUSBMode(this)),
-    locks(new MeeGo::QmLocks(this))
+    ,usbMode(new MeeGo::QmUSBMode(this))
 {
     if (errorCodeToTranslationID.isEmpty()) {
         errorCodeToTranslationID.insert("qtn_usb_filessystem_inuse", "qtn_usb_filessystem_inuse");
@@ -57,16 +56,7 @@ void USBModeSelector::setWindowVisible(bool visible)
     if (visible) {
         emit dialogShown();
 
-        if (window == 0) {
-            window = new HomeWindow();
-            window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
-            window->setCategory(QLatin1String("dialog"));
-            window->setWindowTitle("USB Mode");
-            window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
-            window->setContextProperty("usbModeSelector", this);
-            window->setSource(QUrl("qrc:/qml/USBModeSelector.qml"));
-            window->installEventFilter(new CloseEventEater(this));
-        }
+        createWindowIfNecessary();
 
         if (!window->isVisible()) {
             window->show();
@@ -78,6 +68,22 @@ void USBModeSelector::setWindowVisible(bool visible)
     }
 }
 
+void USBModeSelector::createWindowIfNecessary()
+{
+    if (window != 0) {
+        return;
+    }
+
+    window = new HomeWindow();
+    window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
+    window->setCategory(QLatin1String("dialog"));
+    window->setWindowTitle("USB Mode");
+    window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
+    window->setContextProperty("usbModeSelector", this);
+    window->setSource(QUrl("qrc:/qml/USBModeSelector.qml"));
+    window->installEventFilter(new CloseEventEater(this));
+}
+
 bool USBModeSelector::windowVisible() const
 {
     return window != 0 && window->isVisible();
@@ -92,7 +98,7 @@ void USBModeSelector::applyUSBMode(MeeGo::QmUSBMode::Mode mode)
 {
     switch (mode) {
     case MeeGo::QmUSBMode::Connected:
-        if (locks->getState(MeeGo::QmLocks::Device) == MeeGo::QmLocks::Locked) {
+        if (SystemState::instance()->lockState(MeeGo::QmLocks::Device) == MeeGo::QmLocks::Locked) {
             // When the device lock is on and USB is connected, always pretend that the USB mode selection dialog is shown to unlock the touch screen lock
             emit dialogShown();
         }
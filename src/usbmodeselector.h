@@ -23,10 +23,6 @@
 
 class HomeWindow;
 
-namespace MeeGo {
-class QmLocks;
-}
-
 class LIPSTICK_EXPORT USBModeSelector : public QObject
 {
     Q_OBJECT
@@ -74,6 +70,10 @@ signals:
     //! Sent when the supported USB modes have changed.
     void supportedUSBModesChanged();
 
+public slots:
+    //! Creates the USB mode selector window if it has not been created yet
+    void createWindowIfNecessary();
+
 private slots:
     /*!
      * Shows the USB dialog/banners based on the given USB mode.
@@ -111,9 +111,6 @@ private:
     //! For getting and setting the USB mode
     MeeGo::QmUSBMode *usbMode;
 
-    //! For getting information about the device lock state
-    MeeGo::QmLocks *locks;
-
     //! A list of supported USB modes
     QList<int> supportedUSBModeList;
 
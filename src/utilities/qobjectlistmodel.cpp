@@ -119,6 +119,19 @@ void QObjectListModel::removeItem(int index)
     emit itemCountChanged();
 }
 
+void QObjectListModel::removeItems(int index, int count)
+{
+    if (count <= 0)
+        return;
+
+    beginRemoveRows(QModelIndex(), index, index + count - 1);
+    for (int i = index; i < index + count; i++)
+        disconnect(_list->at(i), SIGNAL(destroyed()), this, SLOT(removeDestroyedItem()));
+    _list->erase(_list->begin() + index, _list->begin() + index + count);
+    endRemoveRows();
+    emit itemCountChanged();
+}
+
 QObject* QObjectListModel::get(int index)
 {
     if (index >= _list->count() || index < 0)
@@ -42,6 +42,7 @@ public:
     void addItem(QObject *item);
     void removeItem(QObject *item);
     void removeItem(int index);
+    void removeItems(int index, int count);
     Q_INVOKABLE QObject* get(int index);
     int indexOf(QObject *obj) const;
 
@@ -53,8 +54,8 @@ public:
     void setList(QList<T*> *list);
     void setList(QList<QObject*> *list);
 
-private slots:
-    void removeDestroyedItem();
+protected slots:
+    virtual void removeDestroyedItem();
 
 signals:
     void itemAdded(QObject *item);
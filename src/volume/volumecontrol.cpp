@@ -86,16 +86,7 @@ int VolumeControl::safeVolume() const
 void VolumeControl::setWindowVisible(bool visible)
 {
     if (visible) {
-        if (window == 0) {
-            window = new HomeWindow();
-            window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
-            window->setCategory(QLatin1String("notification"));
-            window->setWindowTitle("Volume");
-            window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
-            window->setContextProperty("volumeControl", this);
-            window->setSource(QUrl("qrc:/qml/VolumeControl.qml"));
-            window->installEventFilter(new CloseEventEater(this));
-        }
+        createWindowIfNecessary();
 
         if (!window->isVisible()) {
             window->show();
@@ -107,6 +98,22 @@ void VolumeControl::setWindowVisible(bool visible)
     }
 }
 
+void VolumeControl::createWindowIfNecessary()
+{
+    if (window != 0) {
+        return;
+    }
+
+    window = new HomeWindow();
+    window->setGeometry(QRect(QPoint(), QGuiApplication::primaryScreen()->size()));
+    window->setCategory(QLatin1String("notification"));
+    window->setWindowTitle("Volume");
+    window->setContextProperty("initialSize", QGuiApplication::primaryScreen()->size());
+    window->setContextProperty("volumeControl", this);
+    window->setSource(QUrl("qrc:/qml/VolumeControl.qml"));
+    window->installEventFilter(new CloseEventEater(this));
+}
+
 bool VolumeControl::windowVisible() const
 {
     return window != 0 && window->isVisible();
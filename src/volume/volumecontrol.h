@@ -148,6 +148,9 @@ public slots:
      */
     void setWarningAcknowledged(bool acknowledged);
 
+    //! Creates the volume window if it has not been created yet
+    void createWindowIfNecessary();
+
 private slots:
     //! Sets the volume and maximum volume
     void setVolume(int volume, int maximumVolume);
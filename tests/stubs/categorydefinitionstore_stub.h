@@ -24,12 +24,19 @@
 class CategoryDefinitionStoreStub : public StubBase {
   public:
   virtual void CategoryDefinitionStoreConstructor(const QString &categoryDefinitionsPath, uint maxStoredCategoryDefinitions, QObject *parent);
+  virtual void CategoryDefinitionStoreDestructor();
+  virtual void setMaxStoredCategoryDefinitions(uint maxStoredCategoryDefinitions);
+  virtual uint maxStoredCategoryDefinitions() const;
+  virtual quint64 hitCount() const;
+  virtual quint64 missCount() const;
   virtual bool categoryDefinitionExists(const QString &category);
   virtual QList<QString> allKeys(const QString &category);
   virtual bool contains(const QString &category, const QString &key);
   virtual QString value(const QString &category, const QString &key);
-  virtual void updateCategoryDefinitionFileList();
-  virtual void updateCategoryDefinitionFile(const QString &path);
+  virtual void setCachePath(const QString &cachePath);
+  virtual CategoryDefinitionStore::Parameters parameters(const QString &category);
+  virtual void readFileSystemEvents();
+  virtual void applyCategoryDefinitionChanges();
 };
 
 // 2. IMPLEMENT STUB
@@ -39,6 +46,31 @@ void CategoryDefinitionStoreStub::CategoryDefinitionStoreConstructor(const QStri
   Q_UNUSED(parent);
 
 }
+void CategoryDefinitionStoreStub::CategoryDefinitionStoreDestructor() {
+
+}
+
+void CategoryDefinitionStoreStub::setMaxStoredCategoryDefinitions(uint maxStoredCategoryDefinitions) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<uint >(maxStoredCategoryDefinitions));
+  stubMethodEntered("setMaxStoredCategoryDefinitions",params);
+}
+
+uint CategoryDefinitionStoreStub::maxStoredCategoryDefinitions() const {
+  stubMethodEntered("maxStoredCategoryDefinitions");
+  return stubReturnValue<uint>("maxStoredCategoryDefinitions");
+}
+
+quint64 CategoryDefinitionStoreStub::hitCount() const {
+  stubMethodEntered("hitCount");
+  return stubReturnValue<quint64>("hitCount");
+}
+
+quint64 CategoryDefinitionStoreStub::missCount() const {
+  stubMethodEntered("missCount");
+  return stubReturnValue<quint64>("missCount");
+}
+
 bool CategoryDefinitionStoreStub::categoryDefinitionExists(const QString &category) {
   QList<ParameterBase*> params;
   params.append( new Parameter<const QString & >(category));
@@ -69,14 +101,25 @@ QString CategoryDefinitionStoreStub::value(const QString &category, const QStrin
   return stubReturnValue<QString>("value");
 }
 
-void CategoryDefinitionStoreStub::updateCategoryDefinitionFileList() {
-  stubMethodEntered("updateCategoryDefinitionFileList");
+void CategoryDefinitionStoreStub::setCachePath(const QString &cachePath) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<const QString & >(cachePath));
+  stubMethodEntered("setCachePath",params);
 }
 
-void CategoryDefinitionStoreStub::updateCategoryDefinitionFile(const QString &path) {
+CategoryDefinitionStore::Parameters CategoryDefinitionStoreStub::parameters(const QString &category) {
   QList<ParameterBase*> params;
-  params.append( new Parameter<const QString & >(path));
-  stubMethodEntered("updateCategoryDefinitionFile",params);
+  params.append( new Parameter<const QString & >(category));
+  stubMethodEntered("parameters",params);
+  return stubReturnValue<CategoryDefinitionStore::Parameters>("parameters");
+}
+
+void CategoryDefinitionStoreStub::readFileSystemEvents() {
+  stubMethodEntered("readFileSystemEvents");
+}
+
+void CategoryDefinitionStoreStub::applyCategoryDefinitionChanges() {
+  stubMethodEntered("applyCategoryDefinitionChanges");
 }
 
 
@@ -91,6 +134,26 @@ CategoryDefinitionStore::CategoryDefinitionStore(const QString &categoryDefiniti
   gCategoryDefinitionStoreStub->CategoryDefinitionStoreConstructor(categoryDefinitionsPath, maxStoredCategoryDefinitions, parent);
 }
 
+CategoryDefinitionStore::~CategoryDefinitionStore() {
+  gCategoryDefinitionStoreStub->CategoryDefinitionStoreDestructor();
+}
+
+void CategoryDefinitionStore::setMaxStoredCategoryDefinitions(uint maxStoredCategoryDefinitions) {
+  gCategoryDefinitionStoreStub->setMaxStoredCategoryDefinitions(maxStoredCategoryDefinitions);
+}
+
+uint CategoryDefinitionStore::maxStoredCategoryDefinitions() const {
+  return gCategoryDefinitionStoreStub->maxStoredCategoryDefinitions();
+}
+
+quint64 CategoryDefinitionStore::hitCount() const {
+  return gCategoryDefinitionStoreStub->hitCount();
+}
+
+quint64 CategoryDefinitionStore::missCount() const {
+  return gCategoryDefinitionStoreStub->missCount();
+}
+
 bool CategoryDefinitionStore::categoryDefinitionExists(const QString &category) {
   return gCategoryDefinitionStoreStub->categoryDefinitionExists(category);
 }
@@ -107,12 +170,20 @@ QString CategoryDefinitionStore::value(const QString &category, const QString &k
   return gCategoryDefinitionStoreStub->value(category, key);
 }
 
-void CategoryDefinitionStore::updateCategoryDefinitionFileList() {
-  gCategoryDefinitionStoreStub->updateCategoryDefinitionFileList();
+void CategoryDefinitionStore::setCachePath(const QString &cachePath) {
+  gCategoryDefinitionStoreStub->setCachePath(cachePath);
+}
+
+CategoryDefinitionStore::Parameters CategoryDefinitionStore::parameters(const QString &category) {
+  return gCategoryDefinitionStoreStub->parameters(category);
+}
+
+void CategoryDefinitionStore::readFileSystemEvents() {
+  gCategoryDefinitionStoreStub->readFileSystemEvents();
 }
 
-void CategoryDefinitionStore::updateCategoryDefinitionFile(const QString &path) {
-  gCategoryDefinitionStoreStub->updateCategoryDefinitionFile(path);
+void CategoryDefinitionStore::applyCategoryDefinitionChanges() {
+  gCategoryDefinitionStoreStub->applyCategoryDefinitionChanges();
 }
 
 
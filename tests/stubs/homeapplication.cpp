@@ -28,3 +28,11 @@ void HomeApplication::sendHomeReadySignalIfNotAlreadySent()
 void HomeApplication::connectFrameSwappedSignal(bool)
 {
 }
+
+void HomeApplication::prewarmWindows()
+{
+}
+
+void HomeApplication::prewarmNextWindow()
+{
+}
@@ -78,6 +78,10 @@ void HomeWindow::setSource(const QUrl &url)
     d->setSource(url);
 }
 
+void HomeWindow::createRootObject()
+{
+}
+
 void HomeWindow::setWindowTitle(const QString &t)
 {
     d->setTitle(t);
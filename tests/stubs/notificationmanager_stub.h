@@ -25,17 +25,35 @@ class NotificationManagerStub : public StubBase {
   public:
    enum NotificationClosedReason { NotificationExpired=1, NotificationDismissedByUser, CloseNotificationCalled } ;
   virtual NotificationManager * instance();
-  virtual LipstickNotification * notification(uint id) const;
+  virtual LipstickNotification * notification(uint id);
   virtual QList<uint> notificationIds() const;
+  virtual qint64 notificationTimestamp(uint id) const;
+  virtual qint64 restoreDuration() const;
+  virtual QList<uint> notificationIdsForAppName(const QString &appName) const;
+  virtual QList<uint> notificationIdsForCategory(const QString &category) const;
+  virtual uint droppedNotificationCount() const;
+  virtual uint coalescedNotificationCount() const;
+  virtual QVariantMap databaseStatistics() const;
+  virtual QImage notificationImage(uint id);
   virtual QStringList GetCapabilities();
   virtual uint Notify(const QString &appName, uint replacesId, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout);
   virtual void CloseNotification(uint id, NotificationManager::NotificationClosedReason closeReason);
   virtual QString GetServerInformation(QString &name, QString &vendor, QString &version);
   virtual NotificationList GetNotifications(const QString &appName);
+  virtual QList<uint> NotifyBatch(const NotificationList &notifications);
+  virtual void CloseNotifications(const QList<uint> &ids);
+  virtual NotificationList GetNotificationChanges(const QString &appName, quint64 since, QList<uint> &removedIds, quint64 &sequence, bool &reset);
+  virtual quint64 changeSequence() const;
+  virtual void applyCategoryDefinitionChanges(const QStringList &modifiedCategories, const QStringList &uninstalledCategories);
   virtual void removeNotificationsWithCategory(const QString &category);
   virtual void updateNotificationsWithCategory(const QString &category);
-  virtual void commit();
+  virtual void destroyRemovedNotifications();
   virtual void invokeAction(const QString &action);
+  virtual void expireNotifications();
+  virtual void emitPendingModifications();
+  virtual void emitNotificationsChanged();
+  virtual void scheduleDatabaseMaintenance();
+  virtual void performDatabaseMaintenance();
   virtual void removeUserRemovableNotifications();
   virtual void NotificationManagerConstructor(QObject *parent);
   virtual void NotificationManagerDestructor();
@@ -47,7 +65,7 @@ NotificationManager * NotificationManagerStub::instance() {
   return stubReturnValue<NotificationManager *>("instance");
 }
 
-LipstickNotification * NotificationManagerStub::notification(uint id) const {
+LipstickNotification * NotificationManagerStub::notification(uint id) {
   QList<ParameterBase*> params;
   params.append( new Parameter<uint >(id));
   stubMethodEntered("notification",params);
@@ -59,6 +77,54 @@ QList<uint> NotificationManagerStub::notificationIds() const {
   return stubReturnValue<QList<uint>>("notificationIds");
 }
 
+qint64 NotificationManagerStub::notificationTimestamp(uint id) const {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<uint >(id));
+  stubMethodEntered("notificationTimestamp",params);
+  return stubReturnValue<qint64>("notificationTimestamp");
+}
+
+qint64 NotificationManagerStub::restoreDuration() const {
+  stubMethodEntered("restoreDuration");
+  return stubReturnValue<qint64>("restoreDuration");
+}
+
+QList<uint> NotificationManagerStub::notificationIdsForAppName(const QString &appName) const {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QString >(appName));
+  stubMethodEntered("notificationIdsForAppName",params);
+  return stubReturnValue<QList<uint>>("notificationIdsForAppName");
+}
+
+QList<uint> NotificationManagerStub::notificationIdsForCategory(const QString &category) const {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QString >(category));
+  stubMethodEntered("notificationIdsForCategory",params);
+  return stubReturnValue<QList<uint>>("notificationIdsForCategory");
+}
+
+uint NotificationManagerStub::droppedNotificationCount() const {
+  stubMethodEntered("droppedNotificationCount");
+  return stubReturnValue<uint>("droppedNotificationCount");
+}
+
+uint NotificationManagerStub::coalescedNotificationCount() const {
+  stubMethodEntered("coalescedNotificationCount");
+  return stubReturnValue<uint>("coalescedNotificationCount");
+}
+
+QVariantMap NotificationManagerStub::databaseStatistics() const {
+  stubMethodEntered("databaseStatistics");
+  return stubReturnValue<QVariantMap>("databaseStatistics");
+}
+
+QImage NotificationManagerStub::notificationImage(uint id) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<uint >(id));
+  stubMethodEntered("notificationImage",params);
+  return stubReturnValue<QImage>("notificationImage");
+}
+
 QStringList NotificationManagerStub::GetCapabilities() {
   stubMethodEntered("GetCapabilities");
   return stubReturnValue<QStringList>("GetCapabilities");
@@ -101,6 +167,42 @@ NotificationList NotificationManagerStub::GetNotifications(const QString &appNam
   return stubReturnValue<NotificationList>("GetNotifications");
 }
 
+QList<uint> NotificationManagerStub::NotifyBatch(const NotificationList &notifications) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<NotificationList >(notifications));
+  stubMethodEntered("NotifyBatch",params);
+  return stubReturnValue<QList<uint> >("NotifyBatch");
+}
+
+void NotificationManagerStub::CloseNotifications(const QList<uint> &ids) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QList<uint> >(ids));
+  stubMethodEntered("CloseNotifications",params);
+}
+
+NotificationList NotificationManagerStub::GetNotificationChanges(const QString &appName, quint64 since, QList<uint> &removedIds, quint64 &sequence, bool &reset) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QString >(appName));
+  params.append( new Parameter<quint64 >(since));
+  params.append( new Parameter<QList<uint> & >(removedIds));
+  params.append( new Parameter<quint64 & >(sequence));
+  params.append( new Parameter<bool & >(reset));
+  stubMethodEntered("GetNotificationChanges",params);
+  return stubReturnValue<NotificationList>("GetNotificationChanges");
+}
+
+quint64 NotificationManagerStub::changeSequence() const {
+  stubMethodEntered("changeSequence");
+  return stubReturnValue<quint64>("changeSequence");
+}
+
+void NotificationManagerStub::applyCategoryDefinitionChanges(const QStringList &modifiedCategories, const QStringList &uninstalledCategories) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QStringList >(modifiedCategories));
+  params.append( new Parameter<QStringList >(uninstalledCategories));
+  stubMethodEntered("applyCategoryDefinitionChanges",params);
+}
+
 void NotificationManagerStub::removeNotificationsWithCategory(const QString &category) {
   QList<ParameterBase*> params;
   params.append( new Parameter<QString >(category));
@@ -113,8 +215,8 @@ void NotificationManagerStub::updateNotificationsWithCategory(const QString &cat
   stubMethodEntered("updateNotificationsWithCategory",params);
 }
 
-void NotificationManagerStub::commit() {
-  stubMethodEntered("commit");
+void NotificationManagerStub::destroyRemovedNotifications() {
+  stubMethodEntered("destroyRemovedNotifications");
 }
 
 void NotificationManagerStub::invokeAction(const QString &action) {
@@ -123,6 +225,26 @@ void NotificationManagerStub::invokeAction(const QString &action) {
   stubMethodEntered("invokeAction",params);
 }
 
+void NotificationManagerStub::expireNotifications() {
+  stubMethodEntered("expireNotifications");
+}
+
+void NotificationManagerStub::emitPendingModifications() {
+  stubMethodEntered("emitPendingModifications");
+}
+
+void NotificationManagerStub::emitNotificationsChanged() {
+  stubMethodEntered("emitNotificationsChanged");
+}
+
+void NotificationManagerStub::scheduleDatabaseMaintenance() {
+  stubMethodEntered("scheduleDatabaseMaintenance");
+}
+
+void NotificationManagerStub::performDatabaseMaintenance() {
+  stubMethodEntered("performDatabaseMaintenance");
+}
+
 void NotificationManagerStub::removeUserRemovableNotifications() {
   stubMethodEntered("removeUserRemovableNotifications");
 }
@@ -154,6 +276,8 @@ const char *NotificationManager::HINT_PREVIEW_BODY = "x-nemo-preview-body";
 const char *NotificationManager::HINT_PREVIEW_SUMMARY = "x-nemo-preview-summary";
 const char *NotificationManager::HINT_HIDDEN = "x-nemo-hidden";
 const char *NotificationManager::HINT_USER_REMOVABLE = "x-nemo-user-removable";
+const char *NotificationManager::HINT_FEEDBACK = "x-nemo-feedback";
+const char *NotificationManager::HINT_DISPLAY_ON = "x-nemo-display-on";
 
 NotificationManager *NotificationManager::instance_ = 0;
 NotificationManager * NotificationManager::instance() {
@@ -163,7 +287,7 @@ NotificationManager * NotificationManager::instance() {
   return instance_;
 }
 
-LipstickNotification * NotificationManager::notification(uint id) const {
+LipstickNotification * NotificationManager::notification(uint id) {
   return gNotificationManagerStub->notification(id);
 }
 
@@ -171,6 +295,38 @@ QList<uint> NotificationManager::notificationIds() const {
   return gNotificationManagerStub->notificationIds();
 }
 
+qint64 NotificationManager::notificationTimestamp(uint id) const {
+  return gNotificationManagerStub->notificationTimestamp(id);
+}
+
+qint64 NotificationManager::restoreDuration() const {
+  return gNotificationManagerStub->restoreDuration();
+}
+
+QList<uint> NotificationManager::notificationIdsForAppName(const QString &appName) const {
+  return gNotificationManagerStub->notificationIdsForAppName(appName);
+}
+
+QList<uint> NotificationManager::notificationIdsForCategory(const QString &category) const {
+  return gNotificationManagerStub->notificationIdsForCategory(category);
+}
+
+uint NotificationManager::droppedNotificationCount() const {
+  return gNotificationManagerStub->droppedNotificationCount();
+}
+
+uint NotificationManager::coalescedNotificationCount() const {
+  return gNotificationManagerStub->coalescedNotificationCount();
+}
+
+QVariantMap NotificationManager::databaseStatistics() const {
+  return gNotificationManagerStub->databaseStatistics();
+}
+
+QImage NotificationManager::notificationImage(uint id) {
+  return gNotificationManagerStub->notificationImage(id);
+}
+
 QStringList NotificationManager::GetCapabilities() {
   return gNotificationManagerStub->GetCapabilities();
 }
@@ -191,6 +347,26 @@ NotificationList NotificationManager::GetNotifications(const QString &appName) {
   return gNotificationManagerStub->GetNotifications(appName);
 }
 
+QList<uint> NotificationManager::NotifyBatch(const NotificationList &notifications) {
+  return gNotificationManagerStub->NotifyBatch(notifications);
+}
+
+void NotificationManager::CloseNotifications(const QList<uint> &ids) {
+  gNotificationManagerStub->CloseNotifications(ids);
+}
+
+NotificationList NotificationManager::GetNotificationChanges(const QString &appName, quint64 since, QList<uint> &removedIds, quint64 &sequence, bool &reset) {
+  return gNotificationManagerStub->GetNotificationChanges(appName, since, removedIds, sequence, reset);
+}
+
+quint64 NotificationManager::changeSequence() const {
+  return gNotificationManagerStub->changeSequence();
+}
+
+void NotificationManager::applyCategoryDefinitionChanges(const QStringList &modifiedCategories, const QStringList &uninstalledCategories) {
+  gNotificationManagerStub->applyCategoryDefinitionChanges(modifiedCategories, uninstalledCategories);
+}
+
 void NotificationManager::removeNotificationsWithCategory(const QString &category) {
   gNotificationManagerStub->removeNotificationsWithCategory(category);
 }
@@ -199,14 +375,34 @@ void NotificationManager::updateNotificationsWithCategory(const QString &categor
   gNotificationManagerStub->updateNotificationsWithCategory(category);
 }
 
-void NotificationManager::commit() {
-  gNotificationManagerStub->commit();
+void NotificationManager::destroyRemovedNotifications() {
+  gNotificationManagerStub->destroyRemovedNotifications();
 }
 
 void NotificationManager::invokeAction(const QString &action) {
   gNotificationManagerStub->invokeAction(action);
 }
 
+void NotificationManager::expireNotifications() {
+  gNotificationManagerStub->expireNotifications();
+}
+
+void NotificationManager::emitPendingModifications() {
+  gNotificationManagerStub->emitPendingModifications();
+}
+
+void NotificationManager::emitNotificationsChanged() {
+  gNotificationManagerStub->emitNotificationsChanged();
+}
+
+void NotificationManager::scheduleDatabaseMaintenance() {
+  gNotificationManagerStub->scheduleDatabaseMaintenance();
+}
+
+void NotificationManager::performDatabaseMaintenance() {
+  gNotificationManagerStub->performDatabaseMaintenance();
+}
+
 void NotificationManager::removeUserRemovableNotifications() {
   gNotificationManagerStub->removeUserRemovableNotifications();
 }
@@ -30,6 +30,9 @@ class NotificationManagerAdaptorStub : public StubBase {
   virtual QString GetServerInformation(QString &name, QString &vendor, QString &version);
   virtual uint Notify(const QString &app_name, uint replaces_id, const QString &app_icon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expire_timeout);
   virtual NotificationList GetNotifications(const QString &app_name);
+  virtual QList<uint> NotifyBatch(const NotificationList &notifications);
+  virtual NotificationList GetNotificationChanges(const QString &app_name, qulonglong since, QList<uint> &removed_ids, qulonglong &sequence, bool &reset);
+  virtual void CloseNotifications(const QList<uint> &ids);
 };
 
 // 2. IMPLEMENT STUB
@@ -81,6 +84,30 @@ NotificationList NotificationManagerAdaptorStub::GetNotifications(const QString
   return stubReturnValue<NotificationList >("GetNotifications");
 }
 
+QList<uint> NotificationManagerAdaptorStub::NotifyBatch(const NotificationList &notifications) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<NotificationList >(notifications));
+  stubMethodEntered("NotifyBatch",params);
+  return stubReturnValue<QList<uint> >("NotifyBatch");
+}
+
+NotificationList NotificationManagerAdaptorStub::GetNotificationChanges(const QString &app_name, qulonglong since, QList<uint> &removed_ids, qulonglong &sequence, bool &reset) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QString >(app_name));
+  params.append( new Parameter<qulonglong >(since));
+  params.append( new Parameter<QList<uint> & >(removed_ids));
+  params.append( new Parameter<qulonglong & >(sequence));
+  params.append( new Parameter<bool & >(reset));
+  stubMethodEntered("GetNotificationChanges",params);
+  return stubReturnValue<NotificationList >("GetNotificationChanges");
+}
+
+void NotificationManagerAdaptorStub::CloseNotifications(const QList<uint> &ids) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<QList<uint> >(ids));
+  stubMethodEntered("CloseNotifications",params);
+}
+
 
 
 // 3. CREATE A STUB INSTANCE
@@ -117,5 +144,17 @@ NotificationList NotificationManagerAdaptor::GetNotifications(const QString &app
   return gNotificationManagerAdaptorStub->GetNotifications(app_name);
 }
 
+QList<uint> NotificationManagerAdaptor::NotifyBatch(const NotificationList &notifications) {
+  return gNotificationManagerAdaptorStub->NotifyBatch(notifications);
+}
+
+NotificationList NotificationManagerAdaptor::GetNotificationChanges(const QString &app_name, qulonglong since, QList<uint> &removed_ids, qulonglong &sequence, bool &reset) {
+  return gNotificationManagerAdaptorStub->GetNotificationChanges(app_name, since, removed_ids, sequence, reset);
+}
+
+void NotificationManagerAdaptor::CloseNotifications(const QList<uint> &ids) {
+  gNotificationManagerAdaptorStub->CloseNotifications(ids);
+}
+
 
 #endif
@@ -13,6 +13,7 @@ class NotificationPreviewPresenterStub : public StubBase {
   virtual void NotificationPreviewPresenterDestructor();
   virtual LipstickNotification * notification() const;
   virtual void showNextNotification();
+  virtual void createWindowIfNecessary();
   virtual void updateNotification(uint id);
   virtual void removeNotification(uint id, bool onlyFromQueue);
 }; 
@@ -34,6 +35,10 @@ void NotificationPreviewPresenterStub::showNextNotification() {
   stubMethodEntered("showNextNotification");
 }
 
+void NotificationPreviewPresenterStub::createWindowIfNecessary() {
+  stubMethodEntered("createWindowIfNecessary");
+}
+
 void NotificationPreviewPresenterStub::updateNotification(uint id) {
   QList<ParameterBase*> params;
   params.append( new Parameter<uint >(id));
@@ -71,6 +76,10 @@ void NotificationPreviewPresenter::showNextNotification() {
   gNotificationPreviewPresenterStub->showNextNotification();
 }
 
+void NotificationPreviewPresenter::createWindowIfNecessary() {
+  gNotificationPreviewPresenterStub->createWindowIfNecessary();
+}
+
 void NotificationPreviewPresenter::updateNotification(uint id) {
   gNotificationPreviewPresenterStub->updateNotification(id);
 }
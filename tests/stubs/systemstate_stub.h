@@ -0,0 +1,148 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+#ifndef SYSTEMSTATE_STUB
+#define SYSTEMSTATE_STUB
+
+#include "systemstate.h"
+#include <stubbase.h>
+
+
+// 1. DECLARE STUB
+// FIXME - stubgen is not yet finished
+class SystemStateStub : public StubBase {
+  public:
+  virtual void SystemStateConstructor(QObject *parent);
+  virtual MeeGo::QmLocks::State lockState(MeeGo::QmLocks::Lock lock);
+  virtual MeeGo::QmDisplayState::DisplayState displayState();
+  virtual SystemState::NotificationPreviewMode notificationPreviewMode();
+  virtual qulonglong ipcCallCount() const;
+  virtual qulonglong ipcCallsAvoided() const;
+  virtual void setLockState(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state);
+  virtual void setDisplayState(MeeGo::QmDisplayState::DisplayState state);
+  virtual void invalidateNotificationPreviewMode();
+  virtual void clearTopmostSurface();
+};
+
+// 2. IMPLEMENT STUB
+void SystemStateStub::SystemStateConstructor(QObject *parent) {
+  Q_UNUSED(parent);
+
+}
+MeeGo::QmLocks::State SystemStateStub::lockState(MeeGo::QmLocks::Lock lock) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<MeeGo::QmLocks::Lock >(lock));
+  stubMethodEntered("lockState",params);
+  return stubReturnValue<MeeGo::QmLocks::State>("lockState");
+}
+
+MeeGo::QmDisplayState::DisplayState SystemStateStub::displayState() {
+  stubMethodEntered("displayState");
+  return stubReturnValue<MeeGo::QmDisplayState::DisplayState>("displayState");
+}
+
+SystemState::NotificationPreviewMode SystemStateStub::notificationPreviewMode() {
+  stubMethodEntered("notificationPreviewMode");
+  return stubReturnValue<SystemState::NotificationPreviewMode>("notificationPreviewMode");
+}
+
+qulonglong SystemStateStub::ipcCallCount() const {
+  stubMethodEntered("ipcCallCount");
+  return stubReturnValue<qulonglong>("ipcCallCount");
+}
+
+qulonglong SystemStateStub::ipcCallsAvoided() const {
+  stubMethodEntered("ipcCallsAvoided");
+  return stubReturnValue<qulonglong>("ipcCallsAvoided");
+}
+
+void SystemStateStub::setLockState(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<MeeGo::QmLocks::Lock >(lock));
+  params.append( new Parameter<MeeGo::QmLocks::State >(state));
+  stubMethodEntered("setLockState",params);
+}
+
+void SystemStateStub::setDisplayState(MeeGo::QmDisplayState::DisplayState state) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<MeeGo::QmDisplayState::DisplayState >(state));
+  stubMethodEntered("setDisplayState",params);
+}
+
+void SystemStateStub::invalidateNotificationPreviewMode() {
+  stubMethodEntered("invalidateNotificationPreviewMode");
+}
+
+void SystemStateStub::clearTopmostSurface() {
+  stubMethodEntered("clearTopmostSurface");
+}
+
+
+
+// 3. CREATE A STUB INSTANCE
+SystemStateStub gDefaultSystemStateStub;
+SystemStateStub* gSystemStateStub = &gDefaultSystemStateStub;
+
+
+// 4. CREATE A PROXY WHICH CALLS THE STUB
+SystemState *SystemState::instance_ = 0;
+SystemState * SystemState::instance() {
+  if (instance_ == 0) {
+    instance_ = new SystemState;
+  }
+  return instance_;
+}
+
+SystemState::SystemState(QObject *parent) {
+  gSystemStateStub->SystemStateConstructor(parent);
+}
+
+MeeGo::QmLocks::State SystemState::lockState(MeeGo::QmLocks::Lock lock) {
+  return gSystemStateStub->lockState(lock);
+}
+
+MeeGo::QmDisplayState::DisplayState SystemState::displayState() {
+  return gSystemStateStub->displayState();
+}
+
+SystemState::NotificationPreviewMode SystemState::notificationPreviewMode() {
+  return gSystemStateStub->notificationPreviewMode();
+}
+
+qulonglong SystemState::ipcCallCount() const {
+  return gSystemStateStub->ipcCallCount();
+}
+
+qulonglong SystemState::ipcCallsAvoided() const {
+  return gSystemStateStub->ipcCallsAvoided();
+}
+
+void SystemState::setLockState(MeeGo::QmLocks::Lock lock, MeeGo::QmLocks::State state) {
+  gSystemStateStub->setLockState(lock, state);
+}
+
+void SystemState::setDisplayState(MeeGo::QmDisplayState::DisplayState state) {
+  gSystemStateStub->setDisplayState(state);
+}
+
+void SystemState::invalidateNotificationPreviewMode() {
+  gSystemStateStub->invalidateNotificationPreviewMode();
+}
+
+void SystemState::clearTopmostSurface() {
+  gSystemStateStub->clearTopmostSurface();
+}
+
+
+#endif
@@ -9,11 +9,16 @@ SUBDIRS = \
           ut_lowbatterynotifier \
           ut_lipsticknotification \
           ut_notificationfeedbackplayer \
+          ut_notificationidallocator \
+          ut_notificationimagestore \
+          ut_notificationjournal \
           ut_notificationlistmodel \
           ut_notificationmanager \
           ut_notificationpreviewpresenter \
+          ut_notificationstringpool \
           ut_screenlock \
           ut_shutdownscreen \
+          ut_systemstate \
           ut_usbmodeselector \
           ut_volumecontrol \
 
@@ -15,6 +15,7 @@
 ****************************************************************************/
 
 #include <QtTest/QtTest>
+#include <utime.h>
 #include "ut_categorydefinitionstore.h"
 #include "categorydefinitionstore.h"
 
@@ -24,12 +25,8 @@ QStringList categoryDefinitionFilesList;
 QMap<QString, QMap<QString, QString> > categoryDefinitionSettingsMap;
 // Size of the category definition file
 uint categoryDefinitionFileSize;
-
-// QFileSystemWatcher stubs
-bool QFileSystemWatcher::addPath(const QString &)
-{
-    return true;
-}
+// Number of category definition files parsed
+int categoryDefinitionFilesParsed;
 
 // QFileInfo stubs
 bool QFileInfo::exists() const
@@ -56,6 +53,7 @@ QStringList QDir::entryList(const QStringList &, Filters, SortFlags) const
 // Stubs of QSettings methods
 QStringList QSettings::allKeys() const
 {
+    categoryDefinitionFilesParsed++;
     return QStringList(categoryDefinitionSettingsMap.value(QFileInfo(fileName()).baseName()).keys());
 }
 
@@ -78,6 +76,7 @@ void Ut_CategoryDefinitionStore::init()
     categoryDefinitionFilesList.clear();
     categoryDefinitionSettingsMap.clear();
     categoryDefinitionFileSize = 100;
+    categoryDefinitionFilesParsed = 0;
 }
 
 void Ut_CategoryDefinitionStore::cleanup()
@@ -162,26 +161,139 @@ void Ut_CategoryDefinitionStore::testCategoryDefinitionUninstalling()
     categoryDefinitionFilesList.append("smsCategoryDefinition.conf");
 
     store = new CategoryDefinitionStore("/categorydefinitionpath");
-    QSignalSpy uninstallSpy(store, SIGNAL(categoryDefinitionUninstalled(QString)));
-    connect(this, SIGNAL(directoryChanged(QString)), store, SLOT(updateCategoryDefinitionFileList()));
+    QSignalSpy changeSpy(store, SIGNAL(categoryDefinitionsChanged(QStringList, QStringList)));
+    connect(this, SIGNAL(directoryChanged(QString)), store, SLOT(applyCategoryDefinitionChanges()));
 
     // Add new category definition file
     categoryDefinitionFilesList.append("chatCategoryDefinition.conf");
     emit directoryChanged("/categorydefinitionpath");
-    QCOMPARE(uninstallSpy.count(), 0);
+    QCOMPARE(changeSpy.count(), 0);
     QCOMPARE(store->categoryDefinitionExists("chatCategoryDefinition"), true);
 
     // Remove the added category definition file
     categoryDefinitionFilesList.removeOne("chatCategoryDefinition.conf");
     emit directoryChanged("/categorydefinitionpath");
-    QCOMPARE(uninstallSpy.count(), 1);
+    QCOMPARE(changeSpy.count(), 1);
+    QCOMPARE(changeSpy.last().at(0).toStringList(), QStringList());
+    QCOMPARE(changeSpy.last().at(1).toStringList(), QStringList() << "chatCategoryDefinition");
     QCOMPARE(store->categoryDefinitionExists("chatCategoryDefinition"), false);
 
     // Remove the existing category definition file
     categoryDefinitionFilesList.removeOne("smsCategoryDefinition.conf");
     emit directoryChanged("/categorydefinitionpath");
-    QCOMPARE(uninstallSpy.count(), 2);
+    QCOMPARE(changeSpy.count(), 2);
+    QCOMPARE(changeSpy.last().at(1).toStringList(), QStringList() << "smsCategoryDefinition");
     QCOMPARE(store->categoryDefinitionExists("smsCategoryDefinition"), false);
 }
 
-QTEST_APPLESS_MAIN(Ut_CategoryDefinitionStore)
+void Ut_CategoryDefinitionStore::testCategoryDefinitionChangesAreBatched()
+{
+    QTemporaryDir definitionsDirectory;
+    categoryDefinitionFilesList << "smsCategoryDefinition.conf" << "chatCategoryDefinition.conf" << "emailCategoryDefinition.conf";
+    QMap<QString, QString> smsSettingsMap;
+    smsSettingsMap.insert("iconId", "sms-icon");
+    categoryDefinitionSettingsMap.insert("smsCategoryDefinition", smsSettingsMap);
+
+    store = new CategoryDefinitionStore(definitionsDirectory.path());
+    QSignalSpy changeSpy(store, SIGNAL(categoryDefinitionsChanged(QStringList, QStringList)));
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+
+    // Modify two category definitions and remove one in quick succession
+    smsSettingsMap.insert("iconId", "new-sms-icon");
+    categoryDefinitionSettingsMap.insert("smsCategoryDefinition", smsSettingsMap);
+    foreach (const QString &fileName, QStringList() << "smsCategoryDefinition.conf" << "chatCategoryDefinition.conf" << "emailCategoryDefinition.conf") {
+        QFile file(definitionsDirectory.path() + "/" + fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[Section]\n");
+        file.close();
+    }
+    QVERIFY(QFile::remove(definitionsDirectory.path() + "/emailCategoryDefinition.conf"));
+    categoryDefinitionFilesList.removeOne("emailCategoryDefinition.conf");
+
+    // All changes are signaled at once
+    QTRY_COMPARE(changeSpy.count(), 1);
+    QCOMPARE(changeSpy.last().at(0).toStringList().toSet(), QSet<QString>() << "smsCategoryDefinition" << "chatCategoryDefinition");
+    QCOMPARE(changeSpy.last().at(1).toStringList(), QStringList() << "emailCategoryDefinition");
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("new-sms-icon"));
+    QCOMPARE(store->categoryDefinitionExists("emailCategoryDefinition"), false);
+}
+
+void Ut_CategoryDefinitionStore::testCategoryDefinitionsAreReadFromCache()
+{
+    QTemporaryDir definitionsDirectory;
+    QTemporaryDir cacheDirectory;
+    QString cachePath = cacheDirectory.path() + "/categorydefinitions.cache";
+    categoryDefinitionFilesList.append("smsCategoryDefinition.conf");
+    categoryDefinitionFilesList.append("chatCategoryDefinition.conf");
+    QMap<QString, QString> smsSettingsMap;
+    smsSettingsMap.insert("iconId", "sms-icon");
+    smsSettingsMap.insert("feedbackId", "sound-file");
+    categoryDefinitionSettingsMap.insert("smsCategoryDefinition", smsSettingsMap);
+
+    // The cache is built from all category definition files when it doesn't exist
+    store = new CategoryDefinitionStore(definitionsDirectory.path(), 2);
+    store->setCachePath(cachePath);
+    QCOMPARE(categoryDefinitionFilesParsed, 2);
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+    QCOMPARE(categoryDefinitionFilesParsed, 2);
+    delete store;
+
+    // An up to date cache is used without parsing the category definition files
+    categoryDefinitionSettingsMap.clear();
+    store = new CategoryDefinitionStore(definitionsDirectory.path(), 2);
+    store->setCachePath(cachePath);
+    QCOMPARE(store->parameters("smsCategoryDefinition").count(), 2);
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+    QCOMPARE(store->value("smsCategoryDefinition", "feedbackId"), QString("sound-file"));
+    QCOMPARE(store->categoryDefinitionExists("chatCategoryDefinition"), true);
+    QCOMPARE(store->allKeys("chatCategoryDefinition").count(), 0);
+    QCOMPARE(store->categoryDefinitionExists("idontexist"), false);
+    QCOMPARE(categoryDefinitionFilesParsed, 2);
+    delete store;
+
+    // The cache is rebuilt when the category definition directory is modified
+    smsSettingsMap.insert("iconId", "new-sms-icon");
+    categoryDefinitionSettingsMap.insert("smsCategoryDefinition", smsSettingsMap);
+    struct utimbuf times;
+    times.actime = times.modtime = 1000000000;
+    QCOMPARE(utime(QFile::encodeName(definitionsDirectory.path()).constData(), &times), 0);
+    store = new CategoryDefinitionStore(definitionsDirectory.path(), 2);
+    store->setCachePath(cachePath);
+    QCOMPARE(categoryDefinitionFilesParsed, 4);
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("new-sms-icon"));
+}
+
+void Ut_CategoryDefinitionStore::testLeastRecentlyUsedCategoryDefinitionIsDropped()
+{
+    categoryDefinitionFilesList << "a.conf" << "b.conf" << "c.conf";
+    store = new CategoryDefinitionStore("/categorydefinitionpath", 2);
+
+    // Loading a category definition is a miss and finding it in memory a hit
+    QCOMPARE(store->categoryDefinitionExists("a"), true);
+    QCOMPARE(store->categoryDefinitionExists("b"), true);
+    QCOMPARE(store->categoryDefinitionExists("a"), true);
+    QCOMPARE(store->missCount(), (quint64)2);
+    QCOMPARE(store->hitCount(), (quint64)1);
+    QCOMPARE(categoryDefinitionFilesParsed, 2);
+
+    // Loading a third category definition drops the least recently used one
+    QCOMPARE(store->categoryDefinitionExists("c"), true);
+    QCOMPARE(store->categoryDefinitionExists("a"), true);
+    QCOMPARE(categoryDefinitionFilesParsed, 3);
+    QCOMPARE(store->categoryDefinitionExists("b"), true);
+    QCOMPARE(categoryDefinitionFilesParsed, 4);
+    QCOMPARE(store->missCount(), (quint64)4);
+    QCOMPARE(store->hitCount(), (quint64)2);
+
+    // Lowering the limit drops the extra category definitions right away
+    store->setMaxStoredCategoryDefinitions(1);
+    QCOMPARE(store->maxStoredCategoryDefinitions(), 1u);
+    QCOMPARE(store->categoryDefinitionExists("b"), true);
+    QCOMPARE(categoryDefinitionFilesParsed, 4);
+    QCOMPARE(store->categoryDefinitionExists("a"), true);
+    QCOMPARE(categoryDefinitionFilesParsed, 5);
+    QCOMPARE(store->missCount(), (quint64)5);
+    QCOMPARE(store->hitCount(), (quint64)3);
+}
+
+QTEST_MAIN(Ut_CategoryDefinitionStore)
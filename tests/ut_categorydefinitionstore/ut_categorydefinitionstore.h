@@ -32,6 +32,9 @@ private slots:
     void testCategoryDefinitionSettingsValues();
     void testCategoryDefinitionStoreMaxFileSizeHandling();
     void testCategoryDefinitionUninstalling();
+    void testCategoryDefinitionChangesAreBatched();
+    void testCategoryDefinitionsAreReadFromCache();
+    void testLeastRecentlyUsedCategoryDefinitionIsDropped();
 
 private:
     CategoryDefinitionStore *store;
@@ -6,9 +6,13 @@ INCLUDEPATH += $$NOTIFICATIONSRCDIR
 SOURCES += \
     ut_categorydefinitionstore.cpp \
     $$NOTIFICATIONSRCDIR/categorydefinitionstore.cpp \
+    $$NOTIFICATIONSRCDIR/categorydefinitioncache.cpp \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.cpp \
     $$STUBSDIR/stubbase.cpp \
 
 # unit test and unit
 HEADERS += \
     ut_categorydefinitionstore.h \
-    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h
+    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h \
+    $$NOTIFICATIONSRCDIR/categorydefinitioncache.h \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.h
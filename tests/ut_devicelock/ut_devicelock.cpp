@@ -18,9 +18,8 @@
 #include <QTimer>
 #include <QSettings>
 #include "mgconfitem_stub.h"
-#include "qmlocks_stub.h"
 #include "qmactivity_stub.h"
-#include "qmdisplaystate_stub.h"
+#include "systemstate_stub.h"
 #include "devicelock.h"
 #include "ut_devicelock.h"
 
@@ -107,8 +106,8 @@ void Ut_DeviceLock::testSignalConnections()
     QCOMPARE(disconnect(deviceLock->lockingGConfItem, SIGNAL(valueChanged()), deviceLock, SLOT(setStateAndSetupLockTimer())), true);
     QCOMPARE(disconnect(deviceLock->lockTimer, SIGNAL(timeout()), deviceLock, SLOT(lock())), true);
     QCOMPARE(disconnect(deviceLock->qmActivity, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)), deviceLock, SLOT(setStateAndSetupLockTimer())), true);
-    QCOMPARE(disconnect(deviceLock->qmLocks, SIGNAL(stateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), deviceLock, SLOT(setStateAndSetupLockTimer())), true);
-    QCOMPARE(disconnect(deviceLock->qmDisplayState, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), deviceLock, SLOT(checkDisplayState(MeeGo::QmDisplayState::DisplayState))), true);
+    QCOMPARE(disconnect(SystemState::instance(), SIGNAL(lockStateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), deviceLock, SLOT(setStateAndSetupLockTimer())), true);
+    QCOMPARE(disconnect(SystemState::instance(), SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), deviceLock, SLOT(checkDisplayState(MeeGo::QmDisplayState::DisplayState))), true);
 }
 
 void Ut_DeviceLock::testInitialState()
@@ -261,8 +260,7 @@ void Ut_DeviceLock::testDisplayStateWhenDeviceScreenIsLocked()
     qTimerStopCount = 0;
 
     gMGConfItemStub->stubSetReturnValue("value", QVariant(automaticLocking));
-    gQmLocksStub->stubSetReturnValue("getState", touchScreenLockState);
-    gQmDisplayStateStub->stubSetReturnValue("get", state);
+    gSystemStateStub->stubSetReturnValue("lockState", touchScreenLockState);
 
     deviceLock->checkDisplayState(state);
 
@@ -299,7 +297,7 @@ void Ut_DeviceLock::testStateOnAutomaticLockingAndTouchScreenLockState()
     deviceLock->setState(DeviceLock::Undefined);
 
     gMGConfItemStub->stubSetReturnValue("value", QVariant(automaticLocking));
-    gQmLocksStub->stubSetReturnValue("getState", touchScreenLockState);
+    gSystemStateStub->stubSetReturnValue("lockState", touchScreenLockState);
     deviceLock->setStateAndSetupLockTimer();
 
     QCOMPARE(deviceLock->state(), (int)deviceLockState);
@@ -126,9 +126,11 @@ void Ut_DiskSpaceNotifier::testConstruction()
     QVariantHash hints;
     hints.insert(NotificationManager::HINT_CATEGORY, "x-nemo.system.diskspace");
     LipstickNotification notification(qApp->applicationName(), 1, QString(), QString(), QString(), QStringList(), hints, -1);
-    gNotificationManagerStub->stubSetReturnValue("notificationIds", QList<uint>() << 1u << 1u);
+    gNotificationManagerStub->stubSetReturnValue("notificationIdsForCategory", QList<uint>() << 1u << 1u);
     gNotificationManagerStub->stubSetReturnValue("notification", &notification);
     m_subject = new DiskSpaceNotifier();
+    QCOMPARE(gNotificationManagerStub->stubCallCount("notificationIdsForCategory"), 1);
+    QCOMPARE(gNotificationManagerStub->stubLastCallTo("notificationIdsForCategory").parameter<QString>(0), QString("x-nemo.system.diskspace"));
     QCOMPARE(gNotificationManagerStub->stubCallCount("CloseNotification"), 2);
 }
 
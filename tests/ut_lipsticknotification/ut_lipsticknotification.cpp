@@ -191,6 +191,38 @@ void Ut_Notification::testSignals()
     QCOMPARE(urgencySpy.count(), 1);
 }
 
+void Ut_Notification::testDecodedHints()
+{
+    LipstickNotification notification(QString(), 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    QCOMPARE(notification.isHidden(), false);
+    QCOMPARE(notification.isUserRemovable(), true);
+    QCOMPARE(notification.displayOn(), false);
+    QCOMPARE(notification.feedback(), QString());
+
+    QSignalSpy userRemovableSpy(&notification, SIGNAL(userRemovableChanged()));
+    QSignalSpy categorySpy(&notification, SIGNAL(categoryChanged()));
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_HIDDEN, true);
+    hints.insert(NotificationManager::HINT_USER_REMOVABLE, false);
+    hints.insert(NotificationManager::HINT_DISPLAY_ON, true);
+    hints.insert(NotificationManager::HINT_FEEDBACK, "feedback");
+    hints.insert("x-unknown", "value");
+    notification.setHints(hints);
+    QCOMPARE(notification.isHidden(), true);
+    QCOMPARE(notification.isUserRemovable(), false);
+    QCOMPARE(notification.displayOn(), true);
+    QCOMPARE(notification.feedback(), QString("feedback"));
+    QCOMPARE(userRemovableSpy.count(), 1);
+    QCOMPARE(categorySpy.count(), 0);
+
+    // The hints are kept as they were given, including the unknown ones
+    QCOMPARE(notification.hints(), hints);
+
+    // Setting the same values again emits nothing
+    notification.setHints(hints);
+    QCOMPARE(userRemovableSpy.count(), 1);
+}
+
 void Ut_Notification::testSerialization()
 {
     QString appName = "appName1";
@@ -225,4 +257,62 @@ void Ut_Notification::testSerialization()
     QCOMPARE(n2.timestamp(), n1.timestamp());
 }
 
+void Ut_Notification::testNotificationListSerialization()
+{
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "category1");
+    QList<LipstickNotification *> notifications;
+    notifications.append(new LipstickNotification("appName1", 1, "appIcon1", "summary1", "body1", QStringList() << "action1", hints, 1));
+    notifications.append(new LipstickNotification("appName2", 2, "appIcon2", "summary2", "body2", QStringList(), QVariantHash(), 2));
+
+    // Transfer a list of notifications by serializing it to a QDBusArgument and unserializing it
+    QDBusArgument arg;
+    arg << NotificationList(notifications);
+    NotificationList list;
+    arg >> list;
+
+    QList<NotificationData> data = list.data();
+    QCOMPARE(data.count(), 2);
+    for (int i = 0; i < data.count(); i++) {
+        QCOMPARE(data.at(i).appName, notifications.at(i)->appName());
+        QCOMPARE(data.at(i).replacesId, notifications.at(i)->replacesId());
+        QCOMPARE(data.at(i).appIcon, notifications.at(i)->appIcon());
+        QCOMPARE(data.at(i).summary, notifications.at(i)->summary());
+        QCOMPARE(data.at(i).body, notifications.at(i)->body());
+        QCOMPARE(data.at(i).actions, notifications.at(i)->actions());
+        QCOMPARE(data.at(i).expireTimeout, notifications.at(i)->expireTimeout());
+    }
+
+    // A list created from notification objects returns the same objects
+    QCOMPARE(NotificationList(notifications).notifications(), notifications);
+
+    // Notification objects are only created on request for unmarshalled lists
+    QList<LipstickNotification *> restored = list.notifications();
+    QCOMPARE(restored.count(), 2);
+    QCOMPARE(restored.at(0)->summary(), QString("summary1"));
+    QCOMPARE(restored.at(0)->category(), QString("category1"));
+    qDeleteAll(restored);
+    qDeleteAll(notifications);
+}
+
+void Ut_Notification::benchmarkNotificationListSerialization()
+{
+    QList<NotificationData> notifications;
+    for (int i = 0; i < 1000; i++) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_CATEGORY, "category");
+        hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime::currentDateTime());
+        hints.insert(NotificationManager::HINT_PREVIEW_SUMMARY, QString("previewSummary%1").arg(i));
+        notifications.append(NotificationData("appName", i + 1, "appIcon", QString("summary%1").arg(i), QString("body%1").arg(i), QStringList() << "default" << "", hints, -1));
+    }
+    NotificationList notificationList(notifications);
+
+    QBENCHMARK {
+        QDBusArgument arg;
+        arg << notificationList;
+        NotificationList list;
+        arg >> list;
+    }
+}
+
 QTEST_MAIN(Ut_Notification)
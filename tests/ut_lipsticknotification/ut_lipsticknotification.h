@@ -26,7 +26,10 @@ private slots:
     void testIcon_data();
     void testIcon();
     void testSignals();
+    void testDecodedHints();
     void testSerialization();
+    void testNotificationListSerialization();
+    void benchmarkNotificationListSerialization();
 };
 
 #endif
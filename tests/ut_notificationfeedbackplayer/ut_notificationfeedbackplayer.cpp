@@ -14,10 +14,14 @@
 ****************************************************************************/
 
 #include <QtTest/QtTest>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <mce/dbus-names.h>
 #include "notificationmanager.h"
 #include "notificationfeedbackplayer.h"
 #include "notificationpreviewpresenter_stub.h"
-#include "lipstickcompositor_stub.h"
+#include "systemstate_stub.h"
 #include "ngfclient_stub.h"
 #include "ut_notificationfeedbackplayer.h"
 
@@ -33,6 +37,7 @@ const char *NotificationManager::HINT_PREVIEW_SUMMARY = "x-nemo-preview-summary"
 const char *NotificationManager::HINT_FEEDBACK = "x-nemo-feedback";
 const char *NotificationManager::HINT_USER_REMOVABLE = "x-nemo-user-removable";
 const char *NotificationManager::HINT_DISPLAY_ON = "x-nemo-display-on";
+const char *NotificationManager::HINT_HIDDEN = "x-nemo-hidden";
 
 NotificationManager::NotificationManager(QObject *parent) : QObject(parent)
 {
@@ -54,7 +59,31 @@ void NotificationManager::updateNotificationsWithCategory(const QString &)
 {
 }
 
-void NotificationManager::commit()
+void NotificationManager::applyCategoryDefinitionChanges(const QStringList &, const QStringList &)
+{
+}
+
+void NotificationManager::destroyRemovedNotifications()
+{
+}
+
+void NotificationManager::expireNotifications()
+{
+}
+
+void NotificationManager::emitPendingModifications()
+{
+}
+
+void NotificationManager::emitNotificationsChanged()
+{
+}
+
+void NotificationManager::scheduleDatabaseMaintenance()
+{
+}
+
+void NotificationManager::performDatabaseMaintenance()
 {
 }
 
@@ -72,8 +101,10 @@ NotificationManager *NotificationManager::instance()
 }
 
 QHash<uint, LipstickNotification *> notificationManagerNotification;
-LipstickNotification *NotificationManager::notification(uint id) const
+int notificationManagerNotificationCallCount = 0;
+LipstickNotification *NotificationManager::notification(uint id)
 {
+    notificationManagerNotificationCallCount++;
     return notificationManagerNotification.value(id);
 }
 
@@ -82,24 +113,19 @@ QList<uint> NotificationManager::notificationIds() const
     return notificationManagerNotification.keys();
 }
 
-LipstickNotification *createNotification(uint id, int urgency = 0)
+LipstickNotification *createNotification(uint id, int urgency = 0, const QString &feedback = "feedback", bool displayOn = false)
 {
     LipstickNotification *notification = new LipstickNotification;
     QVariantHash hints;
-    hints.insert(NotificationManager::HINT_FEEDBACK, "feedback");
+    hints.insert(NotificationManager::HINT_FEEDBACK, feedback);
     hints.insert(NotificationManager::HINT_URGENCY, urgency);
+    hints.insert(NotificationManager::HINT_DISPLAY_ON, displayOn);
     notification->setHints(hints);
     notificationManagerNotification.insert(id, notification);
     gNotificationPreviewPresenterStub->stubSetReturnValue("notification", notification);
     return notification;
 }
 
-QVariantMap qWaylandSurfaceWindowProperties;
-QVariantMap QWaylandSurface::windowProperties() const
-{
-    return qWaylandSurfaceWindowProperties;
-}
-
 void QTimer::singleShot(int, const QObject *receiver, const char *member)
 {
     // The "member" string is of form "1member()", so remove the trailing 1 and the ()
@@ -110,9 +136,15 @@ void QTimer::singleShot(int, const QObject *receiver, const char *member)
     QMetaObject::invokeMethod(const_cast<QObject *>(receiver), modifiedMember, Qt::DirectConnection);
 }
 
+QList<QDBusMessage> qDBusConnectionAsyncCallMessages;
+QDBusPendingCall QDBusConnection::asyncCall(const QDBusMessage &message, int) const
+{
+    qDBusConnectionAsyncCallMessages.append(message);
+    return QDBusPendingCall::fromError(QDBusError());
+}
+
 void Ut_NotificationFeedbackPlayer::initTestCase()
 {
-    gLipstickCompositorStub->stubSetReturnValue("instance", new LipstickCompositor());
 }
 
 void Ut_NotificationFeedbackPlayer::init()
@@ -126,8 +158,13 @@ void Ut_NotificationFeedbackPlayer::cleanup()
     delete player;
     delete presenter;
 
+    qDeleteAll(notificationManagerNotification);
+    notificationManagerNotification.clear();
+    notificationManagerNotificationCallCount = 0;
     gClientStub->stubReset();
     gNotificationPreviewPresenterStub->stubReset();
+    gSystemStateStub->stubReset();
+    qDBusConnectionAsyncCallMessages.clear();
 }
 
 void Ut_NotificationFeedbackPlayer::testAddAndRemoveNotification()
@@ -197,45 +234,48 @@ void Ut_NotificationFeedbackPlayer::testUpdateNotificationIsNotPossibleAfterRest
     QCOMPARE(gClientStub->stubCallCount("play"), 0);
 }
 
-QWaylandSurface surface;
+void Ut_NotificationFeedbackPlayer::testExistingNotificationsAreNotCreatedOnInit()
+{
+    delete player;
+
+    // Only the IDs of the existing notifications should be needed
+    createNotification(1);
+    createNotification(2);
+    notificationManagerNotificationCallCount = 0;
+    player = new NotificationFeedbackPlayer(presenter);
+    QCOMPARE(notificationManagerNotificationCallCount, 0);
+
+    // Removing an existing notification doesn't need the notification either
+    player->removeNotification(1);
+    QCOMPARE(notificationManagerNotificationCallCount, 0);
+    QCOMPARE(gClientStub->stubCallCount("stop"), 0);
+}
+
+Q_DECLARE_METATYPE(SystemState::NotificationPreviewMode)
+
 void Ut_NotificationFeedbackPlayer::testNotificationPreviewsDisabled_data()
 {
-    QTest::addColumn<QWaylandSurface *>("surface");
-    QTest::addColumn<QVariantMap>("windowProperties");
+    QTest::addColumn<SystemState::NotificationPreviewMode>("mode");
     QTest::addColumn<int>("urgency");
     QTest::addColumn<int>("playCount");
 
-    QVariantMap allNotificationsEnabled;
-    QVariantMap applicationNotificationsDisabled;
-    QVariantMap systemNotificationsDisabled;
-    QVariantMap allNotificationsDisabled;
-    allNotificationsEnabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 0);
-    applicationNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 1);
-    systemNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 2);
-    allNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 3);
-    QTest::newRow("No surface, application notification") << (QWaylandSurface *)0 << QVariantMap() << 1 << 1;
-    QTest::newRow("Surface, no properties, application notification") << &surface << QVariantMap() << 1 << 1;
-    QTest::newRow("Surface, all notifications enabled, application notification") << &surface << allNotificationsEnabled << 1 << 1;
-    QTest::newRow("Surface, application notifications disabled, application notification") << &surface << applicationNotificationsDisabled << 1 << 0;
-    QTest::newRow("Surface, system notifications disabled, application notification") << &surface << systemNotificationsDisabled << 1 << 1;
-    QTest::newRow("Surface, all notifications disabled, application notification") << &surface << allNotificationsDisabled << 1 << 0;
-    QTest::newRow("No surface, system notification") << (QWaylandSurface *)0 << QVariantMap() << 2 << 1;
-    QTest::newRow("Surface, no properties, system notification") << &surface << QVariantMap() << 2 << 1;
-    QTest::newRow("Surface, all notifications enabled, system notification") << &surface << allNotificationsEnabled << 2 << 1;
-    QTest::newRow("Surface, application notifications disabled, system notification") << &surface << applicationNotificationsDisabled << 2 << 1;
-    QTest::newRow("Surface, system notifications disabled, system notification") << &surface << systemNotificationsDisabled << 2 << 0;
-    QTest::newRow("Surface, all notifications disabled, system notification") << &surface << allNotificationsDisabled << 2 << 0;
+    QTest::newRow("All notifications enabled, application notification") << SystemState::AllNotificationsEnabled << 1 << 1;
+    QTest::newRow("Application notifications disabled, application notification") << SystemState::ApplicationNotificationsDisabled << 1 << 0;
+    QTest::newRow("System notifications disabled, application notification") << SystemState::SystemNotificationsDisabled << 1 << 1;
+    QTest::newRow("All notifications disabled, application notification") << SystemState::AllNotificationsDisabled << 1 << 0;
+    QTest::newRow("All notifications enabled, system notification") << SystemState::AllNotificationsEnabled << 2 << 1;
+    QTest::newRow("Application notifications disabled, system notification") << SystemState::ApplicationNotificationsDisabled << 2 << 1;
+    QTest::newRow("System notifications disabled, system notification") << SystemState::SystemNotificationsDisabled << 2 << 0;
+    QTest::newRow("All notifications disabled, system notification") << SystemState::AllNotificationsDisabled << 2 << 0;
 }
 
 void Ut_NotificationFeedbackPlayer::testNotificationPreviewsDisabled()
 {
-    QFETCH(QWaylandSurface *, surface);
-    QFETCH(QVariantMap, windowProperties);
+    QFETCH(SystemState::NotificationPreviewMode, mode);
     QFETCH(int, urgency);
     QFETCH(int, playCount);
 
-    gLipstickCompositorStub->stubSetReturnValue("surfaceForId", surface);
-    qWaylandSurfaceWindowProperties = windowProperties;
+    gSystemStateStub->stubSetReturnValue("notificationPreviewMode", mode);
 
     createNotification(1, urgency);
     player->addNotification(1);
@@ -243,4 +283,76 @@ void Ut_NotificationFeedbackPlayer::testNotificationPreviewsDisabled()
     QCOMPARE(gClientStub->stubCallCount("play"), playCount);
 }
 
+void Ut_NotificationFeedbackPlayer::testFeedbackIsCoalesced()
+{
+    gClientStub->stubSetReturnValue("play", (quint32)1);
+
+    // The same feedback should be played only once within the coalescing window
+    createNotification(1);
+    player->addNotification(1);
+    createNotification(2);
+    player->addNotification(2);
+    QCOMPARE(gClientStub->stubCallCount("play"), 1);
+    QCOMPARE(player->suppressedFeedbackCount(), (uint)1);
+
+    // A different feedback should be played
+    gClientStub->stubSetReturnValue("play", (quint32)2);
+    createNotification(3, 0, "feedback2");
+    player->addNotification(3);
+    QCOMPARE(gClientStub->stubCallCount("play"), 2);
+    QCOMPARE(gClientStub->stubLastCallTo("play").parameter<QString>(0), QString("feedback2"));
+
+    // The shared feedback should be stopped only when all notifications using it have been removed
+    player->removeNotification(1);
+    QCOMPARE(gClientStub->stubCallCount("stop"), 0);
+    player->removeNotification(2);
+    QCOMPARE(gClientStub->stubCallCount("stop"), 1);
+    QCOMPARE(gClientStub->stubLastCallTo("stop").parameter<quint32>(0), (quint32)1);
+    player->removeNotification(2);
+    QCOMPARE(gClientStub->stubCallCount("stop"), 1);
+    player->removeNotification(3);
+    QCOMPARE(gClientStub->stubCallCount("stop"), 2);
+    QCOMPARE(gClientStub->stubLastCallTo("stop").parameter<quint32>(0), (quint32)2);
+
+    // After the coalescing window the feedback should be played again
+    player->endCoalescingWindow();
+    createNotification(4);
+    player->addNotification(4);
+    QCOMPARE(gClientStub->stubCallCount("play"), 3);
+    QCOMPARE(player->suppressedFeedbackCount(), (uint)1);
+}
+
+void Ut_NotificationFeedbackPlayer::testDisplayOnRequestIsCoalesced()
+{
+    // The display should be requested to be turned on only once within the coalescing window
+    createNotification(1, 0, "feedback", true);
+    player->addNotification(1);
+    createNotification(2, 0, "feedback2", true);
+    player->addNotification(2);
+    QCOMPARE(qDBusConnectionAsyncCallMessages.count(), 1);
+    QCOMPARE(qDBusConnectionAsyncCallMessages.first().member(), QString(MCE_DISPLAY_ON_REQ));
+    QCOMPARE(player->suppressedDisplayOnRequestCount(), (uint)1);
+
+    // After the coalescing window the display should be requested to be turned on again
+    player->endCoalescingWindow();
+    createNotification(3, 0, "feedback", true);
+    player->addNotification(3);
+    QCOMPARE(qDBusConnectionAsyncCallMessages.count(), 2);
+    QCOMPARE(player->suppressedDisplayOnRequestCount(), (uint)1);
+}
+
+void Ut_NotificationFeedbackPlayer::testCoalescingCanBeDisabled()
+{
+    player->coalescingTimer.setInterval(0);
+
+    createNotification(1, 0, "feedback", true);
+    player->addNotification(1);
+    createNotification(2, 0, "feedback", true);
+    player->addNotification(2);
+    QCOMPARE(gClientStub->stubCallCount("play"), 2);
+    QCOMPARE(qDBusConnectionAsyncCallMessages.count(), 2);
+    QCOMPARE(player->suppressedFeedbackCount(), (uint)0);
+    QCOMPARE(player->suppressedDisplayOnRequestCount(), (uint)0);
+}
+
 QTEST_MAIN(Ut_NotificationFeedbackPlayer)
@@ -38,8 +38,12 @@ private slots:
     void testWithoutFeedbackId();
     void testUpdateNotificationIsNotPossible();
     void testUpdateNotificationIsNotPossibleAfterRestart();
+    void testExistingNotificationsAreNotCreatedOnInit();
     void testNotificationPreviewsDisabled_data();
     void testNotificationPreviewsDisabled();
+    void testFeedbackIsCoalesced();
+    void testDisplayOnRequestIsCoalesced();
+    void testCoalescingCanBeDisabled();
 
 private:
     NotificationFeedbackPlayer *player;
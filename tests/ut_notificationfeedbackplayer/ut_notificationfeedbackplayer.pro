@@ -1,6 +1,6 @@
 include(../common.pri)
 TARGET = ut_notificationfeedbackplayer
-INCLUDEPATH += $$NOTIFICATIONSRCDIR $$COMPOSITORSRCDIR /usr/include/ngf-qt5 /usr/include/qmsystem2-qt5
+INCLUDEPATH += $$NOTIFICATIONSRCDIR /usr/include/ngf-qt5 /usr/include/qmsystem2-qt5
 CONFIG += link_pkgconfig
 QT += dbus compositor quick
 DEFINES += QT_COMPOSITOR_QUICK
@@ -11,7 +11,7 @@ HEADERS += \
     $$NOTIFICATIONSRCDIR/notificationpreviewpresenter.h \
     $$NOTIFICATIONSRCDIR/notificationmanager.h \
     $$NOTIFICATIONSRCDIR/lipsticknotification.h \
-    $$COMPOSITORSRCDIR/lipstickcompositor.h \
+    $$SRCDIR/systemstate.h \
     /usr/include/ngf-qt5/ngfclient.h
 
 SOURCES += \
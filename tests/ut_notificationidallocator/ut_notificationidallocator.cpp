@@ -0,0 +1,134 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QQueue>
+#include "ut_notificationidallocator.h"
+#include "notificationidallocator.h"
+
+void Ut_NotificationIdAllocator::testIdsAreAllocatedInIncreasingOrderStartingFromOne()
+{
+    NotificationIdAllocator allocator;
+
+    QCOMPARE(allocator.allocate(), 1u);
+    QCOMPARE(allocator.allocate(), 2u);
+    QCOMPARE(allocator.allocate(), 3u);
+    QCOMPARE(allocator.count(), 3);
+    QCOMPARE(allocator.isAllocated(0), false);
+    QCOMPARE(allocator.isAllocated(2), true);
+}
+
+void Ut_NotificationIdAllocator::testReleasedIdsAreNotReusedBeforeWrapAround()
+{
+    NotificationIdAllocator allocator(10);
+
+    QCOMPARE(allocator.allocate(), 1u);
+    QCOMPARE(allocator.allocate(), 2u);
+    allocator.release(1);
+    QCOMPARE(allocator.isAllocated(1), false);
+    QCOMPARE(allocator.allocate(), 3u);
+    QCOMPARE(allocator.count(), 2);
+}
+
+void Ut_NotificationIdAllocator::testAllocationSkipsIdsInUseAfterWrapAround()
+{
+    NotificationIdAllocator allocator(5);
+    for (uint id = 1; id <= 5; id++) {
+        QCOMPARE(allocator.allocate(), id);
+    }
+
+    allocator.release(2);
+    allocator.release(4);
+
+    QCOMPARE(allocator.allocate(), 2u);
+    QCOMPARE(allocator.allocate(), 4u);
+}
+
+void Ut_NotificationIdAllocator::testZeroIsReturnedWhenAllIdsAreInUse()
+{
+    NotificationIdAllocator allocator(3);
+    allocator.allocate();
+    allocator.allocate();
+    allocator.allocate();
+
+    QCOMPARE(allocator.allocate(), 0u);
+
+    allocator.release(2);
+    QCOMPARE(allocator.allocate(), 2u);
+    QCOMPARE(allocator.allocate(), 0u);
+}
+
+void Ut_NotificationIdAllocator::testAllocationContinuesAfterReservedIds()
+{
+    NotificationIdAllocator allocator(100);
+    allocator.reserve(3);
+    allocator.reserve(7);
+
+    QCOMPARE(allocator.allocate(), 8u);
+    QCOMPARE(allocator.count(), 3);
+
+    // IDs 0 and IDs beyond the maximum are never reserved
+    allocator.reserve(0);
+    allocator.reserve(101);
+    QCOMPARE(allocator.isAllocated(0), false);
+    QCOMPARE(allocator.isAllocated(101), false);
+    QCOMPARE(allocator.count(), 3);
+}
+
+void Ut_NotificationIdAllocator::testReservedIdsAreNotAllocated()
+{
+    NotificationIdAllocator allocator(5);
+    allocator.reserve(5);
+    allocator.release(5);
+    allocator.reserve(2);
+
+    // The allocation wraps around since ID 5 was the largest one reserved
+    QCOMPARE(allocator.allocate(), 1u);
+    QCOMPARE(allocator.allocate(), 3u);
+    QCOMPARE(allocator.allocate(), 4u);
+    QCOMPARE(allocator.allocate(), 5u);
+    QCOMPARE(allocator.allocate(), 0u);
+}
+
+void Ut_NotificationIdAllocator::testAllocatingAndReleasingMillionsOfIds()
+{
+    // Keep a sliding window of live IDs in a small ID space so that the allocation wraps around frequently
+    const uint maximumId = 1000;
+    const int liveIdCount = 250;
+    NotificationIdAllocator allocator(maximumId);
+    QQueue<uint> liveIds;
+    QVector<bool> live(maximumId + 1, false);
+
+    for (int i = 0; i < 4000000; i++) {
+        uint id = allocator.allocate();
+        if (id == 0 || id > maximumId || live.at(id)) {
+            QFAIL(qPrintable(QString("Invalid ID %1 allocated on iteration %2").arg(id).arg(i)));
+        }
+        live[id] = true;
+        liveIds.enqueue(id);
+
+        // Release IDs out of order every now and then
+        if (liveIds.count() > liveIdCount) {
+            int index = (i % 7 == 0) ? liveIds.count() / 2 : 0;
+            uint released = liveIds.takeAt(index);
+            live[released] = false;
+            allocator.release(released);
+        }
+    }
+
+    QCOMPARE(allocator.count(), liveIds.count());
+}
+
+QTEST_APPLESS_MAIN(Ut_NotificationIdAllocator)
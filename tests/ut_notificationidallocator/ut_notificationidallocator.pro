@@ -0,0 +1,13 @@
+include(../common.pri)
+TARGET = ut_notificationidallocator
+INCLUDEPATH += $$NOTIFICATIONSRCDIR
+
+# unit test and unit
+SOURCES += \
+    ut_notificationidallocator.cpp \
+    $$NOTIFICATIONSRCDIR/notificationidallocator.cpp
+
+# unit test and unit
+HEADERS += \
+    ut_notificationidallocator.h \
+    $$NOTIFICATIONSRCDIR/notificationidallocator.h
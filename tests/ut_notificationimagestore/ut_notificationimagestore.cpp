@@ -0,0 +1,220 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <climits>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "ut_notificationimagestore.h"
+#include "notificationimagestore.h"
+
+static QByteArray imageData(uchar red)
+{
+    // A 2x1 RGB image with a padded rowstride
+    QByteArray pixels;
+    pixels.append(char(red)).append(char(0x20)).append(char(0x30));
+    pixels.append(char(0x40)).append(char(0x50)).append(char(0x60));
+    pixels.append(2, char(0));
+    return NotificationImageStore::encode(2, 1, 8, false, 8, 3, pixels);
+}
+
+static int fileCount(const QString &path)
+{
+    return QDir(path).entryList(QDir::Files).count();
+}
+
+void FileWorker::writeImage(const QString &filePath, const QByteArray &header, const QByteArray &pixels)
+{
+    writtenFiles << filePath;
+    NotificationImageStore::writeFile(filePath, header, pixels);
+}
+
+void Ut_NotificationImageStore::init()
+{
+    directory = new QTemporaryDir;
+}
+
+void Ut_NotificationImageStore::cleanup()
+{
+    delete directory;
+}
+
+void Ut_NotificationImageStore::testIdenticalImagesAreStoredOnce()
+{
+    NotificationImageStore store(directory->path());
+    QString key1 = store.store(imageData(0x10));
+    QString key2 = store.store(imageData(0x10));
+    QString key3 = store.store(imageData(0x11));
+
+    QVERIFY(!key1.isEmpty());
+    QCOMPARE(key2, key1);
+    QVERIFY(key3 != key1);
+    QCOMPARE(store.count(), 2);
+    QCOMPARE(fileCount(directory->path()), 2);
+    QCOMPARE(store.data(key1), imageData(0x10));
+    QCOMPARE(store.data(key3), imageData(0x11));
+}
+
+void Ut_NotificationImageStore::testImageCanBeStoredInParts()
+{
+    QByteArray pixels(3, char(0x10));
+    NotificationImageStore store(directory->path());
+    QString key = store.store(NotificationImageStore::encodeHeader(1, 1, 3, false, 8, 3, pixels.size()), pixels);
+
+    // The parts are stored as a whole and identified by the hash of the whole
+    QCOMPARE(store.store(NotificationImageStore::encode(1, 1, 3, false, 8, 3, pixels)), key);
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(store.data(key), NotificationImageStore::encode(1, 1, 3, false, 8, 3, pixels));
+    QCOMPARE(NotificationImageStore::decode(store.data(key)).pixel(0, 0), qRgb(0x10, 0x10, 0x10));
+}
+
+void Ut_NotificationImageStore::testInvalidKeysAreRejected()
+{
+    // A file outside the store which must not be reachable through a key
+    QFile outside(directory->path() + "/outside");
+    QVERIFY(outside.open(QIODevice::WriteOnly));
+    outside.write("data");
+    outside.close();
+
+    QDir(directory->path()).mkdir("images");
+    NotificationImageStore store(directory->path() + "/images");
+    QString key = store.store(imageData(0x10));
+    QStringList invalidKeys;
+    invalidKeys << "../outside" << key.toUpper() << key.left(39) << key + "0" << QString(40, QChar('g'));
+    foreach (const QString &invalidKey, invalidKeys) {
+        QCOMPARE(store.addReference(invalidKey), false);
+        QCOMPARE(store.data(invalidKey), QByteArray());
+        store.release(invalidKey);
+    }
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(outside.exists(), true);
+    QCOMPARE(store.data(key), imageData(0x10));
+}
+
+void Ut_NotificationImageStore::testImageIsRemovedWhenLastReferenceIsReleased()
+{
+    NotificationImageStore store(directory->path());
+    QString key = store.store(imageData(0x10));
+    store.store(imageData(0x10));
+
+    store.release(key);
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(store.data(key), imageData(0x10));
+
+    store.release(key);
+    QCOMPARE(store.count(), 0);
+    QCOMPARE(store.data(key), QByteArray());
+    QCOMPARE(fileCount(directory->path()), 0);
+}
+
+void Ut_NotificationImageStore::testReferenceCanOnlyBeAddedToStoredImage()
+{
+    QString key;
+    {
+        NotificationImageStore store(directory->path());
+        key = store.store(imageData(0x10));
+    }
+
+    // A new store finds the images stored earlier
+    NotificationImageStore store(directory->path());
+    QCOMPARE(store.addReference(key), true);
+    QCOMPARE(store.addReference("0123456789abcdef0123456789abcdef01234567"), false);
+    QCOMPARE(store.addReference(QString()), false);
+    QCOMPARE(store.count(), 1);
+}
+
+void Ut_NotificationImageStore::testUnreferencedImagesAreRemoved()
+{
+    QString key1, key2;
+    {
+        NotificationImageStore store(directory->path());
+        key1 = store.store(imageData(0x10));
+        key2 = store.store(imageData(0x11));
+    }
+
+    NotificationImageStore store(directory->path());
+    store.addReference(key1);
+    store.removeUnreferenced();
+    QCOMPARE(store.data(key1), imageData(0x10));
+    QCOMPARE(store.data(key2), QByteArray());
+    QCOMPARE(fileCount(directory->path()), 1);
+}
+
+void Ut_NotificationImageStore::testEncodedImageIsDecoded()
+{
+    QImage image = NotificationImageStore::decode(imageData(0x10));
+    QCOMPARE(image.size(), QSize(2, 1));
+    QCOMPARE(image.pixel(0, 0), qRgb(0x10, 0x20, 0x30));
+    QCOMPARE(image.pixel(1, 0), qRgb(0x40, 0x50, 0x60));
+
+    QByteArray pixels;
+    pixels.append(char(0x10)).append(char(0x20)).append(char(0x30)).append(char(0x80));
+    image = NotificationImageStore::decode(NotificationImageStore::encode(1, 1, 4, true, 8, 4, pixels));
+    QCOMPARE(image.hasAlphaChannel(), true);
+    QCOMPARE(image.pixel(0, 0), qRgba(0x10, 0x20, 0x30, 0x80));
+}
+
+void Ut_NotificationImageStore::testInvalidImageDataIsNotDecoded()
+{
+    QByteArray pixels(3, 0);
+    QVERIFY(NotificationImageStore::decode(QByteArray()).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(2, 1, 6, false, 8, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(1, 1, 3, false, 16, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(1, 1, 3, true, 8, 3, pixels)).isNull());
+
+    // Values which would overflow 32-bit size calculations or are not positive
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(65536, 65536, 196608, false, 8, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(1, 2, INT_MAX, false, 8, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(1, 1, -3, false, 8, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(-1, 1, 3, false, 8, 3, pixels)).isNull());
+    QVERIFY(NotificationImageStore::decode(NotificationImageStore::encode(1, 1, 3, false, -8, 3, pixels)).isNull());
+    QCOMPARE(NotificationImageStore::isValid(1431655766, 1, 3, false, 8, 3, 3), false);
+    QCOMPARE(NotificationImageStore::isValid(1, 1, 3, false, 8, 3, 3), true);
+}
+
+void Ut_NotificationImageStore::testSerializedImageDataIsValidated()
+{
+    QByteArray pixels(3, 0);
+    QCOMPARE(NotificationImageStore::isValid(imageData(0x10)), true);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encode(1, 1, 3, false, 8, 3, pixels)), true);
+
+    // Headers which are truncated, describe an invalid image or don't match the pixel data that follows
+    QCOMPARE(NotificationImageStore::isValid(QByteArray()), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encodeHeader(1, 1, 3, false, 8, 3, 3).left(8)), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encode(4097, 1, 12291, false, 8, 3, QByteArray(12291, 0))), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encode(1, 1, 3, false, 16, 3, pixels)), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encodeHeader(1, 1, 3, false, 8, 3, 3) + QByteArray(2, 0)), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encodeHeader(1, 1, 3, false, 8, 3, 3) + QByteArray(4, 0)), false);
+    QCOMPARE(NotificationImageStore::isValid(NotificationImageStore::encodeHeader(1, 1, 3, false, 8, 3, -1) + pixels), false);
+}
+
+void Ut_NotificationImageStore::testImageCanBeReadBeforeItHasBeenWritten()
+{
+    FileWorker worker;
+    NotificationImageStore store(directory->path());
+    store.setFileWorker(&worker);
+    QString key = store.store(imageData(0x10));
+
+    // The image is read from memory until the file worker has written it
+    QCOMPARE(fileCount(directory->path()), 0);
+    QCOMPARE(store.data(key), imageData(0x10));
+
+    // The file worker writes the file once control returns to the event loop
+    QCoreApplication::processEvents();
+    QCOMPARE(worker.writtenFiles.count(), 1);
+    QCOMPARE(fileCount(directory->path()), 1);
+    QCOMPARE(store.data(key), imageData(0x10));
+}
+
+QTEST_MAIN(Ut_NotificationImageStore)
@@ -0,0 +1,56 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+#ifndef UT_NOTIFICATIONIMAGESTORE_H
+#define UT_NOTIFICATIONIMAGESTORE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QTemporaryDir;
+
+class FileWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    QStringList writtenFiles;
+
+public slots:
+    void writeImage(const QString &filePath, const QByteArray &header, const QByteArray &pixels);
+};
+
+class Ut_NotificationImageStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testIdenticalImagesAreStoredOnce();
+    void testImageCanBeStoredInParts();
+    void testInvalidKeysAreRejected();
+    void testImageIsRemovedWhenLastReferenceIsReleased();
+    void testReferenceCanOnlyBeAddedToStoredImage();
+    void testUnreferencedImagesAreRemoved();
+    void testEncodedImageIsDecoded();
+    void testInvalidImageDataIsNotDecoded();
+    void testSerializedImageDataIsValidated();
+    void testImageCanBeReadBeforeItHasBeenWritten();
+
+private:
+    QTemporaryDir *directory;
+};
+
+#endif
@@ -0,0 +1,13 @@
+include(../common.pri)
+TARGET = ut_notificationimagestore
+INCLUDEPATH += $$NOTIFICATIONSRCDIR
+
+# unit test and unit
+SOURCES += \
+    ut_notificationimagestore.cpp \
+    $$NOTIFICATIONSRCDIR/notificationimagestore.cpp
+
+# unit test and unit
+HEADERS += \
+    ut_notificationimagestore.h \
+    $$NOTIFICATIONSRCDIR/notificationimagestore.h
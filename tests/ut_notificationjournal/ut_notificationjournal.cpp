@@ -0,0 +1,139 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "ut_notificationjournal.h"
+#include "notificationjournal.h"
+
+static NotificationDatabase::Record createRecord(uint id)
+{
+    NotificationDatabase::Record record;
+    record.id = id;
+    record.appName = "appName";
+    record.appIcon = "appIcon";
+    record.summary = "summary";
+    record.body = "body";
+    record.expireTimeout = 1000;
+    record.data = QByteArray("data") + QByteArray::number(id);
+    record.expireAt = 12345;
+    return record;
+}
+
+void Ut_NotificationJournal::init()
+{
+    directory = new QTemporaryDir;
+}
+
+void Ut_NotificationJournal::cleanup()
+{
+    delete directory;
+}
+
+QString Ut_NotificationJournal::journalPath() const
+{
+    return directory->path() + "/notifications.journal";
+}
+
+void Ut_NotificationJournal::testEntriesAreReadInOrder()
+{
+    NotificationJournal journal(journalPath());
+    QCOMPARE(journal.isEmpty(), true);
+    journal.appendStore(createRecord(1));
+    journal.appendRemove(2);
+    journal.appendStore(createRecord(3));
+    journal.sync();
+    QCOMPARE(journal.isEmpty(), false);
+
+    // The entries can be read by another journal instance, as is done after a restart
+    QList<NotificationJournal::Entry> entries = NotificationJournal(journalPath()).read();
+    QCOMPARE(entries.count(), 3);
+    QCOMPARE(entries.at(0).operation, NotificationJournal::StoreNotification);
+    QCOMPARE(entries.at(0).record.id, 1u);
+    QCOMPARE(entries.at(0).record.appName, QString("appName"));
+    QCOMPARE(entries.at(0).record.appIcon, QString("appIcon"));
+    QCOMPARE(entries.at(0).record.summary, QString("summary"));
+    QCOMPARE(entries.at(0).record.body, QString("body"));
+    QCOMPARE(entries.at(0).record.expireTimeout, 1000);
+    QCOMPARE(entries.at(0).record.data, QByteArray("data1"));
+    QCOMPARE(entries.at(0).record.expireAt, qint64(12345));
+    QCOMPARE(entries.at(1).operation, NotificationJournal::RemoveNotification);
+    QCOMPARE(entries.at(1).record.id, 2u);
+    QCOMPARE(entries.at(2).operation, NotificationJournal::StoreNotification);
+    QCOMPARE(entries.at(2).record.data, QByteArray("data3"));
+}
+
+void Ut_NotificationJournal::testClearedJournalIsEmpty()
+{
+    NotificationJournal journal(journalPath());
+    journal.appendStore(createRecord(1));
+    journal.clear();
+    QCOMPARE(journal.isEmpty(), true);
+    QCOMPARE(journal.read().count(), 0);
+
+    // Entries appended after clearing are kept
+    journal.appendRemove(1);
+    QCOMPARE(journal.read().count(), 1);
+
+    // A journal left behind by an earlier instance can be cleared
+    NotificationJournal restoredJournal(journalPath());
+    QCOMPARE(restoredJournal.isEmpty(), false);
+    restoredJournal.clear();
+    QCOMPARE(restoredJournal.isEmpty(), true);
+}
+
+void Ut_NotificationJournal::testPartiallyWrittenEntryIsIgnored()
+{
+    {
+        NotificationJournal journal(journalPath());
+        journal.appendStore(createRecord(1));
+        journal.appendStore(createRecord(2));
+    }
+
+    // Cut the last entry short as if lipstick had exited while writing it
+    QFile file(journalPath());
+    file.resize(file.size() - 3);
+
+    QList<NotificationJournal::Entry> entries = NotificationJournal(journalPath()).read();
+    QCOMPARE(entries.count(), 1);
+    QCOMPARE(entries.at(0).record.id, 1u);
+}
+
+void Ut_NotificationJournal::testCorruptedEntryIsIgnored()
+{
+    {
+        NotificationJournal journal(journalPath());
+        journal.appendStore(createRecord(1));
+    }
+    qint64 firstEntrySize = QFileInfo(journalPath()).size();
+    {
+        NotificationJournal journal(journalPath());
+        journal.appendStore(createRecord(2));
+        journal.appendStore(createRecord(3));
+    }
+
+    // Corrupt the payload of the second entry; it and anything after it are ignored
+    QFile file(journalPath());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.seek(firstEntrySize + 10);
+    file.write("X");
+    file.close();
+
+    QList<NotificationJournal::Entry> entries = NotificationJournal(journalPath()).read();
+    QCOMPARE(entries.count(), 1);
+    QCOMPARE(entries.at(0).record.id, 1u);
+}
+
+QTEST_APPLESS_MAIN(Ut_NotificationJournal)
@@ -0,0 +1,40 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+#ifndef UT_NOTIFICATIONJOURNAL_H
+#define UT_NOTIFICATIONJOURNAL_H
+
+#include <QObject>
+
+class QTemporaryDir;
+
+class Ut_NotificationJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testEntriesAreReadInOrder();
+    void testClearedJournalIsEmpty();
+    void testPartiallyWrittenEntryIsIgnored();
+    void testCorruptedEntryIsIgnored();
+
+private:
+    QString journalPath() const;
+
+    QTemporaryDir *directory;
+};
+
+#endif
@@ -0,0 +1,13 @@
+include(../common.pri)
+TARGET = ut_notificationjournal
+INCLUDEPATH += $$NOTIFICATIONSRCDIR
+
+# unit test and unit
+SOURCES += \
+    ut_notificationjournal.cpp \
+    $$NOTIFICATIONSRCDIR/notificationjournal.cpp
+
+# unit test and unit
+HEADERS += \
+    ut_notificationjournal.h \
+    $$NOTIFICATIONSRCDIR/notificationjournal.h
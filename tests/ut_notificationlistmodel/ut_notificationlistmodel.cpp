@@ -28,6 +28,16 @@ void QTimer::singleShot(int, const QObject *receiver, const char *member)
     QMetaObject::invokeMethod(const_cast<QObject *>(receiver), modifiedMember, Qt::DirectConnection);
 }
 
+//! A model placing every notification at the top of the list
+class TopFirstNotificationListModel : public NotificationListModel
+{
+protected:
+    virtual int indexFor(LipstickNotification *)
+    {
+        return 0;
+    }
+};
+
 void Ut_NotificationListModel::init()
 {
 }
@@ -40,8 +50,7 @@ void Ut_NotificationListModel::cleanup()
 void Ut_NotificationListModel::testSignalConnections()
 {
     NotificationListModel model;
-    QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationModified(uint)), &model, SLOT(updateNotification(uint))), true);
-    QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), &model, SLOT(removeNotification(uint))), true);
+    QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationsChanged(QList<uint>, QList<uint>)), &model, SLOT(updateNotifications(QList<uint>, QList<uint>))), true);
     QCOMPARE(disconnect(&model, SIGNAL(clearRequested()), NotificationManager::instance(), SLOT(removeUserRemovableNotifications())), true);
 }
 
@@ -123,12 +132,59 @@ void Ut_NotificationListModel::testAlreadyAddedNotificationIsRemovedIfNoLongerAd
 void Ut_NotificationListModel::testNotificationRemoval()
 {
     LipstickNotification notification("appName", 1, "appIcon", "summary", "body", QStringList() << "action", QVariantHash(), 1);
+    gNotificationManagerStub->stubSetReturnValue("notificationIds", QList<uint>() << 1);
     gNotificationManagerStub->stubSetReturnValue("notification", &notification);
     NotificationListModel model;
-    model.removeNotification(1);
+    QCOMPARE(model.itemCount(), 1);
+
+    // The removed notification is no longer available from the manager
+    gNotificationManagerStub->stubSetReturnValue("notification", (LipstickNotification *)0);
+    model.updateNotifications(QList<uint>(), QList<uint>() << 1);
     QCOMPARE(model.itemCount(), 0);
 }
 
+void Ut_NotificationListModel::testAdjacentNotificationsAreRemovedTogether()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    for (uint id = 1; id <= 5; id++) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, id), QTime(12, 34, 56)));
+        notifications.append(new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1, &model));
+        gNotificationManagerStub->stubSetReturnValue("notification", notifications.last());
+        model.updateNotifications(QList<uint>() << id, QList<uint>());
+    }
+    QCOMPARE(model.itemCount(), 5);
+
+    // Notifications 1, 2 and 4 are in rows 4, 3 and 1 so two row removals are needed
+    QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+    model.updateNotifications(QList<uint>(), QList<uint>() << 4 << 1 << 2);
+    QCOMPARE(removeSpy.count(), 2);
+    QCOMPARE(removeSpy.at(0).at(1).toInt(), 3);
+    QCOMPARE(removeSpy.at(0).at(2).toInt(), 4);
+    QCOMPARE(removeSpy.at(1).at(1).toInt(), 1);
+    QCOMPARE(removeSpy.at(1).at(2).toInt(), 1);
+    QCOMPARE(model.itemCount(), 2);
+    QCOMPARE(model.get(0), notifications.at(4));
+    QCOMPARE(model.get(1), notifications.at(2));
+}
+
+void Ut_NotificationListModel::testBatchIsAppliedRemovalsFirst()
+{
+    NotificationListModel model;
+    LipstickNotification oldNotification("appName", 1, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    gNotificationManagerStub->stubSetReturnValue("notification", &oldNotification);
+    model.updateNotifications(QList<uint>() << 1, QList<uint>());
+    QCOMPARE(model.get(0), &oldNotification);
+
+    // A notification removed and added again with the same ID replaces the previous one
+    LipstickNotification newNotification("appName", 1, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    gNotificationManagerStub->stubSetReturnValue("notification", &newNotification);
+    model.updateNotifications(QList<uint>() << 1, QList<uint>() << 1);
+    QCOMPARE(model.itemCount(), 1);
+    QCOMPARE(model.get(0), &newNotification);
+}
+
 void Ut_NotificationListModel::testNotificationOrdering()
 {
     NotificationListModel model;
@@ -142,7 +198,7 @@ void Ut_NotificationListModel::testNotificationOrdering()
     LipstickNotification notification2("appName2", 2, "appIcon2", "summary2", "body2", QStringList() << "action2", hints2, 1);
     LipstickNotification notification3("appName3", 3, "appIcon3", "summary3", "body3", QStringList() << "action3", hints3, 1);
     gNotificationManagerStub->stubSetReturnValue("notification", &notification1);
-    model.updateNotification(1);
+    model.updateNotifications(QList<uint>() << 1, QList<uint>());
     gNotificationManagerStub->stubSetReturnValue("notification", &notification3);
     model.updateNotification(3);
     gNotificationManagerStub->stubSetReturnValue("notification", &notification2);
@@ -164,4 +220,165 @@ void Ut_NotificationListModel::testNotificationOrdering()
     QCOMPARE(model.get(0), &notification1);
 }
 
+void Ut_NotificationListModel::testNotificationIsMovedDownWhenTimestampDecreases()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    for (uint id = 1; id <= 3; id++) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, id), QTime(12, 34, 56)));
+        notifications.append(new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1, &model));
+        gNotificationManagerStub->stubSetReturnValue("notification", notifications.last());
+        model.updateNotification(id);
+    }
+    QCOMPARE(model.get(0), notifications.at(2));
+
+    // Moving the latest notification between the two others
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, 1), QTime(18, 0, 0)));
+    notifications.at(2)->setHints(hints);
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(2));
+    model.updateNotification(3);
+    QCOMPARE(model.get(0), notifications.at(1));
+    QCOMPARE(model.get(1), notifications.at(2));
+    QCOMPARE(model.get(2), notifications.at(0));
+
+    // Moving it to the end
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2012, 12, 31), QTime(12, 34, 56)));
+    notifications.at(2)->setHints(hints);
+    model.updateNotification(3);
+    QCOMPARE(model.get(0), notifications.at(1));
+    QCOMPARE(model.get(1), notifications.at(0));
+    QCOMPARE(model.get(2), notifications.at(2));
+}
+
+void Ut_NotificationListModel::testNotificationIsMovedToIndexForPosition()
+{
+    TopFirstNotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    for (uint id = 1; id <= 3; id++) {
+        notifications.append(new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1, &model));
+        gNotificationManagerStub->stubSetReturnValue("notification", notifications.last());
+        model.updateNotification(id);
+    }
+    QCOMPARE(model.get(0), notifications.at(2));
+
+    // Check that an updated notification is moved to the position given by indexFor()
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(0));
+    model.updateNotification(1);
+    QCOMPARE(model.get(0), notifications.at(0));
+    QCOMPARE(model.get(1), notifications.at(2));
+    QCOMPARE(model.get(2), notifications.at(1));
+}
+
+void Ut_NotificationListModel::testSortKeysOfDestroyedNotificationsAreDropped()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    for (uint id = 1; id <= 2; id++) {
+        notifications.append(new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1));
+        gNotificationManagerStub->stubSetReturnValue("notification", notifications.last());
+        model.updateNotification(id);
+    }
+
+    // Check that destroying a notification removes its row and its sort key
+    delete notifications.takeFirst();
+    QCOMPARE(model.itemCount(), 1);
+    QCOMPARE(model.sortKeys.count(), 1);
+    QCOMPARE(model.sortKeys.contains(1), false);
+    QCOMPARE(model.notificationIds.count(), 1);
+    QCOMPARE(model.rowFor(2), 0);
+
+    // Check that removing a notification by its ID drops its sort key as well
+    model.updateNotifications(QList<uint>(), QList<uint>() << 2);
+    QCOMPARE(model.itemCount(), 0);
+    QCOMPARE(model.sortKeys.count(), 0);
+    QCOMPARE(model.notificationIds.count(), 0);
+    qDeleteAll(notifications);
+}
+
+void Ut_NotificationListModel::testNotificationsWithSameTimestampAreFoundById()
+{
+    NotificationListModel model;
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, 1), QTime(12, 34, 56)));
+    QList<LipstickNotification *> notifications;
+    for (uint id = 1; id <= 4; id++) {
+        notifications.append(new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1, &model));
+        gNotificationManagerStub->stubSetReturnValue("notification", notifications.last());
+        model.updateNotification(id);
+    }
+
+    // Notifications with the same timestamp are placed before the earlier ones
+    QCOMPARE(model.get(0), notifications.at(3));
+    QCOMPARE(model.get(3), notifications.at(0));
+    QCOMPARE(model.rowFor(1), 3);
+    QCOMPARE(model.rowFor(3), 1);
+    QCOMPARE(model.rowFor(5), -1);
+
+    // Updating a notification without changing its timestamp keeps it in place
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(1));
+    model.updateNotification(2);
+    QCOMPARE(model.get(2), notifications.at(1));
+
+    model.updateNotifications(QList<uint>(), QList<uint>() << 2);
+    QCOMPARE(model.itemCount(), 3);
+    QCOMPARE(model.rowFor(1), 2);
+    QCOMPARE(model.rowFor(2), -1);
+}
+
+void Ut_NotificationListModel::testRowsAreFetchedInBatches()
+{
+    LipstickNotification notification("appName", 1, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    QList<uint> ids;
+    for (uint id = 1; id <= 25; id++) {
+        ids.append(id);
+    }
+    gNotificationManagerStub->stubSetReturnValue("notificationIds", ids);
+    gNotificationManagerStub->stubSetReturnValue("notification", &notification);
+
+    // The notifications are ordered by their timestamps but only the first batch is created on construction
+    NotificationListModel model;
+    QCOMPARE(gNotificationManagerStub->stubCallCount("notificationTimestamp"), 25);
+    QCOMPARE(gNotificationManagerStub->stubCallCount("notification"), 20);
+    QCOMPARE(model.itemCount(), 20);
+    QCOMPARE(model.canFetchMore(QModelIndex()), true);
+
+    // The rest are created when the view fetches more rows
+    model.fetchMore(QModelIndex());
+    QCOMPARE(gNotificationManagerStub->stubCallCount("notification"), 25);
+    QCOMPARE(model.itemCount(), 25);
+    QCOMPARE(model.canFetchMore(QModelIndex()), false);
+}
+
+void Ut_NotificationListModel::testNotificationsAfterUnfetchedRowsAreFetchedWithThem()
+{
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, 2), QTime(12, 34, 56)));
+    LipstickNotification notification("appName", 1, "appIcon", "summary", "body", QStringList(), hints, 1);
+    QList<uint> ids;
+    for (uint id = 1; id <= 25; id++) {
+        ids.append(id);
+    }
+    gNotificationManagerStub->stubSetReturnValue("notificationIds", ids);
+    gNotificationManagerStub->stubSetReturnValue("notificationTimestamp", notification.timestamp().toMSecsSinceEpoch());
+    gNotificationManagerStub->stubSetReturnValue("notification", &notification);
+    NotificationListModel model;
+    QCOMPARE(model.itemCount(), 20);
+
+    // A notification older than the rows not fetched yet is not placed before them
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, 1), QTime(12, 34, 56)));
+    LipstickNotification olderNotification("appName", 26, "appIcon", "summary", "body", QStringList(), hints, 1);
+    gNotificationManagerStub->stubSetReturnValue("notification", &olderNotification);
+    model.updateNotifications(QList<uint>() << 26, QList<uint>());
+    QCOMPARE(model.itemCount(), 20);
+    QCOMPARE(model.rowFor(26), -1);
+
+    // It is placed once the rows before it have been fetched
+    gNotificationManagerStub->stubSetReturnValue("notification", &notification);
+    model.fetchMore(QModelIndex());
+    QCOMPARE(model.itemCount(), 26);
+    QCOMPARE(model.canFetchMore(QModelIndex()), false);
+}
+
 QTEST_MAIN(Ut_NotificationListModel)
@@ -33,7 +33,15 @@ private slots:
     void testNotificationIsNotAddedIfHidden();
     void testAlreadyAddedNotificationIsRemovedIfNoLongerAddable();
     void testNotificationRemoval();
+    void testAdjacentNotificationsAreRemovedTogether();
+    void testBatchIsAppliedRemovalsFirst();
     void testNotificationOrdering();
+    void testNotificationIsMovedDownWhenTimestampDecreases();
+    void testNotificationIsMovedToIndexForPosition();
+    void testSortKeysOfDestroyedNotificationsAreDropped();
+    void testNotificationsWithSameTimestampAreFoundById();
+    void testRowsAreFetchedInBatches();
+    void testNotificationsAfterUnfetchedRowsAreFetchedWithThem();
 };
 
 #endif
@@ -16,17 +16,41 @@
 #include <QtTest/QtTest>
 #include "ut_notificationmanager.h"
 #include "notificationmanager.h"
+#include "notificationlistmodel.h"
+#include "notificationdatabase.h"
+#include "notificationimagestore.h"
+#include "notificationjournal.h"
 #include "notificationmanageradaptor_stub.h"
 #include "categorydefinitionstore_stub.h"
+#include "qmactivity_stub.h"
+#include "systemstate_stub.h"
 #include <QSqlQuery>
 #include <QSqlTableModel>
 #include <QSqlRecord>
 #include <QSqlError>
+#include <QSettings>
+#include <QTemporaryDir>
 #include <mremoteaction.h>
 #include <sys/statfs.h>
 
 const static uint DISK_SPACE_NEEDED = 1024;
 
+static QByteArray serializedData(const QStringList &actions, const QVariantHash &hints)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << actions << hints;
+    return data;
+}
+
+static void deserializeData(const QVariant &data, QStringList &actions, QVariantHash &hints)
+{
+    QDataStream stream(data.toByteArray());
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream >> actions >> hints;
+}
+
 unsigned long diskSpaceAvailableKb;
 bool diskSpaceChecked;
 int statfs (const char *, struct statfs *st)
@@ -92,12 +116,26 @@ bool QSqlDatabase::transaction()
 }
 
 bool qSqlDatabaseCommitCalled = false;
+bool qSqlDatabaseCommitSucceeds = true;
 bool QSqlDatabase::commit()
 {
     qSqlDatabaseCommitCalled = true;
+    return qSqlDatabaseCommitSucceeds;
+}
+
+bool qSqlDatabaseRollbackCalled = false;
+bool QSqlDatabase::rollback()
+{
+    qSqlDatabaseRollbackCalled = true;
     return true;
 }
 
+QStringList qSqlDatabaseRemoveDatabase;
+void QSqlDatabase::removeDatabase(const QString &connectionName)
+{
+    qSqlDatabaseRemoveDatabase << connectionName;
+}
+
 // QSqlQuery stubs
 QStringList qSqlQueryExecQuery = QStringList();
 int qSqlQueryIndex = -1;
@@ -120,8 +158,11 @@ bool QSqlQuery::exec(const QString& query)
     return true;
 }
 
+QStringList qSqlQueryExecPrepared = QStringList();
+QHash<const QSqlQuery *, QString> qSqlQueryPreparedQuery;
 bool QSqlQuery::exec()
 {
+    qSqlQueryExecPrepared << qSqlQueryPreparedQuery.value(this);
     return true;
 }
 
@@ -134,13 +175,14 @@ QStringList qSqlQueryPrepare = QStringList();
 bool QSqlQuery::prepare(const QString& query)
 {
     qSqlQueryPrepare << query;
+    qSqlQueryPreparedQuery.insert(this, query);
     return true;
 }
 
-QVariantList qSqlQueryAddBindValue = QVariantList();
-void QSqlQuery::addBindValue(const QVariant &val, QSql::ParamType)
+QVariantList qSqlQueryBindValue = QVariantList();
+void QSqlQuery::bindValue(int, const QVariant &val, QSql::ParamType)
 {
-    qSqlQueryAddBindValue << val;
+    qSqlQueryBindValue << val;
 }
 
 QHash<QString, int> qSqlRecordIndexOf;
@@ -154,13 +196,11 @@ QSqlRecord QSqlQuery::record() const
         qSqlRecordIndexOf.insert("summary", 3);
         qSqlRecordIndexOf.insert("body", 4);
         qSqlRecordIndexOf.insert("expire_timeout", 5);
-    } else if (qSqlQueryExecQuery.last() == "SELECT * FROM actions") {
-        qSqlRecordIndexOf.insert("id", 0);
-        qSqlRecordIndexOf.insert("action", 1);
-    } else if (qSqlQueryExecQuery.last() == "SELECT * FROM hints") {
-        qSqlRecordIndexOf.insert("id", 0);
-        qSqlRecordIndexOf.insert("hint", 1);
-        qSqlRecordIndexOf.insert("value", 2);
+        qSqlRecordIndexOf.insert("data", 6);
+        qSqlRecordIndexOf.insert("timestamp", 7);
+        qSqlRecordIndexOf.insert("urgency", 8);
+        qSqlRecordIndexOf.insert("category", 9);
+        qSqlRecordIndexOf.insert("expire_at", 10);
     }
     return QSqlRecord();
 }
@@ -205,6 +245,11 @@ int QSqlTableModel::fieldIndex(const QString &fieldName) const
         notificationsTableFieldIndices.insert("summary", 3);
         notificationsTableFieldIndices.insert("body", 4);
         notificationsTableFieldIndices.insert("expire_timeout", 5);
+        notificationsTableFieldIndices.insert("data", 6);
+        notificationsTableFieldIndices.insert("timestamp", 7);
+        notificationsTableFieldIndices.insert("urgency", 8);
+        notificationsTableFieldIndices.insert("category", 9);
+        notificationsTableFieldIndices.insert("expire_at", 10);
 
         actionsTableFieldIndices.insert("id", 0);
         actionsTableFieldIndices.insert("action", 1);
@@ -234,6 +279,13 @@ int QSqlTableModel::fieldIndex(const QString &fieldName) const
     return ret;
 }
 
+// QSettings stubs
+QVariantHash qSettingsValues;
+QVariant QSettings::value(const QString &key, const QVariant &defaultValue) const
+{
+    return qSettingsValues.value(key, defaultValue);
+}
+
 // QTimer stubs
 bool timerStartCalled = false;
 int timerInterval = -1;
@@ -258,12 +310,37 @@ void MRemoteAction::trigger()
     mRemoteActionTrigger.append(toString());
 }
 
+void Ut_NotificationManager::waitForDatabaseOperations(NotificationManager *manager)
+{
+    // Queued database operations are executed in order so a blocking call returns only after all of them have been executed
+    QMetaObject::invokeMethod(manager->database, "commit", Qt::BlockingQueuedConnection);
+}
+
+void Ut_NotificationManager::initTestCase()
+{
+    // Keep the files written by the notification manager in a temporary home directory
+    homeDirectory = new QTemporaryDir;
+    originalHome = qgetenv("HOME");
+    qputenv("HOME", homeDirectory->path().toUtf8());
+}
+
+void Ut_NotificationManager::cleanupTestCase()
+{
+    qputenv("HOME", originalHome);
+    delete homeDirectory;
+}
+
 void Ut_NotificationManager::init()
 {
     qSqlQueryExecQuery.clear();
     qSqlQueryPrepare.clear();
-    qSqlQueryAddBindValue.clear();
+    qSqlQueryPreparedQuery.clear();
+    qSqlQueryExecPrepared.clear();
+    qSqlQueryBindValue.clear();
     qSqlQueryValues.clear();
+    qSqlQueryValues["PRAGMA user_version"].append(QHash<int, QVariant>());
+    qSqlQueryValues["PRAGMA user_version"].first().insert(0, 3);
+    qSettingsValues.clear();
     qSqlDatabaseAddDatabaseType.clear();
     qSqlDatabaseDatabaseName.clear();
     qSqlDatabaseOpenCalledCount = 0;
@@ -273,9 +350,17 @@ void Ut_NotificationManager::init()
     qSqlDatabaseExec.clear();
     qTimerStartInstances.clear();
     qSqlDatabaseCommitCalled = false;
+    qSqlDatabaseCommitSucceeds = true;
+    qSqlDatabaseRollbackCalled = false;
+    qSqlDatabaseRemoveDatabase.clear();
     diskSpaceAvailableKb = DISK_SPACE_NEEDED + 100;
     diskSpaceChecked = true;
     mRemoteActionTrigger.clear();
+    gCategoryDefinitionStoreStub->stubReset();
+    gSystemStateStub->stubReset();
+    gSystemStateStub->stubSetReturnValue("displayState", MeeGo::QmDisplayState::On);
+    gQmActivityStub->stubReset();
+    gQmActivityStub->stubSetReturnValue("get", MeeGo::QmActivity::Active);
 }
 
 void Ut_NotificationManager::cleanup()
@@ -312,24 +397,20 @@ void Ut_NotificationManager::testDatabaseConnectionSucceedsAndTablesAreNotOk()
     notificationsTableFieldIndices.insert("created", 0);
     actionsTableFieldIndices.insert("created", 0);
     hintsTableFieldIndices.insert("created", 0);
-    qSqlQueryValues.clear();
 
-    // Check that the tables are dropped and recreated
+    // Check that the table is dropped and recreated
     NotificationManager::instance();
     QCOMPARE(qSqlDatabaseAddDatabaseType, QString("QSQLITE"));
     QCOMPARE(qSqlDatabaseDatabaseName, QDir::homePath() + "/.config/lipstick/notifications.db");
     QCOMPARE(qSqlDatabaseOpenCalledCount, 1);
-    QCOMPARE(qSqlQueryExecQuery.count(), 10);
+    QCOMPARE(qSqlQueryExecQuery.count(), 6);
     QCOMPARE(qSqlQueryExecQuery.at(0), QString("PRAGMA journal_mode=WAL"));
-    QCOMPARE(qSqlQueryExecQuery.at(1), QString("DROP TABLE notifications"));
-    QCOMPARE(qSqlQueryExecQuery.at(2), QString("CREATE TABLE notifications (id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER)"));
-    QCOMPARE(qSqlQueryExecQuery.at(3), QString("DROP TABLE actions"));
-    QCOMPARE(qSqlQueryExecQuery.at(4), QString("CREATE TABLE actions (id INTEGER, action TEXT, PRIMARY KEY(id, action))"));
-    QCOMPARE(qSqlQueryExecQuery.at(5), QString("DROP TABLE hints"));
-    QCOMPARE(qSqlQueryExecQuery.at(6), QString("CREATE TABLE hints (id INTEGER, hint TEXT, value TEXT, PRIMARY KEY(id, hint))"));
+    QCOMPARE(qSqlQueryExecQuery.at(1), QString("PRAGMA user_version"));
+    QCOMPARE(qSqlQueryExecQuery.at(2), QString("PRAGMA auto_vacuum=INCREMENTAL"));
+    QCOMPARE(qSqlQueryExecQuery.at(3), QString("DROP TABLE notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(4), QString("CREATE TABLE notifications (id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER, data BLOB, timestamp INTEGER, urgency INTEGER, category TEXT, expire_at INTEGER)"));
+    QCOMPARE(qSqlQueryExecQuery.at(5), QString("SELECT * FROM notifications"));
     QCOMPARE((bool)modelToTableName.values().contains("notifications"), true);
-    QCOMPARE((bool)modelToTableName.values().contains("actions"), true);
-    QCOMPARE((bool)modelToTableName.values().contains("hints"), true);
     notificationsTableFieldIndices.clear();
     actionsTableFieldIndices.clear();
     hintsTableFieldIndices.clear();
@@ -345,7 +426,7 @@ void Ut_NotificationManager::testFirstDatabaseConnectionFails()
     // Check that the old database is removed, the database opened twice and the database opened as expected on the second time
     QCOMPARE(qDirRemoveCalled, true);
     QCOMPARE(qSqlDatabaseOpenCalledCount, 2);
-    QCOMPARE(qSqlQueryExecQuery.count(), 4);
+    QCOMPARE(qSqlQueryExecQuery.count(), 3);
 }
 
 void Ut_NotificationManager::testNotEnoughDiskSpaceToOpenDatabase()
@@ -359,7 +440,18 @@ void Ut_NotificationManager::testNotEnoughDiskSpaceToOpenDatabase()
 
 void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
 {
+    qSettingsValues.insert("notifications/lazy_restore", false);
+
     // Make the database return two notifications with different values
+    QHash<uint, QStringList> notificationActionsById;
+    notificationActionsById.insert(1, QStringList() << "action1" << "Action 1");
+    notificationActionsById.insert(2, QStringList() << "action2" << "Action 2");
+    QHash<uint, QVariantHash> notificationHintsById;
+    notificationHintsById[1].insert("hint1-1", "value1-1");
+    notificationHintsById[1].insert("hint1-2", "value1-2");
+    notificationHintsById[2].insert("hint2-1", "value2-1");
+    notificationHintsById[2].insert("hint2-2", "value2-2");
+
     QHash<int, QVariant> notification1Values;
     QHash<int, QVariant> notification2Values;
     notification1Values.insert(0, 1);
@@ -368,12 +460,14 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
     notification1Values.insert(3, "summary1");
     notification1Values.insert(4, "body1");
     notification1Values.insert(5, 1);
+    notification1Values.insert(6, serializedData(notificationActionsById.value(1), notificationHintsById.value(1)));
     notification2Values.insert(0, 2);
     notification2Values.insert(1, "appName2");
     notification2Values.insert(2, "appIcon2");
     notification2Values.insert(3, "summary2");
     notification2Values.insert(4, "body2");
     notification2Values.insert(5, 2);
+    notification2Values.insert(6, serializedData(notificationActionsById.value(2), notificationHintsById.value(2)));
     QList<QHash<int, QVariant> > notificationValues;
     notificationValues << notification1Values << notification2Values;
     qSqlQueryValues["SELECT * FROM notifications"].append(notificationValues);
@@ -381,50 +475,12 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
     notificationValuesById.insert(1, notification1Values);
     notificationValuesById.insert(2, notification2Values);
 
-    QHash<int, QVariant> notification1ActionIdentifier;
-    QHash<int, QVariant> notification1ActionName;
-    QHash<int, QVariant> notification2ActionIdentifier;
-    QHash<int, QVariant> notification2ActionName;
-    notification1ActionIdentifier.insert(0, 1);
-    notification1ActionIdentifier.insert(1, "action1");
-    notification1ActionName.insert(0, 1);
-    notification1ActionName.insert(1, "Action 1");
-    notification2ActionIdentifier.insert(0, 2);
-    notification2ActionIdentifier.insert(1, "action2");
-    notification2ActionName.insert(0, 2);
-    notification2ActionName.insert(1, "Action 2");
-    QList<QHash<int, QVariant> > notificationActions;
-    notificationActions << notification1ActionIdentifier << notification1ActionName << notification2ActionIdentifier << notification2ActionName;
-    qSqlQueryValues["SELECT * FROM actions"].append(notificationActions);
-    QHash<uint, QStringList> notificationActionsById;
-    notificationActionsById.insert(1, QStringList() << "action1" << "Action 1");
-    notificationActionsById.insert(2, QStringList() << "action2" << "Action 2");
-
-    QHash<int, QVariant> notification1Hint1;
-    QHash<int, QVariant> notification1Hint2;
-    QHash<int, QVariant> notification2Hint1;
-    QHash<int, QVariant> notification2Hint2;
-    notification1Hint1.insert(0, 1);
-    notification1Hint1.insert(1, "hint1-1");
-    notification1Hint1.insert(2, "value1-1");
-    notification1Hint2.insert(0, 1);
-    notification1Hint2.insert(1, "hint1-2");
-    notification1Hint2.insert(2, "value1-2");
-    notification2Hint1.insert(0, 2);
-    notification2Hint1.insert(1, "hint2-1");
-    notification2Hint1.insert(2, "value2-1");
-    notification2Hint2.insert(0, 2);
-    notification2Hint2.insert(1, "hint2-2");
-    notification2Hint2.insert(2, "value2-2");
-    QList<QHash<int, QVariant> > notificationHints;
-    notificationHints << notification1Hint1 << notification1Hint2 << notification2Hint1 << notification2Hint2;
-    qSqlQueryValues["SELECT * FROM hints"].append(notificationHints);
-    QHash<uint, QList<QPair<QString, QVariant> > > notificationHintsById;
-    notificationHintsById.insert(1, QList<QPair<QString, QVariant> >() << qMakePair(QString("hint1-1"), QVariant("value1-1")) << qMakePair(QString("hint1-2"), QVariant("value1-2")));
-    notificationHintsById.insert(2, QList<QPair<QString, QVariant> >() << qMakePair(QString("hint2-1"), QVariant("value2-1")) << qMakePair(QString("hint2-2"), QVariant("value2-2")));
-
     // Check that the notifications exist in the manager after construction and contain the expected values
     NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(qSqlQueryExecQuery.count(), 3);
+    QCOMPARE(qSqlQueryExecQuery.at(2), QString("SELECT * FROM notifications"));
+    QCOMPARE(manager->notifications.count(), 2);
+    QCOMPARE(manager->notifications.count(), manager->notificationIds().count());
     QList<uint> ids = manager->notificationIds();
     QCOMPARE(ids.count(), notificationValuesById.count());
     foreach (uint id, notificationValuesById.keys()) {
@@ -436,27 +492,212 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
         QCOMPARE(notification->body(), notificationValuesById.value(id).value(4).toString());
         QCOMPARE(notification->expireTimeout(), notificationValuesById.value(id).value(5).toInt());
         QCOMPARE(notification->actions(), notificationActionsById.value(id));
-
-        typedef QPair<QString, QVariant> HintData;
-        foreach (const HintData &hint, notificationHintsById.value(id)) {
-            QCOMPARE(notification->hints().value(hint.first), hint.second);
-        }
+        QCOMPARE(notification->hints(), notificationHintsById.value(id));
     }
 }
 
+void Ut_NotificationManager::testNotificationsAreMigratedFromOldSchema()
+{
+    // Make the database look like schema version 0 which stored actions and hints in separate tables
+    qSqlQueryValues.clear();
+    QHash<int, QVariant> notificationValues;
+    notificationValues.insert(0, 1);
+    notificationValues.insert(1, "appName1");
+    notificationValues.insert(2, "appIcon1");
+    notificationValues.insert(3, "summary1");
+    notificationValues.insert(4, "body1");
+    notificationValues.insert(5, 1);
+    qSqlQueryValues["SELECT id, app_name, app_icon, summary, body, expire_timeout FROM notifications"].append(notificationValues);
+
+    QHash<int, QVariant> actionIdentifier;
+    QHash<int, QVariant> actionName;
+    actionIdentifier.insert(0, 1);
+    actionIdentifier.insert(1, "action1");
+    actionName.insert(0, 1);
+    actionName.insert(1, "Action 1");
+    qSqlQueryValues["SELECT id, action FROM actions"] << actionIdentifier << actionName;
+
+    QHash<int, QVariant> hint1;
+    QHash<int, QVariant> hint2;
+    hint1.insert(0, 1);
+    hint1.insert(1, "hint1-1");
+    hint1.insert(2, "value1-1");
+    hint2.insert(0, 1);
+    hint2.insert(1, "hint1-2");
+    hint2.insert(2, "value1-2");
+    qSqlQueryValues["SELECT id, hint, value FROM hints"] << hint1 << hint2;
+
+    // Check that the old tables are replaced and the notifications are written back in the new format
+    NotificationManager::instance();
+    QCOMPARE(qSqlQueryExecQuery.count(), 12);
+    QCOMPARE(qSqlQueryExecQuery.at(0), QString("PRAGMA journal_mode=WAL"));
+    QCOMPARE(qSqlQueryExecQuery.at(1), QString("PRAGMA user_version"));
+    QCOMPARE(qSqlQueryExecQuery.at(2), QString("SELECT id, action FROM actions"));
+    QCOMPARE(qSqlQueryExecQuery.at(3), QString("SELECT id, hint, value FROM hints"));
+    QCOMPARE(qSqlQueryExecQuery.at(4), QString("SELECT id, app_name, app_icon, summary, body, expire_timeout FROM notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(5), QString("DROP TABLE actions"));
+    QCOMPARE(qSqlQueryExecQuery.at(6), QString("DROP TABLE hints"));
+    QCOMPARE(qSqlQueryExecQuery.at(7), QString("PRAGMA auto_vacuum=INCREMENTAL"));
+    QCOMPARE(qSqlQueryExecQuery.at(8), QString("DROP TABLE notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(9), QString("CREATE TABLE notifications (id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER, data BLOB, timestamp INTEGER, urgency INTEGER, category TEXT, expire_at INTEGER)"));
+    QCOMPARE(qSqlQueryExecQuery.at(10), QString("PRAGMA user_version=3"));
+    QCOMPARE(qSqlQueryExecQuery.at(11), QString("SELECT * FROM notifications"));
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), (uint)1);
+    QCOMPARE(qSqlQueryBindValue.at(1), QVariant("appName1"));
+    QCOMPARE(qSqlQueryBindValue.at(2), QVariant("appIcon1"));
+    QCOMPARE(qSqlQueryBindValue.at(3), QVariant("summary1"));
+    QCOMPARE(qSqlQueryBindValue.at(4), QVariant("body1"));
+    QCOMPARE(qSqlQueryBindValue.at(5).toInt(), 1);
+    QStringList actions;
+    QVariantHash hints;
+    deserializeData(qSqlQueryBindValue.at(6), actions, hints);
+    QCOMPARE(actions, QStringList() << "action1" << "Action 1");
+    QCOMPARE(hints.count(), 2);
+    QCOMPARE(hints.value("hint1-1"), QVariant("value1-1"));
+    QCOMPARE(hints.value("hint1-2"), QVariant("value1-2"));
+    QCOMPARE(qSqlQueryBindValue.at(7).toLongLong(), (qint64)0);
+    QCOMPARE(qSqlQueryBindValue.at(8).toInt(), 0);
+    QCOMPARE(qSqlQueryBindValue.at(9), QVariant(QString()));
+    QCOMPARE(qSqlQueryBindValue.at(10).toLongLong(), (qint64)0);
+    QCOMPARE(qSqlDatabaseCommitCalled, true);
+}
+
+void Ut_NotificationManager::testNotificationsAreMigratedFromSchemaVersion1()
+{
+    // Make the database look like schema version 1 which had no sort key columns
+    qSqlQueryValues["PRAGMA user_version"].first().insert(0, 1);
+    QVariantHash storedHints;
+    storedHints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime::fromMSecsSinceEpoch(1000));
+    storedHints.insert(NotificationManager::HINT_URGENCY, 2);
+    storedHints.insert(NotificationManager::HINT_CATEGORY, "category");
+    QHash<int, QVariant> notificationValues;
+    notificationValues.insert(0, 1);
+    notificationValues.insert(1, "appName1");
+    notificationValues.insert(2, "appIcon1");
+    notificationValues.insert(3, "summary1");
+    notificationValues.insert(4, "body1");
+    notificationValues.insert(5, 1);
+    notificationValues.insert(6, serializedData(QStringList(), storedHints));
+    qSqlQueryValues["SELECT id, app_name, app_icon, summary, body, expire_timeout, data FROM notifications"].append(notificationValues);
+
+    // Check that the table is recreated and the sort keys are filled in from the hints
+    NotificationManager::instance();
+    QCOMPARE(qSqlQueryExecQuery.count(), 8);
+    QCOMPARE(qSqlQueryExecQuery.at(2), QString("SELECT id, app_name, app_icon, summary, body, expire_timeout, data FROM notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(3), QString("PRAGMA auto_vacuum=INCREMENTAL"));
+    QCOMPARE(qSqlQueryExecQuery.at(4), QString("DROP TABLE notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(6), QString("PRAGMA user_version=3"));
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), (uint)1);
+    QCOMPARE(qSqlQueryBindValue.at(7).toLongLong(), (qint64)1000);
+    QCOMPARE(qSqlQueryBindValue.at(8).toInt(), 2);
+    QCOMPARE(qSqlQueryBindValue.at(9), QVariant("category"));
+    QCOMPARE(qSqlQueryBindValue.at(10).toLongLong(), (qint64)1001);
+}
+
+void Ut_NotificationManager::testNotificationsAreRestoredLazily()
+{
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "category1");
+    QHash<int, QVariant> notification1Values;
+    QHash<int, QVariant> notification2Values;
+    notification1Values.insert(0, 1);
+    notification1Values.insert(1, "appName1");
+    notification1Values.insert(5, 1);
+    notification1Values.insert(6, serializedData(QStringList() << "action1" << "Action 1", hints));
+    notification1Values.insert(9, "category1");
+    notification2Values.insert(0, 5);
+    notification2Values.insert(1, "appName2");
+    notification2Values.insert(5, 1);
+    notification2Values.insert(6, serializedData(QStringList(), QVariantHash()));
+    qSqlQueryValues["SELECT * FROM notifications"] << notification1Values << notification2Values;
+
+    // Check that no notifications are created during construction but the IDs are known
+    NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(manager->notifications.count(), 0);
+    QCOMPARE(manager->notificationIds().count() - manager->notifications.count(), 2);
+    QCOMPARE(manager->notificationIds().count(), 2);
+    QCOMPARE(manager->notificationIds().contains(1), true);
+    QCOMPARE(manager->notificationIds().contains(5), true);
+    QVERIFY(manager->restoreDuration() >= 0);
+
+    // Check that the notifications are indexed without creating them
+    QCOMPARE(manager->notificationIdsForCategory("category1"), QList<uint>() << 1);
+    QCOMPARE(manager->notificationIdsForAppName("appName2"), QList<uint>() << 5);
+    QCOMPARE(manager->notifications.count(), 0);
+
+    // Check that the notification is created on first access
+    LipstickNotification *notification = manager->notification(1);
+    QVERIFY(notification != 0);
+    QCOMPARE(manager->notifications.count(), 1);
+    QCOMPARE(manager->notificationIds().count() - manager->notifications.count(), 1);
+    QCOMPARE(notification->appName(), QString("appName1"));
+    QCOMPARE(notification->actions(), QStringList() << "action1" << "Action 1");
+    QCOMPARE(notification->hints().value(NotificationManager::HINT_CATEGORY), QVariant("category1"));
+    QCOMPARE(manager->notification(1), notification);
+    QCOMPARE(disconnect(notification, SIGNAL(actionInvoked(QString)), manager, SLOT(invokeAction(QString))), true);
+
+    // Check that new notification IDs don't collide with the lazily restored ones
+    uint id = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    QCOMPARE(id, (uint)6);
+
+    // Check that lazily restored notifications can be closed
+    QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
+    manager->CloseNotification(5);
+    QCOMPARE(closedSpy.count(), 1);
+    QCOMPARE(manager->notificationIds().contains(5), false);
+}
+
+void Ut_NotificationManager::testDatabaseOperationsAreDoneInDatabaseThread()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(manager->databaseThread.isRunning(), true);
+    QCOMPARE(manager->database->thread(), &manager->databaseThread);
+    QCOMPARE(disconnect(manager->database, SIGNAL(transactionCommitted()), manager, SLOT(destroyRemovedNotifications())), true);
+}
+
 void Ut_NotificationManager::testDatabaseCommitIsDoneOnDestruction()
 {
+    NotificationManager::instance()->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
     delete NotificationManager::instance();
     NotificationManager::instance_ = 0;
 
     QCOMPARE(qSqlDatabaseCommitCalled, true);
+
+    // The database connection is removed once the database has been destroyed in its thread
+    QCOMPARE(qSqlDatabaseRemoveDatabase, QStringList() << "NotificationDatabase");
+}
+
+void Ut_NotificationManager::testFailedCommitIsRolledBackAndRetried()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    NotificationJournal journal(NotificationDatabase::dataPath() + "/notifications.journal");
+    qSqlDatabaseCommitSucceeds = false;
+    manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    waitForDatabaseOperations(manager);
+
+    // The failed transaction is rolled back and its modifications are kept in the journal
+    QCOMPARE(qSqlDatabaseRollbackCalled, true);
+    QCOMPARE(journal.read().count(), 1);
+
+    // The modifications of the failed transaction are written again along with the next modification
+    qSqlDatabaseCommitSucceeds = true;
+    qSqlQueryExecPrepared.clear();
+    manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 2);
+    QCOMPARE(journal.isEmpty(), true);
 }
 
 void Ut_NotificationManager::testCapabilities()
 {
     // Check the supported capabilities includes all the Nemo hints
     QStringList capabilities = NotificationManager::instance()->GetCapabilities();
-    QCOMPARE(capabilities.count(), 11);
+    QCOMPARE(capabilities.count(), 13);
     QCOMPARE((bool)capabilities.contains("body"), true);
     QCOMPARE((bool)capabilities.contains("actions"), true);
     QCOMPARE((bool)capabilities.contains(NotificationManager::HINT_ICON), true);
@@ -468,6 +709,8 @@ void Ut_NotificationManager::testCapabilities()
     QCOMPARE((bool)capabilities.contains("x-nemo-remote-actions"), true);
     QCOMPARE((bool)capabilities.contains(NotificationManager::HINT_USER_REMOVABLE), true);
     QCOMPARE((bool)capabilities.contains("x-nemo-get-notifications"), true);
+    QCOMPARE((bool)capabilities.contains("x-nemo-notify-batch"), true);
+    QCOMPARE((bool)capabilities.contains("x-nemo-get-notification-changes"), true);
 }
 
 void Ut_NotificationManager::testAddingNotification()
@@ -479,39 +722,27 @@ void Ut_NotificationManager::testAddingNotification()
     QVariantHash hints;
     hints.insert("hint", "value");
     uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList() << "action" << "Action", hints, 1);
+    waitForDatabaseOperations(manager);
     LipstickNotification *notification = manager->notification(id);
     QCOMPARE(disconnect(notification, SIGNAL(actionInvoked(QString)), manager, SLOT(invokeAction(QString))), true);
     QCOMPARE(spy.count(), 1);
     QCOMPARE(spy.last().at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryPrepare.count(), 5);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(1), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(3), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(4), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 16);
-    QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(1), QVariant("appName"));
-    QCOMPARE(qSqlQueryAddBindValue.at(2), QVariant("appIcon"));
-    QCOMPARE(qSqlQueryAddBindValue.at(3), QVariant("summary"));
-    QCOMPARE(qSqlQueryAddBindValue.at(4), QVariant("body"));
-    QCOMPARE(qSqlQueryAddBindValue.at(5).toInt(), 1);
-    QCOMPARE(qSqlQueryAddBindValue.at(6).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(7), QVariant("action"));
-    QCOMPARE(qSqlQueryAddBindValue.at(8).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(9), QVariant("Action"));
-    int hintBase = 10;
-    int timestampHintBase = 13;
-    if (qSqlQueryAddBindValue.at(11) != QVariant("hint")) {
-        hintBase = 13;
-        timestampHintBase = 10;
-    }
-    QCOMPARE(qSqlQueryAddBindValue.at(hintBase).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(hintBase + 1), QVariant("hint"));
-    QCOMPARE(qSqlQueryAddBindValue.at(hintBase + 2), QVariant("value"));
-    QCOMPARE(qSqlQueryAddBindValue.at(timestampHintBase).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(timestampHintBase + 1), QVariant(NotificationManager::HINT_TIMESTAMP));
-    QCOMPARE(qSqlQueryAddBindValue.at(timestampHintBase + 2).type(), QVariant::DateTime);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), id);
+    QCOMPARE(qSqlQueryBindValue.at(1), QVariant("appName"));
+    QCOMPARE(qSqlQueryBindValue.at(2), QVariant("appIcon"));
+    QCOMPARE(qSqlQueryBindValue.at(3), QVariant("summary"));
+    QCOMPARE(qSqlQueryBindValue.at(4), QVariant("body"));
+    QCOMPARE(qSqlQueryBindValue.at(5).toInt(), 1);
+    QStringList storedActions;
+    QVariantHash storedHints;
+    deserializeData(qSqlQueryBindValue.at(6), storedActions, storedHints);
+    QCOMPARE(storedActions, QStringList() << "action" << "Action");
+    QCOMPARE(storedHints.count(), 2);
+    QCOMPARE(storedHints.value("hint"), QVariant("value"));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::DateTime);
     QCOMPARE(notification->appName(), QString("appName"));
     QCOMPARE(notification->appIcon(), QString("appIcon"));
     QCOMPARE(notification->summary(), QString("summary"));
@@ -523,43 +754,142 @@ void Ut_NotificationManager::testAddingNotification()
     QCOMPARE(notification->hints().value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::DateTime);
 }
 
+void Ut_NotificationManager::testStatementsArePreparedOnlyOnce()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(qSqlQueryPrepare.count(), 2);
+    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryPrepare.at(1), QString("DELETE FROM notifications WHERE id=?"));
+
+    // Adding, updating and removing notifications should reuse the prepared statements
+    QVariantHash hints;
+    hints.insert("hint1", "value1");
+    hints.insert("hint2", "value2");
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList() << "action" << "Action", hints, 1);
+    manager->Notify("appName", id, "appIcon", "summary", "body", QStringList() << "action" << "Action", hints, 1);
+    manager->CloseNotification(id);
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryPrepare.count(), 2);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 3);
+}
+
+void Ut_NotificationManager::benchmarkStartup_data()
+{
+    QTest::addColumn<bool>("lazyRestore");
+    QTest::newRow("eager") << false;
+    QTest::newRow("lazy") << true;
+}
+
+void Ut_NotificationManager::benchmarkStartup()
+{
+    QFETCH(bool, lazyRestore);
+
+    qSettingsValues.insert("notifications/lazy_restore", lazyRestore);
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "category");
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime(QDate(2013, 1, 1), QTime(12, 34, 56)));
+    QByteArray data = serializedData(QStringList() << "action" << "Action", hints);
+    for (int i = 1; i <= 1000; i++) {
+        QHash<int, QVariant> values;
+        values.insert(0, i);
+        values.insert(1, "appName");
+        values.insert(2, "appIcon");
+        values.insert(3, "summary");
+        values.insert(4, "body");
+        values.insert(5, 1);
+        values.insert(6, data);
+        values.insert(7, QDateTime(QDate(2013, 1, 1), QTime(12, 34, 56)).toMSecsSinceEpoch() + i);
+        values.insert(9, "category");
+        qSqlQueryValues["SELECT * FROM notifications"].append(values);
+    }
+
+    // Measures the cost of restoring the notifications and populating the notification list from them
+    int notificationCount = 0;
+    QBENCHMARK {
+        NotificationManager *manager = NotificationManager::instance();
+        NotificationListModel model;
+        QMetaObject::invokeMethod(&model, "init");
+        notificationCount = manager->notifications.count();
+        QCOMPARE(manager->notificationIds().count(), 1000);
+        cleanup();
+    }
+
+    // When restoring lazily only the notifications in the first batch of rows are created
+    if (lazyRestore) {
+        QVERIFY(notificationCount <= 20);
+    } else {
+        QCOMPARE(notificationCount, 1000);
+    }
+}
+
+void Ut_NotificationManager::benchmarkNotify_data()
+{
+    QTest::addColumn<int>("hintCount");
+    QTest::newRow("no hints") << 0;
+    QTest::newRow("15 hints") << 15;
+    QTest::newRow("50 hints") << 50;
+}
+
+void Ut_NotificationManager::benchmarkNotify()
+{
+    QFETCH(int, hintCount);
+
+    // Measure the cost without rate limiting so that every update is stored right away
+    qSettingsValues.insert("notifications/rate_limit_burst", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    QVariantHash hints;
+    for (int i = 0; i < hintCount; i++) {
+        hints.insert(QString("hint%1").arg(i), QString("value%1").arg(i));
+    }
+    int preparedCount = qSqlQueryPrepare.count();
+    qSqlQueryExecPrepared.clear();
+
+    // Measures the cost of storing a notification; the statement compilations needed per notification are checked below
+    uint id = 0;
+    int iterations = 0;
+    QBENCHMARK {
+        id = manager->Notify("appName", id, "appIcon", "summary", "body", QStringList() << "action" << "Action", hints, 1);
+        waitForDatabaseOperations(manager);
+        iterations++;
+    }
+
+    // No statements are compiled when notifying and a single row is written per notification regardless of the number of hints
+    QCOMPARE(qSqlQueryPrepare.count() - preparedCount, 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), iterations);
+}
+
 void Ut_NotificationManager::testUpdatingExistingNotification()
 {
     NotificationManager *manager = NotificationManager::instance();
 
     uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
-    qSqlQueryPrepare.clear();
-    qSqlQueryAddBindValue.clear();
+    waitForDatabaseOperations(manager);
+    qSqlQueryExecPrepared.clear();
+    qSqlQueryBindValue.clear();
 
     QSignalSpy spy(manager, SIGNAL(notificationModified(uint)));
     uint newId = manager->Notify("newAppName", id, "newAppIcon", "newSummary", "newBody", QStringList() << "action", QVariantHash(), 2);
+    waitForDatabaseOperations(manager);
     QCOMPARE(newId, id);
     LipstickNotification *notification = manager->notification(id);
     QCOMPARE(disconnect(notification, SIGNAL(actionInvoked(QString)), manager, SLOT(invokeAction(QString))), true);
     QCOMPARE(spy.count(), 1);
     QCOMPARE(spy.last().at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryPrepare.count(), 6);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("DELETE FROM notifications WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(1), QString("DELETE FROM actions WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("DELETE FROM hints WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(3), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(4), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(5), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 14);
-    QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(2).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(3).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(4), QVariant("newAppName"));
-    QCOMPARE(qSqlQueryAddBindValue.at(5), QVariant("newAppIcon"));
-    QCOMPARE(qSqlQueryAddBindValue.at(6), QVariant("newSummary"));
-    QCOMPARE(qSqlQueryAddBindValue.at(7), QVariant("newBody"));
-    QCOMPARE(qSqlQueryAddBindValue.at(8).toInt(), 2);
-    QCOMPARE(qSqlQueryAddBindValue.at(9).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(10), QVariant("action"));
-    QCOMPARE(qSqlQueryAddBindValue.at(11).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(12), QVariant(NotificationManager::HINT_TIMESTAMP));
-    QCOMPARE(qSqlQueryAddBindValue.at(13).type(), QVariant::DateTime);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), id);
+    QCOMPARE(qSqlQueryBindValue.at(1), QVariant("newAppName"));
+    QCOMPARE(qSqlQueryBindValue.at(2), QVariant("newAppIcon"));
+    QCOMPARE(qSqlQueryBindValue.at(3), QVariant("newSummary"));
+    QCOMPARE(qSqlQueryBindValue.at(4), QVariant("newBody"));
+    QCOMPARE(qSqlQueryBindValue.at(5).toInt(), 2);
+    QStringList storedActions;
+    QVariantHash storedHints;
+    deserializeData(qSqlQueryBindValue.at(6), storedActions, storedHints);
+    QCOMPARE(storedActions, QStringList() << "action");
+    QCOMPARE(storedHints.count(), 1);
+    QCOMPARE(storedHints.value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::DateTime);
     QCOMPARE(notification->appName(), QString("newAppName"));
     QCOMPARE(notification->appIcon(), QString("newAppIcon"));
     QCOMPARE(notification->summary(), QString("newSummary"));
@@ -569,39 +899,332 @@ void Ut_NotificationManager::testUpdatingExistingNotification()
     QCOMPARE(notification->hints().value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::DateTime);
 }
 
+void Ut_NotificationManager::testNotificationExpiresAfterTimeout()
+{
+    NotificationManager *manager = NotificationManager::instance();
+
+    // Check that the expiration time is stored and the expiration timer started
+    qint64 before = QDateTime::currentMSecsSinceEpoch();
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1000);
+    qint64 after = QDateTime::currentMSecsSinceEpoch();
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QVERIFY(qSqlQueryBindValue.at(10).toLongLong() >= before + 1000);
+    QVERIFY(qSqlQueryBindValue.at(10).toLongLong() <= after + 1000);
+    QCOMPARE(manager->expirationQueue.count(), 1);
+    QCOMPARE(qTimerStartInstances.contains(&manager->expirationTimer), true);
+    QVERIFY(manager->expirationTimer.interval() > 0);
+    QVERIFY(manager->expirationTimer.interval() <= 1000);
+
+    // Check that the notification is closed as expired once the expiration time has passed
+    manager->setExpirationTime(id, before);
+    QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
+    manager->expireNotifications();
+    QCOMPARE(closedSpy.count(), 1);
+    QCOMPARE(closedSpy.last().at(0).toUInt(), id);
+    QCOMPARE(closedSpy.last().at(1).toInt(), (int)NotificationManager::NotificationExpired);
+    QCOMPARE(manager->expirationQueue.count(), 0);
+    QCOMPARE(manager->expirationTimes.count(), 0);
+}
+
+void Ut_NotificationManager::testNotificationsWithoutTimeoutDoNotExpire()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 0);
+    manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), -1);
+    QCOMPARE(manager->expirationQueue.count(), 0);
+
+    // Check that updating the notification with a timeout makes it expire and updating it again without one cancels the expiration
+    manager->Notify("appName", id, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1000);
+    QCOMPARE(manager->expirationQueue.count(), 1);
+    manager->Notify("appName", id, "appIcon", "summary", "body", QStringList(), QVariantHash(), 0);
+    QCOMPARE(manager->expirationQueue.count(), 0);
+
+    // Check that closing a notification removes its expiration
+    manager->Notify("appName", id, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1000);
+    manager->CloseNotification(id);
+    QCOMPARE(manager->expirationQueue.count(), 0);
+}
+
+void Ut_NotificationManager::testExpiredNotificationsAreClosedAfterRestart()
+{
+    // Make the database return a notification which expired while lipstick was not running and one that expires later
+    QHash<int, QVariant> notification1Values;
+    QHash<int, QVariant> notification2Values;
+    notification1Values.insert(0, 1);
+    notification1Values.insert(5, 1000);
+    notification1Values.insert(10, QDateTime::currentMSecsSinceEpoch() - 1000);
+    notification2Values.insert(0, 2);
+    notification2Values.insert(5, 1000);
+    notification2Values.insert(10, QDateTime::currentMSecsSinceEpoch() + 100000);
+    qSqlQueryValues["SELECT * FROM notifications"] << notification1Values << notification2Values;
+
+    NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(manager->expirationQueue.count(), 2);
+    QCOMPARE(qTimerStartInstances.contains(&manager->expirationTimer), true);
+    QCOMPARE(manager->expirationTimer.interval(), 0);
+
+    // Check that only the expired notification is closed
+    QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
+    manager->expireNotifications();
+    QCOMPARE(closedSpy.count(), 1);
+    QCOMPARE(closedSpy.last().at(0).toUInt(), (uint)1);
+    QCOMPARE(closedSpy.last().at(1).toInt(), (int)NotificationManager::NotificationExpired);
+    QCOMPARE(manager->expirationQueue.count(), 1);
+    QVERIFY(manager->expirationTimer.interval() > 0);
+}
+
+void Ut_NotificationManager::testNotificationsAreIndexedByAppNameAndCategory()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    QVariantHash hints1;
+    hints1.insert(NotificationManager::HINT_CATEGORY, "category1");
+    QVariantHash hints2;
+    hints2.insert(NotificationManager::HINT_CATEGORY, "category2");
+    uint id1 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), hints1, 0);
+    uint id2 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), hints2, 0);
+    uint id3 = manager->Notify("appName2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+
+    QList<uint> ids = manager->notificationIdsForAppName("appName1");
+    QCOMPARE(ids.count(), 2);
+    QCOMPARE(ids.contains(id1), true);
+    QCOMPARE(ids.contains(id2), true);
+    QCOMPARE(manager->notificationIdsForAppName("appName2"), QList<uint>() << id3);
+    QCOMPARE(manager->notificationIdsForAppName("appName3"), QList<uint>());
+    QCOMPARE(manager->notificationIdsForCategory("category1"), QList<uint>() << id1);
+    QCOMPARE(manager->notificationIdsForCategory("category2"), QList<uint>() << id2);
+
+    // Check that updating a notification moves it in the indexes
+    manager->Notify("appName2", id2, QString(), QString(), QString(), QStringList(), hints1, 0);
+    QCOMPARE(manager->notificationIdsForAppName("appName1"), QList<uint>() << id1);
+    QCOMPARE(manager->notificationIdsForAppName("appName2").count(), 2);
+    QCOMPARE(manager->notificationIdsForCategory("category1").count(), 2);
+    QCOMPARE(manager->notificationIdsForCategory("category2"), QList<uint>());
+
+    // Check that closing a notification removes it from the indexes
+    manager->CloseNotification(id1);
+    QCOMPARE(manager->notificationIdsForAppName("appName1"), QList<uint>());
+    QCOMPARE(manager->notificationIdsForCategory("category1"), QList<uint>() << id2);
+}
+
+void Ut_NotificationManager::testNewNotificationsExceedingRateLimitAreDropped()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 2);
+    qSettingsValues.insert("notifications/rate_limit_rate", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    QSignalSpy spy(manager, SIGNAL(notificationModified(uint)));
+
+    // Check that new notifications beyond the burst size are dropped
+    QVERIFY(manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0) != 0);
+    QVERIFY(manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0) != 0);
+    QCOMPARE(manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0), (uint)0);
+    QCOMPARE(manager->droppedNotificationCount(), (uint)1);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(manager->notificationIds().count(), 2);
+
+    // Check that the limit is per application
+    QVERIFY(manager->Notify("appName2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0) != 0);
+    QCOMPARE(manager->droppedNotificationCount(), (uint)1);
+    QCOMPARE(spy.count(), 3);
+}
+
+void Ut_NotificationManager::testUpdatesExceedingRateLimitAreCoalesced()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 1);
+    qSettingsValues.insert("notifications/rate_limit_rate", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 0);
+    waitForDatabaseOperations(manager);
+    qSqlQueryExecPrepared.clear();
+    qSqlQueryBindValue.clear();
+    qTimerStartInstances.clear();
+
+    // Check that updates exceeding the rate limit are not applied, stored or signaled right away
+    QSignalSpy spy(manager, SIGNAL(notificationModified(uint)));
+    QCOMPARE(manager->Notify("appName", id, "appIcon", "summary1", "body", QStringList(), QVariantHash(), 0), id);
+    QCOMPARE(manager->Notify("appName", id, "appIcon", "summary2", "body", QStringList(), QVariantHash(), 0), id);
+    QCOMPARE(manager->Notify("appName", id, "appIcon", "summary3", "body", QStringList(), QVariantHash(), 0), id);
+    waitForDatabaseOperations(manager);
+    QCOMPARE(manager->notification(id)->summary(), QString("summary"));
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 0);
+    QCOMPARE(manager->droppedNotificationCount(), (uint)0);
+    QCOMPARE(manager->coalescedNotificationCount(), (uint)2);
+    QCOMPARE(qTimerStartInstances.contains(&manager->modificationCoalescingTimer), true);
+    QCOMPARE(manager->modificationCoalescingTimer.interval(), 500);
+
+    // Check that the latest of the coalesced updates is applied, stored and signaled once
+    manager->emitPendingModifications();
+    waitForDatabaseOperations(manager);
+    QCOMPARE(manager->notification(id)->summary(), QString("summary3"));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.last().at(0).toUInt(), id);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryBindValue.at(3), QVariant("summary3"));
+
+    // Check that closing a notification discards its pending update
+    manager->Notify("appName", id, "appIcon", "summary4", "body", QStringList(), QVariantHash(), 0);
+    manager->CloseNotification(id);
+    spy.clear();
+    manager->emitPendingModifications();
+    QCOMPARE(spy.count(), 0);
+}
+
+void Ut_NotificationManager::testRefilledRateLimitBucketsAreDropped()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 1);
+    qSettingsValues.insert("notifications/rate_limit_rate", 1000);
+    NotificationManager *manager = NotificationManager::instance();
+
+    // Check that the buckets of the applications that have stopped sending notifications are dropped when new buckets are needed
+    for (int i = 0; i < 64; i++) {
+        manager->Notify(QString("appName%1").arg(i), 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    }
+    QCOMPARE(manager->rateLimitBuckets.count(), 64);
+    QTest::qWait(10);
+    manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    QCOMPARE(manager->rateLimitBuckets.count(), 1);
+    QCOMPARE(manager->rateLimitBuckets.contains("appName"), true);
+}
+
+void Ut_NotificationManager::testRateLimitCanBeSetInCategoryDefinition()
+{
+    // The stubbed category definition store returns "1" for both the burst size and the rate
+    gCategoryDefinitionStoreStub->stubSetReturnValue("contains", true);
+    gCategoryDefinitionStoreStub->stubSetReturnValue("value", QString("1"));
+    NotificationManager *manager = NotificationManager::instance();
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "category");
+
+    QVERIFY(manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), hints, 0) != 0);
+    QCOMPARE(manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), hints, 0), (uint)0);
+    QCOMPARE(manager->droppedNotificationCount(), (uint)1);
+}
+
+void Ut_NotificationManager::testNotificationChangesAreBatched()
+{
+    qRegisterMetaType<QList<uint> >();
+    NotificationManager *manager = NotificationManager::instance();
+    QSignalSpy spy(manager, SIGNAL(notificationsChanged(QList<uint>, QList<uint>)));
+    qTimerStartInstances.clear();
+
+    // Check that changes are collected until the batch timer fires
+    uint id1 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    uint id2 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    uint id3 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->Notify("appName", id1, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->CloseNotification(id3);
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(qTimerStartInstances.contains(&manager->notificationsChangedTimer), true);
+    QCOMPARE(manager->notificationsChangedTimer.interval(), 0);
+
+    // Check that each notification is listed once and removed notifications are not listed as modified
+    manager->emitNotificationsChanged();
+    QCOMPARE(spy.count(), 1);
+    QList<uint> modifiedIds = spy.last().at(0).value<QList<uint> >();
+    QList<uint> removedIds = spy.last().at(1).value<QList<uint> >();
+    QCOMPARE(modifiedIds.count(), 2);
+    QCOMPARE(modifiedIds.contains(id1), true);
+    QCOMPARE(modifiedIds.contains(id2), true);
+    QCOMPARE(removedIds, QList<uint>() << id3);
+
+    // Check that nothing is emitted when there are no changes
+    manager->emitNotificationsChanged();
+    QCOMPARE(spy.count(), 1);
+}
+
+static QVariantHash separatelyAllocatedHints(int index)
+{
+    // Build the hints from separately allocated strings like the D-Bus demarshaller does
+    QVariantHash hints;
+    hints.insert(QString::fromLatin1(NotificationManager::HINT_CATEGORY), QString::fromLatin1("x-nemo.battery"));
+    hints.insert(QString::fromLatin1(NotificationManager::HINT_PREVIEW_SUMMARY), QString("summary%1").arg(index));
+    hints.insert(QString::fromLatin1(NotificationManager::HINT_PREVIEW_BODY), QString("body%1").arg(index));
+    return hints;
+}
+
+void Ut_NotificationManager::testHintKeysAndCategoriesAreShared()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    uint id1 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), separatelyAllocatedHints(1), 0);
+    uint id2 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), separatelyAllocatedHints(2), 0);
+    QVariantHash hints1 = manager->notification(id1)->hints();
+    QVariantHash hints2 = manager->notification(id2)->hints();
+
+    foreach (const QString &key, hints1.keys()) {
+        QCOMPARE(hints2.constFind(key).key().constData(), key.constData());
+    }
+    QCOMPARE(manager->notification(id1)->category().constData(), manager->notification(id2)->category().constData());
+
+    // Other hint values are not shared
+    QVERIFY(hints1.value(NotificationManager::HINT_PREVIEW_BODY) != hints2.value(NotificationManager::HINT_PREVIEW_BODY));
+}
+
+void Ut_NotificationManager::benchmarkHintStringMemory()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    const int notificationCount = 1000;
+    QList<uint> ids;
+    for (int i = 0; i < notificationCount; i++) {
+        ids.append(manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), separatelyAllocatedHints(i), 0));
+    }
+
+    // Sum up the memory used by the hint key and category strings, counting each shared string only once
+    QSet<const QChar *> countedStrings;
+    qint64 copiedBytes = 0;
+    qint64 sharedBytes = 0;
+    foreach (uint id, ids) {
+        LipstickNotification *notification = manager->notification(id);
+        QStringList strings = notification->hints().keys();
+        strings.append(notification->category());
+        foreach (const QString &string, strings) {
+            qint64 bytes = sizeof(QStringData) + (string.size() + 1) * sizeof(QChar);
+            copiedBytes += bytes;
+            if (!countedStrings.contains(string.constData())) {
+                countedStrings.insert(string.constData());
+                sharedBytes += bytes;
+            }
+        }
+    }
+
+    qDebug() << "Hint key and category bytes per notification:" << copiedBytes / notificationCount << "without interning," << sharedBytes / notificationCount << "with interning";
+    QVERIFY(sharedBytes * 10 < copiedBytes);
+    QTest::setBenchmarkResult((qreal)sharedBytes / notificationCount, QTest::BytesAllocated);
+}
+
 void Ut_NotificationManager::testUpdatingInexistingNotification()
 {
     NotificationManager *manager = NotificationManager::instance();
     QSignalSpy spy(manager, SIGNAL(notificationModified(uint)));
     uint id = manager->Notify("appName", 1, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    waitForDatabaseOperations(manager);
     QCOMPARE(id, (uint)0);
     QCOMPARE(spy.count(), 0);
-    QCOMPARE(qSqlQueryPrepare.count(), 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 0);
 }
 
 void Ut_NotificationManager::testRemovingExistingNotification()
 {
     NotificationManager *manager = NotificationManager::instance();
     uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
-    qSqlQueryPrepare.clear();
-    qSqlQueryAddBindValue.clear();
+    waitForDatabaseOperations(manager);
+    qSqlQueryExecPrepared.clear();
+    qSqlQueryBindValue.clear();
 
     QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
     QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
     manager->CloseNotification(id);
+    waitForDatabaseOperations(manager);
     QCOMPARE(removedSpy.count(), 1);
     QCOMPARE(removedSpy.last().at(0).toUInt(), id);
     QCOMPARE(closedSpy.count(), 1);
     QCOMPARE(closedSpy.last().at(0).toUInt(), id);
     QCOMPARE(closedSpy.last().at(1).toInt(), (int)NotificationManager::CloseNotificationCalled);
-    QCOMPARE(qSqlQueryPrepare.count(), 3);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("DELETE FROM notifications WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(1), QString("DELETE FROM actions WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("DELETE FROM hints WHERE id=?"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 3);
-    QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(2).toUInt(), id);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("DELETE FROM notifications WHERE id=?"));
+    QCOMPARE(qSqlQueryBindValue.count(), 1);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), id);
 }
 
 void Ut_NotificationManager::testRemovingInexistingNotification()
@@ -610,9 +1233,10 @@ void Ut_NotificationManager::testRemovingInexistingNotification()
     QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
     QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
     manager->CloseNotification(1);
+    waitForDatabaseOperations(manager);
     QCOMPARE(removedSpy.count(), 0);
     QCOMPARE(closedSpy.count(), 0);
-    QCOMPARE(qSqlQueryPrepare.count(), 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 0);
 }
 
 void Ut_NotificationManager::testServerInformation()
@@ -631,9 +1255,6 @@ void Ut_NotificationManager::testModifyingCategoryDefinitionUpdatesNotifications
 {
     NotificationManager *manager = NotificationManager::instance();
 
-    // Check the signal connection
-    QCOMPARE(disconnect(manager->categoryDefinitionStore, SIGNAL(categoryDefinitionModified(QString)), manager, SLOT(updateNotificationsWithCategory(QString))), true);
-
     // Add two notifications, one with category "category1" and one with category "category2"
     QVariantHash hints1;
     QVariantHash hints2;
@@ -663,9 +1284,6 @@ void Ut_NotificationManager::testUninstallingCategoryDefinitionRemovesNotificati
 {
     NotificationManager *manager = NotificationManager::instance();
 
-    // Check the signal connection
-    QCOMPARE(disconnect(manager->categoryDefinitionStore, SIGNAL(categoryDefinitionUninstalled(QString)), manager, SLOT(removeNotificationsWithCategory(QString))), true);
-
     // Add two notifications, one with category "category1" and one with category "category2"
     QVariantHash hints1;
     QVariantHash hints2;
@@ -683,6 +1301,43 @@ void Ut_NotificationManager::testUninstallingCategoryDefinitionRemovesNotificati
     QCOMPARE(manager->notification(id2), (LipstickNotification *)0);
 }
 
+void Ut_NotificationManager::testCategoryDefinitionChangesAreAppliedAtOnce()
+{
+    NotificationManager *manager = NotificationManager::instance();
+
+    // Check the signal connection
+    QCOMPARE(disconnect(manager->categoryDefinitionStore, SIGNAL(categoryDefinitionsChanged(QStringList, QStringList)), manager, SLOT(applyCategoryDefinitionChanges(QStringList, QStringList))), true);
+
+    // Add notifications in three categories
+    QVariantHash hints1;
+    QVariantHash hints2;
+    QVariantHash hints3;
+    hints1.insert(NotificationManager::HINT_CATEGORY, "category1");
+    hints1.insert(NotificationManager::HINT_PREVIEW_SUMMARY, "previewSummary1");
+    hints2.insert(NotificationManager::HINT_CATEGORY, "category2");
+    hints2.insert(NotificationManager::HINT_PREVIEW_SUMMARY, "previewSummary2");
+    hints3.insert(NotificationManager::HINT_CATEGORY, "category3");
+    hints3.insert(NotificationManager::HINT_PREVIEW_SUMMARY, "previewSummary3");
+    uint id1 = manager->Notify("app1", 0, QString(), QString(), QString(), QStringList(), hints1, 0);
+    uint id2 = manager->Notify("app2", 0, QString(), QString(), QString(), QStringList(), hints2, 0);
+    uint id3 = manager->Notify("app3", 0, QString(), QString(), QString(), QStringList(), hints3, 0);
+    manager->emitNotificationsChanged();
+
+    // Notifications in modified categories are updated and those in uninstalled categories removed
+    qRegisterMetaType<QList<uint> >();
+    QSignalSpy changedSpy(manager, SIGNAL(notificationsChanged(QList<uint>, QList<uint>)));
+    manager->applyCategoryDefinitionChanges(QStringList() << "category1", QStringList() << "category2");
+    QCOMPARE(manager->notification(id1)->hints().contains(NotificationManager::HINT_PREVIEW_SUMMARY), false);
+    QCOMPARE(manager->notification(id2), (LipstickNotification *)0);
+    QCOMPARE(manager->notification(id3)->hints().value(NotificationManager::HINT_PREVIEW_SUMMARY), QVariant("previewSummary3"));
+
+    // All changes are signaled at once
+    manager->emitNotificationsChanged();
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.last().at(0).value<QList<uint> >(), QList<uint>() << id1);
+    QCOMPARE(changedSpy.last().at(1).value<QList<uint> >(), QList<uint>() << id2);
+}
+
 void Ut_NotificationManager::testActionIsInvokedIfDefined()
 {
     // Add two notifications, only the first one with an action named "action1"
@@ -787,24 +1442,29 @@ void Ut_NotificationManager::testInvokingActionRemovesNotificationIfUserRemovabl
     uint id = manager->Notify("app2", 0, QString(), QString(), QString(), QStringList(), hints, 0);
     LipstickNotification *notification = manager->notification(id);
     connect(this, SIGNAL(actionInvoked(QString)), notification, SIGNAL(actionInvoked(QString)));
-    qSqlQueryPrepare.clear();
-    qSqlQueryAddBindValue.clear();
+    waitForDatabaseOperations(manager);
+    qSqlQueryExecPrepared.clear();
+    qSqlQueryBindValue.clear();
 
     // Make the notifications emit the actionInvoked() signal for action "action"; removable notifications should get removed but non-closeable should not be closed
     QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
     QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
     emit actionInvoked("action");
+    waitForDatabaseOperations(manager);
     QCOMPARE(removedSpy.count(), 1);
     QCOMPARE(removedSpy.at(0).at(0).toUInt(), id);
     QCOMPARE(closedSpy.count(), 0);
 
     // Check that the notification was marked hidden
-    QCOMPARE(qSqlQueryPrepare.count(), 1);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 3);
-    QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(1), QVariant(NotificationManager::HINT_HIDDEN));
-    QCOMPARE(qSqlQueryAddBindValue.at(2), QVariant(true));
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryBindValue.count(), 11);
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), id);
+    QStringList storedActions;
+    QVariantHash storedHints;
+    deserializeData(qSqlQueryBindValue.at(6), storedActions, storedHints);
+    QCOMPARE(storedHints.value(NotificationManager::HINT_HIDDEN), QVariant(true));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_USER_REMOVABLE), QVariant(true));
 }
 
 void Ut_NotificationManager::testListingNotifications()
@@ -902,4 +1562,400 @@ void Ut_NotificationManager::testRemoveUserRemovableNotifications()
     QCOMPARE(closedIds.contains(id4), true);
 }
 
+void Ut_NotificationManager::testImageDataIsStoredOutOfLine()
+{
+    // Keep the image store in a temporary home directory
+    QTemporaryDir home;
+    QByteArray originalHome = qgetenv("HOME");
+    qputenv("HOME", home.path().toUtf8());
+    QString imagePath = NotificationDatabase::dataPath() + "/images";
+
+    QByteArray pixels;
+    pixels.append(char(0x10)).append(char(0x20)).append(char(0x30));
+    QByteArray imageData = NotificationImageStore::encode(1, 1, 3, false, 8, 3, pixels);
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_IMAGE_DATA, imageData);
+    hints.insert(NotificationManager::HINT_CATEGORY, "category");
+
+    NotificationManager *manager = NotificationManager::instance();
+    uint id1 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), hints, 0);
+    uint id2 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), hints, 0);
+    waitForDatabaseOperations(manager);
+
+    // Only a reference to the image is kept in the hints and identical images are stored once
+    QVariantHash hints1 = manager->notification(id1)->hints();
+    QCOMPARE(hints1.contains(NotificationManager::HINT_IMAGE_DATA), false);
+    QVERIFY(!hints1.value(NotificationManager::HINT_IMAGE_DATA_KEY).toString().isEmpty());
+    QCOMPARE(manager->notification(id2)->hints().value(NotificationManager::HINT_IMAGE_DATA_KEY), hints1.value(NotificationManager::HINT_IMAGE_DATA_KEY));
+    QCOMPARE(QDir(imagePath).entryList(QDir::Files).count(), 1);
+    QCOMPARE(manager->notificationImage(id1).pixel(0, 0), qRgb(0x10, 0x20, 0x30));
+
+    // Image references sent by clients are not accepted, not even references to existing images
+    QStringList clientKeys;
+    clientKeys << hints1.value(NotificationManager::HINT_IMAGE_DATA_KEY).toString() << "../../../.bashrc" << "0123456789ABCDEF0123456789ABCDEF01234567";
+    foreach (const QString &clientKey, clientKeys) {
+        QVariantHash clientHints;
+        clientHints.insert(NotificationManager::HINT_IMAGE_DATA_KEY, clientKey);
+        uint id3 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), clientHints, 0);
+        QCOMPARE(manager->notification(id3)->hints().contains(NotificationManager::HINT_IMAGE_DATA_KEY), false);
+        QVERIFY(manager->notificationImage(id3).isNull());
+        manager->CloseNotification(id3);
+    }
+
+    // Serialized image data is only stored if it describes a valid image
+    QList<QByteArray> invalidImageData;
+    invalidImageData << imageData.left(imageData.size() - 1) << NotificationImageStore::encode(4097, 1, 12291, false, 8, 3, QByteArray(12291, 0)) << QByteArray("image");
+    foreach (const QByteArray &data, invalidImageData) {
+        QVariantHash invalidHints;
+        invalidHints.insert(NotificationManager::HINT_IMAGE_DATA, data);
+        uint id3 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), invalidHints, 0);
+        QCOMPARE(manager->notification(id3)->hints().contains(NotificationManager::HINT_IMAGE_DATA_KEY), false);
+        manager->CloseNotification(id3);
+    }
+    waitForDatabaseOperations(manager);
+    QCOMPARE(QDir(imagePath).entryList(QDir::Files).count(), 1);
+
+    // Category definition changes keep the image
+    manager->updateNotificationsWithCategory("category");
+    QCOMPARE(manager->notification(id1)->hints().value(NotificationManager::HINT_IMAGE_DATA_KEY), hints1.value(NotificationManager::HINT_IMAGE_DATA_KEY));
+
+    // The image is removed when the last notification referencing it is closed
+    manager->CloseNotification(id1);
+    waitForDatabaseOperations(manager);
+    QCOMPARE(QDir(imagePath).entryList(QDir::Files).count(), 1);
+    manager->CloseNotification(id2);
+    waitForDatabaseOperations(manager);
+    QCOMPARE(QDir(imagePath).entryList(QDir::Files).count(), 0);
+
+    qputenv("HOME", originalHome);
+}
+
+static void setPragmaValue(const QString &pragma, const QList<int> &values)
+{
+    QHash<int, QVariant> row;
+    for (int column = 0; column < values.count(); column++) {
+        row.insert(column, values.at(column));
+    }
+    qSqlQueryValues["PRAGMA " + pragma].clear();
+    qSqlQueryValues["PRAGMA " + pragma].append(row);
+}
+
+void Ut_NotificationManager::testDatabaseMaintenanceIsScheduledWhenDeviceIsIdle()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    QCOMPARE(disconnect(SystemState::instance(), SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), manager, SLOT(scheduleDatabaseMaintenance())), true);
+    QCOMPARE(disconnect(manager->activity, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)), manager, SLOT(scheduleDatabaseMaintenance())), true);
+
+    // No maintenance while the display is on or the device is in use
+    qTimerStartInstances.clear();
+    gSystemStateStub->stubSetReturnValue("displayState", MeeGo::QmDisplayState::Off);
+    manager->scheduleDatabaseMaintenance();
+    QCOMPARE(qTimerStartInstances.contains(&manager->databaseMaintenanceTimer), false);
+
+    gQmActivityStub->stubSetReturnValue("get", MeeGo::QmActivity::Inactive);
+    manager->scheduleDatabaseMaintenance();
+    QCOMPARE(qTimerStartInstances.contains(&manager->databaseMaintenanceTimer), true);
+
+    manager->performDatabaseMaintenance();
+    waitForDatabaseOperations(manager);
+    QCOMPARE(manager->databaseStatistics().value("maintenanceCount").toInt(), 1);
+
+    // The maintenance is not repeated until the maintenance interval has passed
+    qTimerStartInstances.clear();
+    manager->scheduleDatabaseMaintenance();
+    QCOMPARE(qTimerStartInstances.contains(&manager->databaseMaintenanceTimer), false);
+}
+
+void Ut_NotificationManager::testDatabaseIsCheckpointedAndVacuumedWithinBudget()
+{
+    setPragmaValue("wal_checkpoint(PASSIVE)", QList<int>() << 0 << 10 << 10);
+    setPragmaValue("page_size", QList<int>() << 4096);
+    setPragmaValue("page_count", QList<int>() << 1000);
+    setPragmaValue("freelist_count", QList<int>() << 100);
+    setPragmaValue("auto_vacuum", QList<int>() << 2);
+    qSettingsValues.insert("notifications/maintenance_time_budget", 10000);
+    qSettingsValues.insert("notifications/maintenance_size_budget", 40 * 4096);
+    gSystemStateStub->stubSetReturnValue("displayState", MeeGo::QmDisplayState::Off);
+    gQmActivityStub->stubSetReturnValue("get", MeeGo::QmActivity::Inactive);
+
+    NotificationManager *manager = NotificationManager::instance();
+    qSqlQueryExecQuery.clear();
+    manager->performDatabaseMaintenance();
+    waitForDatabaseOperations(manager);
+
+    // The write-ahead log is truncated once it has been checkpointed completely
+    QCOMPARE(qSqlQueryExecQuery.contains("PRAGMA wal_checkpoint(TRUNCATE)"), true);
+
+    // Free pages are released in steps up to the size budget
+    QCOMPARE(qSqlQueryExecQuery.count("PRAGMA incremental_vacuum(32)"), 1);
+    QCOMPARE(qSqlQueryExecQuery.count("PRAGMA incremental_vacuum(8)"), 1);
+    QCOMPARE(qSqlQueryExecQuery.contains("VACUUM"), false);
+
+    // The statistics are refreshed after the maintenance
+    QVariantMap statistics = manager->databaseStatistics();
+    QCOMPARE(statistics.value("pageSize").toInt(), 4096);
+    QCOMPARE(statistics.value("pageCount").toInt(), 1000);
+    QCOMPARE(statistics.value("freePageCount").toInt(), 100);
+    QCOMPARE(statistics.value("fragmentation").toDouble(), 0.1);
+    QCOMPARE(statistics.value("maintenanceCount").toInt(), 1);
+}
+
+void Ut_NotificationManager::testLegacyDatabaseIsFullyVacuumedOnce()
+{
+    setPragmaValue("wal_checkpoint(PASSIVE)", QList<int>() << 1 << 10 << 5);
+    setPragmaValue("page_size", QList<int>() << 4096);
+    setPragmaValue("page_count", QList<int>() << 1000);
+    setPragmaValue("freelist_count", QList<int>() << 0);
+    setPragmaValue("auto_vacuum", QList<int>() << 0);
+    qSettingsValues.insert("notifications/maintenance_size_budget", 100 * 4096);
+    gSystemStateStub->stubSetReturnValue("displayState", MeeGo::QmDisplayState::Off);
+    gQmActivityStub->stubSetReturnValue("get", MeeGo::QmActivity::Inactive);
+
+    NotificationManager *manager = NotificationManager::instance();
+    qSqlQueryExecQuery.clear();
+    manager->performDatabaseMaintenance();
+    waitForDatabaseOperations(manager);
+
+    // The write-ahead log is not truncated while a reader blocks the checkpoint
+    QCOMPARE(qSqlQueryExecQuery.contains("PRAGMA wal_checkpoint(TRUNCATE)"), false);
+
+    // A database without incremental vacuuming is rebuilt even if it is larger than the size budget
+    QCOMPARE(qSqlQueryExecQuery.contains("PRAGMA auto_vacuum=INCREMENTAL"), true);
+    QCOMPARE(qSqlQueryExecQuery.contains("VACUUM"), true);
+
+    // Once incremental vacuuming is enabled the database is not rebuilt again
+    setPragmaValue("auto_vacuum", QList<int>() << 2);
+    qSqlQueryExecQuery.clear();
+    manager->performDatabaseMaintenance();
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryExecQuery.contains("PRAGMA auto_vacuum=INCREMENTAL"), false);
+    QCOMPARE(qSqlQueryExecQuery.contains("VACUUM"), false);
+}
+
+void Ut_NotificationManager::testModificationsAreJournaledUntilCommitted()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    NotificationJournal journal(NotificationDatabase::dataPath() + "/notifications.journal");
+    uint id = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->CloseNotification(id);
+
+    // Wait for the queued database operations without committing them
+    QMetaObject::invokeMethod(manager->database, "syncJournal", Qt::BlockingQueuedConnection);
+    QList<NotificationJournal::Entry> entries = journal.read();
+    QCOMPARE(entries.count(), 2);
+    QCOMPARE(entries.at(0).operation, NotificationJournal::StoreNotification);
+    QCOMPARE(entries.at(0).record.id, id);
+    QCOMPARE(entries.at(0).record.appName, QString("appName"));
+    QCOMPARE(entries.at(1).operation, NotificationJournal::RemoveNotification);
+    QCOMPARE(entries.at(1).record.id, id);
+
+    // The journal is cleared once the modifications have been committed
+    waitForDatabaseOperations(manager);
+    QCOMPARE(journal.isEmpty(), true);
+}
+
+void Ut_NotificationManager::testJournalIsReplayedOnRestore()
+{
+    // Leave modifications in the journal as if lipstick had crashed before committing them
+    QDir::root().mkpath(NotificationDatabase::dataPath());
+    NotificationJournal journal(NotificationDatabase::dataPath() + "/notifications.journal");
+    NotificationDatabase::Record record;
+    record.id = 1;
+    record.appName = "appName";
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_URGENCY, 2);
+    QDataStream stream(&record.data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << QStringList() << hints;
+    journal.appendStore(record);
+    journal.appendRemove(2);
+
+    NotificationManager::instance();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 2);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT OR REPLACE INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryExecPrepared.at(1), QString("DELETE FROM notifications WHERE id=?"));
+    QCOMPARE(qSqlQueryBindValue.at(0).toUInt(), (uint)1);
+    QCOMPARE(qSqlQueryBindValue.at(1), QVariant("appName"));
+    QCOMPARE(qSqlQueryBindValue.at(6), QVariant(record.data));
+    QCOMPARE(qSqlQueryBindValue.at(8), QVariant(2));
+    QCOMPARE(qSqlQueryBindValue.at(11).toUInt(), (uint)2);
+    QCOMPARE(qSqlDatabaseCommitCalled, true);
+    QCOMPARE(journal.isEmpty(), true);
+}
+
+void Ut_NotificationManager::testNotificationsCanBeAddedAndClosedInBatches()
+{
+    qRegisterMetaType<QList<uint> >();
+    NotificationManager *manager = NotificationManager::instance();
+    uint existingId = manager->Notify("appName", 0, QString(), "summary", QString(), QStringList(), QVariantHash(), 0);
+    manager->emitNotificationsChanged();
+    QSignalSpy spy(manager, SIGNAL(notificationsChanged(QList<uint>, QList<uint>)));
+    qSqlQueryExecPrepared.clear();
+
+    // New notifications are added and existing ones replaced; notifications which don't exist can't be replaced
+    QList<NotificationData> notifications;
+    notifications.append(NotificationData("appName1", 0, "appIcon1", "summary1", "body1", QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName2", existingId, "appIcon2", "summary2", "body2", QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName3", 12345, "appIcon3", "summary3", "body3", QStringList(), QVariantHash(), 0));
+    QList<uint> ids = manager->NotifyBatch(NotificationList(notifications));
+    QCOMPARE(ids.count(), 3);
+    QVERIFY(ids.at(0) != 0);
+    QCOMPARE(ids.at(1), existingId);
+    QCOMPARE(ids.at(2), (uint)0);
+    QCOMPARE(manager->notification(ids.at(0))->summary(), QString("summary1"));
+    QCOMPARE(manager->notification(existingId)->summary(), QString("summary2"));
+
+    // The whole batch is signaled at once
+    manager->emitNotificationsChanged();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.last().at(0).value<QList<uint> >().toSet(), QSet<uint>() << ids.at(0) << existingId);
+
+    manager->CloseNotifications(QList<uint>() << ids.at(0) << existingId << 12345);
+    QCOMPARE(manager->notificationIds().count(), 0);
+    manager->emitNotificationsChanged();
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.last().at(1).value<QList<uint> >().toSet(), QSet<uint>() << ids.at(0) << existingId);
+
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 4);
+}
+
+void Ut_NotificationManager::testBatchIsChargedPerApplicationAgainstRateLimit()
+{
+    qRegisterMetaType<QList<uint> >();
+    qSettingsValues.insert("notifications/rate_limit_burst", 3);
+    qSettingsValues.insert("notifications/rate_limit_rate", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    uint existingId = manager->Notify("appName1", 0, QString(), "summary", QString(), QStringList(), QVariantHash(), 0);
+    manager->emitNotificationsChanged();
+    QSignalSpy modifiedSpy(manager, SIGNAL(notificationModified(uint)));
+    QSignalSpy changedSpy(manager, SIGNAL(notificationsChanged(QList<uint>, QList<uint>)));
+    waitForDatabaseOperations(manager);
+    qSqlQueryExecPrepared.clear();
+
+    // Check that each notification of a mixed batch takes a token from the bucket of its own application
+    QList<NotificationData> notifications;
+    notifications.append(NotificationData("appName1", 0, QString(), "summary1", QString(), QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName2", 0, QString(), "summary2", QString(), QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName1", 0, QString(), "summary3", QString(), QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName1", 0, QString(), "summary4", QString(), QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName2", 0, QString(), "summary5", QString(), QStringList(), QVariantHash(), 0));
+    notifications.append(NotificationData("appName1", existingId, QString(), "modified", QString(), QStringList(), QVariantHash(), 0));
+    QList<uint> ids = manager->NotifyBatch(NotificationList(notifications));
+    QCOMPARE(ids.count(), 6);
+    QVERIFY(ids.at(0) != 0);
+    QVERIFY(ids.at(1) != 0);
+    QVERIFY(ids.at(2) != 0);
+    QCOMPARE(ids.at(3), (uint)0);
+    QVERIFY(ids.at(4) != 0);
+    QCOMPARE(ids.at(5), existingId);
+    QCOMPARE(manager->droppedNotificationCount(), (uint)1);
+
+    // Check that an update exceeding the rate limit of its application is deferred
+    QCOMPARE(manager->notification(existingId)->summary(), QString("summary"));
+
+    // Check that the notifications within the rate limit are stored at once and signaled only in a single change batch
+    waitForDatabaseOperations(manager);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 4);
+    QCOMPARE(modifiedSpy.count(), 0);
+    manager->emitNotificationsChanged();
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.last().at(0).value<QList<uint> >().toSet(), QSet<uint>() << ids.at(0) << ids.at(1) << ids.at(2) << ids.at(4));
+
+    // Check that the second application still has a token left and the first one doesn't
+    QVERIFY(manager->Notify("appName2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0) != 0);
+    QCOMPARE(manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0), (uint)0);
+}
+
+void Ut_NotificationManager::testBatchSizeIsLimited()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 0);
+    NotificationManager *manager = NotificationManager::instance();
+
+    // Notifications beyond the maximum batch size of 100 are not added
+    QList<NotificationData> notifications;
+    for (int i = 0; i < 101; i++) {
+        notifications.append(NotificationData("appName", 0, QString(), QString("summary%1").arg(i), QString(), QStringList(), QVariantHash(), 0));
+    }
+    QList<uint> ids = manager->NotifyBatch(NotificationList(notifications));
+    QCOMPARE(ids.count(), 101);
+    QCOMPARE(ids.mid(0, 100).contains(0), false);
+    QCOMPARE(ids.last(), (uint)0);
+    QCOMPARE(manager->notificationIds().count(), 100);
+}
+
+static QList<uint> notificationIds(const NotificationList &notificationList)
+{
+    QList<uint> ids;
+    foreach (const NotificationData &data, notificationList.data()) {
+        ids.append(data.replacesId);
+    }
+    return ids;
+}
+
+void Ut_NotificationManager::testNotificationChangesSinceSequence()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    uint id1 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    uint id2 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    uint id3 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->Notify("appName2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    quint64 since = manager->changeSequence();
+
+    // Only the notifications of the application changed since the given sequence are returned
+    manager->Notify("appName1", id2, QString(), "modified", QString(), QStringList(), QVariantHash(), 0);
+    manager->CloseNotification(id3);
+    uint id4 = manager->Notify("appName1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->Notify("appName2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+
+    QList<uint> removedIds;
+    quint64 sequence = 0;
+    bool reset = true;
+    NotificationList changes = manager->GetNotificationChanges("appName1", since, removedIds, sequence, reset);
+    QCOMPARE(reset, false);
+    QCOMPARE(sequence, manager->changeSequence());
+    QVERIFY(sequence > since);
+    QCOMPARE(notificationIds(changes), QList<uint>() << id2 << id4);
+    QCOMPARE(changes.data().first().summary, QString("modified"));
+    QCOMPARE(removedIds, QList<uint>() << id3);
+
+    // Nothing is returned when nothing has changed
+    changes = manager->GetNotificationChanges("appName1", sequence, removedIds, sequence, reset);
+    QCOMPARE(reset, false);
+    QCOMPARE(changes.data().count(), 0);
+    QCOMPARE(removedIds.count(), 0);
+
+    // A notification modified several times is returned once
+    manager->Notify("appName1", id1, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    manager->Notify("appName1", id1, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    changes = manager->GetNotificationChanges("appName1", sequence, removedIds, sequence, reset);
+    QCOMPARE(notificationIds(changes), QList<uint>() << id1);
+}
+
+void Ut_NotificationManager::testAllNotificationsAreReturnedWhenChangesAreNotKnown()
+{
+    qSettingsValues.insert("notifications/rate_limit_burst", 0);
+    NotificationManager *manager = NotificationManager::instance();
+    uint id1 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+    uint id2 = manager->Notify("appName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0);
+
+    // Sequences from before the notification manager was created are not known
+    QList<uint> removedIds;
+    quint64 sequence = 0;
+    bool reset = false;
+    NotificationList changes = manager->GetNotificationChanges("appName", 0, removedIds, sequence, reset);
+    QCOMPARE(reset, true);
+    QCOMPARE(notificationIds(changes).toSet(), QSet<uint>() << id1 << id2);
+
+    // Closings are only remembered up to a limit
+    quint64 since = manager->changeSequence();
+    for (int i = 0; i < 1001; i++) {
+        manager->CloseNotification(manager->Notify("otherAppName", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 0));
+    }
+    changes = manager->GetNotificationChanges("appName", since, removedIds, sequence, reset);
+    QCOMPARE(reset, true);
+    QCOMPARE(notificationIds(changes).toSet(), QSet<uint>() << id1 << id2);
+    QCOMPARE(removedIds.count(), 0);
+}
+
 QTEST_MAIN(Ut_NotificationManager)
@@ -17,11 +17,16 @@
 
 #include <QObject>
 
+class NotificationManager;
+class QTemporaryDir;
+
 class Ut_NotificationManager : public QObject
 {
     Q_OBJECT
 
 private slots:
+    void initTestCase();
+    void cleanupTestCase();
     void init();
     void cleanup();
     void testManagerIsSingleton();
@@ -30,16 +35,49 @@ private slots:
     void testFirstDatabaseConnectionFails();
     void testNotEnoughDiskSpaceToOpenDatabase();
     void testNotificationsAreRestoredOnConstruction();
+    void testNotificationsAreMigratedFromOldSchema();
+    void testNotificationsAreMigratedFromSchemaVersion1();
+    void testNotificationsAreRestoredLazily();
+    void testDatabaseOperationsAreDoneInDatabaseThread();
     void testDatabaseCommitIsDoneOnDestruction();
+    void testFailedCommitIsRolledBackAndRetried();
     void testCapabilities();
     void testAddingNotification();
+    void testStatementsArePreparedOnlyOnce();
+    void benchmarkStartup_data();
+    void benchmarkStartup();
+    void benchmarkNotify_data();
+    void benchmarkNotify();
     void testUpdatingExistingNotification();
+    void testNotificationExpiresAfterTimeout();
+    void testNotificationsWithoutTimeoutDoNotExpire();
+    void testExpiredNotificationsAreClosedAfterRestart();
+    void testNotificationsAreIndexedByAppNameAndCategory();
+    void testNewNotificationsExceedingRateLimitAreDropped();
+    void testUpdatesExceedingRateLimitAreCoalesced();
+    void testRefilledRateLimitBucketsAreDropped();
+    void testRateLimitCanBeSetInCategoryDefinition();
+    void testNotificationChangesAreBatched();
+    void testHintKeysAndCategoriesAreShared();
+    void benchmarkHintStringMemory();
+    void testImageDataIsStoredOutOfLine();
+    void testDatabaseMaintenanceIsScheduledWhenDeviceIsIdle();
+    void testDatabaseIsCheckpointedAndVacuumedWithinBudget();
+    void testLegacyDatabaseIsFullyVacuumedOnce();
+    void testModificationsAreJournaledUntilCommitted();
+    void testJournalIsReplayedOnRestore();
+    void testNotificationsCanBeAddedAndClosedInBatches();
+    void testBatchIsChargedPerApplicationAgainstRateLimit();
+    void testBatchSizeIsLimited();
+    void testNotificationChangesSinceSequence();
+    void testAllNotificationsAreReturnedWhenChangesAreNotKnown();
     void testUpdatingInexistingNotification();
     void testRemovingExistingNotification();
     void testRemovingInexistingNotification();
     void testServerInformation();
     void testModifyingCategoryDefinitionUpdatesNotifications();
     void testUninstallingCategoryDefinitionRemovesNotifications();
+    void testCategoryDefinitionChangesAreAppliedAtOnce();
     void testActionIsInvokedIfDefined();
     void testActionIsNotInvokedIfIncomplete();
     void testRemoteActionIsInvokedIfDefined();
@@ -50,6 +88,12 @@ private slots:
 
 signals:
     void actionInvoked(QString action);
+
+private:
+    void waitForDatabaseOperations(NotificationManager *manager);
+
+    QTemporaryDir *homeDirectory;
+    QByteArray originalHome;
 };
 
 #endif
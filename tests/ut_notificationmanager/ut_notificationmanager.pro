@@ -1,6 +1,6 @@
 include(../common.pri)
 TARGET = ut_notificationmanager
-INCLUDEPATH += $$NOTIFICATIONSRCDIR
+INCLUDEPATH += $$NOTIFICATIONSRCDIR $$UTILITYSRCDIR /usr/include/qmsystem2-qt5
 CONFIG += link_pkgconfig
 QT += sql dbus
 PKGCONFIG += mlite5
@@ -9,14 +9,32 @@ PKGCONFIG += mlite5
 SOURCES += \
     ut_notificationmanager.cpp \
     $$NOTIFICATIONSRCDIR/notificationmanager.cpp \
+    $$NOTIFICATIONSRCDIR/categorydefinitioncache.cpp \
+    $$NOTIFICATIONSRCDIR/notificationdatabase.cpp \
+    $$NOTIFICATIONSRCDIR/notificationidallocator.cpp \
+    $$NOTIFICATIONSRCDIR/notificationimagestore.cpp \
+    $$NOTIFICATIONSRCDIR/notificationjournal.cpp \
+    $$NOTIFICATIONSRCDIR/notificationlistmodel.cpp \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.cpp \
     $$NOTIFICATIONSRCDIR/lipsticknotification.cpp \
+    $$UTILITYSRCDIR/qobjectlistmodel.cpp \
     $$STUBSDIR/stubbase.cpp \
 
 # unit test and unit
 HEADERS += \
     ut_notificationmanager.h \
     $$NOTIFICATIONSRCDIR/notificationmanager.h \
+    $$NOTIFICATIONSRCDIR/notificationdatabase.h \
+    $$NOTIFICATIONSRCDIR/notificationidallocator.h \
+    $$NOTIFICATIONSRCDIR/notificationimagestore.h \
+    $$NOTIFICATIONSRCDIR/notificationjournal.h \
+    $$NOTIFICATIONSRCDIR/notificationlistmodel.h \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.h \
     $$NOTIFICATIONSRCDIR/lipsticknotification.h \
+    $$UTILITYSRCDIR/qobjectlistmodel.h \
     $$NOTIFICATIONSRCDIR/notificationmanageradaptor.h \
-    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h
+    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h \
+    $$NOTIFICATIONSRCDIR/categorydefinitioncache.h \
+    /usr/include/qmsystem2-qt5/qmactivity.h \
+    $$SRCDIR/systemstate.h
 
@@ -22,8 +22,7 @@
 #include "notificationpreviewpresenter.h"
 #include "lipstickcompositor_stub.h"
 #include "closeeventeater_stub.h"
-#include "qmlocks_stub.h"
-#include "qmdisplaystate_stub.h"
+#include "systemstate_stub.h"
 
 Q_DECLARE_METATYPE(NotificationPreviewPresenter*)
 Q_DECLARE_METATYPE(LipstickNotification*)
@@ -81,6 +80,10 @@ void HomeWindow::setGeometry(const QRect &)
 {
 }
 
+void HomeWindow::createRootObject()
+{
+}
+
 QHash<HomeWindow *, QString> homeWindowCategories;
 
 void HomeWindow::setCategory(const QString &category)
@@ -99,6 +102,8 @@ const char *NotificationManager::HINT_PREVIEW_BODY = "x-nemo-preview-body";
 const char *NotificationManager::HINT_PREVIEW_SUMMARY = "x-nemo-preview-summary";
 const char *NotificationManager::HINT_HIDDEN = "x-nemo-hidden";
 const char *NotificationManager::HINT_USER_REMOVABLE = "x-nemo-user-removable";
+const char *NotificationManager::HINT_FEEDBACK = "x-nemo-feedback";
+const char *NotificationManager::HINT_DISPLAY_ON = "x-nemo-display-on";
 
 NotificationManager::NotificationManager(QObject *parent) : QObject(parent)
 {
@@ -120,7 +125,31 @@ void NotificationManager::updateNotificationsWithCategory(const QString &)
 {
 }
 
-void NotificationManager::commit()
+void NotificationManager::applyCategoryDefinitionChanges(const QStringList &, const QStringList &)
+{
+}
+
+void NotificationManager::destroyRemovedNotifications()
+{
+}
+
+void NotificationManager::expireNotifications()
+{
+}
+
+void NotificationManager::emitPendingModifications()
+{
+}
+
+void NotificationManager::emitNotificationsChanged()
+{
+}
+
+void NotificationManager::scheduleDatabaseMaintenance()
+{
+}
+
+void NotificationManager::performDatabaseMaintenance()
 {
 }
 
@@ -140,7 +169,7 @@ NotificationManager *NotificationManager::instance()
 }
 
 QHash<uint, LipstickNotification *> notificationManagerNotification;
-LipstickNotification *NotificationManager::notification(uint id) const
+LipstickNotification *NotificationManager::notification(uint id)
 {
     return notificationManagerNotification.value(id);
 }
@@ -149,24 +178,22 @@ void NotificationManager::removeUserRemovableNotifications()
 {
 }
 
-LipstickNotification *createNotification(uint id, int urgency = 0)
+LipstickNotification *createNotification(uint id, int urgency = 0, int priority = 0, const QString &category = QString())
 {
     LipstickNotification *notification = new LipstickNotification;
     QVariantHash hints;
     hints.insert(NotificationManager::HINT_PREVIEW_SUMMARY, "summary");
     hints.insert(NotificationManager::HINT_PREVIEW_BODY, "body");
     hints.insert(NotificationManager::HINT_URGENCY, urgency);
+    hints.insert(NotificationManager::HINT_PRIORITY, priority);
+    if (!category.isEmpty()) {
+        hints.insert(NotificationManager::HINT_CATEGORY, category);
+    }
     notification->setHints(hints);
     notificationManagerNotification.insert(id, notification);
     return notification;
 }
 
-QVariantMap qWaylandSurfaceWindowProperties;
-QVariantMap QWaylandSurface::windowProperties() const
-{
-    return qWaylandSurfaceWindowProperties;
-}
-
 void Ut_NotificationPreviewPresenter::initTestCase()
 {
     qRegisterMetaType<LipstickNotification *>();
@@ -181,17 +208,30 @@ void Ut_NotificationPreviewPresenter::cleanup()
     qDeleteAll(notificationManagerNotification);
     notificationManagerNotification.clear();
     notificationManagerCloseNotificationIds.clear();
-    gQmLocksStub->stubReset();
-    gQmDisplayStateStub->stubReset();
+    gSystemStateStub->stubReset();
 }
 
 void Ut_NotificationPreviewPresenter::testSignalConnections()
 {
     NotificationPreviewPresenter presenter;
-    QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationModified(uint)), &presenter, SLOT(updateNotification(uint))), true);
+    QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationsChanged(QList<uint>, QList<uint>)), &presenter, SLOT(updateNotifications(QList<uint>, QList<uint>))), true);
     QCOMPARE(disconnect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), &presenter, SLOT(removeNotification(uint))), true);
 }
 
+void Ut_NotificationPreviewPresenter::testModifiedNotificationsOfBatchAreUpdated()
+{
+    NotificationPreviewPresenter presenter;
+    QSignalSpy presentedSpy(&presenter, SIGNAL(notificationPresented(uint)));
+
+    // Check that the modified notifications of a batch are updated and the removed ones are left to removeNotification()
+    createNotification(1);
+    createNotification(2);
+    presenter.updateNotifications(QList<uint>() << 1, QList<uint>() << 2);
+    QCOMPARE(homeWindows.count(), 1);
+    QCOMPARE(presentedSpy.count(), 1);
+    QCOMPARE(presentedSpy.last().at(0).toUInt(), (uint)1);
+}
+
 void Ut_NotificationPreviewPresenter::testAddNotificationWhenWindowNotOpen()
 {
     NotificationPreviewPresenter presenter;
@@ -222,6 +262,24 @@ void Ut_NotificationPreviewPresenter::testAddNotificationWhenWindowNotOpen()
     QCOMPARE(presentedSpy.last().at(0).toUInt(), (uint)1);
 }
 
+void Ut_NotificationPreviewPresenter::testCreateWindowAheadOfTime()
+{
+    NotificationPreviewPresenter presenter;
+    QSignalSpy changedSpy(&presenter, SIGNAL(notificationChanged()));
+
+    // Check that the window can be created without showing it
+    presenter.createWindowIfNecessary();
+    QCOMPARE(homeWindows.count(), 1);
+    QCOMPARE(homeWindowVisible[homeWindows.first()], false);
+    QCOMPARE(changedSpy.count(), 0);
+
+    // Check that the window is not created again when a notification is shown
+    createNotification(1);
+    presenter.updateNotification(1);
+    QCOMPARE(homeWindows.count(), 1);
+    QCOMPARE(homeWindowVisible[homeWindows.first()], true);
+}
+
 void Ut_NotificationPreviewPresenter::testAddNotificationWhenWindowAlreadyOpen()
 {
     NotificationPreviewPresenter presenter;
@@ -398,7 +456,7 @@ void Ut_NotificationPreviewPresenter::testShowingOnlyCriticalNotifications()
     QCOMPARE(homeWindowVisible.isEmpty(), true);
 
     // When the screen or device is locked and the urgency is not high enough, so the notification shouldn't be shown
-    gQmLocksStub->stubSetReturnValue("getState", MeeGo::QmLocks::Locked);
+    gSystemStateStub->stubSetReturnValue("lockState", MeeGo::QmLocks::Locked);
     presenter.updateNotification(1);
     QCOMPARE(changedSpy.count(), 0);
     QCOMPARE(homeWindowVisible.isEmpty(), true);
@@ -471,8 +529,8 @@ void Ut_NotificationPreviewPresenter::testNotificationNotShownIfTouchScreenIsLoc
     QFETCH(int, notifications);
     QFETCH(int, presentedCount);
 
-    gQmDisplayStateStub->stubSetReturnValue("get", displayState);
-    gQmLocksStub->stubSetReturnValue("getState", lockState);
+    gSystemStateStub->stubSetReturnValue("displayState", displayState);
+    gSystemStateStub->stubSetReturnValue("lockState", lockState);
 
     NotificationPreviewPresenter presenter;
     QSignalSpy changedSpy(&presenter, SIGNAL(notificationChanged()));
@@ -504,45 +562,102 @@ void Ut_NotificationPreviewPresenter::testCriticalNotificationIsClosedAfterShowi
     QCOMPARE(notificationManagerCloseNotificationIds.count(), 1);
 }
 
-QWaylandSurface surface;
+void Ut_NotificationPreviewPresenter::testNotificationsAreShownInPriorityOrder()
+{
+    NotificationPreviewPresenter presenter;
+    QSignalSpy presentedSpy(&presenter, SIGNAL(notificationPresented(uint)));
+
+    // The first notification is shown right away, the rest are queued
+    createNotification(1);
+    createNotification(2);
+    createNotification(3, 1);
+    createNotification(4, 0, 100);
+    createNotification(5, 2);
+    createNotification(6, 1);
+    for (uint id = 1; id <= 6; id++) {
+        presenter.updateNotification(id);
+    }
+    QCOMPARE(presentedSpy.count(), 1);
+
+    // Check that more urgent notifications are shown first, then the ones with a higher priority and then the older ones
+    for (int i = 0; i < 5; i++) {
+        presenter.showNextNotification();
+    }
+    QCOMPARE(presentedSpy.count(), 6);
+    QCOMPARE(presentedSpy.at(1).at(0).toUInt(), (uint)5);
+    QCOMPARE(presentedSpy.at(2).at(0).toUInt(), (uint)3);
+    QCOMPARE(presentedSpy.at(3).at(0).toUInt(), (uint)6);
+    QCOMPARE(presentedSpy.at(4).at(0).toUInt(), (uint)4);
+    QCOMPARE(presentedSpy.at(5).at(0).toUInt(), (uint)2);
+}
+
+void Ut_NotificationPreviewPresenter::testQueuedNotificationsAreCollapsed()
+{
+    NotificationPreviewPresenter presenter;
+    QSignalSpy presentedSpy(&presenter, SIGNAL(notificationPresented(uint)));
+
+    // Show one notification and queue more than fit in the queue
+    createNotification(1);
+    createNotification(2, 0, 0, "x-nemo.chat");
+    createNotification(3, 0, 0, "x-nemo.chat");
+    createNotification(4, 0, 0, "x-nemo.email");
+    createNotification(5, 2, 0, "x-nemo.chat");
+    createNotification(6, 0, 0, "x-nemo.sms");
+    createNotification(7, 0, 0, "x-nemo.chat");
+    for (uint id = 1; id <= 7; id++) {
+        presenter.updateNotification(id);
+    }
+
+    // Removing a collapsed notification should remove it from the summary
+    presenter.removeNotification(3);
+
+    // The critical notification should not be collapsed and is shown first
+    presenter.showNextNotification();
+    QCOMPARE(presenter.notification(), notificationManagerNotification.value(5));
+    QCOMPARE(presentedSpy.count(), 2);
+
+    // The other chat notifications should be shown as a single summary in place of the first one
+    presenter.showNextNotification();
+    QVERIFY(presenter.notification() != 0);
+    QCOMPARE(presenter.notification()->itemCount(), 3);
+    QCOMPARE(presenter.notification()->category(), QString("x-nemo.chat"));
+    QCOMPARE(presentedSpy.count(), 4);
+    QCOMPARE(presentedSpy.at(2).at(0).toUInt(), (uint)2);
+    QCOMPARE(presentedSpy.at(3).at(0).toUInt(), (uint)7);
+
+    presenter.showNextNotification();
+    QCOMPARE(presenter.notification(), notificationManagerNotification.value(4));
+    presenter.showNextNotification();
+    QCOMPARE(presenter.notification(), notificationManagerNotification.value(6));
+    presenter.showNextNotification();
+    QCOMPARE(presenter.notification(), (LipstickNotification *)0);
+}
+
+Q_DECLARE_METATYPE(SystemState::NotificationPreviewMode)
+
 void Ut_NotificationPreviewPresenter::testNotificationPreviewsDisabled_data()
 {
-    QTest::addColumn<QWaylandSurface *>("surface");
-    QTest::addColumn<QVariantMap>("windowProperties");
+    QTest::addColumn<SystemState::NotificationPreviewMode>("mode");
     QTest::addColumn<int>("urgency");
     QTest::addColumn<int>("showCount");
 
-    QVariantMap allNotificationsEnabled;
-    QVariantMap applicationNotificationsDisabled;
-    QVariantMap systemNotificationsDisabled;
-    QVariantMap allNotificationsDisabled;
-    allNotificationsEnabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 0);
-    applicationNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 1);
-    systemNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 2);
-    allNotificationsDisabled.insert("NOTIFICATION_PREVIEWS_DISABLED", 3);
-    QTest::newRow("No surface, application notification") << (QWaylandSurface *)0 << QVariantMap() << 1 << 1;
-    QTest::newRow("Surface, no properties, application notification") << &surface << QVariantMap() << 1 << 1;
-    QTest::newRow("Surface, all notifications enabled, application notification") << &surface << allNotificationsEnabled << 1 << 1;
-    QTest::newRow("Surface, application notifications disabled, application notification") << &surface << applicationNotificationsDisabled << 1 << 0;
-    QTest::newRow("Surface, system notifications disabled, application notification") << &surface << systemNotificationsDisabled << 1 << 1;
-    QTest::newRow("Surface, all notifications disabled, application notification") << &surface << allNotificationsDisabled << 1 << 0;
-    QTest::newRow("No surface, system notification") << (QWaylandSurface *)0 << QVariantMap() << 2 << 1;
-    QTest::newRow("Surface, no properties, system notification") << &surface << QVariantMap() << 2 << 1;
-    QTest::newRow("Surface, all notifications enabled, system notification") << &surface << allNotificationsEnabled << 2 << 1;
-    QTest::newRow("Surface, application notifications disabled, system notification") << &surface << applicationNotificationsDisabled << 2 << 1;
-    QTest::newRow("Surface, system notifications disabled, system notification") << &surface << systemNotificationsDisabled << 2 << 0;
-    QTest::newRow("Surface, all notifications disabled, system notification") << &surface << allNotificationsDisabled << 2 << 0;
+    QTest::newRow("All notifications enabled, application notification") << SystemState::AllNotificationsEnabled << 1 << 1;
+    QTest::newRow("Application notifications disabled, application notification") << SystemState::ApplicationNotificationsDisabled << 1 << 0;
+    QTest::newRow("System notifications disabled, application notification") << SystemState::SystemNotificationsDisabled << 1 << 1;
+    QTest::newRow("All notifications disabled, application notification") << SystemState::AllNotificationsDisabled << 1 << 0;
+    QTest::newRow("All notifications enabled, system notification") << SystemState::AllNotificationsEnabled << 2 << 1;
+    QTest::newRow("Application notifications disabled, system notification") << SystemState::ApplicationNotificationsDisabled << 2 << 1;
+    QTest::newRow("System notifications disabled, system notification") << SystemState::SystemNotificationsDisabled << 2 << 0;
+    QTest::newRow("All notifications disabled, system notification") << SystemState::AllNotificationsDisabled << 2 << 0;
 }
 
 void Ut_NotificationPreviewPresenter::testNotificationPreviewsDisabled()
 {
-    QFETCH(QWaylandSurface *, surface);
-    QFETCH(QVariantMap, windowProperties);
+    QFETCH(SystemState::NotificationPreviewMode, mode);
     QFETCH(int, urgency);
     QFETCH(int, showCount);
 
-    gLipstickCompositorStub->stubSetReturnValue("surfaceForId", surface);
-    qWaylandSurfaceWindowProperties = windowProperties;
+    gSystemStateStub->stubSetReturnValue("notificationPreviewMode", mode);
 
     NotificationPreviewPresenter presenter;
     createNotification(1, urgency);
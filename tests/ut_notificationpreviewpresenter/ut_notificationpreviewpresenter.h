@@ -26,7 +26,9 @@ private slots:
     void initTestCase();
     void cleanup();
     void testSignalConnections();
+    void testModifiedNotificationsOfBatchAreUpdated();
     void testAddNotificationWhenWindowNotOpen();
+    void testCreateWindowAheadOfTime();
     void testAddNotificationWhenWindowAlreadyOpen();
     void testUpdateNotification();
     void testRemoveNotification();
@@ -38,6 +40,8 @@ private slots:
     void testNotificationNotShownIfTouchScreenIsLockedAndDisplayIsOff_data();
     void testNotificationNotShownIfTouchScreenIsLockedAndDisplayIsOff();
     void testCriticalNotificationIsClosedAfterShowing();
+    void testNotificationsAreShownInPriorityOrder();
+    void testQueuedNotificationsAreCollapsed();
     void testNotificationPreviewsDisabled_data();
     void testNotificationPreviewsDisabled();
 };
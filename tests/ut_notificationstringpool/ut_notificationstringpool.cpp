@@ -0,0 +1,88 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include "ut_notificationstringpool.h"
+#include "notificationstringpool.h"
+
+void Ut_NotificationStringPool::testEqualStringsShareData()
+{
+    QString string1 = QString::fromLatin1("x-nemo-preview-body");
+    QString string2 = QString::fromLatin1("x-nemo-preview-body");
+    QVERIFY(string1.constData() != string2.constData());
+
+    QString interned1 = NotificationStringPool::intern(string1);
+    QString interned2 = NotificationStringPool::intern(string2);
+    QCOMPARE(interned1, string1);
+    QCOMPARE(interned2.constData(), interned1.constData());
+    QCOMPARE(interned1.constData(), string1.constData());
+}
+
+void Ut_NotificationStringPool::testEmptyStringsAreNotPooled()
+{
+    int count = NotificationStringPool::count();
+    QCOMPARE(NotificationStringPool::intern(QString()), QString());
+    QCOMPARE(NotificationStringPool::intern(QString("")), QString(""));
+    QCOMPARE(NotificationStringPool::count(), count);
+}
+
+void Ut_NotificationStringPool::testPoolSizeIsLimited()
+{
+    for (int i = NotificationStringPool::count(); i < NotificationStringPool::MAXIMUM_COUNT + 10; i++) {
+        NotificationStringPool::intern(QString("string%1").arg(i));
+    }
+    QCOMPARE(NotificationStringPool::count(), NotificationStringPool::MAXIMUM_COUNT);
+
+    // Strings that don't fit in the pool are returned as is
+    QString string = QString::fromLatin1("not pooled");
+    QCOMPARE(NotificationStringPool::intern(string).constData(), string.constData());
+    QVERIFY(NotificationStringPool::intern(QString::fromLatin1("not pooled")).constData() != string.constData());
+
+    // Strings already in the pool are still shared
+    QString pooled = QString::fromLatin1("x-nemo-preview-body");
+    QVERIFY(NotificationStringPool::intern(pooled).constData() != pooled.constData());
+}
+
+void Ut_NotificationStringPool::testUnreferencedStringsAreEvicted()
+{
+    // Intern unreferenced strings until an eviction has left only the latest one in the pool
+    int internCount = 0;
+    do {
+        NotificationStringPool::intern(QString("unreferenced%1").arg(internCount++));
+    } while (NotificationStringPool::count() != 1 && internCount <= NotificationStringPool::MAXIMUM_COUNT + NotificationStringPool::EVICTION_INTERVAL);
+    QCOMPARE(NotificationStringPool::count(), 1);
+
+    // Fill the pool with strings of which only one is still referenced
+    QString referenced = NotificationStringPool::intern(QString::fromLatin1("referenced"));
+    for (int i = NotificationStringPool::count(); i < NotificationStringPool::MAXIMUM_COUNT; i++) {
+        NotificationStringPool::intern(QString("evicted%1").arg(i));
+    }
+    QCOMPARE(NotificationStringPool::count(), NotificationStringPool::MAXIMUM_COUNT);
+
+    // Check that the unreferenced strings are evicted once enough strings haven't fit in the pool
+    for (int i = 0; i < NotificationStringPool::EVICTION_INTERVAL - 1; i++) {
+        NotificationStringPool::intern(QString("missed%1").arg(i));
+    }
+    QCOMPARE(NotificationStringPool::count(), NotificationStringPool::MAXIMUM_COUNT);
+    QString string = QString::fromLatin1("fits");
+    QCOMPARE(NotificationStringPool::intern(string).constData(), string.constData());
+    QCOMPARE(NotificationStringPool::count(), 2);
+    QCOMPARE(NotificationStringPool::intern(QString::fromLatin1("fits")).constData(), string.constData());
+
+    // Check that the referenced string is still shared
+    QCOMPARE(NotificationStringPool::intern(QString::fromLatin1("referenced")).constData(), referenced.constData());
+}
+
+QTEST_APPLESS_MAIN(Ut_NotificationStringPool)
@@ -0,0 +1,13 @@
+include(../common.pri)
+TARGET = ut_notificationstringpool
+INCLUDEPATH += $$NOTIFICATIONSRCDIR
+
+# unit test and unit
+SOURCES += \
+    ut_notificationstringpool.cpp \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.cpp
+
+# unit test and unit
+HEADERS += \
+    ut_notificationstringpool.h \
+    $$NOTIFICATIONSRCDIR/notificationstringpool.h
@@ -0,0 +1,126 @@
+/***************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd.
+** Contact: Robin Burchell <robin.burchell@jollamobile.com>
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QWaylandSurface>
+#include "systemstate.h"
+#include "ut_systemstate.h"
+#include "lipstickcompositor_stub.h"
+#include "qmlocks_stub.h"
+#include "qmdisplaystate_stub.h"
+
+QWaylandSurface surface;
+QVariantMap qWaylandSurfaceWindowProperties;
+QVariantMap QWaylandSurface::windowProperties() const
+{
+    return qWaylandSurfaceWindowProperties;
+}
+
+void Ut_SystemState::init()
+{
+    systemState = new SystemState;
+}
+
+void Ut_SystemState::cleanup()
+{
+    delete systemState;
+    qWaylandSurfaceWindowProperties.clear();
+    gLipstickCompositorStub->stubReset();
+    gQmLocksStub->stubReset();
+    gQmDisplayStateStub->stubReset();
+}
+
+void Ut_SystemState::testSignalConnections()
+{
+    QCOMPARE(disconnect(systemState->locks, SIGNAL(stateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)), systemState, SLOT(setLockState(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State))), true);
+    QCOMPARE(disconnect(systemState->qmDisplayState, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)), systemState, SLOT(setDisplayState(MeeGo::QmDisplayState::DisplayState))), true);
+}
+
+void Ut_SystemState::testLockStateIsQueriedOnce()
+{
+    QSignalSpy spy(systemState, SIGNAL(lockStateChanged(MeeGo::QmLocks::Lock,MeeGo::QmLocks::State)));
+    gQmLocksStub->stubSetReturnValue("getState", MeeGo::QmLocks::Locked);
+
+    // The state should be queried from the service only the first time
+    QCOMPARE(systemState->lockState(MeeGo::QmLocks::TouchAndKeyboard), MeeGo::QmLocks::Locked);
+    QCOMPARE(systemState->lockState(MeeGo::QmLocks::TouchAndKeyboard), MeeGo::QmLocks::Locked);
+    QCOMPARE(gQmLocksStub->stubCallCount("getState"), 1);
+    QCOMPARE(systemState->ipcCallCount(), (qulonglong)1);
+    QCOMPARE(systemState->ipcCallsAvoided(), (qulonglong)1);
+
+    // Each lock is queried separately
+    QCOMPARE(systemState->lockState(MeeGo::QmLocks::Device), MeeGo::QmLocks::Locked);
+    QCOMPARE(gQmLocksStub->stubCallCount("getState"), 2);
+    QCOMPARE(gQmLocksStub->stubLastCallTo("getState").parameter<MeeGo::QmLocks::Lock>(0), MeeGo::QmLocks::Device);
+
+    // A changed state should be used without querying it
+    systemState->setLockState(MeeGo::QmLocks::TouchAndKeyboard, MeeGo::QmLocks::Unlocked);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(systemState->lockState(MeeGo::QmLocks::TouchAndKeyboard), MeeGo::QmLocks::Unlocked);
+    QCOMPARE(gQmLocksStub->stubCallCount("getState"), 2);
+    QCOMPARE(systemState->ipcCallCount(), (qulonglong)2);
+    QCOMPARE(systemState->ipcCallsAvoided(), (qulonglong)2);
+}
+
+void Ut_SystemState::testDisplayStateIsQueriedOnce()
+{
+    QSignalSpy spy(systemState, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)));
+    gQmDisplayStateStub->stubSetReturnValue("get", MeeGo::QmDisplayState::On);
+
+    // The state should be queried from the service only the first time
+    QCOMPARE(systemState->displayState(), MeeGo::QmDisplayState::On);
+    QCOMPARE(systemState->displayState(), MeeGo::QmDisplayState::On);
+    QCOMPARE(gQmDisplayStateStub->stubCallCount("get"), 1);
+
+    // A changed state should be used without querying it
+    systemState->setDisplayState(MeeGo::QmDisplayState::Off);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(systemState->displayState(), MeeGo::QmDisplayState::Off);
+    QCOMPARE(gQmDisplayStateStub->stubCallCount("get"), 1);
+    QCOMPARE(systemState->ipcCallCount(), (qulonglong)1);
+    QCOMPARE(systemState->ipcCallsAvoided(), (qulonglong)2);
+}
+
+void Ut_SystemState::testNotificationPreviewModeWithoutCompositor()
+{
+    gLipstickCompositorStub->stubSetReturnValue("instance", (LipstickCompositor *)0);
+    QCOMPARE(systemState->notificationPreviewMode(), SystemState::AllNotificationsEnabled);
+}
+
+void Ut_SystemState::testNotificationPreviewModeIsCached()
+{
+    LipstickCompositor compositor;
+    gLipstickCompositorStub->stubSetReturnValue("instance", &compositor);
+    gLipstickCompositorStub->stubSetReturnValue("surfaceForId", &surface);
+    qWaylandSurfaceWindowProperties.insert("NOTIFICATION_PREVIEWS_DISABLED", 1);
+
+    // The mode should be read from the topmost window only the first time
+    QCOMPARE(systemState->notificationPreviewMode(), SystemState::ApplicationNotificationsDisabled);
+    qWaylandSurfaceWindowProperties.insert("NOTIFICATION_PREVIEWS_DISABLED", 3);
+    QCOMPARE(systemState->notificationPreviewMode(), SystemState::ApplicationNotificationsDisabled);
+    QCOMPARE(gLipstickCompositorStub->stubCallCount("surfaceForId"), 1);
+
+    // The mode should be read again when the topmost window changes
+    emit compositor.topmostWindowIdChanged();
+    QCOMPARE(systemState->notificationPreviewMode(), SystemState::AllNotificationsDisabled);
+    QCOMPARE(gLipstickCompositorStub->stubCallCount("surfaceForId"), 2);
+
+    // Without a topmost window all notifications are enabled
+    gLipstickCompositorStub->stubSetReturnValue("surfaceForId", (QWaylandSurface *)0);
+    systemState->invalidateNotificationPreviewMode();
+    QCOMPARE(systemState->notificationPreviewMode(), SystemState::AllNotificationsEnabled);
+}
+
+QTEST_MAIN(Ut_SystemState)
@@ -0,0 +1,18 @@
+include(../common.pri)
+TARGET = ut_systemstate
+INCLUDEPATH += $$SRCDIR $$COMPOSITORSRCDIR /usr/include/qmsystem2-qt5
+QT += qml quick compositor
+
+# unit test and unit
+SOURCES += \
+    ut_systemstate.cpp \
+    $$SRCDIR/systemstate.cpp \
+    $$STUBSDIR/stubbase.cpp
+
+# unit test and unit
+HEADERS += \
+    ut_systemstate.h \
+    $$SRCDIR/systemstate.h \
+    $$COMPOSITORSRCDIR/lipstickcompositor.h \
+    /usr/include/qmsystem2-qt5/qmlocks.h \
+    /usr/include/qmsystem2-qt5/qmdisplaystate.h
@@ -19,7 +19,7 @@
 #include <usbmodeselector.h>
 
 #include "ut_usbmodeselector.h"
-#include "qmlocks_stub.h"
+#include "systemstate_stub.h"
 #include "qmusbmode_stub.h"
 #include "notificationmanager_stub.h"
 #include "closeeventeater_stub.h"
@@ -82,6 +82,10 @@ void HomeWindow::setGeometry(const QRect &)
 {
 }
 
+void HomeWindow::createRootObject()
+{
+}
+
 int argc = 1;
 char *argv[] = { (char *) "./ut_usbmodeselector", NULL };
 
@@ -146,6 +150,21 @@ void Ut_USBModeSelector::testShowDialog()
     QCOMPARE(spy.count(), 1);
 }
 
+void Ut_USBModeSelector::testCreateWindowAheadOfTime()
+{
+    // Check that the window can be created without showing it
+    usbModeSelector->createWindowIfNecessary();
+    QCOMPARE(homeWindows.count(), 1);
+    QCOMPARE(homeWindowVisible[homeWindows.first()], false);
+    QCOMPARE(usbModeSelector->windowVisible(), false);
+
+    // Check that the same window is used when it's shown
+    usbModeSelector->createWindowIfNecessary();
+    usbModeSelector->setWindowVisible(true);
+    QCOMPARE(homeWindows.count(), 1);
+    QCOMPARE(homeWindowVisible[homeWindows.first()], true);
+}
+
 void Ut_USBModeSelector::testHideDialog_data()
 {
     QTest::addColumn<MeeGo::QmUSBMode::Mode>("mode");
@@ -215,7 +234,7 @@ void Ut_USBModeSelector::testConnectingUSBWhenDeviceIsLockedEmitsDialogShown()
     QFETCH(int, dialogShownCount);
 
     QSignalSpy spy(usbModeSelector, SIGNAL(dialogShown()));
-    gQmLocksStub->stubSetReturnValue("getState", deviceLocked);
+    gSystemStateStub->stubSetReturnValue("lockState", deviceLocked);
     usbModeSelector->applyUSBMode(MeeGo::QmUSBMode::Connected);
     QCOMPARE(spy.count(), dialogShownCount);
 }
@@ -40,6 +40,7 @@ private slots:
     void testConnections();
     void testShowDialog_data();
     void testShowDialog();
+    void testCreateWindowAheadOfTime();
     void testHideDialog_data();
     void testHideDialog();
     void testUSBNotifications_data();
@@ -15,7 +15,7 @@ HEADERS += \
     $$NOTIFICATIONSRCDIR/notificationmanager.h \
     $$NOTIFICATIONSRCDIR/lipsticknotification.h \
     $$UTILITYSRCDIR/closeeventeater.h \
-    /usr/include/qmsystem2-qt5/qmlocks.h \
+    $$SRCDIR/systemstate.h \
     /usr/include/qmsystem2-qt5/qmusbmode.h \
     ut_usbmodeselector.h \
     $$SRCDIR/homewindow.h \
@@ -33,6 +33,12 @@ ToolOperation toolOperation = Undefined;
 // The notification ID to use
 uint id = 0;
 
+// All notification IDs given; more than one is only allowed when removing notifications
+QList<uint> ids;
+
+// The number of notifications to add
+int number = 1;
+
 // The icon of the notification
 QString icon;
 
@@ -62,7 +68,8 @@ int usage(const char *program)
     std::cerr << std::setw(7) << "                             add - Adds a new notification." << std::endl;
     std::cerr << std::setw(7) << "                             update - Updates an existing notification." << std::endl;
     std::cerr << std::setw(7) << "                             remove - Removes an existing notification." << std::endl;
-    std::cerr << std::setw(7) << "  -i, --id=ID                The notification ID to use when updating or removing a notification." << std::endl;
+    std::cerr << std::setw(7) << "  -i, --id=ID                The notification ID to use when updating or removing a notification. Can be given several times when removing notifications." << std::endl;
+    std::cerr << std::setw(7) << "  -n, --number=NUMBER        The number of identical notifications to add in a single call." << std::endl;
     std::cerr << std::setw(7) << "  -I, --icon=ICON            Icon for the notification."<< std::endl;
     std::cerr << std::setw(7) << "  -c, --category=CATEGORY    The category of the notification." << std::endl;
     std::cerr << std::setw(7) << "  -C, --count=NUMBER         The number of items represented by the notification." << std::endl;
@@ -72,6 +79,7 @@ int usage(const char *program)
     std::cerr << std::setw(7) << "      --help                 display this help and exit" << std::endl;
     std::cerr << std::setw(7) << std::endl;
     std::cerr << std::setw(7) << "A notification ID is mandatory when the operation is 'update' or 'remove'." << std::endl;
+    std::cerr << std::setw(7) << "When adding several notifications their IDs are printed, one per line." << std::endl;
     std::cerr << std::setw(7) << "The number of items and the timestamp are only used when the operation is 'add' or 'update'." << std::endl;
     return -1;
 }
@@ -84,6 +92,7 @@ int parseArguments(int argc, char *argv[])
         static struct option long_options[] = {
             { "operation", required_argument, NULL, 'o' },
             { "id", required_argument, NULL, 'i' },
+            { "number", required_argument, NULL, 'n' },
             { "icon", required_argument, NULL, 'I' },
             { "category", required_argument, NULL, 'c' },
             { "count", required_argument, NULL, 'C' },
@@ -94,7 +103,7 @@ int parseArguments(int argc, char *argv[])
             { 0, 0, 0, 0 }
         };
 
-        int c = getopt_long(argc, argv, "o:i:I:c:C:t:T:a:h", long_options, &option_index);
+        int c = getopt_long(argc, argv, "o:i:n:I:c:C:t:T:a:h", long_options, &option_index);
         if (c == -1) {
             break;
         }
@@ -111,6 +120,10 @@ int parseArguments(int argc, char *argv[])
             break;
         case 'i':
             id = atoi(optarg);
+            ids.append(id);
+            break;
+        case 'n':
+            number = atoi(optarg);
             break;
         case 'I':
             icon = QString(optarg);
@@ -167,8 +180,10 @@ int parseArguments(int argc, char *argv[])
     if (toolOperation == Undefined ||
             (toolOperation == Add && argc < optind) ||
             (toolOperation == Add && id != 0) ||
+            (toolOperation == Add && number < 1) ||
             (toolOperation == Update && argc < optind) ||
-            (toolOperation == Update && id == 0)) {
+            (toolOperation == Update && id == 0) ||
+            (toolOperation != Remove && ids.count() > 1)) {
         return usage(argv[0]);
     }
     return 0;
@@ -184,6 +199,9 @@ int main(int argc, char *argv[])
 
     QCoreApplication application(argc, argv);
     qDBusRegisterMetaType<QVariantHash>();
+    qDBusRegisterMetaType<NotificationData>();
+    qDBusRegisterMetaType<NotificationList>();
+    qDBusRegisterMetaType<QList<uint> >();
     NotificationManagerProxy proxy("org.freedesktop.Notifications", "/org/freedesktop/Notifications", QDBusConnection::sessionBus());
 
     // Execute the desired operation
@@ -227,11 +245,27 @@ int main(int argc, char *argv[])
         if (!previewBody.isEmpty()) {
             hints.insert(NotificationManager::HINT_PREVIEW_BODY, previewBody);
         }
-        result = proxy.Notify(argv[0], id, icon, summary, body, QStringList(), hints, expireTimeout);
+        if (number > 1) {
+            // Add all the notifications in a single call
+            QList<NotificationData> notifications;
+            for (int i = 0; i < number; i++) {
+                notifications.append(NotificationData(argv[0], 0, icon, summary, body, QStringList(), hints, expireTimeout));
+            }
+            QList<uint> addedIds = proxy.NotifyBatch(NotificationList(notifications));
+            foreach (uint addedId, addedIds) {
+                std::cout << addedId << std::endl;
+            }
+            result = 0;
+        } else {
+            result = proxy.Notify(argv[0], id, icon, summary, body, QStringList(), hints, expireTimeout);
+        }
         break;
     }
     case Remove:
-        if (id > 0) {
+        if (ids.count() > 1) {
+            // Remove all the notifications in a single call
+            proxy.CloseNotifications(ids);
+        } else if (id > 0) {
             proxy.CloseNotification(id);
         }
         break;